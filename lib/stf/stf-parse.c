@@ -693,21 +693,24 @@ stf_parse_csv_line (Source_t *src, StfParseOptions_t *parseoptions)
 			stf_parse_csv_cell (text, src, parseoptions);
 		trim_spaces_inplace (text->str, parseoptions);
 		switch (res) {
+		/* The fields live in the chunk, like the fixed width
+		 * ones, since stf_parse_general_free does not free them.  */
 		case STF_CELL_FIELD_NO_SEP:
-			g_ptr_array_add (line, g_string_free (text, FALSE));
+			g_ptr_array_add (line, g_string_chunk_insert (src->chunk, text->str));
+			g_string_free (text, TRUE);
 			cont = FALSE;
 			break;
 
 		case STF_CELL_FIELD_SEP:
-			g_ptr_array_add (line, g_string_free (text, FALSE));
+			g_ptr_array_add (line, g_string_chunk_insert (src->chunk, text->str));
+			g_string_free (text, TRUE);
 			cont = TRUE;  /* Make sure we see one more field.  */
 			break;
 
 		default:
 			if (cont)
-				g_ptr_array_add (line, g_string_free (text, FALSE));
-			else
-				g_string_free (text, TRUE);
+				g_ptr_array_add (line, g_string_chunk_insert (src->chunk, text->str));
+			g_string_free (text, TRUE);
 			return line;
 		}
 	}
@@ -841,6 +844,61 @@ stf_parse_general (StfParseOptions_t *parseoptions,
 	return lines;
 }
 
+/**
+ * stf_parse_general_partial:
+ *
+ * Like stf_parse_general, but parses at most @maxlines lines and sets
+ * @data_next to where the first line that was not parsed starts.
+ * Unless @at_eof is TRUE, @data up to @data_end is taken to be a piece
+ * of a longer text, and the line running into @data_end is left for
+ * the next call as it may be incomplete.  The text must end in a nul
+ * at @data_end.
+ **/
+GPtrArray *
+stf_parse_general_partial (StfParseOptions_t *parseoptions,
+			   GStringChunk *lines_chunk,
+			   char const *data, char const *data_end,
+			   int maxlines, gboolean at_eof,
+			   char const **data_next)
+{
+	GPtrArray *lines;
+	Source_t src;
+
+	g_return_val_if_fail (parseoptions != NULL, NULL);
+	g_return_val_if_fail (data != NULL, NULL);
+	g_return_val_if_fail (data_end != NULL, NULL);
+	g_return_val_if_fail (data_next != NULL, NULL);
+	g_return_val_if_fail (stf_parse_options_valid (parseoptions), NULL);
+	g_return_val_if_fail (g_utf8_validate (data, data_end - data, NULL), NULL);
+
+	src.chunk = lines_chunk;
+	src.position = data;
+
+	lines = g_ptr_array_new ();
+	while (*src.position != '\0' && src.position < data_end &&
+	       (int) lines->len < maxlines) {
+		char const *line_start = src.position;
+		GPtrArray *line;
+
+		line = parseoptions->parsetype == PARSE_TYPE_CSV
+			? stf_parse_csv_line (&src, parseoptions)
+			: stf_parse_fixed_line (&src, parseoptions);
+		if (parseoptions->parsetype != PARSE_TYPE_CSV)
+			src.position += compare_terminator (src.position, parseoptions);
+
+		if (!at_eof && src.position >= data_end) {
+			/* The rest of it may be in the next piece.  */
+			g_ptr_array_free (line, TRUE);
+			src.position = line_start;
+			break;
+		}
+		g_ptr_array_add (lines, line);
+	}
+
+	*data_next = src.position;
+	return lines;
+}
+
 GPtrArray *
 stf_parse_lines (StfParseOptions_t *parseoptions,
 		 GStringChunk *lines_chunk,
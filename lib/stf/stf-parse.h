@@ -94,6 +94,13 @@ GPtrArray	*stf_parse_general			(StfParseOptions_t *parseoptions,
 							 GStringChunk *lines_chunk,
 							 char const *data,
 							 char const *data_end);
+GPtrArray	*stf_parse_general_partial		(StfParseOptions_t *parseoptions,
+							 GStringChunk *lines_chunk,
+							 char const *data,
+							 char const *data_end,
+							 int maxlines,
+							 gboolean at_eof,
+							 char const **data_next);
 void		 stf_parse_general_free			(GPtrArray *lines);
 GPtrArray	*stf_parse_lines			(StfParseOptions_t *parseoptions,
 							 GStringChunk *lines_chunk,
@@ -167,8 +167,9 @@ static AddressQF* build_shared_quickfill (QofBook *book, const char * key)
     qof_query_destroy(query);
 
     result->listener =
-        qof_event_register_handler (listen_for_gncaddress_events,
-                                    result);
+        qof_event_register_filtered_handler (listen_for_gncaddress_events,
+                result, GNC_ID_ADDRESS,
+                QOF_EVENT_MODIFY | QOF_EVENT_DESTROY);
 
     qof_book_set_data_fin (book, key, result, shared_quickfill_destroy);
 
@@ -1287,6 +1287,7 @@ gnc_dbi_session_end( QofBackend *be_start )
 
     ENTER (" ");
 
+    gnc_sql_finalize_batch( &be->sql_be );
     if ( be->conn != NULL )
     {
         gnc_dbi_unlock( be_start );
@@ -1533,6 +1534,8 @@ gnc_dbi_sync_all( QofBackend* qbe, /*@ dependent @*/ QofBook *book )
 
     ENTER( "book=%p, primary=%p", book, be->primary_book );
 
+    (void)gnc_sql_flush_batch( &be->sql_be );
+
     /* Destroy the current contents of the database */
     dbname = dbi_conn_get_option( be->conn, "dbname" );
     table_name_list = conn->provider->get_table_list( conn->conn, dbname );
@@ -1573,6 +1576,7 @@ gnc_dbi_safe_sync_all( QofBackend *qbe, QofBook *book )
     g_return_if_fail( book != NULL );
 
     ENTER( "book=%p, primary=%p", book, be->primary_book );
+    (void)gnc_sql_flush_batch( &be->sql_be );
     dbname = dbi_conn_get_option( be->conn, "dbname" );
     table_list = conn->provider->get_table_list( conn->conn, dbname );
     if ( !conn_table_operation( (GncSqlConnection*)conn, table_list,
@@ -1921,122 +1925,290 @@ gnc_module_finalize_backend_dbi( void )
 }
 
 /* --------------------------------------------------------- */
+/* A column of a result.  The columns are looked up by name once per
+ * result rather than by libdbi on every access, and each keeps the
+ * GValue handed out for it, which is good until the next row. */
+typedef struct
+{
+    guint idx;                  /* libdbi field index, 1-based */
+    gushort type;
+    guint attrs;
+    GValue value;
+    guint value_row;            /* Row number value belongs to, 0 if none */
+    gchar datetime[32];         /* DATETIME value as YYYYMMDDhhmmss */
+} GncDbiSqlField;
+
+/* The row of a result.  There is only the one, which moves along the
+ * result instead of a new row being allocated for each. */
 typedef struct
 {
     GncSqlRow base;
 
     /*@ dependent @*/
     dbi_result result;
-    GList* gvalue_list;
+    guint row_no;               /* Number of the current row, 1-based */
+    guint num_fields;
+    /*@ only @*/
+    GncDbiSqlField* fields;
+    /*@ only @*/
+    GHashTable* field_index;    /* Column name -> GncDbiSqlField* */
 } GncDbiSqlRow;
 
 static void
 row_dispose( /*@ only @*/ GncSqlRow* row )
 {
     GncDbiSqlRow* dbi_row = (GncDbiSqlRow*)row;
-    GList* node;
+    guint i;
 
-    if ( dbi_row->gvalue_list != NULL )
+    /* The row belongs to the result, so only its values go. */
+    for ( i = 0; i < dbi_row->num_fields; i++ )
     {
-        for ( node = dbi_row->gvalue_list; node != NULL; node = node->next )
+        if ( G_IS_VALUE( &dbi_row->fields[i].value ) )
         {
-            GValue* value;
-            if ( !G_IS_VALUE(node->data) )
-                continue;
-            value = (GValue*)node->data;
-            if ( G_VALUE_HOLDS_STRING(value) )
-            {
-                g_free( (gpointer)g_value_get_string( value ) );
-            }
-            g_free( value );
+            g_value_unset( &dbi_row->fields[i].value );
         }
-        g_list_free( dbi_row->gvalue_list );
+        dbi_row->fields[i].value_row = 0;
     }
-    g_free( dbi_row );
+}
+
+static void
+row_index_fields( GncDbiSqlRow* dbi_row )
+{
+    guint i, num_fields;
+
+    dbi_row->field_index = g_hash_table_new_full( g_str_hash, g_str_equal,
+                           g_free, NULL );
+    num_fields = dbi_result_get_numfields( dbi_row->result );
+    if ( num_fields == DBI_FIELD_ERROR )
+    {
+        PERR( "Error in dbi_result_get_numfields()\n" );
+        return;
+    }
+    dbi_row->num_fields = num_fields;
+    dbi_row->fields = g_new0( GncDbiSqlField, num_fields );
+    for ( i = 0; i < num_fields; i++ )
+    {
+        GncDbiSqlField* field = &dbi_row->fields[i];
+        const gchar* name;
+
+        field->idx = i + 1;
+        field->type = dbi_result_get_field_type_idx( dbi_row->result, field->idx );
+        field->attrs = dbi_result_get_field_attribs_idx( dbi_row->result, field->idx );
+        name = dbi_result_get_field_name( dbi_row->result, field->idx );
+        if ( name != NULL && g_hash_table_lookup( dbi_row->field_index, name ) == NULL )
+        {
+            g_hash_table_insert( dbi_row->field_index, g_strdup( name ), field );
+        }
+    }
+}
+
+static /*@ null @*/ GncDbiSqlField*
+row_find_field( GncDbiSqlRow* dbi_row, const gchar* col_name )
+{
+    GncDbiSqlField* field;
+    guint i;
+
+    if ( dbi_row->field_index == NULL )
+    {
+        row_index_fields( dbi_row );
+    }
+    field = g_hash_table_lookup( dbi_row->field_index, col_name );
+    if ( field != NULL )
+    {
+        return field;
+    }
+
+    /* libdbi matches names regardless of case, so do the same, and
+     * remember the spelling for the next rows. */
+    for ( i = 0; i < dbi_row->num_fields; i++ )
+    {
+        const gchar* name = dbi_result_get_field_name( dbi_row->result, i + 1 );
+        if ( name != NULL && g_ascii_strcasecmp( name, col_name ) == 0 )
+        {
+            field = &dbi_row->fields[i];
+            g_hash_table_insert( dbi_row->field_index, g_strdup( col_name ), field );
+            return field;
+        }
+    }
+    PERR( "Field %s: no such column\n", col_name );
+    return NULL;
+}
+
+static /*@ null @*/ const gchar*
+row_get_datetime( GncDbiSqlRow* dbi_row, GncDbiSqlField* field )
+{
+    time_t time;
+    struct tm tm_struct;
+
+    if ( dbi_result_field_is_null_idx( dbi_row->result, field->idx ) )
+    {
+        return NULL;
+    }
+    time = dbi_result_get_datetime_idx( dbi_row->result, field->idx );
+    (void)gmtime_r( &time, &tm_struct );
+    (void)g_snprintf( field->datetime, sizeof(field->datetime),
+                      "%d%02d%02d%02d%02d%02d",
+                      1900 + tm_struct.tm_year, tm_struct.tm_mon + 1, tm_struct.tm_mday,
+                      tm_struct.tm_hour, tm_struct.tm_min, tm_struct.tm_sec );
+    return field->datetime;
+}
+
+static gboolean
+row_get_decimal( GncDbiSqlRow* dbi_row, GncDbiSqlField* field, gdouble* value )
+{
+    gboolean found = TRUE;
+
+    gnc_push_locale( LC_NUMERIC, "C" );
+    if ( (field->attrs & DBI_DECIMAL_SIZEMASK) == DBI_DECIMAL_SIZE4 )
+    {
+        *value = dbi_result_get_float_idx( dbi_row->result, field->idx );
+    }
+    else if ( (field->attrs & DBI_DECIMAL_SIZEMASK) == DBI_DECIMAL_SIZE8 )
+    {
+        *value = dbi_result_get_double_idx( dbi_row->result, field->idx );
+    }
+    else
+    {
+        PERR( "Field %s: strange decimal length attrs=%d\n",
+              dbi_result_get_field_name( dbi_row->result, field->idx ), field->attrs );
+        found = FALSE;
+    }
+    gnc_pop_locale( LC_NUMERIC );
+    return found;
 }
 
 static /*@ null @*/ const GValue*
 row_get_value_at_col_name( GncSqlRow* row, const gchar* col_name )
 {
     GncDbiSqlRow* dbi_row = (GncDbiSqlRow*)row;
-    gushort type;
-    guint attrs;
+    GncDbiSqlField* field = row_find_field( dbi_row, col_name );
     GValue* value;
-    time_t time;
-    struct tm tm_struct;
+    const gchar* s;
+    gdouble d;
 
-    type = dbi_result_get_field_type( dbi_row->result, col_name );
-    attrs = dbi_result_get_field_attribs( dbi_row->result, col_name );
-    value = g_new0( GValue, 1 );
-    g_assert( value != NULL );
+    if ( field == NULL )
+    {
+        return NULL;
+    }
+    value = &field->value;
+    if ( field->value_row == dbi_row->row_no )
+    {
+        return G_IS_VALUE( value ) ? value : NULL;
+    }
 
-    switch ( type )
+    if ( G_IS_VALUE( value ) )
+    {
+        g_value_unset( value );
+    }
+    field->value_row = dbi_row->row_no;
+    switch ( field->type )
     {
     case DBI_TYPE_INTEGER:
         (void)g_value_init( value, G_TYPE_INT64 );
-        g_value_set_int64( value, dbi_result_get_longlong( dbi_row->result, col_name ) );
+        g_value_set_int64( value, dbi_result_get_longlong_idx( dbi_row->result, field->idx ) );
         break;
     case DBI_TYPE_DECIMAL:
-        gnc_push_locale( LC_NUMERIC, "C" );
-        if ( (attrs & DBI_DECIMAL_SIZEMASK) == DBI_DECIMAL_SIZE4 )
-        {
-            (void)g_value_init( value, G_TYPE_FLOAT );
-            g_value_set_float( value, dbi_result_get_float( dbi_row->result, col_name ) );
-        }
-        else if ( (attrs & DBI_DECIMAL_SIZEMASK) == DBI_DECIMAL_SIZE8 )
-        {
-            (void)g_value_init( value, G_TYPE_DOUBLE );
-            g_value_set_double( value, dbi_result_get_double( dbi_row->result, col_name ) );
-        }
-        else
+        if ( row_get_decimal( dbi_row, field, &d ) )
         {
-            PERR( "Field %s: strange decimal length attrs=%d\n", col_name, attrs );
+            if ( (field->attrs & DBI_DECIMAL_SIZEMASK) == DBI_DECIMAL_SIZE4 )
+            {
+                (void)g_value_init( value, G_TYPE_FLOAT );
+                g_value_set_float( value, (gfloat)d );
+            }
+            else
+            {
+                (void)g_value_init( value, G_TYPE_DOUBLE );
+                g_value_set_double( value, d );
+            }
         }
-        gnc_pop_locale( LC_NUMERIC );
         break;
     case DBI_TYPE_STRING:
+        /* The string belongs to the result. */
         (void)g_value_init( value, G_TYPE_STRING );
-        g_value_take_string( value, dbi_result_get_string_copy( dbi_row->result, col_name ) );
+        g_value_set_static_string( value, dbi_result_get_string_idx( dbi_row->result, field->idx ) );
         break;
     case DBI_TYPE_DATETIME:
-        if ( dbi_result_field_is_null( dbi_row->result, col_name ) )
-        {
-            return NULL;
-        }
-        else
+        s = row_get_datetime( dbi_row, field );
+        if ( s != NULL )
         {
-            time = dbi_result_get_datetime( dbi_row->result, col_name );
-            (void)gmtime_r( &time, &tm_struct );
             (void)g_value_init( value, G_TYPE_STRING );
-            g_value_take_string( value,
-                                 g_strdup_printf( "%d%02d%02d%02d%02d%02d",
-                                                  1900 + tm_struct.tm_year, tm_struct.tm_mon + 1, tm_struct.tm_mday,
-                                                  tm_struct.tm_hour, tm_struct.tm_min, tm_struct.tm_sec ) );
+            g_value_set_static_string( value, s );
         }
         break;
     default:
-        PERR( "Field %s: unknown DBI_TYPE: %d\n", col_name, type );
-        g_free( value );
-        return NULL;
+        PERR( "Field %s: unknown DBI_TYPE: %d\n", col_name, field->type );
+        break;
+    }
+
+    return G_IS_VALUE( value ) ? value : NULL;
+}
+
+static gboolean
+row_get_int64_at_col_name( GncSqlRow* row, const gchar* col_name, gint64* value )
+{
+    GncDbiSqlRow* dbi_row = (GncDbiSqlRow*)row;
+    GncDbiSqlField* field = row_find_field( dbi_row, col_name );
+    const GValue* val;
+
+    if ( field != NULL && field->type == DBI_TYPE_INTEGER )
+    {
+        *value = dbi_result_get_longlong_idx( dbi_row->result, field->idx );
+        return TRUE;
     }
 
-    dbi_row->gvalue_list = g_list_prepend( dbi_row->gvalue_list, value );
-    return value;
+    /* Anything else converts the way gnc_sql_get_integer_value does. */
+    val = (field != NULL) ? row_get_value_at_col_name( row, col_name ) : NULL;
+    if ( val == NULL )
+    {
+        return FALSE;
+    }
+    *value = gnc_sql_get_integer_value( val );
+    return TRUE;
 }
 
-static GncSqlRow*
-create_dbi_row( /*@ dependent @*/ dbi_result result )
+static gboolean
+row_get_double_at_col_name( GncSqlRow* row, const gchar* col_name, gdouble* value )
 {
-    GncDbiSqlRow* row;
+    GncDbiSqlRow* dbi_row = (GncDbiSqlRow*)row;
+    GncDbiSqlField* field = row_find_field( dbi_row, col_name );
 
-    row = g_new0( GncDbiSqlRow, 1 );
-    g_assert( row != NULL );
+    if ( field == NULL )
+    {
+        return FALSE;
+    }
+    switch ( field->type )
+    {
+    case DBI_TYPE_DECIMAL:
+        return row_get_decimal( dbi_row, field, value );
+    case DBI_TYPE_INTEGER:
+        *value = (gdouble)dbi_result_get_longlong_idx( dbi_row->result, field->idx );
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
 
-    row->base.getValueAtColName = row_get_value_at_col_name;
-    row->base.dispose = row_dispose;
-    row->result = result;
+static gboolean
+row_get_string_at_col_name( GncSqlRow* row, const gchar* col_name, const gchar** value )
+{
+    GncDbiSqlRow* dbi_row = (GncDbiSqlRow*)row;
+    GncDbiSqlField* field = row_find_field( dbi_row, col_name );
 
-    return (GncSqlRow*)row;
+    if ( field == NULL )
+    {
+        return FALSE;
+    }
+    switch ( field->type )
+    {
+    case DBI_TYPE_STRING:
+        *value = dbi_result_get_string_idx( dbi_row->result, field->idx );
+        return TRUE;
+    case DBI_TYPE_DATETIME:
+        *value = row_get_datetime( dbi_row, field );
+        return *value != NULL;
+    default:
+        return FALSE;
+    }
 }
 /* --------------------------------------------------------- */
 typedef struct
@@ -2049,7 +2221,7 @@ typedef struct
     dbi_result result;
     guint num_rows;
     guint cur_row;
-    GncSqlRow* row;
+    GncDbiSqlRow row;
 } GncDbiSqlResult;
 
 static void
@@ -2057,9 +2229,11 @@ result_dispose( /*@ only @*/ GncSqlResult* result )
 {
     GncDbiSqlResult* dbi_result = (GncDbiSqlResult*)result;
 
-    if ( dbi_result->row != NULL )
+    gnc_sql_row_dispose( &dbi_result->row.base );
+    g_free( dbi_result->row.fields );
+    if ( dbi_result->row.field_index != NULL )
     {
-        gnc_sql_row_dispose( dbi_result->row );
+        g_hash_table_destroy( dbi_result->row.field_index );
     }
     if ( dbi_result->result != NULL )
     {
@@ -2088,11 +2262,6 @@ result_get_first_row( GncSqlResult* result )
 {
     GncDbiSqlResult* dbi_result = (GncDbiSqlResult*)result;
 
-    if ( dbi_result->row != NULL )
-    {
-        gnc_sql_row_dispose( dbi_result->row );
-        dbi_result->row = NULL;
-    }
     if ( dbi_result->num_rows > 0 )
     {
         gint status = dbi_result_first_row( dbi_result->result );
@@ -2102,8 +2271,9 @@ result_get_first_row( GncSqlResult* result )
             qof_backend_set_error( dbi_result->dbi_conn->qbe, ERR_BACKEND_SERVER_ERR );
         }
         dbi_result->cur_row = 1;
-        dbi_result->row = create_dbi_row( dbi_result->result );
-        return dbi_result->row;
+        /* The values of the row before are stale now. */
+        dbi_result->row.row_no++;
+        return &dbi_result->row.base;
     }
     else
     {
@@ -2116,11 +2286,6 @@ result_get_next_row( GncSqlResult* result )
 {
     GncDbiSqlResult* dbi_result = (GncDbiSqlResult*)result;
 
-    if ( dbi_result->row != NULL )
-    {
-        gnc_sql_row_dispose( dbi_result->row );
-        dbi_result->row = NULL;
-    }
     if ( dbi_result->cur_row < dbi_result->num_rows )
     {
         gint status = dbi_result_next_row( dbi_result->result );
@@ -2130,8 +2295,8 @@ result_get_next_row( GncSqlResult* result )
             qof_backend_set_error( dbi_result->dbi_conn->qbe, ERR_BACKEND_SERVER_ERR );
         }
         dbi_result->cur_row++;
-        dbi_result->row = create_dbi_row( dbi_result->result );
-        return dbi_result->row;
+        dbi_result->row.row_no++;
+        return &dbi_result->row.base;
     }
     else
     {
@@ -2156,6 +2321,14 @@ create_dbi_result( /*@ observer @*/ GncDbiSqlConnection* dbi_conn, /*@ owned @*/
     dbi_result->cur_row = 0;
     dbi_result->dbi_conn = dbi_conn;
 
+    /* The fields are looked up when the first value is asked for. */
+    dbi_result->row.base.getValueAtColName = row_get_value_at_col_name;
+    dbi_result->row.base.getInt64AtColName = row_get_int64_at_col_name;
+    dbi_result->row.base.getDoubleAtColName = row_get_double_at_col_name;
+    dbi_result->row.base.getStringAtColName = row_get_string_at_col_name;
+    dbi_result->row.base.dispose = row_dispose;
+    dbi_result->row.result = result;
+
     return (GncSqlResult*)dbi_result;
 }
 /* --------------------------------------------------------- */
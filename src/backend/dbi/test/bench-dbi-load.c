@@ -0,0 +1,114 @@
+/***************************************************************************
+ *            bench-dbi-load.c
+ *
+ *  Time the bulk and the generic load of the transactions of a
+ *  dbi/sqlite3 db
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file bench-dbi-load.c
+ * @brief Print the timings of the loads test-dbi-load compares.
+ *
+ * This is not run by "make check".  Pass a transaction count to time
+ * a bigger database, e.g. "bench-dbi-load 1000000".
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "qof.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+#include "test-dbi-stuff.h"
+
+#include "TransLog.h"
+#include "Account.h"
+#include "gnc-commodity.h"
+#include "gnc-transaction-sql.h"
+
+#define GNC_LIB_NAME "gncmod-backend-dbi"
+#define DEFAULT_TRANSACTIONS 200000
+#define NUM_ACCOUNTS 10
+
+static QofSession*
+create_session( guint count )
+{
+    QofSession* session = qof_session_new();
+    QofBook* book = qof_session_get_book( session );
+    gnc_commodity* currency;
+
+    currency = gnc_commodity_table_lookup( gnc_commodity_table_get_table( book ),
+                                           GNC_COMMODITY_NS_CURRENCY, "CAD" );
+    g_ptr_array_free( make_test_book_transactions( book, currency, NUM_ACCOUNTS, count ),
+                      TRUE );
+    return session;
+}
+
+static gdouble
+time_load( const gchar* url, gboolean bulk )
+{
+    QofSession* session = qof_session_new();
+    GTimer* timer = g_timer_new();
+    gdouble seconds;
+
+    gnc_sql_transaction_set_bulk_load( bulk );
+    qof_session_begin( session, url, TRUE, FALSE, FALSE );
+    qof_session_load( session, NULL );
+    seconds = g_timer_elapsed( timer, NULL );
+    g_timer_destroy( timer );
+    if ( qof_session_get_error( session ) != ERR_BACKEND_NO_ERR )
+        g_warning( "Session Error: %s", qof_session_get_error_message( session ) );
+    qof_session_end( session );
+    qof_session_destroy( session );
+    return seconds;
+}
+
+int main( int argc, char** argv )
+{
+    guint count = DEFAULT_TRANSACTIONS;
+    gchar* filename;
+    gchar* url;
+    gdouble generic_time, bulk_time;
+
+    if ( argc > 1 )
+        count = MAX( atoi( argv[1] ), 1 );
+
+    qof_init();
+    cashobjects_register();
+    xaccLogDisable();
+    qof_load_backend_library( "../.libs/", GNC_LIB_NAME );
+
+    filename = tempnam( "/tmp", "bench-sqlite3-" );
+    url = g_strdup_printf( "sqlite3://%s", filename );
+    if ( test_dbi_save_session( create_session( count ), url ) )
+    {
+        generic_time = time_load( url, FALSE );
+        bulk_time = time_load( url, TRUE );
+        printf( "%8u transactions: generic load %10.3f s, bulk load %10.3f s\n",
+                count, generic_time, bulk_time );
+    }
+    (void)unlink( filename );
+    g_free( url );
+    free( filename );
+
+    qof_close();
+    return 0;
+}
@@ -0,0 +1,172 @@
+/***************************************************************************
+ *            test-dbi-batch.c
+ *
+ *  Check that the write batch of a dbi/sqlite3 db is written as a whole
+ *  or not at all
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-dbi-batch.c
+ * @brief Commit objects to an sqlite3 book and flush them.
+ *
+ * Two accounts and a transaction between them are committed to a
+ * loaded book, and the account is committed again.  Nothing may be in
+ * the database before the flush.  The splits table is then moved out
+ * of the way, so that the flush fails half way through: the accounts
+ * written before the splits have to be rolled back with them, and all
+ * the objects and the book have to be dirty again.  Once the table is
+ * back, the next flush writes everything, once, and leaves the objects
+ * and the book clean.  No main loop runs, so nothing but the flushes
+ * may write.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "qof.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+#include "test-dbi-stuff.h"
+
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-backend-sql.h"
+
+#define GNC_LIB_NAME "gncmod-backend-dbi"
+
+static guint
+count_rows( GncSqlBackend* be, const gchar* table, const gchar* column,
+            QofInstance* inst )
+{
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+    gchar* sql;
+    GncSqlResult* result;
+    guint count = 0;
+
+    (void)guid_to_string_buff( qof_instance_get_guid( inst ), guid_buf );
+    sql = g_strdup_printf( "SELECT * FROM %s WHERE %s='%s'", table, column, guid_buf );
+    result = gnc_sql_execute_select_sql( be, sql );
+    g_free( sql );
+    if ( result != NULL )
+    {
+        count = gnc_sql_result_get_num_rows( result );
+        gnc_sql_result_dispose( result );
+    }
+    return count;
+}
+
+static void
+test_batch( GncSqlBackend* be, QofBook* book )
+{
+    gnc_commodity* currency;
+    Account* from;
+    Account* to;
+    Transaction* trans;
+
+    currency = gnc_commodity_table_lookup( gnc_commodity_table_get_table( book ),
+                                           GNC_COMMODITY_NS_CURRENCY, "CAD" );
+    from = make_test_account( book, NULL, ACCT_TYPE_BANK, currency, "From" );
+    to = make_test_account( book, NULL, ACCT_TYPE_BANK, currency, "To" );
+    trans = make_test_transaction( book, from, to, TEST_BOOK_START,
+                                   gnc_numeric_create( 1234, 100 ) );
+    xaccTransCommitEdit( trans );
+    xaccAccountBeginEdit( from );
+    xaccAccountSetDescription( from, "Changed after the transaction" );
+    xaccAccountCommitEdit( from );
+
+    do_test( count_rows( be, "accounts", "guid", QOF_INSTANCE(from) ) == 0
+             && count_rows( be, "transactions", "guid", QOF_INSTANCE(trans) ) == 0,
+             "Nothing written before the flush" );
+    do_test( qof_book_not_saved( book ), "Book unsaved before the flush" );
+
+    /* Make the flush fail at the splits, after the accounts. */
+    (void)gnc_sql_execute_nonselect_sql( be, "ALTER TABLE splits RENAME TO splits_aside" );
+    do_test( !gnc_sql_flush_batch( be ), "Flush fails without the splits table" );
+    (void)qof_backend_get_error( (QofBackend*)be );
+    do_test( count_rows( be, "accounts", "guid", QOF_INSTANCE(from) ) == 0
+             && count_rows( be, "accounts", "guid", QOF_INSTANCE(to) ) == 0
+             && count_rows( be, "transactions", "guid", QOF_INSTANCE(trans) ) == 0,
+             "Failed flush rolled back" );
+    do_test( qof_instance_get_dirty_flag( from ) && qof_instance_get_dirty_flag( to )
+             && qof_instance_get_dirty_flag( trans ),
+             "Failed flush left the objects dirty" );
+    do_test( qof_book_not_saved( book ), "Failed flush left the book unsaved" );
+
+    (void)gnc_sql_execute_nonselect_sql( be, "ALTER TABLE splits_aside RENAME TO splits" );
+    do_test( gnc_sql_flush_batch( be ), "Flush succeeds with the splits table back" );
+    do_test( count_rows( be, "accounts", "guid", QOF_INSTANCE(from) ) == 1
+             && count_rows( be, "accounts", "guid", QOF_INSTANCE(to) ) == 1,
+             "Accounts written once" );
+    do_test( count_rows( be, "transactions", "guid", QOF_INSTANCE(trans) ) == 1
+             && count_rows( be, "splits", "tx_guid", QOF_INSTANCE(trans) ) == 2,
+             "Transaction and splits written once" );
+    do_test( !qof_instance_get_dirty_flag( from ) && !qof_instance_get_dirty_flag( to )
+             && !qof_instance_get_dirty_flag( trans ),
+             "Flush left the objects clean" );
+    do_test( !qof_book_not_saved( book ), "Flush left the book saved" );
+}
+
+int main( int argc, char** argv )
+{
+    gchar* filename;
+    gchar* url;
+    QofSession* session;
+
+    qof_init();
+    cashobjects_register();
+    xaccLogDisable();
+    qof_load_backend_library( "../.libs/", GNC_LIB_NAME );
+
+    filename = tempnam( "/tmp", "test-sqlite3-" );
+    url = g_strdup_printf( "sqlite3://%s", filename );
+    printf( "Using filename: %s\n", filename );
+    if ( !test_dbi_save_session( qof_session_new(), url ) )
+    {
+        do_test( FALSE, "DB Session Save Failed" );
+    }
+    else
+    {
+        QofBook* book;
+        GncSqlBackend* be;
+
+        session = qof_session_new();
+        qof_session_begin( session, url, TRUE, FALSE, FALSE );
+        qof_session_load( session, NULL );
+        book = qof_session_get_book( session );
+        be = (GncSqlBackend*)qof_book_get_backend( book );
+        do_test( be != NULL, "DB Session Load" );
+        if ( be != NULL )
+        {
+            test_batch( be, book );
+        }
+        qof_session_end( session );
+        qof_session_destroy( session );
+    }
+    (void)unlink( filename );
+    g_free( url );
+    free( filename );
+
+    print_test_results();
+    qof_close();
+    exit( get_rv() );
+}
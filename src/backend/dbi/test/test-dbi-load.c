@@ -0,0 +1,147 @@
+/***************************************************************************
+ *            test-dbi-load.c
+ *
+ *  Compare the bulk and the generic load of the transactions of a
+ *  dbi/sqlite3 db
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-dbi-load.c
+ * @brief Load the same synthetic database both ways.
+ *
+ * A book with a few accounts and balanced two-split transactions, some
+ * of them with slots, is saved to a sqlite3 file.  The file is then
+ * loaded once through the generic column-table code and once through
+ * the bulk load, and the two books have to hold the same transactions.
+ * bench-dbi-load times both loads.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "qof.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+#include "test-dbi-stuff.h"
+
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "Split.h"
+#include "gnc-commodity.h"
+#include "gnc-transaction-sql.h"
+
+#define GNC_LIB_NAME "gncmod-backend-dbi"
+#define NUM_TRANSACTIONS 2000
+#define NUM_ACCOUNTS 10
+
+static QofSession*
+create_session( guint count )
+{
+    QofSession* session = qof_session_new();
+    QofBook* book = qof_session_get_book( session );
+    gnc_commodity* currency;
+
+    currency = gnc_commodity_table_lookup( gnc_commodity_table_get_table( book ),
+                                           GNC_COMMODITY_NS_CURRENCY, "CAD" );
+    g_ptr_array_free( make_test_book_transactions( book, currency, NUM_ACCOUNTS, count ),
+                      TRUE );
+    return session;
+}
+
+static QofSession*
+load_session( const gchar* url, gboolean bulk )
+{
+    QofSession* session = qof_session_new();
+
+    gnc_sql_transaction_set_bulk_load( bulk );
+    qof_session_begin( session, url, TRUE, FALSE, FALSE );
+    qof_session_load( session, NULL );
+    if ( qof_session_get_error( session ) != ERR_BACKEND_NO_ERR )
+    {
+        g_warning( "Session Error: %s", qof_session_get_error_message( session ) );
+        do_test( FALSE, "DB Session Load Failed" );
+    }
+    return session;
+}
+
+static void
+compare_single_tx( QofInstance* inst, gpointer user_data )
+{
+    CompareInfoStruct* info = (CompareInfoStruct*)user_data;
+    Transaction* tx_1 = GNC_TRANS(inst);
+    Transaction* tx_2 = xaccTransLookup( qof_instance_get_guid( inst ), info->book_2 );
+
+    if ( !xaccTransEqual( tx_1, tx_2, TRUE, TRUE, TRUE, FALSE ) )
+    {
+        info->result = FALSE;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    gchar* filename;
+    gchar* url;
+    QofSession* generic;
+    QofSession* bulk;
+    QofBook* book_1;
+    QofBook* book_2;
+
+    qof_init();
+    cashobjects_register();
+    xaccLogDisable();
+    qof_load_backend_library( "../.libs/", GNC_LIB_NAME );
+
+    filename = tempnam( "/tmp", "test-sqlite3-" );
+    url = g_strdup_printf( "sqlite3://%s", filename );
+    printf( "Using filename: %s\n", filename );
+    if ( !test_dbi_save_session( create_session( NUM_TRANSACTIONS ), url ) )
+    {
+        do_test( FALSE, "DB Session Save Failed" );
+    }
+    else
+    {
+        generic = load_session( url, FALSE );
+        bulk = load_session( url, TRUE );
+        book_1 = qof_session_get_book( generic );
+        book_2 = qof_session_get_book( bulk );
+
+        do_test( qof_collection_count( qof_book_get_collection( book_2, GNC_ID_TRANS ) ) == NUM_TRANSACTIONS,
+                 "All transactions loaded" );
+        do_test( qof_collection_count( qof_book_get_collection( book_1, GNC_ID_SPLIT ) )
+                 == qof_collection_count( qof_book_get_collection( book_2, GNC_ID_SPLIT ) ),
+                 "Split counts match" );
+        do_compare( book_1, book_2, GNC_ID_TRANS, compare_single_tx, "Transaction lists match" );
+        do_compare( book_2, book_1, GNC_ID_TRANS, compare_single_tx, "Transaction lists match" );
+
+        qof_session_end( generic );
+        qof_session_destroy( generic );
+        qof_session_end( bulk );
+        qof_session_destroy( bulk );
+    }
+    (void)unlink( filename );
+    g_free( url );
+    free( filename );
+
+    print_test_results();
+    qof_close();
+    exit( get_rv() );
+}
@@ -0,0 +1,197 @@
+/***************************************************************************
+ *            test-dbi-row.c
+ *
+ *  Check the typed column accessors of the rows of a dbi/sqlite3 db
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-dbi-row.c
+ * @brief Read the columns of a small table through the typed accessors.
+ *
+ * A table with an integer, a double, a text and a date column is added
+ * to an empty sqlite3 book, with one row of values and one of NULLs.
+ * The typed accessors have to agree with getValueAtColName, read an
+ * integer as a double and a date as a string, refuse a column of
+ * another type, and find the columns whatever the case of their names.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "qof.h"
+#include "cashobjects.h"
+#include "test-stuff.h"
+#include "test-dbi-stuff.h"
+
+#include "TransLog.h"
+#include "gnc-backend-sql.h"
+
+#define GNC_LIB_NAME "gncmod-backend-dbi"
+
+static const gchar* create_sql =
+    "CREATE TABLE test_row (id integer, an_int integer, a_double float8, "
+    "a_text text, a_date TIMESTAMP)";
+static const gchar* insert_sql[] =
+{
+    "INSERT INTO test_row VALUES (1, 42, 2.5, 'Text', '2010-01-02 03:04:05')",
+    "INSERT INTO test_row VALUES (2, NULL, NULL, NULL, NULL)",
+    NULL
+};
+static const gchar* select_sql = "SELECT * FROM test_row ORDER BY id";
+
+static void
+test_value_row( GncSqlRow* row )
+{
+    gint64 i_value = 0;
+    gdouble d_value = 0;
+    const gchar* s = NULL;
+
+    do_test( gnc_sql_row_get_int64_at_col_name( row, "an_int", &i_value ) && i_value == 42,
+             "Integer as an integer" );
+    do_test( gnc_sql_row_get_double_at_col_name( row, "an_int", &d_value ) && d_value == 42.0,
+             "Integer as a double" );
+    do_test( gnc_sql_row_get_double_at_col_name( row, "a_double", &d_value ) && d_value == 2.5,
+             "Double as a double" );
+    do_test( gnc_sql_row_get_string_at_col_name( row, "a_text", &s )
+             && s != NULL && strcmp( s, "Text" ) == 0,
+             "Text as a string" );
+    do_test( gnc_sql_row_get_string_at_col_name( row, "a_date", &s )
+             && s != NULL && strcmp( s, "20100102030405" ) == 0,
+             "Date as a string" );
+    do_test( !gnc_sql_row_get_double_at_col_name( row, "a_text", &d_value ),
+             "No double from text" );
+    do_test( !gnc_sql_row_get_string_at_col_name( row, "an_int", &s ),
+             "No string from an integer" );
+    do_test( !gnc_sql_row_get_int64_at_col_name( row, "no_such_column", &i_value )
+             && !gnc_sql_row_get_double_at_col_name( row, "no_such_column", &d_value )
+             && !gnc_sql_row_get_string_at_col_name( row, "no_such_column", &s ),
+             "No value from a missing column" );
+
+    /* Names that differ only in case find the same columns. */
+    do_test( gnc_sql_row_get_int64_at_col_name( row, "AN_INT", &i_value ) && i_value == 42,
+             "Integer by upper case name" );
+    do_test( gnc_sql_row_get_string_at_col_name( row, "A_Text", &s )
+             && s != NULL && strcmp( s, "Text" ) == 0,
+             "Text by mixed case name" );
+    do_test( gnc_sql_row_get_value_at_col_name( row, "A_DATE" ) != NULL,
+             "Value by upper case name" );
+}
+
+static void
+test_null_row( GncSqlRow* row )
+{
+    const GValue* val;
+    gint64 i_value = -1;
+    gdouble d_value = -1;
+    const gchar* s = "";
+
+    /* NULL integers and doubles read as 0 the way their GValues do. */
+    val = gnc_sql_row_get_value_at_col_name( row, "an_int" );
+    do_test( gnc_sql_row_get_int64_at_col_name( row, "an_int", &i_value )
+             && val != NULL && i_value == gnc_sql_get_integer_value( val ),
+             "NULL integer matches its value" );
+    do_test( gnc_sql_row_get_double_at_col_name( row, "a_double", &d_value ) && d_value == 0,
+             "NULL double is 0" );
+
+    /* NULL text is a NULL string, a NULL date no value at all. */
+    do_test( gnc_sql_row_get_string_at_col_name( row, "a_text", &s ) && s == NULL,
+             "NULL text is a NULL string" );
+    do_test( !gnc_sql_row_get_string_at_col_name( row, "a_date", &s )
+             && gnc_sql_row_get_value_at_col_name( row, "a_date" ) == NULL,
+             "NULL date has no value" );
+}
+
+static void
+test_rows( GncSqlBackend* be )
+{
+    GncSqlResult* result;
+    GncSqlRow* row;
+    gint i;
+
+    for ( i = 0; insert_sql[i] != NULL; i++ )
+    {
+        (void)gnc_sql_execute_nonselect_sql( be, insert_sql[i] );
+    }
+    result = gnc_sql_execute_select_sql( be, select_sql );
+    if ( result == NULL )
+    {
+        do_test( FALSE, "Select failed" );
+        return;
+    }
+    row = gnc_sql_result_get_first_row( result );
+    do_test( row != NULL, "First row" );
+    if ( row != NULL )
+    {
+        test_value_row( row );
+        row = gnc_sql_result_get_next_row( result );
+        do_test( row != NULL, "Second row" );
+        if ( row != NULL )
+        {
+            test_null_row( row );
+        }
+    }
+    gnc_sql_result_dispose( result );
+}
+
+int main( int argc, char** argv )
+{
+    gchar* filename;
+    gchar* url;
+    QofSession* session;
+
+    qof_init();
+    cashobjects_register();
+    xaccLogDisable();
+    qof_load_backend_library( "../.libs/", GNC_LIB_NAME );
+
+    filename = tempnam( "/tmp", "test-sqlite3-" );
+    url = g_strdup_printf( "sqlite3://%s", filename );
+    printf( "Using filename: %s\n", filename );
+    if ( !test_dbi_save_session( qof_session_new(), url ) )
+    {
+        do_test( FALSE, "DB Session Save Failed" );
+    }
+    else
+    {
+        GncSqlBackend* be;
+
+        session = qof_session_new();
+        qof_session_begin( session, url, TRUE, FALSE, FALSE );
+        qof_session_load( session, NULL );
+        be = (GncSqlBackend*)qof_book_get_backend( qof_session_get_book( session ) );
+        do_test( be != NULL, "DB Session Load" );
+        if ( be != NULL )
+        {
+            do_test( gnc_sql_execute_nonselect_sql( be, create_sql ) != -1,
+                     "Create table" );
+            test_rows( be );
+        }
+        qof_session_end( session );
+        qof_session_destroy( session );
+    }
+    (void)unlink( filename );
+    g_free( url );
+    free( filename );
+
+    print_test_results();
+    qof_close();
+    exit( get_rv() );
+}
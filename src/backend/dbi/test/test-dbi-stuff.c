@@ -217,6 +217,32 @@ test_dbi_store_and_reload( const gchar* driver, QofSession* session_1, const gch
     qof_session_destroy( session_3 );
 }
 
+gboolean
+test_dbi_save_session( QofSession* session_1, const gchar* url )
+{
+    QofSession* session_2 = qof_session_new();
+    gboolean ok = FALSE;
+
+    qof_session_begin( session_2, url, FALSE, TRUE, TRUE );
+    if ( qof_session_get_error( session_2 ) != ERR_BACKEND_NO_ERR )
+    {
+        g_warning( "Session Error: %s", qof_session_get_error_message( session_2 ) );
+    }
+    else
+    {
+        qof_session_swap_data( session_1, session_2 );
+        qof_session_save( session_2, NULL );
+        ok = ( qof_session_get_error( session_2 ) == ERR_BACKEND_NO_ERR );
+        if ( !ok )
+            g_warning( "Session Error: %s", qof_session_get_error_message( session_2 ) );
+    }
+    qof_session_end( session_1 );
+    qof_session_destroy( session_1 );
+    qof_session_end( session_2 );
+    qof_session_destroy( session_2 );
+    return ok;
+}
+
 /* Given an already-created url (yeah, bad testing practice: Should
  * start fresh from a synthetic session) load and safe-save it, then
  * load it again into a new session and compare the two. Since
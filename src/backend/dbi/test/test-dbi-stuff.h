@@ -44,6 +44,16 @@ void do_compare( QofBook* book_1, QofBook* book_2, const gchar* id, QofInstanceF
  */
 void test_dbi_store_and_reload( const gchar* driver, QofSession* session_1, const gchar* url );
 
+/**
+ * Save the contents of a session to a new db the way QofSession::save_as
+ * does.  The session is ended and destroyed.
+ *
+ * @param session_1 Session to save
+ * @param url Database URL
+ * @return FALSE if the db could not be created or written
+ */
+gboolean test_dbi_save_session( QofSession* session_1, const gchar* url );
+
 /** Test the safe_save mechanism.  Beware that this test used on its
  * own doesn't ensure that the resave is done safely, only that the
  * database is intact and unchanged after the save. To observe the
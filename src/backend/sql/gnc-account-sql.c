@@ -345,7 +345,7 @@ gnc_sql_save_account( GncSqlBackend* be, QofInstance* inst )
 
     ENTER( "inst=%p", inst );
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
 
     // If there is no commodity yet, this might be because a new account name
     // has been entered directly into the register and an account window will
@@ -88,6 +88,7 @@ static void update_progress( GncSqlBackend* be );
 static void finish_progress( GncSqlBackend* be );
 static void register_standard_col_type_handlers( void );
 static gboolean reset_version_info( GncSqlBackend* be );
+static void batch_clear( GncSqlBackend* be );
 /*@ null @*/
 static GncSqlStatement* build_insert_statement( GncSqlBackend* be,
         const gchar* table_name,
@@ -225,6 +226,7 @@ gnc_sql_load( GncSqlBackend* be, /*@ dependent @*/ QofBook *book, QofBackendLoad
 
     ENTER( "be=%p, book=%p", be, book );
 
+    (void)gnc_sql_flush_batch( be );
     be->loading = TRUE;
 
     if ( loadType == LOAD_TYPE_INITIAL_LOAD )
@@ -493,6 +495,7 @@ gnc_sql_sync_all( GncSqlBackend* be, /*@ dependent @*/ QofBook *book )
     g_return_if_fail( book != NULL );
 
     ENTER( "book=%p, be->book=%p", book, be->book );
+    (void)gnc_sql_flush_batch( be );
     update_progress( be );
     (void)reset_version_info( be );
     gnc_sql_set_table_version( be, "Gnucash", gnc_get_long_version() );
@@ -544,6 +547,7 @@ gnc_sql_sync_all( GncSqlBackend* be, /*@ dependent @*/ QofBook *book )
     if ( is_ok )
     {
         be->is_pristine_db = FALSE;
+        batch_clear( be );
 
         // Mark the book as clean
         qof_book_mark_saved( book );
@@ -580,33 +584,270 @@ gnc_sql_rollback_edit( GncSqlBackend *be, QofInstance *inst )
     LEAVE( "" );
 }
 
+/* ----------------------------------------------------------------- */
+/* Write batches.  gnc_sql_commit_edit() only queues the objects it is
+ * given, once each and in commit order.  The queue is written in one
+ * database transaction when it is flushed, so an object committed many
+ * times is written once, and either the whole queue lands or nothing
+ * does.  Objects are marked clean after the COMMIT; if the batch is
+ * rolled back they are marked dirty again and stay queued. */
+
+#define GNC_SQL_BATCH_MAX 1000
+
+typedef struct
+{
+    QofInstance* inst;
+    GncSqlObjectBackend* handler;
+    GList* link;				/* Link of the item in be->batch */
+    gboolean is_infant;		/* Not in the db before this batch */
+    gboolean is_written;		/* Written by the batch being flushed */
+} BatchItem;
+
+/* Find the backend handler that commits objects of the type of inst. */
+static GncSqlObjectBackend*
+lookup_commit_handler( QofInstance* inst )
+{
+    GncSqlObjectBackend* pData;
+
+    pData = qof_object_lookup_backend( inst->e_type, GNC_SQL_BACKEND );
+    if ( pData == NULL || pData->version != GNC_SQL_BACKEND_VERSION
+            || pData->commit == NULL )
+    {
+        return NULL;
+    }
+    return pData;
+}
+
+static gboolean
+batch_flush_idle( gpointer data )
+{
+    GncSqlBackend* be = (GncSqlBackend*)data;
+
+    be->batch_flush_id = 0;
+    (void)gnc_sql_flush_batch( be );
+    return FALSE;
+}
+
 static void
-commit_cb( const gchar* type, gpointer data_p, gpointer be_data_p )
+batch_add( GncSqlBackend* be, QofInstance* inst, GncSqlObjectBackend* handler )
 {
-    GncSqlObjectBackend* pData = data_p;
-    sql_backend* be_data = be_data_p;
+    BatchItem* item;
 
-    g_return_if_fail( type != NULL && pData != NULL && be_data != NULL );
-    g_return_if_fail( pData->version == GNC_SQL_BACKEND_VERSION );
+    if ( be->batch_items == NULL )
+    {
+        be->batch_items = g_hash_table_new( g_direct_hash, g_direct_equal );
+    }
+    if ( g_hash_table_lookup( be->batch_items, inst ) != NULL ) return;
+
+    item = g_new0( BatchItem, 1 );
+    item->inst = g_object_ref( inst );
+    item->handler = handler;
+    item->is_infant = qof_instance_get_infant( inst );
+    g_queue_push_tail( &be->batch, item );
+    item->link = g_queue_peek_tail_link( &be->batch );
+    g_hash_table_insert( be->batch_items, inst, item );
+
+    if ( be->batch_flush_id == 0 )
+    {
+        be->batch_flush_id = g_idle_add_full( G_PRIORITY_LOW, batch_flush_idle, be, NULL );
+    }
+}
+
+static void
+batch_remove( GncSqlBackend* be, BatchItem* item )
+{
+    g_hash_table_remove( be->batch_items, item->inst );
+    g_queue_delete_link( &be->batch, item->link );
+    g_object_unref( item->inst );
+    g_free( item );
+}
+
+/* Nothing of the batch made it to the db: the objects are dirty again
+ * and stay queued for the next flush. */
+static void
+batch_failed( GncSqlBackend* be )
+{
+    GList* node;
+
+    qof_backend_set_error( (QofBackend*)be, ERR_BACKEND_SERVER_ERR );
+    for ( node = be->batch.head; node != NULL; node = node->next )
+    {
+        BatchItem* item = node->data;
 
-    /* If this has already been handled, or is not the correct handler, return */
-    if ( strcmp( pData->type_name, be_data->inst->e_type ) != 0 ) return;
-    if ( be_data->is_known ) return;
+        item->is_written = FALSE;
+        qof_instance_set_dirty( item->inst );
+    }
+    qof_book_mark_dirty( be->book );
+}
+
+/* The whole book has been saved, which covers the queued objects. */
+static void
+batch_clear( GncSqlBackend* be )
+{
+    GList* node;
+    GList* next;
 
-    if ( pData->commit != NULL )
+    for ( node = be->batch.head; node != NULL; node = next )
     {
-        be_data->is_ok = (pData->commit)( be_data->be, be_data->inst );
-        be_data->is_known = TRUE;
+        BatchItem* item = node->data;
+
+        next = node->next;
+        if ( qof_instance_get_editlevel( item->inst ) > 0 )
+        {
+            item->is_infant = FALSE;
+            continue;
+        }
+        qof_instance_mark_clean( item->inst );
+        batch_remove( be, item );
     }
 }
 
+/* Write the queued objects and, if destroyed isn't NULL, delete that
+ * object, all in one database transaction.  Objects open for editing
+ * are left for a later batch, since they may hold uncommitted
+ * changes. */
+static gboolean
+batch_write( GncSqlBackend* be, QofInstance* destroyed,
+             GncSqlObjectBackend* destroyed_handler )
+{
+    GList* node;
+    GList* next;
+    gboolean is_ok;
+
+    if ( be->batch_flush_id != 0 )
+    {
+        (void)g_source_remove( be->batch_flush_id );
+        be->batch_flush_id = 0;
+    }
+    if ( g_queue_is_empty( &be->batch ) && destroyed == NULL ) return TRUE;
+
+    ENTER( "%u objects", g_queue_get_length( &be->batch ) );
+    if ( !gnc_sql_connection_begin_transaction( be->conn ) )
+    {
+        PERR( "Couldn't begin the write batch\n" );
+        batch_failed( be );
+        LEAVE( "begin_transaction failed" );
+        return FALSE;
+    }
+    be->batch_known = g_hash_table_new( g_direct_hash, g_direct_equal );
+
+    is_ok = TRUE;
+    for ( node = be->batch.head; node != NULL && is_ok; node = node->next )
+    {
+        BatchItem* item = node->data;
+
+        if ( item->is_written || qof_instance_get_editlevel( item->inst ) > 0 )
+            continue;
+        is_ok = (item->handler->commit)( be, item->inst );
+        item->is_written = TRUE;
+    }
+    if ( is_ok && destroyed != NULL )
+    {
+        is_ok = (destroyed_handler->commit)( be, destroyed );
+    }
+    if ( is_ok )
+    {
+        is_ok = gnc_sql_connection_commit_transaction( be->conn );
+    }
+
+    g_hash_table_destroy( be->batch_known );
+    be->batch_known = NULL;
+
+    if ( !is_ok )
+    {
+        PERR( "Write batch failed, rolled back\n" );
+        (void)gnc_sql_connection_rollback_transaction( be->conn );
+        batch_failed( be );
+        LEAVE( "rolled back" );
+        return FALSE;
+    }
+
+    for ( node = be->batch.head; node != NULL; node = next )
+    {
+        BatchItem* item = node->data;
+
+        next = node->next;
+        if ( !item->is_written ) continue;
+        qof_instance_mark_clean( item->inst );
+        batch_remove( be, item );
+    }
+    if ( g_queue_is_empty( &be->batch ) )
+    {
+        qof_book_mark_saved( be->book );
+    }
+    LEAVE( "" );
+    return TRUE;
+}
+
+gboolean
+gnc_sql_flush_batch( GncSqlBackend* be )
+{
+    g_return_val_if_fail( be != NULL, FALSE );
+
+    return batch_write( be, NULL, NULL );
+}
+
+void
+gnc_sql_finalize_batch( GncSqlBackend* be )
+{
+    g_return_if_fail( be != NULL );
+
+    if ( be->conn != NULL )
+    {
+        (void)gnc_sql_flush_batch( be );
+    }
+    if ( be->batch_flush_id != 0 )
+    {
+        (void)g_source_remove( be->batch_flush_id );
+        be->batch_flush_id = 0;
+    }
+    while ( !g_queue_is_empty( &be->batch ) )
+    {
+        batch_remove( be, g_queue_peek_head( &be->batch ) );
+    }
+    if ( be->batch_items != NULL )
+    {
+        g_hash_table_destroy( be->batch_items );
+        be->batch_items = NULL;
+    }
+}
+
+gboolean
+gnc_sql_instance_is_infant( GncSqlBackend* be, QofInstance* inst )
+{
+    BatchItem* item;
+    gboolean is_infant;
+
+    g_return_val_if_fail( be != NULL, FALSE );
+    g_return_val_if_fail( inst != NULL, FALSE );
+
+    /* The engine clears the infant flag when the commit returns, long
+       before a queued object is written. */
+    if ( be->batch_known == NULL || be->batch_items == NULL )
+    {
+        return qof_instance_get_infant( inst );
+    }
+    item = g_hash_table_lookup( be->batch_items, inst );
+    if ( item == NULL )
+    {
+        return qof_instance_get_infant( inst );
+    }
+
+    /* The caller writes it now, so it isn't written again for its own
+       entry, and any later write in this batch is an update. */
+    is_infant = item->is_infant && !item->is_written;
+    item->is_written = TRUE;
+    return is_infant;
+}
+
 /* Commit_edit handler - find the correct backend handler for this object
- * type and call its commit handler
+ * type and queue the object for it
  */
 void
 gnc_sql_commit_edit( GncSqlBackend *be, QofInstance *inst )
 {
-    sql_backend be_data;
+    GncSqlObjectBackend* handler;
+    BatchItem* item;
     gboolean is_dirty;
     gboolean is_destroying;
     gboolean is_infant;
@@ -617,7 +858,6 @@ gnc_sql_commit_edit( GncSqlBackend *be, QofInstance *inst )
     if ( qof_book_is_readonly( be->book ) )
     {
         qof_backend_set_error( (QofBackend*)be, ERR_BACKEND_READONLY );
-        (void)gnc_sql_connection_rollback_transaction( be->conn );
         return;
     }
     /* During initial load where objects are being created, don't commit
@@ -652,45 +892,45 @@ gnc_sql_commit_edit( GncSqlBackend *be, QofInstance *inst )
         return;
     }
 
-    if ( !gnc_sql_connection_begin_transaction( be->conn ) )
-    {
-        PERR( "gnc_sql_commit_edit(): begin_transaction failed\n" );
-        LEAVE( "Rolled back - database transaction begin error" );
-        return;
-    }
-
-    be_data.is_known = FALSE;
-    be_data.be = be;
-    be_data.inst = inst;
-    be_data.is_ok = TRUE;
-
-    qof_object_foreach_backend( GNC_SQL_BACKEND, commit_cb, &be_data );
-
-    if ( !be_data.is_known )
+    handler = lookup_commit_handler( inst );
+    if ( handler == NULL )
     {
         PERR( "gnc_sql_commit_edit(): Unknown object type '%s'\n", inst->e_type );
-        (void)gnc_sql_connection_rollback_transaction( be->conn );
 
         // Don't let unknown items still mark the book as being dirty
         qof_instance_mark_clean(inst);
-        qof_book_mark_saved( be->book );
-        LEAVE( "Rolled back - unknown object type" );
+        if ( g_queue_is_empty( &be->batch ) )
+        {
+            qof_book_mark_saved( be->book );
+        }
+        LEAVE( "Unknown object type" );
         return;
     }
-    if ( !be_data.is_ok )
-    {
-        // Error - roll it back
-        (void)gnc_sql_connection_rollback_transaction( be->conn );
 
-        // This *should* leave things marked dirty
-        LEAVE( "Rolled back - database error" );
+    if ( is_destroying )
+    {
+        /* The object is freed as soon as this returns, so its delete
+           can't wait; it goes out with the queue ahead of it. */
+        item = ( be->batch_items != NULL ) ? g_hash_table_lookup( be->batch_items, inst ) : NULL;
+        if ( item != NULL )
+        {
+            batch_remove( be, item );
+        }
+        if ( !batch_write( be, inst, handler ) )
+        {
+            // This *should* leave things marked dirty
+            LEAVE( "Rolled back - database error" );
+            return;
+        }
+        LEAVE( "" );
         return;
     }
 
-    (void)gnc_sql_connection_commit_transaction( be->conn );
-
-    qof_instance_mark_clean(inst);
-    qof_book_mark_saved( be->book );
+    batch_add( be, inst, handler );
+    if ( g_queue_get_length( &be->batch ) >= GNC_SQL_BATCH_MAX )
+    {
+        (void)gnc_sql_flush_batch( be );
+    }
 
     LEAVE( "" );
 }
@@ -1049,6 +1289,8 @@ gnc_sql_run_query( QofBackend* pBEnd, gpointer pQuery )
 
     ENTER( " " );
 
+    /* The queued objects have to be in the db before it is read. */
+    (void)gnc_sql_flush_batch( be );
     be->loading = TRUE;
     be->in_query = TRUE;
 
@@ -1248,8 +1490,8 @@ load_string( const GncSqlBackend* be, GncSqlRow* row,
 /*@ null @*/ QofSetterFunc setter, gpointer pObject,
 const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
     const gchar* s;
+    gboolean found;
 
     g_return_if_fail( be != NULL );
     g_return_if_fail( row != NULL );
@@ -1257,9 +1499,8 @@ const GncSqlColumnTableEntry* table_row )
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    g_return_if_fail( val != NULL );
-    s = g_value_get_string( val );
+    found = gnc_sql_row_get_string_at_col_name( row, table_row->col_name, &s );
+    g_return_if_fail( found );
     if ( table_row->gobj_param_name != NULL )
     {
         g_object_set( pObject, table_row->gobj_param_name, s, NULL );
@@ -1345,7 +1586,7 @@ load_int( const GncSqlBackend* be, GncSqlRow* row,
           /*@ null @*/ QofSetterFunc setter, gpointer pObject,
           const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
+    gint64 i64_value;
     gint int_value;
     IntSetterFunc i_setter;
 
@@ -1355,14 +1596,13 @@ load_int( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val == NULL )
+    if ( !gnc_sql_row_get_int64_at_col_name( row, table_row->col_name, &i64_value ) )
     {
         int_value = 0;
     }
     else
     {
-        int_value = (gint)gnc_sql_get_integer_value( val );
+        int_value = (gint)i64_value;
     }
     if ( table_row->gobj_param_name != NULL )
     {
@@ -1443,7 +1683,7 @@ load_boolean( const GncSqlBackend* be, GncSqlRow* row,
               /*@ null @*/ QofSetterFunc setter, gpointer pObject,
               const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
+    gint64 i64_value;
     gint int_value;
     BooleanSetterFunc b_setter;
 
@@ -1453,14 +1693,13 @@ load_boolean( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val == NULL )
+    if ( !gnc_sql_row_get_int64_at_col_name( row, table_row->col_name, &i64_value ) )
     {
         int_value = 0;
     }
     else
     {
-        int_value = (gint)gnc_sql_get_integer_value( val );
+        int_value = (gint)i64_value;
     }
     if ( table_row->gobj_param_name != NULL )
     {
@@ -1541,8 +1780,7 @@ load_int64( const GncSqlBackend* be, GncSqlRow* row,
             /*@ null @*/ QofSetterFunc setter, gpointer pObject,
             const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
-    gint64 i64_value = 0;
+    gint64 i64_value;
     Int64SetterFunc i64_setter = (Int64SetterFunc)setter;
 
     g_return_if_fail( be != NULL );
@@ -1551,10 +1789,9 @@ load_int64( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val != NULL )
+    if ( !gnc_sql_row_get_int64_at_col_name( row, table_row->col_name, &i64_value ) )
     {
-        i64_value = gnc_sql_get_integer_value( val );
+        i64_value = 0;
     }
     if ( table_row->gobj_param_name != NULL )
     {
@@ -1630,7 +1867,6 @@ load_double( const GncSqlBackend* be, GncSqlRow* row,
              /*@ null @*/ QofSetterFunc setter, gpointer pObject,
              const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
     gdouble d_value;
 
     g_return_if_fail( be != NULL );
@@ -1639,38 +1875,25 @@ load_double( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val == NULL )
+    if ( !gnc_sql_row_get_double_at_col_name( row, table_row->col_name, &d_value ) )
+    {
+        const GValue* val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
+
+        if ( val == NULL )
+        {
+            (*setter)( pObject, (gpointer)NULL );
+            return;
+        }
+        PWARN( "Unknown float value type: %s\n", g_type_name( G_VALUE_TYPE(val) ) );
+        d_value = 0;
+    }
+    if ( table_row->gobj_param_name != NULL )
     {
-        (*setter)( pObject, (gpointer)NULL );
+        g_object_set( pObject, table_row->gobj_param_name, d_value, NULL );
     }
     else
     {
-        if ( G_VALUE_HOLDS(val, G_TYPE_INT) )
-        {
-            d_value = (gdouble)g_value_get_int( val );
-        }
-        else if ( G_VALUE_HOLDS(val, G_TYPE_FLOAT) )
-        {
-            d_value = g_value_get_float( val );
-        }
-        else if (G_VALUE_HOLDS(val, G_TYPE_DOUBLE) )
-        {
-            d_value = g_value_get_double( val );
-        }
-        else
-        {
-            PWARN( "Unknown float value type: %s\n", g_type_name( G_VALUE_TYPE(val) ) );
-            d_value = 0;
-        }
-        if ( table_row->gobj_param_name != NULL )
-        {
-            g_object_set( pObject, table_row->gobj_param_name, d_value, NULL );
-        }
-        else
-        {
-            (*setter)( pObject, (gpointer)&d_value );
-        }
+        (*setter)( pObject, (gpointer)&d_value );
     }
 }
 
@@ -1740,7 +1963,7 @@ load_guid( const GncSqlBackend* be, GncSqlRow* row,
            /*@ null @*/ QofSetterFunc setter, gpointer pObject,
            const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
+    const gchar* s;
     GncGUID guid;
     const GncGUID* pGuid;
 
@@ -1750,14 +1973,13 @@ load_guid( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val == NULL || g_value_get_string( val ) == NULL )
+    if ( !gnc_sql_row_get_string_at_col_name( row, table_row->col_name, &s ) || s == NULL )
     {
         pGuid = NULL;
     }
     else
     {
-        (void)string_to_guid( g_value_get_string( val ), &guid );
+        (void)string_to_guid( s, &guid );
         pGuid = &guid;
     }
     if ( pGuid != NULL )
@@ -1928,10 +2150,9 @@ load_timespec( const GncSqlBackend* be, GncSqlRow* row,
                /*@ null @*/ QofSetterFunc setter, gpointer pObject,
                const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
+    const gchar* s;
     Timespec ts = {0, 0};
     TimespecSetterFunc ts_setter;
-    gboolean isOK = FALSE;
 
     g_return_if_fail( be != NULL );
     g_return_if_fail( row != NULL );
@@ -1940,47 +2161,40 @@ load_timespec( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
     ts_setter = (TimespecSetterFunc)setter;
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val == NULL )
+    if ( !gnc_sql_row_get_string_at_col_name( row, table_row->col_name, &s ) )
     {
-        isOK = TRUE;
-    }
-    else
-    {
-        if ( G_VALUE_HOLDS_STRING( val ) )
-        {
-            const gchar* s = g_value_get_string( val );
-            if ( s != NULL )
-            {
-                gchar* buf;
-                buf = g_strdup_printf( "%c%c%c%c-%c%c-%c%c %c%c:%c%c:%c%c",
-                                       s[0], s[1], s[2], s[3],
-                                       s[4], s[5],
-                                       s[6], s[7],
-                                       s[8], s[9],
-                                       s[10], s[11],
-                                       s[12], s[13] );
-                ts = gnc_iso8601_to_timespec_gmt( buf );
-                g_free( buf );
-                isOK = TRUE;
-            }
+        const GValue* val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
 
-        }
-        else
+        if ( val != NULL )
         {
             PWARN( "Unknown timespec type: %s", G_VALUE_TYPE_NAME( val ) );
+            return;
         }
     }
-    if ( isOK )
+    else if ( s == NULL )
     {
-        if (table_row->gobj_param_name != NULL)
-        {
-            g_object_set( pObject, table_row->gobj_param_name, &ts, NULL );
-        }
-        else
-        {
-            (*ts_setter)( pObject, ts );
-        }
+        return;
+    }
+    else
+    {
+        gchar* buf;
+        buf = g_strdup_printf( "%c%c%c%c-%c%c-%c%c %c%c:%c%c:%c%c",
+                               s[0], s[1], s[2], s[3],
+                               s[4], s[5],
+                               s[6], s[7],
+                               s[8], s[9],
+                               s[10], s[11],
+                               s[12], s[13] );
+        ts = gnc_iso8601_to_timespec_gmt( buf );
+        g_free( buf );
+    }
+    if (table_row->gobj_param_name != NULL)
+    {
+        g_object_set( pObject, table_row->gobj_param_name, &ts, NULL );
+    }
+    else
+    {
+        (*ts_setter)( pObject, ts );
     }
 }
 
@@ -2055,7 +2269,7 @@ load_date( const GncSqlBackend* be, GncSqlRow* row,
            /*@ null @*/ QofSetterFunc setter, gpointer pObject,
            const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
+    const gchar* s;
     GDate* date;
 
     g_return_if_fail( be != NULL );
@@ -2064,48 +2278,35 @@ load_date( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row != NULL );
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
-    val = gnc_sql_row_get_value_at_col_name( row, table_row->col_name );
-    if ( val != NULL )
+    // Format of date is YYYYMMDD
+    if ( gnc_sql_row_get_string_at_col_name( row, table_row->col_name, &s ) && s != NULL )
     {
-        if ( G_VALUE_HOLDS_STRING( val ) )
-        {
-            // Format of date is YYYYMMDD
-            const gchar* s = g_value_get_string( val );
+        gchar buf[5];
+        GDateDay day;
+        guint month;
+        GDateYear year;
 
-            if ( s != NULL )
+        strncpy( buf, &s[0], 4 );
+        buf[4] = '\0';
+        year = (GDateYear)atoi( buf );
+        strncpy( buf, &s[4], 2 );
+        buf[2] = '\0';
+        month = (guint)atoi( buf );
+        strncpy( buf, &s[6], 2 );
+        day = (GDateDay)atoi( buf );
+
+        if ( year != 0 || month != 0 || day != (GDateDay)0 )
+        {
+            date = g_date_new_dmy( day, month, year );
+            if ( table_row->gobj_param_name != NULL )
             {
-                gchar buf[5];
-                GDateDay day;
-                guint month;
-                GDateYear year;
-
-                strncpy( buf, &s[0], 4 );
-                buf[4] = '\0';
-                year = (GDateYear)atoi( buf );
-                strncpy( buf, &s[4], 2 );
-                buf[2] = '\0';
-                month = (guint)atoi( buf );
-                strncpy( buf, &s[6], 2 );
-                day = (GDateDay)atoi( buf );
-
-                if ( year != 0 || month != 0 || day != (GDateDay)0 )
-                {
-                    date = g_date_new_dmy( day, month, year );
-                    if ( table_row->gobj_param_name != NULL )
-                    {
-                        g_object_set( pObject, table_row->gobj_param_name, date, NULL );
-                    }
-                    else
-                    {
-                        (*setter)( pObject, date );
-                    }
-                    g_date_free( date );
-                }
+                g_object_set( pObject, table_row->gobj_param_name, date, NULL );
             }
-        }
-        else
-        {
-            PWARN( "Unknown date type: %s", G_VALUE_TYPE_NAME( val ) );
+            else
+            {
+                (*setter)( pObject, date );
+            }
+            g_date_free( date );
         }
     }
 }
@@ -2191,7 +2392,6 @@ load_numeric( const GncSqlBackend* be, GncSqlRow* row,
               /*@ null @*/ QofSetterFunc setter, gpointer pObject,
               const GncSqlColumnTableEntry* table_row )
 {
-    const GValue* val;
     gchar* buf;
     gint64 num, denom;
     gnc_numeric n;
@@ -2204,29 +2404,19 @@ load_numeric( const GncSqlBackend* be, GncSqlRow* row,
     g_return_if_fail( table_row->gobj_param_name != NULL || setter != NULL );
 
     buf = g_strdup_printf( "%s_num", table_row->col_name );
-    val = gnc_sql_row_get_value_at_col_name( row, buf );
-    g_free( buf );
-    if ( val == NULL )
+    if ( !gnc_sql_row_get_int64_at_col_name( row, buf, &num ) )
     {
         isNull = TRUE;
         num = 0;
     }
-    else
-    {
-        num = gnc_sql_get_integer_value( val );
-    }
-    buf = g_strdup_printf( "%s_denom", table_row->col_name );
-    val = gnc_sql_row_get_value_at_col_name( row, buf );
     g_free( buf );
-    if ( val == NULL )
+    buf = g_strdup_printf( "%s_denom", table_row->col_name );
+    if ( !gnc_sql_row_get_int64_at_col_name( row, buf, &denom ) )
     {
         isNull = TRUE;
         denom = 1;
     }
-    else
-    {
-        denom = gnc_sql_get_integer_value( val );
-    }
+    g_free( buf );
     n = gnc_numeric_create( num, denom );
     if ( !isNull )
     {
@@ -2657,6 +2847,13 @@ gnc_sql_object_is_it_in_db( GncSqlBackend* be, const gchar* table_name,
     g_return_val_if_fail( pObject != NULL, FALSE );
     g_return_val_if_fail( table != NULL, FALSE );
 
+    /* Asked before in this write batch? */
+    if ( be->batch_known != NULL
+            && g_strcmp0( g_hash_table_lookup( be->batch_known, pObject ), table_name ) == 0 )
+    {
+        return TRUE;
+    }
+
     /* SELECT * FROM */
     sqlStmt = create_single_col_select_statement( be, table_name, table );
     g_assert( sqlStmt != NULL );
@@ -2676,6 +2873,10 @@ gnc_sql_object_is_it_in_db( GncSqlBackend* be, const gchar* table_name,
     }
     else
     {
+        if ( be->batch_known != NULL )
+        {
+            g_hash_table_insert( be->batch_known, pObject, (gpointer)table_name );
+        }
         return TRUE;
     }
 }
@@ -2725,6 +2926,17 @@ gnc_sql_do_db_operation( GncSqlBackend* be,
         else
         {
             ok = TRUE;
+            if ( be->batch_known != NULL )
+            {
+                if ( op == OP_DB_INSERT )
+                {
+                    g_hash_table_insert( be->batch_known, pObject, (gpointer)table_name );
+                }
+                else if ( op == OP_DB_DELETE )
+                {
+                    (void)g_hash_table_remove( be->batch_known, pObject );
+                }
+            }
         }
         gnc_sql_statement_dispose( stmt );
     }
@@ -2840,6 +3052,41 @@ free_gvalue_list( GSList* list )
     g_slist_free( list );
 }
 
+/* The column names of a column table only depend on the table, which
+ * is always static, so they are worked out once per table. */
+static GHashTable* colnames_cache = NULL;
+
+static /*@ dependent @*/ GList*
+get_table_colnames( const GncSqlColumnTableEntry* table )
+{
+    GList* colnames;
+    const GncSqlColumnTableEntry* table_row;
+
+    if ( colnames_cache == NULL )
+    {
+        colnames_cache = g_hash_table_new( g_direct_hash, g_direct_equal );
+    }
+    colnames = g_hash_table_lookup( colnames_cache, table );
+    if ( colnames != NULL ) return colnames;
+
+    for ( table_row = table; table_row->col_name != NULL; table_row++ )
+    {
+        if (( table_row->flags & COL_AUTOINC ) == 0 )
+        {
+            GncSqlColumnTypeHandler* pHandler;
+
+            // Add col names to the list
+            pHandler = get_handler( table_row );
+            g_assert( pHandler != NULL );
+            pHandler->add_colname_to_list_fn( table_row, &colnames );
+        }
+    }
+    g_assert( colnames != NULL );
+    g_hash_table_insert( colnames_cache, (gpointer)table, colnames );
+
+    return colnames;
+}
+
 /*@ null @*/ static GncSqlStatement*
 build_insert_statement( GncSqlBackend* be,
                         const gchar* table_name,
@@ -2853,7 +3100,6 @@ build_insert_statement( GncSqlBackend* be,
     gchar* sqlbuf;
     GList* colnames = NULL;
     GList* colname;
-    const GncSqlColumnTableEntry* table_row;
 
     g_return_val_if_fail( be != NULL, NULL );
     g_return_val_if_fail( table_name != NULL, NULL );
@@ -2865,21 +3111,7 @@ build_insert_statement( GncSqlBackend* be,
     sql = g_string_new( sqlbuf );
     g_free( sqlbuf );
 
-    // Get all col names and all values
-    for ( table_row = table; table_row->col_name != NULL; table_row++ )
-    {
-        if (( table_row->flags & COL_AUTOINC ) == 0 )
-        {
-            GncSqlColumnTypeHandler* pHandler;
-
-            // Add col names to the list
-            pHandler = get_handler( table_row );
-            g_assert( pHandler != NULL );
-            pHandler->add_colname_to_list_fn( table_row, &colnames );
-        }
-    }
-    g_assert( colnames != NULL );
-
+    colnames = get_table_colnames( table );
     for ( colname = colnames; colname != NULL; colname = colname->next )
     {
         if ( colname != colnames )
@@ -2887,9 +3119,7 @@ build_insert_statement( GncSqlBackend* be,
             g_string_append( sql, "," );
         }
         g_string_append( sql, (gchar*)colname->data );
-        g_free( colname->data );
     }
-    g_list_free( colnames );
 
     g_string_append( sql, ") VALUES(" );
     values = create_gslist_from_values( be, obj_name, pObject, table );
@@ -2928,7 +3158,6 @@ build_update_statement( GncSqlBackend* be,
     GSList* value;
     GList* colname;
     gboolean firstCol;
-    const GncSqlColumnTableEntry* table_row;
     gchar* sqlbuf;
 
     g_return_val_if_fail( be != NULL, NULL );
@@ -2938,19 +3167,7 @@ build_update_statement( GncSqlBackend* be,
     g_return_val_if_fail( table != NULL, NULL );
 
     // Get all col names and all values
-    for ( table_row = table; table_row->col_name != NULL; table_row++ )
-    {
-        if (( table_row->flags & COL_AUTOINC ) == 0 )
-        {
-            GncSqlColumnTypeHandler* pHandler;
-
-            // Add col names to the list
-            pHandler = get_handler( table_row );
-            g_assert( pHandler != NULL );
-            pHandler->add_colname_to_list_fn( table_row, &colnames );
-        }
-    }
-    g_assert( colnames != NULL );
+    colnames = get_table_colnames( table );
     values = create_gslist_from_values( be, obj_name, pObject, table );
 
     // Create the SQL statement
@@ -2975,11 +3192,6 @@ build_update_statement( GncSqlBackend* be,
         g_free( value_str );
         firstCol = FALSE;
     }
-    for ( colname = colnames; colname != NULL; colname = colname->next )
-    {
-        g_free( colname->data );
-    }
-    g_list_free( colnames );
     if ( value != NULL || colname != NULL )
     {
         PERR( "Mismatch in number of column names and values" );
@@ -3035,7 +3247,7 @@ gnc_sql_commit_standard_item( GncSqlBackend* be, QofInstance* inst, const gchar*
     gint op;
     gboolean is_ok;
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -63,6 +63,10 @@ struct GncSqlBackend
     gint operations_done;			/**< Number of operations (save/load) done */
     GHashTable* versions;			/**< Version number for each table */
     const gchar* timespec_format;	/**< Format string for SQL for timespec values */
+    GQueue batch;				/**< Committed objects waiting to be written */
+    GHashTable* batch_items;		/**< Queue entry of each object in the batch */
+    GHashTable* batch_known;		/**< Objects known to be in the db, while the batch is written */
+    guint batch_flush_id;			/**< Idle source that writes the batch */
 };
 typedef struct GncSqlBackend GncSqlBackend;
 
@@ -113,6 +117,44 @@ void gnc_sql_rollback_edit( GncSqlBackend* qbe, QofInstance *inst );
  */
 void gnc_sql_commit_edit( GncSqlBackend* qbe, QofInstance *inst );
 
+/**
+ * Writes the queued objects.
+ *
+ * gnc_sql_commit_edit() doesn't write an object, it queues it.  The
+ * queue is written in one database transaction once GNC_SQL_BATCH_MAX
+ * objects are waiting, when the main loop goes idle, before an object
+ * is deleted, and when this is called.  Anything that reads the
+ * database, or that starts a database transaction of its own, must call
+ * this first.  The objects are marked clean when the transaction has
+ * been committed.  If it fails, it is rolled back and the objects are
+ * marked dirty again and stay queued, so a crash or an error never
+ * leaves part of a batch in the database.
+ *
+ * @param be SQL backend
+ * @return TRUE if successful, FALSE if the batch was rolled back
+ */
+gboolean gnc_sql_flush_batch( GncSqlBackend* be );
+
+/**
+ * Writes the queued objects one last time and drops whatever couldn't
+ * be written.  Called when the session ends.
+ *
+ * @param be SQL backend
+ */
+void gnc_sql_finalize_batch( GncSqlBackend* be );
+
+/**
+ * Returns whether an object has never been written to the database, so
+ * that it has to be inserted rather than updated.  Commit handlers use
+ * this instead of qof_instance_get_infant(), because the engine clears
+ * that flag as soon as the object has been queued.
+ *
+ * @param be SQL backend
+ * @param inst Object about to be written
+ * @return TRUE if the object has to be inserted
+ */
+gboolean gnc_sql_instance_is_infant( GncSqlBackend* be, QofInstance* inst );
+
 /**
  */
 typedef struct GncSqlColumnTableEntry GncSqlColumnTableEntry;
@@ -190,14 +232,29 @@ struct GncSqlConnection
  *
  * Struct used to represent a row in the result of an SQL SELECT statement.
  * SQL backends must provide a structure which implements all of the functions.
+ * The values handed out, strings included, are only good until the next
+ * row is fetched.  The typed accessors return FALSE where
+ * getValueAtColName would return NULL or a value of another type, and
+ * read integer and NULL columns the way gnc_sql_get_integer_value and
+ * the loaders read their GValues.  The double accessor reads integer
+ * columns as well, and the string accessor date columns.
  */
 struct GncSqlRow
 {
     const GValue* (*getValueAtColName)( GncSqlRow*, const gchar* );
+    gboolean (*getInt64AtColName)( GncSqlRow*, const gchar*, gint64* ); /**< Returns FALSE if no value */
+    gboolean (*getDoubleAtColName)( GncSqlRow*, const gchar*, gdouble* ); /**< Returns FALSE if no value */
+    gboolean (*getStringAtColName)( GncSqlRow*, const gchar*, const gchar** ); /**< Returns FALSE if no value; NULL text is a NULL string */
     void (*dispose)( /*@ only @*/ GncSqlRow* );
 };
 #define gnc_sql_row_get_value_at_col_name(ROW,N) \
 		(ROW)->getValueAtColName(ROW,N)
+#define gnc_sql_row_get_int64_at_col_name(ROW,N,V) \
+		(ROW)->getInt64AtColName(ROW,N,V)
+#define gnc_sql_row_get_double_at_col_name(ROW,N,V) \
+		(ROW)->getDoubleAtColName(ROW,N,V)
+#define gnc_sql_row_get_string_at_col_name(ROW,N,V) \
+		(ROW)->getStringAtColName(ROW,N,V)
 #define gnc_sql_row_dispose(ROW) \
 		(ROW)->dispose(ROW)
 
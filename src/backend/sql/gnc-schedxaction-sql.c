@@ -177,7 +177,7 @@ gnc_sql_save_schedxaction( GncSqlBackend* be, QofInstance* inst )
 
     pSx = GNC_SX(inst);
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -467,7 +467,7 @@ save_taxtable( GncSqlBackend* be, QofInstance* inst )
 
     tt = GNC_TAXTABLE(inst);
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -28,6 +28,7 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib/gi18n.h>
 
 #include "qof.h"
@@ -490,6 +491,375 @@ query_transactions( GncSqlBackend* be, GncSqlStatement* stmt )
     }
 }
 
+/* ================================================================= */
+/* Bulk loading.  When the whole book is loaded into an empty book,
+ * the transactions and the splits are read with one query each,
+ * without the GncGUID lists that load_splits_for_tx_list() builds,
+ * and the rows are decoded straight into the objects instead of
+ * going through the type handlers and the GObject properties.  The
+ * column names still come from tx_col_table and split_col_table: every
+ * column is found by the property it loads and checked for its type,
+ * and if one can't be found the normal loader is used. */
+
+static gboolean bulk_load = TRUE;
+
+typedef struct
+{
+    /*@ dependent @*/ const gchar* guid;
+    /*@ dependent @*/ const gchar* currency;
+    /*@ dependent @*/ const gchar* num;
+    /*@ dependent @*/ const gchar* post_date;
+    /*@ dependent @*/ const gchar* enter_date;
+    /*@ dependent @*/ const gchar* description;
+} tx_bulk_cols_t;
+
+typedef struct
+{
+    /*@ dependent @*/ const gchar* guid;
+    /*@ dependent @*/ const gchar* tx;
+    /*@ dependent @*/ const gchar* account;
+    /*@ dependent @*/ const gchar* memo;
+    /*@ dependent @*/ const gchar* action;
+    /*@ dependent @*/ const gchar* reconcile_state;
+    /*@ dependent @*/ const gchar* reconcile_date;
+    /*@ dependent @*/ const gchar* lot;
+    /*@ only @*/ gchar* value_num;
+    /*@ only @*/ gchar* value_denom;
+    /*@ only @*/ gchar* quantity_num;
+    /*@ only @*/ gchar* quantity_denom;
+} split_bulk_cols_t;
+
+void
+gnc_sql_transaction_set_bulk_load( gboolean bulk )
+{
+    bulk_load = bulk;
+}
+
+/* Finds the column of the table that loads the property param_name,
+ * or when that is NULL, the one that is loaded with the setter. */
+static /*@ null @*/ const gchar*
+bulk_col_name( const GncSqlColumnTableEntry* table, const gchar* col_type,
+               /*@ null @*/ const gchar* param_name, /*@ null @*/ QofSetterFunc setter )
+{
+    for ( ; table->col_name != NULL; table++ )
+    {
+        if ( strcmp( table->col_type, col_type ) != 0 ) continue;
+        if ( param_name != NULL )
+        {
+            if ( table->gobj_param_name != NULL
+                    && strcmp( table->gobj_param_name, param_name ) == 0 )
+                return table->col_name;
+        }
+        else if ( table->setter == setter )
+        {
+            return table->col_name;
+        }
+    }
+    PWARN( "No %s column found for %s", col_type,
+           param_name != NULL ? param_name : "setter" );
+    return NULL;
+}
+
+static gboolean
+bulk_get_tx_cols( tx_bulk_cols_t* cols )
+{
+    cols->guid = bulk_col_name( tx_col_table, CT_GUID, "guid", NULL );
+    cols->currency = bulk_col_name( tx_col_table, CT_COMMODITYREF, "currency", NULL );
+    cols->num = bulk_col_name( tx_col_table, CT_STRING, "num", NULL );
+    cols->post_date = bulk_col_name( tx_col_table, CT_TIMESPEC, "post-date", NULL );
+    cols->enter_date = bulk_col_name( tx_col_table, CT_TIMESPEC, "enter-date", NULL );
+    cols->description = bulk_col_name( tx_col_table, CT_STRING, "description", NULL );
+
+    return cols->guid != NULL && cols->currency != NULL && cols->num != NULL
+           && cols->post_date != NULL && cols->enter_date != NULL
+           && cols->description != NULL;
+}
+
+static gboolean
+bulk_get_split_cols( split_bulk_cols_t* cols )
+{
+    const gchar* value;
+    const gchar* quantity;
+
+    cols->guid = bulk_col_name( split_col_table, CT_GUID, "guid", NULL );
+    cols->tx = bulk_col_name( split_col_table, CT_TXREF, "transaction", NULL );
+    cols->account = bulk_col_name( split_col_table, CT_ACCOUNTREF, "account", NULL );
+    cols->memo = bulk_col_name( split_col_table, CT_STRING, "memo", NULL );
+    cols->action = bulk_col_name( split_col_table, CT_STRING, "action", NULL );
+    cols->reconcile_state = bulk_col_name( split_col_table, CT_STRING, NULL,
+                                           set_split_reconcile_state );
+    cols->reconcile_date = bulk_col_name( split_col_table, CT_TIMESPEC,
+                                          "reconcile-date", NULL );
+    cols->lot = bulk_col_name( split_col_table, CT_LOTREF, NULL, set_split_lot );
+    value = bulk_col_name( split_col_table, CT_NUMERIC, "value", NULL );
+    quantity = bulk_col_name( split_col_table, CT_NUMERIC, "amount", NULL );
+
+    /* Same sub-column names as load_numeric() reads */
+    cols->value_num = value != NULL ? g_strdup_printf( "%s_num", value ) : NULL;
+    cols->value_denom = value != NULL ? g_strdup_printf( "%s_denom", value ) : NULL;
+    cols->quantity_num = quantity != NULL ? g_strdup_printf( "%s_num", quantity ) : NULL;
+    cols->quantity_denom = quantity != NULL ? g_strdup_printf( "%s_denom", quantity ) : NULL;
+
+    return cols->guid != NULL && cols->tx != NULL && cols->account != NULL
+           && cols->memo != NULL && cols->action != NULL
+           && cols->reconcile_state != NULL && cols->reconcile_date != NULL
+           && cols->lot != NULL && value != NULL && quantity != NULL;
+}
+
+static void
+bulk_free_split_cols( split_bulk_cols_t* cols )
+{
+    g_free( cols->value_num );
+    g_free( cols->value_denom );
+    g_free( cols->quantity_num );
+    g_free( cols->quantity_denom );
+}
+
+static /*@ null @*/ const gchar*
+row_get_string( GncSqlRow* row, const gchar* col_name )
+{
+    const gchar* s;
+
+    if ( !gnc_sql_row_get_string_at_col_name( row, col_name, &s ) ) return NULL;
+    return s;
+}
+
+static gboolean
+row_get_guid( GncSqlRow* row, const gchar* col_name, GncGUID* guid )
+{
+    const gchar* s = row_get_string( row, col_name );
+
+    return s != NULL && string_to_guid( s, guid );
+}
+
+static gboolean
+row_get_numeric( GncSqlRow* row, const gchar* num_col, const gchar* denom_col,
+                 gnc_numeric* n )
+{
+    gint64 num, denom;
+
+    if ( !gnc_sql_row_get_int64_at_col_name( row, num_col, &num )
+            || !gnc_sql_row_get_int64_at_col_name( row, denom_col, &denom ) )
+        return FALSE;
+    *n = gnc_numeric_create( num, denom );
+    return TRUE;
+}
+
+/* Same rules as the CT_TIMESPEC loader: a NULL column is time 0, and a
+ * column that isn't text or a date leaves the date alone. */
+static gboolean
+row_get_timespec( GncSqlRow* row, const gchar* col_name, Timespec* ts )
+{
+    const gchar* s;
+    gchar buf[20];
+
+    ts->tv_sec = 0;
+    ts->tv_nsec = 0;
+    if ( !gnc_sql_row_get_string_at_col_name( row, col_name, &s ) )
+        return gnc_sql_row_get_value_at_col_name( row, col_name ) == NULL;
+    if ( s == NULL || strlen( s ) < 14 ) return FALSE;
+
+    g_snprintf( buf, sizeof(buf), "%.4s-%.2s-%.2s %.2s:%.2s:%.2s",
+                s, s + 4, s + 6, s + 8, s + 10, s + 12 );
+    *ts = gnc_iso8601_to_timespec_gmt( buf );
+    return TRUE;
+}
+
+static /*@ null @*/ Transaction*
+bulk_load_single_tx( GncSqlBackend* be, GncSqlRow* row, const tx_bulk_cols_t* cols )
+{
+    GncGUID guid;
+    Transaction* pTx;
+    gnc_commodity* currency;
+    Timespec ts;
+
+    if ( !row_get_guid( row, cols->guid, &guid ) ) return NULL;
+    if ( xaccTransLookup( &guid, be->book ) != NULL ) return NULL;
+
+    pTx = xaccMallocTransaction( be->book );
+    xaccTransBeginEdit( pTx );
+    qof_instance_set_guid( QOF_INSTANCE(pTx), &guid );
+
+    if ( row_get_guid( row, cols->currency, &guid ) )
+    {
+        currency = gnc_commodity_find_commodity_by_guid( &guid, be->book );
+        if ( currency != NULL )
+            xaccTransSetCurrency( pTx, currency );
+        else
+            PWARN( "Commodity ref '%s' not found", row_get_string( row, cols->currency ) );
+    }
+    xaccTransSetNum( pTx, row_get_string( row, cols->num ) );
+    if ( row_get_timespec( row, cols->post_date, &ts ) )
+        xaccTransSetDatePostedTS( pTx, &ts );
+    if ( row_get_timespec( row, cols->enter_date, &ts ) )
+        xaccTransSetDateEnteredTS( pTx, &ts );
+    xaccTransSetDescription( pTx, row_get_string( row, cols->description ) );
+
+    return pTx;
+}
+
+static /*@ null @*/ Split*
+bulk_load_single_split( GncSqlBackend* be, GncSqlRow* row,
+                        const split_bulk_cols_t* cols, GHashTable* new_txs )
+{
+    GncGUID guid;
+    Transaction* pTx;
+    Account* acc;
+    GNCLot* lot;
+    Split* pSplit;
+    const gchar* s;
+    gnc_numeric n;
+    Timespec ts;
+
+    if ( !row_get_guid( row, cols->tx, &guid ) ) return NULL;
+    pTx = xaccTransLookup( &guid, be->book );
+    if ( pTx == NULL || g_hash_table_lookup( new_txs, pTx ) == NULL )
+    {
+        PWARN( "Transaction ref '%s' not found", row_get_string( row, cols->tx ) );
+        return NULL;
+    }
+    if ( !row_get_guid( row, cols->guid, &guid ) ) return NULL;
+
+    pSplit = xaccSplitLookup( &guid, be->book );
+    if ( pSplit == NULL )
+    {
+        pSplit = xaccMallocSplit( be->book );
+        qof_instance_set_guid( QOF_INSTANCE(pSplit), &guid );
+    }
+    else if ( qof_instance_is_dirty( QOF_INSTANCE(pSplit) ) )
+    {
+        return pSplit;
+    }
+
+    xaccSplitSetParent( pSplit, pTx );
+    if ( row_get_guid( row, cols->account, &guid ) )
+    {
+        acc = xaccAccountLookup( &guid, be->book );
+        if ( acc != NULL )
+            xaccSplitSetAccount( pSplit, acc );
+        else
+            PWARN( "Account ref '%s' not found", row_get_string( row, cols->account ) );
+    }
+    xaccSplitSetMemo( pSplit, row_get_string( row, cols->memo ) );
+    xaccSplitSetAction( pSplit, row_get_string( row, cols->action ) );
+    s = row_get_string( row, cols->reconcile_state );
+    if ( s != NULL )
+        xaccSplitSetReconcile( pSplit, s[0] );
+    if ( row_get_timespec( row, cols->reconcile_date, &ts ) )
+        xaccSplitSetDateReconciledTS( pSplit, &ts );
+    if ( row_get_numeric( row, cols->value_num, cols->value_denom, &n ) )
+        xaccSplitSetValue( pSplit, n );
+    if ( row_get_numeric( row, cols->quantity_num, cols->quantity_denom, &n ) )
+        xaccSplitSetAmount( pSplit, n );
+    if ( row_get_guid( row, cols->lot, &guid ) )
+    {
+        lot = gnc_lot_lookup( &guid, be->book );
+        if ( lot != NULL )
+            gnc_lot_add_split( lot, pSplit );
+        else
+            PWARN( "Lot ref '%s' not found", row_get_string( row, cols->lot ) );
+    }
+
+    return pSplit;
+}
+
+/**
+ * Loads every transaction and split into a book that doesn't have any
+ * transactions yet.
+ *
+ * @param be SQL backend
+ * @return FALSE if the columns weren't found and nothing was loaded
+ */
+static gboolean
+bulk_load_transactions( GncSqlBackend* be )
+{
+    tx_bulk_cols_t tx_cols;
+    split_bulk_cols_t split_cols;
+    GHashTable* new_txs;
+    GncSqlStatement* stmt;
+    GncSqlResult* result;
+    GncSqlRow* row;
+    GList* tx_list = NULL;
+    GList* node;
+    gchar* sql;
+
+    ENTER( "" );
+
+    if ( !bulk_get_split_cols( &split_cols ) || !bulk_get_tx_cols( &tx_cols ) )
+    {
+        bulk_free_split_cols( &split_cols );
+        LEAVE( "columns not found" );
+        return FALSE;
+    }
+
+    stmt = gnc_sql_create_select_statement( be, TRANSACTION_TABLE );
+    if ( stmt == NULL )
+    {
+        bulk_free_split_cols( &split_cols );
+        LEAVE( "stmt == NULL" );
+        return TRUE;
+    }
+    result = gnc_sql_execute_select_statement( be, stmt );
+    gnc_sql_statement_dispose( stmt );
+    if ( result == NULL )
+    {
+        bulk_free_split_cols( &split_cols );
+        LEAVE( "result == NULL" );
+        return TRUE;
+    }
+
+    new_txs = g_hash_table_new( g_direct_hash, g_direct_equal );
+    for ( row = gnc_sql_result_get_first_row( result ); row != NULL;
+            row = gnc_sql_result_get_next_row( result ) )
+    {
+        Transaction* pTx = bulk_load_single_tx( be, row, &tx_cols );
+        if ( pTx != NULL )
+        {
+            g_hash_table_insert( new_txs, pTx, pTx );
+            tx_list = g_list_prepend( tx_list, pTx );
+        }
+    }
+    gnc_sql_result_dispose( result );
+
+    if ( tx_list != NULL )
+    {
+        stmt = gnc_sql_create_select_statement( be, SPLIT_TABLE );
+        if ( stmt != NULL )
+        {
+            result = gnc_sql_execute_select_statement( be, stmt );
+            gnc_sql_statement_dispose( stmt );
+            if ( result != NULL )
+            {
+                for ( row = gnc_sql_result_get_first_row( result ); row != NULL;
+                        row = gnc_sql_result_get_next_row( result ) )
+                {
+                    (void)bulk_load_single_split( be, row, &split_cols, new_txs );
+                }
+                gnc_sql_result_dispose( result );
+            }
+        }
+
+        sql = g_strdup_printf( "SELECT DISTINCT guid FROM %s", TRANSACTION_TABLE );
+        gnc_sql_slots_load_for_sql_subquery( be, sql, (BookLookupFn)xaccTransLookup );
+        g_free( sql );
+        sql = g_strdup_printf( "SELECT DISTINCT guid FROM %s", SPLIT_TABLE );
+        gnc_sql_slots_load_for_sql_subquery( be, sql, (BookLookupFn)xaccSplitLookup );
+        g_free( sql );
+    }
+
+    // Commit all of the transactions
+    for ( node = tx_list; node != NULL; node = node->next )
+    {
+        xaccTransCommitEdit( GNC_TRANSACTION(node->data) );
+    }
+    g_list_free( tx_list );
+    g_hash_table_destroy( new_txs );
+    bulk_free_split_cols( &split_cols );
+
+    LEAVE( "" );
+    return TRUE;
+}
+
 /* ================================================================= */
 /**
  * Creates the transaction and split tables.
@@ -630,7 +1000,7 @@ commit_split( GncSqlBackend* be, QofInstance* inst )
     g_return_val_if_fail( inst != NULL, FALSE );
     g_return_val_if_fail( be != NULL, FALSE );
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -702,7 +1072,7 @@ save_transaction( GncSqlBackend* be, Transaction* pTx, gboolean do_save_splits )
     g_return_val_if_fail( pTx != NULL, FALSE );
 
     inst = QOF_INSTANCE(pTx);
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -893,6 +1263,12 @@ void gnc_sql_transaction_load_all_tx( GncSqlBackend* be )
 
     g_return_if_fail( be != NULL );
 
+    if ( bulk_load && qof_collection_count( qof_book_get_collection( be->book, GNC_ID_TRANS ) ) == 0
+            && bulk_load_transactions( be ) )
+    {
+        return;
+    }
+
     query_sql = g_strdup_printf( "SELECT * FROM %s", TRANSACTION_TABLE );
     stmt = gnc_sql_create_statement_from_sql( be, query_sql );
     g_free( query_sql );
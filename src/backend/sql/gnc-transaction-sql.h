@@ -68,6 +68,16 @@ void gnc_sql_transaction_load_tx_for_account( GncSqlBackend* be, Account* accoun
  */
 void gnc_sql_transaction_load_all_tx( GncSqlBackend* be );
 
+/**
+ * Selects how gnc_sql_transaction_load_all_tx() loads into a book
+ * without transactions: with one query per table, decoding the rows
+ * directly (the default), or through the generic column tables like
+ * the other loads.
+ *
+ * @param bulk TRUE for the bulk load
+ */
+void gnc_sql_transaction_set_bulk_load( gboolean bulk );
+
 typedef struct
 {
     Account* acct;
@@ -174,7 +174,7 @@ save_vendor( GncSqlBackend* be, QofInstance* inst )
 
     v = GNC_VENDOR(inst);
 
-    is_infant = qof_instance_get_infant( inst );
+    is_infant = gnc_sql_instance_is_infant( be, inst );
     if ( qof_instance_get_destroying( inst ) )
     {
         op = OP_DB_DELETE;
@@ -228,12 +228,264 @@ cleanup_gnc_price(sixtp_child_result *result)
     if (result->data) gnc_price_unref((GNCPrice *) result->data);
 }
 
+/* <price>, streamed
+
+   Same as above, but the price is filled as the sax callbacks fire
+   rather than from a dom tree of the whole price.  All elements below
+   <price> share one price_stream; the text of the current element is
+   collected in a reused buffer and converted when the element ends.
+   Returns the GNCPrice * in result of the top level frame. */
+
+struct price_stream
+{
+    GNCPrice *price;
+    QofBook *book;
+    GString *text;
+    gboolean guid_type;
+    Timespec ts;
+    gboolean seen_ts;
+    gchar *cmdty_space;
+    gchar *cmdty_id;
+    gboolean ok;
+};
+
+static gnc_commodity *
+price_stream_commodity(struct price_stream *stream)
+{
+    gnc_commodity *c = NULL;
+
+    if (stream->cmdty_space && stream->cmdty_id)
+        c = gnc_commodity_table_lookup(gnc_commodity_table_get_table(stream->book),
+                                       stream->cmdty_space, stream->cmdty_id);
+    g_free(stream->cmdty_space);
+    g_free(stream->cmdty_id);
+    stream->cmdty_space = stream->cmdty_id = NULL;
+    return c;
+}
+
+static gboolean
+price_stream_sub_node(struct price_stream *stream, const gchar *tag)
+{
+    GNCPrice *p = stream->price;
+    const gchar *text = stream->text->str;
+
+    if (strcmp("ts:date", tag) == 0)
+    {
+        stream->seen_ts = string_to_timespec_secs(text, &stream->ts);
+        return stream->seen_ts;
+    }
+    else if (strcmp("ts:ns", tag) == 0)
+    {
+        return string_to_timespec_nsecs(text, &stream->ts);
+    }
+    else if (strcmp("cmdty:space", tag) == 0)
+    {
+        g_free(stream->cmdty_space);
+        stream->cmdty_space = g_strstrip(g_strdup(text));
+    }
+    else if (strcmp("cmdty:id", tag) == 0)
+    {
+        g_free(stream->cmdty_id);
+        stream->cmdty_id = g_strstrip(g_strdup(text));
+    }
+    else if (strcmp("price:id", tag) == 0)
+    {
+        GncGUID guid;
+        if (!stream->guid_type || !string_to_guid(text, &guid)) return FALSE;
+        gnc_price_set_guid(p, &guid);
+    }
+    else if (strcmp("price:commodity", tag) == 0)
+    {
+        gnc_commodity *c = price_stream_commodity(stream);
+        if (!c) return FALSE;
+        gnc_price_set_commodity(p, c);
+    }
+    else if (strcmp("price:currency", tag) == 0)
+    {
+        gnc_commodity *c = price_stream_commodity(stream);
+        if (!c) return FALSE;
+        gnc_price_set_currency(p, c);
+    }
+    else if (strcmp("price:time", tag) == 0)
+    {
+        Timespec t = stream->ts;
+        if (!stream->seen_ts)
+        {
+            PERR("no ts:date node found.");
+            return FALSE;
+        }
+        stream->seen_ts = FALSE;
+        stream->ts.tv_sec = stream->ts.tv_nsec = 0;
+        if (!dom_tree_valid_timespec(&t, BAD_CAST tag)) return FALSE;
+        gnc_price_set_time(p, t);
+    }
+    else if (strcmp("price:source", tag) == 0)
+    {
+        gnc_price_set_source(p, text);
+    }
+    else if (strcmp("price:type", tag) == 0)
+    {
+        gnc_price_set_typestr(p, text);
+    }
+    else if (strcmp("price:value", tag) == 0)
+    {
+        gnc_numeric value;
+        if (!string_to_gnc_numeric(text, &value)) return FALSE;
+        gnc_price_set_value(p, value);
+    }
+    return TRUE;
+}
+
+static void
+price_stream_free(struct price_stream *stream)
+{
+    g_string_free(stream->text, TRUE);
+    g_free(stream->cmdty_space);
+    g_free(stream->cmdty_id);
+    g_free(stream);
+}
+
+static gboolean
+price_stream_start_handler(GSList* sibling_data, gpointer parent_data,
+                           gpointer global_data, gpointer *data_for_children,
+                           gpointer *result, const gchar *tag, gchar **attrs)
+{
+    struct price_stream *stream = parent_data;
+    gxpf_data *gdata = global_data;
+
+    if (!tag) return TRUE;
+
+    if (!stream)
+    {
+        stream = g_new0(struct price_stream, 1);
+        stream->book = gdata->bookdata;
+        stream->text = g_string_sized_new(64);
+        stream->ok = TRUE;
+        stream->price = gnc_price_create(stream->book);
+        if (!stream->price)
+        {
+            price_stream_free(stream);
+            return FALSE;
+        }
+        gnc_price_begin_edit(stream->price);
+        *result = stream;
+    }
+    *data_for_children = stream;
+
+    g_string_truncate(stream->text, 0);
+    stream->guid_type = (attrs && attrs[0] && strcmp(attrs[0], "type") == 0
+                         && (strcmp(attrs[1], "guid") == 0
+                             || strcmp(attrs[1], "new") == 0));
+    return TRUE;
+}
+
+static gboolean
+price_stream_chars_handler(GSList *sibling_data, gpointer parent_data,
+                           gpointer global_data, gpointer *result,
+                           const char *text, int length)
+{
+    struct price_stream *stream = parent_data;
+
+    if (stream && length > 0)
+        g_string_append_len(stream->text, text, length);
+    return TRUE;
+}
+
+static gboolean
+price_stream_end_handler(gpointer data_for_children,
+                         GSList* data_from_children,
+                         GSList* sibling_data,
+                         gpointer parent_data,
+                         gpointer global_data,
+                         gpointer *result,
+                         const gchar *tag)
+{
+    struct price_stream *stream = data_for_children;
+    GNCPrice *p;
+    gboolean ok;
+
+    if (!tag) return TRUE;
+    g_return_val_if_fail(stream, FALSE);
+
+    if (parent_data)
+    {
+        if (stream->ok && !price_stream_sub_node(stream, tag))
+        {
+            PERR("failed to parse %s", tag);
+            stream->ok = FALSE;
+        }
+        g_string_truncate(stream->text, 0);
+        return TRUE;
+    }
+
+    p = stream->price;
+    ok = stream->ok;
+    gnc_price_commit_edit(p);
+    price_stream_free(stream);
+
+    if (ok)
+    {
+        *result = p;
+    }
+    else
+    {
+        *result = NULL;
+        gnc_price_unref(p);
+    }
+    return ok;
+}
+
+static void
+price_stream_fail_handler(gpointer data_for_children,
+                          GSList* data_from_children,
+                          GSList* sibling_data,
+                          gpointer parent_data,
+                          gpointer global_data,
+                          gpointer *result,
+                          const gchar *tag)
+{
+    struct price_stream *stream = *result;
+
+    /* only set for the top level frame, see the start handler */
+    if (!stream) return;
+
+    gnc_price_commit_edit(stream->price);
+    gnc_price_unref(stream->price);
+    price_stream_free(stream);
+    *result = NULL;
+}
+
 static sixtp *
 gnc_price_parser_new (void)
 {
-    return sixtp_dom_parser_new(price_parse_xml_end_handler,
-                                cleanup_gnc_price,
-                                cleanup_gnc_price);
+    sixtp *top_level;
+
+    if (!gnc_xml_get_streaming_load())
+        return sixtp_dom_parser_new(price_parse_xml_end_handler,
+                                    cleanup_gnc_price,
+                                    cleanup_gnc_price);
+
+    if (!(top_level =
+                sixtp_set_any(sixtp_new(), FALSE,
+                              SIXTP_START_HANDLER_ID, price_stream_start_handler,
+                              SIXTP_CHARACTERS_HANDLER_ID,
+                              price_stream_chars_handler,
+                              SIXTP_END_HANDLER_ID, price_stream_end_handler,
+                              SIXTP_FAIL_HANDLER_ID, price_stream_fail_handler,
+                              SIXTP_CLEANUP_RESULT_ID, cleanup_gnc_price,
+                              SIXTP_RESULT_FAIL_ID, cleanup_gnc_price,
+                              SIXTP_NO_MORE_HANDLERS)))
+    {
+        return NULL;
+    }
+
+    if (!sixtp_add_sub_parser(top_level, SIXTP_MAGIC_CATCHER, top_level))
+    {
+        sixtp_destroy(top_level);
+        return NULL;
+    }
+
+    return top_level;
 }
 
 
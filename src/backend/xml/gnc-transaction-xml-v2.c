@@ -47,6 +47,9 @@
 #include "gnc-lot.h"
 #include "gnc-lot-p.h"
 
+/* This static indicates the debugging module that this .o belongs to.  */
+static QofLogModule log_module = GNC_MOD_IO;
+
 const gchar *transaction_version_string = "2.0.0";
 
 static void
@@ -193,6 +196,114 @@ gnc_transaction_dom_tree_create(Transaction *trn)
     return ret;
 }
 
+/* The streaming writer: the same elements as the tree above, in the
+   same order, so that the file stays identical. */
+
+static void
+add_timespec_xml_string(GString *out, int level, const gchar *tag,
+                        Timespec tms, gboolean always)
+{
+    if (always || !((tms.tv_sec == 0) && (tms.tv_nsec == 0)))
+    {
+        timespec_to_xml_string(out, level, tag, NULL, &tms);
+    }
+}
+
+static void
+split_to_xml_string(GString *out, int level, const gchar *tag, Split *spl)
+{
+    const char *memo = xaccSplitGetMemo(spl);
+    const char *action = xaccSplitGetAction(spl);
+    GNCLot *lot = xaccSplitGetLot(spl);
+    gnc_numeric num;
+    char tmp[2];
+
+    xml_string_start(out, level, tag, NULL);
+    level++;
+
+    guid_to_xml_string(out, level, "split:id", xaccSplitGetGUID(spl));
+
+    if (memo && safe_strcmp(memo, "") != 0)
+    {
+        text_to_xml_string(out, level, "split:memo", NULL, memo);
+    }
+    if (action && safe_strcmp(action, "") != 0)
+    {
+        text_to_xml_string(out, level, "split:action", NULL, action);
+    }
+
+    tmp[0] = xaccSplitGetReconcile(spl);
+    tmp[1] = '\0';
+    text_to_xml_string(out, level, "split:reconciled-state", NULL, tmp);
+
+    add_timespec_xml_string(out, level, "split:reconcile-date",
+                            xaccSplitRetDateReconciledTS(spl), FALSE);
+
+    num = xaccSplitGetValue(spl);
+    gnc_numeric_to_xml_string(out, level, "split:value", &num);
+    num = xaccSplitGetAmount(spl);
+    gnc_numeric_to_xml_string(out, level, "split:quantity", &num);
+
+    guid_to_xml_string(out, level, "split:account",
+                       xaccAccountGetGUID(xaccSplitGetAccount(spl)));
+    if (lot)
+    {
+        guid_to_xml_string(out, level, "split:lot", gnc_lot_get_guid(lot));
+    }
+
+    kvp_frame_to_xml_string(out, level, "split:slots", xaccSplitGetSlots(spl));
+
+    xml_string_end(out, level - 1, tag);
+}
+
+void
+gnc_transaction_to_xml_string(GString *out, Transaction *trn)
+{
+    GList *n = xaccTransGetSplitList(trn);
+
+    g_string_append_printf(out, "<gnc:transaction version=\"%s\">\n",
+                           transaction_version_string);
+
+    guid_to_xml_string(out, 1, "trn:id", xaccTransGetGUID(trn));
+
+    commodity_ref_to_xml_string(out, 1, "trn:currency",
+                                xaccTransGetCurrency(trn));
+
+    if (xaccTransGetNum(trn) && (safe_strcmp(xaccTransGetNum(trn), "") != 0))
+    {
+        text_to_xml_string(out, 1, "trn:num", NULL, xaccTransGetNum(trn));
+    }
+
+    add_timespec_xml_string(out, 1, "trn:date-posted",
+                            xaccTransRetDatePostedTS(trn), TRUE);
+    add_timespec_xml_string(out, 1, "trn:date-entered",
+                            xaccTransRetDateEnteredTS(trn), TRUE);
+
+    if (xaccTransGetDescription(trn))
+    {
+        text_to_xml_string(out, 1, "trn:description", NULL,
+                           xaccTransGetDescription(trn));
+    }
+
+    kvp_frame_to_xml_string(out, 1, "trn:slots", xaccTransGetSlots(trn));
+
+    if (!n)
+    {
+        text_to_xml_string(out, 1, "trn:splits", NULL, NULL);
+    }
+    else
+    {
+        xml_string_start(out, 1, "trn:splits", NULL);
+        for (; n; n = n->next)
+        {
+            split_to_xml_string(out, 2, "trn:split", n->data);
+        }
+        xml_string_end(out, 1, "trn:splits");
+    }
+
+    g_string_append(out, "</gnc:transaction>\n");
+}
+
 /***********************************************************************/
 
 struct split_pdata
@@ -642,8 +753,595 @@ dom_tree_to_transaction( xmlNodePtr node, QofBook *book )
     return trn;
 }
 
+/***********************************************************************/
+/* <gnc:transaction>, streamed
+
+   Builds the transaction straight from the sax callbacks instead of
+   collecting a dom tree of it first.  All the elements below the
+   transaction share one trans_stream: the text of the current element
+   is collected in a reused buffer, and when the element ends it is
+   handed to the same setters as above.  Only trn:slots and split:slots,
+   which nest arbitrarily, are still built as a dom tree and converted
+   by dom_tree_to_kvp_frame_given. */
+
+static gboolean streaming_load = TRUE;
+
+void
+gnc_xml_set_streaming_load(gboolean streaming)
+{
+    streaming_load = streaming;
+}
+
+gboolean
+gnc_xml_get_streaming_load(void)
+{
+    return streaming_load;
+}
+
+struct trans_stream
+{
+    Transaction *trans;
+    Split *split;        /* the trn:split being read, if any */
+    QofBook *book;
+    GString *text;       /* text of the current element */
+    gboolean guid_type;  /* the current element has type="guid" */
+    Timespec ts;         /* from ts:date and ts:ns, for the enclosing date */
+    gboolean seen_ts;
+    gchar *cmdty_space;  /* from cmdty:space and cmdty:id, for trn:currency */
+    gchar *cmdty_id;
+    xmlNodePtr slots;    /* a slots subtree being built, and its open node */
+    xmlNodePtr slots_node;
+    guint trn_gotten;
+    guint spl_gotten;
+    gboolean spl_ok;
+    gboolean ok;
+};
+
+struct stream_handler
+{
+    const gchar *tag;
+    gboolean (*handler)(struct trans_stream *stream, const gchar *text);
+    guint required;      /* the bit this tag sets in trn_ or spl_gotten */
+};
+
+static gboolean
+stream_guid(struct trans_stream *stream, const gchar *text, GncGUID *guid)
+{
+    if (!stream->guid_type)
+    {
+        PERR("id without a guid type attribute");
+        return FALSE;
+    }
+    return string_to_guid(text, guid);
+}
+
+static gboolean
+stream_timespec(struct trans_stream *stream, const gchar *tag, Timespec *ts)
+{
+    gboolean seen = stream->seen_ts;
+
+    *ts = stream->ts;
+    stream->ts.tv_sec = 0;
+    stream->ts.tv_nsec = 0;
+    stream->seen_ts = FALSE;
+    if (!seen)
+    {
+        PERR("no ts:date node found.");
+        return FALSE;
+    }
+    return dom_tree_valid_timespec(ts, BAD_CAST tag);
+}
+
+static gboolean
+str_ts_date_handler(struct trans_stream *stream, const gchar *text)
+{
+    stream->seen_ts = string_to_timespec_secs(text, &stream->ts);
+    return stream->seen_ts;
+}
+
+static gboolean
+str_ts_ns_handler(struct trans_stream *stream, const gchar *text)
+{
+    return string_to_timespec_nsecs(text, &stream->ts);
+}
+
+static gboolean
+str_cmdty_space_handler(struct trans_stream *stream, const gchar *text)
+{
+    g_free(stream->cmdty_space);
+    stream->cmdty_space = g_strstrip(g_strdup(text));
+    return TRUE;
+}
+
+static gboolean
+str_cmdty_id_handler(struct trans_stream *stream, const gchar *text)
+{
+    g_free(stream->cmdty_id);
+    stream->cmdty_id = g_strstrip(g_strdup(text));
+    return TRUE;
+}
+
+static gboolean
+str_spl_id_handler(struct trans_stream *stream, const gchar *text)
+{
+    GncGUID guid;
+
+    if (!stream_guid(stream, text, &guid)) return FALSE;
+    xaccSplitSetGUID(stream->split, &guid);
+    return TRUE;
+}
+
+static gboolean
+str_spl_memo_handler(struct trans_stream *stream, const gchar *text)
+{
+    xaccSplitSetMemo(stream->split, text);
+    return TRUE;
+}
+
+static gboolean
+str_spl_action_handler(struct trans_stream *stream, const gchar *text)
+{
+    xaccSplitSetAction(stream->split, text);
+    return TRUE;
+}
+
+static gboolean
+str_spl_reconciled_state_handler(struct trans_stream *stream,
+                                 const gchar *text)
+{
+    xaccSplitSetReconcile(stream->split, text[0]);
+    return TRUE;
+}
+
+static gboolean
+str_spl_reconcile_date_handler(struct trans_stream *stream, const gchar *text)
+{
+    Timespec ts;
+
+    if (!stream_timespec(stream, "split:reconcile-date", &ts)) return FALSE;
+    xaccSplitSetDateReconciledTS(stream->split, &ts);
+    return TRUE;
+}
+
+static gboolean
+str_spl_value_handler(struct trans_stream *stream, const gchar *text)
+{
+    gnc_numeric num;
+
+    if (!string_to_gnc_numeric(text, &num)) return FALSE;
+    xaccSplitSetValue(stream->split, num);
+    return TRUE;
+}
+
+static gboolean
+str_spl_quantity_handler(struct trans_stream *stream, const gchar *text)
+{
+    gnc_numeric num;
+
+    if (!string_to_gnc_numeric(text, &num)) return FALSE;
+    xaccSplitSetAmount(stream->split, num);
+    return TRUE;
+}
+
+static gboolean
+str_spl_account_handler(struct trans_stream *stream, const gchar *text)
+{
+    GncGUID guid;
+    Account *account;
+
+    if (!stream_guid(stream, text, &guid)) return FALSE;
+
+    account = xaccAccountLookup (&guid, stream->book);
+    if (!account && gnc_transaction_xml_v2_testing &&
+            !guid_equal (&guid, guid_null ()))
+    {
+        account = xaccMallocAccount (stream->book);
+        xaccAccountSetGUID (account, &guid);
+        xaccAccountSetCommoditySCU (account,
+                                    xaccSplitGetAmount (stream->split).denom);
+    }
+
+    xaccAccountInsertSplit (account, stream->split);
+    return TRUE;
+}
+
+static gboolean
+str_spl_lot_handler(struct trans_stream *stream, const gchar *text)
+{
+    GncGUID guid;
+    GNCLot *lot;
+
+    if (!stream_guid(stream, text, &guid)) return FALSE;
+
+    lot = gnc_lot_lookup (&guid, stream->book);
+    if (!lot && gnc_transaction_xml_v2_testing &&
+            !guid_equal (&guid, guid_null ()))
+    {
+        lot = gnc_lot_new (stream->book);
+        gnc_lot_set_guid (lot, guid);
+    }
+
+    gnc_lot_add_split (lot, stream->split);
+    return TRUE;
+}
+
+static gboolean
+str_trn_id_handler(struct trans_stream *stream, const gchar *text)
+{
+    GncGUID guid;
+
+    if (!stream_guid(stream, text, &guid)) return FALSE;
+    xaccTransSetGUID(stream->trans, &guid);
+    return TRUE;
+}
+
+static gboolean
+str_trn_currency_handler(struct trans_stream *stream, const gchar *text)
+{
+    gnc_commodity *ref = NULL;
+
+    if (stream->cmdty_space && stream->cmdty_id)
+        ref = gnc_commodity_table_lookup(gnc_commodity_table_get_table(stream->book),
+                                         stream->cmdty_space, stream->cmdty_id);
+    g_free(stream->cmdty_space);
+    g_free(stream->cmdty_id);
+    stream->cmdty_space = stream->cmdty_id = NULL;
+
+    g_return_val_if_fail(ref, FALSE);
+    xaccTransSetCurrency(stream->trans, ref);
+    return TRUE;
+}
+
+static gboolean
+str_trn_num_handler(struct trans_stream *stream, const gchar *text)
+{
+    xaccTransSetNum(stream->trans, text);
+    return TRUE;
+}
+
+static gboolean
+str_trn_date_posted_handler(struct trans_stream *stream, const gchar *text)
+{
+    Timespec ts;
+
+    if (!stream_timespec(stream, "trn:date-posted", &ts)) return FALSE;
+    xaccTransSetDatePostedTS(stream->trans, &ts);
+    return TRUE;
+}
+
+static gboolean
+str_trn_date_entered_handler(struct trans_stream *stream, const gchar *text)
+{
+    Timespec ts;
+
+    if (!stream_timespec(stream, "trn:date-entered", &ts)) return FALSE;
+    xaccTransSetDateEnteredTS(stream->trans, &ts);
+    return TRUE;
+}
+
+static gboolean
+str_trn_description_handler(struct trans_stream *stream, const gchar *text)
+{
+    xaccTransSetDescription(stream->trans, text);
+    return TRUE;
+}
+
+static gboolean
+str_trn_splits_handler(struct trans_stream *stream, const gchar *text)
+{
+    return TRUE;
+}
+
+/* Most frequent tags first. */
+static struct stream_handler str_part_handlers[] =
+{
+    { "ts:date", str_ts_date_handler, 0 },
+    { "ts:ns", str_ts_ns_handler, 0 },
+    { "cmdty:space", str_cmdty_space_handler, 0 },
+    { "cmdty:id", str_cmdty_id_handler, 0 },
+    { NULL, NULL, 0 },
+};
+
+static struct stream_handler str_spl_handlers[] =
+{
+    { "split:id", str_spl_id_handler, 1 << 0 },
+    { "split:reconciled-state", str_spl_reconciled_state_handler, 1 << 1 },
+    { "split:value", str_spl_value_handler, 1 << 2 },
+    { "split:quantity", str_spl_quantity_handler, 1 << 3 },
+    { "split:account", str_spl_account_handler, 1 << 4 },
+    { "split:memo", str_spl_memo_handler, 0 },
+    { "split:action", str_spl_action_handler, 0 },
+    { "split:reconcile-date", str_spl_reconcile_date_handler, 0 },
+    { "split:lot", str_spl_lot_handler, 0 },
+    { NULL, NULL, 0 },
+};
+#define SPL_ALL_REQUIRED 0x1f
+
+static struct stream_handler str_trn_handlers[] =
+{
+    { "trn:id", str_trn_id_handler, 1 << 0 },
+    { "trn:date-posted", str_trn_date_posted_handler, 1 << 1 },
+    { "trn:date-entered", str_trn_date_entered_handler, 1 << 2 },
+    { "trn:splits", str_trn_splits_handler, 1 << 3 },
+    { "trn:currency", str_trn_currency_handler, 0 },
+    { "trn:num", str_trn_num_handler, 0 },
+    { "trn:description", str_trn_description_handler, 0 },
+    { NULL, NULL, 0 },
+};
+#define TRN_ALL_REQUIRED 0xf
+
+static struct stream_handler*
+stream_handler_find(struct stream_handler *handlers, const gchar *tag)
+{
+    for (; handlers->tag; handlers++)
+        if (strcmp(handlers->tag, tag) == 0)
+            return handlers;
+    return NULL;
+}
+
+static void
+trans_stream_free(struct trans_stream *stream)
+{
+    if (stream->slots) xmlFreeNode(stream->slots);
+    if (stream->split) xaccSplitDestroy(stream->split);
+    g_string_free(stream->text, TRUE);
+    g_free(stream->cmdty_space);
+    g_free(stream->cmdty_id);
+    g_free(stream);
+}
+
+static gboolean
+gnc_transaction_stream_start_handler(GSList* sibling_data, gpointer parent_data,
+                                     gpointer global_data,
+                                     gpointer *data_for_children,
+                                     gpointer *result, const gchar *tag,
+                                     gchar **attrs)
+{
+    struct trans_stream *stream = parent_data;
+    gxpf_data *gdata = (gxpf_data*)global_data;
+
+    /* Called without a tag when this is the top level parser. */
+    if (!tag)
+    {
+        return TRUE;
+    }
+
+    if (!stream)
+    {
+        stream = g_new0(struct trans_stream, 1);
+        stream->book = gdata->bookdata;
+        stream->text = g_string_sized_new(64);
+        stream->ok = TRUE;
+        stream->trans = xaccMallocTransaction(stream->book);
+        xaccTransBeginEdit(stream->trans);
+        /* only the top level frame owns the stream */
+        *result = stream;
+    }
+    *data_for_children = stream;
+
+    if (stream->slots)
+    {
+        stream->slots_node = xmlNewChild(stream->slots_node, NULL,
+                                         BAD_CAST tag, NULL);
+        for (; attrs && *attrs; attrs += 2)
+            xmlSetProp(stream->slots_node, BAD_CAST attrs[0], BAD_CAST attrs[1]);
+        return TRUE;
+    }
+
+    g_string_truncate(stream->text, 0);
+    stream->guid_type = (attrs && attrs[0] && strcmp(attrs[0], "type") == 0
+                         && (strcmp(attrs[1], "guid") == 0
+                             || strcmp(attrs[1], "new") == 0));
+
+    if (strcmp(tag, "trn:slots") == 0 || strcmp(tag, "split:slots") == 0)
+    {
+        stream->slots = stream->slots_node = xmlNewNode(NULL, BAD_CAST tag);
+    }
+    else if (strcmp(tag, "trn:split") == 0)
+    {
+        g_return_val_if_fail(!stream->split, FALSE);
+        stream->split = xaccMallocSplit(stream->book);
+        stream->spl_gotten = 0;
+        stream->spl_ok = TRUE;
+    }
+    return TRUE;
+}
+
+static gboolean
+gnc_transaction_stream_chars_handler(GSList *sibling_data, gpointer parent_data,
+                                     gpointer global_data, gpointer *result,
+                                     const char *text, int length)
+{
+    struct trans_stream *stream = parent_data;
+
+    if (!stream || length <= 0)
+        return TRUE;
+
+    if (stream->slots)
+        xmlNodeAddContentLen(stream->slots_node, BAD_CAST text, length);
+    else
+        g_string_append_len(stream->text, text, length);
+    return TRUE;
+}
+
+static void
+trans_stream_end_split(struct trans_stream *stream)
+{
+    if (stream->spl_ok && stream->spl_gotten == SPL_ALL_REQUIRED)
+    {
+        xaccTransAppendSplit(stream->trans, stream->split);
+    }
+    else
+    {
+        /* Like the dom parser, reject the whole transaction rather than
+           load it without the split. */
+        PERR("didn't find all of the expected tags in the split");
+        xaccSplitDestroy(stream->split);
+        stream->ok = FALSE;
+    }
+    stream->split = NULL;
+}
+
+static gboolean
+trans_stream_end_slots(struct trans_stream *stream)
+{
+    gboolean successful;
+    kvp_frame *frame = stream->split ? xaccSplitGetSlots(stream->split) :
+                       xaccTransGetSlots(stream->trans);
+
+    successful = dom_tree_to_kvp_frame_given(stream->slots, frame);
+    xmlFreeNode(stream->slots);
+    stream->slots = stream->slots_node = NULL;
+    return successful;
+}
+
+static void
+trans_stream_fail(struct trans_stream *stream, const gchar *tag)
+{
+    PERR("failed to parse %s", tag);
+    if (stream->split)
+        stream->spl_ok = FALSE;
+    else
+        stream->ok = FALSE;
+}
+
+static gboolean
+gnc_transaction_stream_end_handler(gpointer data_for_children,
+                                   GSList* data_from_children,
+                                   GSList* sibling_data,
+                                   gpointer parent_data, gpointer global_data,
+                                   gpointer *result, const gchar *tag)
+{
+    struct trans_stream *stream = data_for_children;
+    gxpf_data *gdata = (gxpf_data*)global_data;
+    struct stream_handler *handler;
+    Transaction *trn;
+    gboolean successful;
+
+    /* OK.  For some messed up reason this is getting called again with a
+       NULL tag.  So we ignore those cases */
+    if (!tag)
+    {
+        return TRUE;
+    }
+
+    g_return_val_if_fail(stream, FALSE);
+
+    if (parent_data)
+    {
+        if (stream->slots && stream->slots_node != stream->slots)
+        {
+            stream->slots_node = stream->slots_node->parent;
+        }
+        else if (stream->slots)
+        {
+            if (!trans_stream_end_slots(stream))
+                trans_stream_fail(stream, tag);
+        }
+        else if (stream->split && strcmp(tag, "trn:split") == 0)
+        {
+            trans_stream_end_split(stream);
+        }
+        else if ((stream->split &&
+                  (handler = stream_handler_find(str_spl_handlers, tag))) ||
+                 (!stream->split &&
+                  (handler = stream_handler_find(str_trn_handlers, tag))) ||
+                 (handler = stream_handler_find(str_part_handlers, tag)))
+        {
+            if (!handler->handler(stream, stream->text->str))
+                trans_stream_fail(stream, tag);
+            if (stream->split)
+                stream->spl_gotten |= handler->required;
+            else
+                stream->trn_gotten |= handler->required;
+        }
+        else
+        {
+            PERR("Unhandled tag: %s", tag);
+            if (stream->split)
+                stream->spl_ok = FALSE;
+            else
+                stream->ok = FALSE;
+        }
+        g_string_truncate(stream->text, 0);
+        return TRUE;
+    }
+
+    trn = stream->trans;
+    xaccTransCommitEdit(trn);
+
+    successful = stream->ok;
+    if (stream->trn_gotten != TRN_ALL_REQUIRED)
+    {
+        PERR("didn't find all of the expected tags in the input");
+        successful = FALSE;
+    }
+
+    if (successful)
+    {
+        gdata->cb(tag, gdata->parsedata, trn);
+    }
+    else
+    {
+        xaccTransBeginEdit(trn);
+        xaccTransDestroy(trn);
+        xaccTransCommitEdit(trn);
+    }
+
+    trans_stream_free(stream);
+    *result = NULL;
+
+    return successful;
+}
+
+static void
+gnc_transaction_stream_fail_handler(gpointer data_for_children,
+                                    GSList* data_from_children,
+                                    GSList* sibling_data,
+                                    gpointer parent_data,
+                                    gpointer global_data,
+                                    gpointer *result,
+                                    const gchar *tag)
+{
+    struct trans_stream *stream = *result;
+
+    /* only set for the top level frame, see the start handler */
+    if (!stream) return;
+
+    xaccTransDestroy(stream->trans);
+    xaccTransCommitEdit(stream->trans);
+    trans_stream_free(stream);
+    *result = NULL;
+}
+
 sixtp*
 gnc_transaction_sixtp_parser_create(void)
 {
-    return sixtp_dom_parser_new(gnc_transaction_end_handler, NULL, NULL);
+    sixtp *top_level;
+
+    if (!streaming_load)
+        return sixtp_dom_parser_new(gnc_transaction_end_handler, NULL, NULL);
+
+    if (!(top_level =
+                sixtp_set_any(sixtp_new(), FALSE,
+                              SIXTP_START_HANDLER_ID,
+                              gnc_transaction_stream_start_handler,
+                              SIXTP_CHARACTERS_HANDLER_ID,
+                              gnc_transaction_stream_chars_handler,
+                              SIXTP_END_HANDLER_ID,
+                              gnc_transaction_stream_end_handler,
+                              SIXTP_FAIL_HANDLER_ID,
+                              gnc_transaction_stream_fail_handler,
+                              SIXTP_NO_MORE_HANDLERS)))
+    {
+        return NULL;
+    }
+
+    if (!sixtp_add_sub_parser(top_level, SIXTP_MAGIC_CATCHER, top_level))
+    {
+        sixtp_destroy(top_level);
+        return NULL;
+    }
+
+    return top_level;
 }
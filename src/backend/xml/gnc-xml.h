@@ -59,8 +59,18 @@ xmlNodePtr gnc_budget_dom_tree_create( GncBudget *bgt );
 sixtp* gnc_budget_sixtp_parser_create(void);
 
 xmlNodePtr gnc_transaction_dom_tree_create(Transaction *txn);
+/** Append to out the text of gnc_transaction_dom_tree_create(txn) as
+ *  the file backend writes it, without building the tree. */
+void gnc_transaction_to_xml_string(GString *out, Transaction *txn);
 sixtp* gnc_transaction_sixtp_parser_create(void);
 
+/** Whether the parsers for transactions and prices fill the objects
+ *  straight from the sax callbacks, or first build a dom tree of each
+ *  of them, as the other parsers do.  Streaming is the default; the
+ *  setting applies to parsers created after the call. */
+void gnc_xml_set_streaming_load(gboolean streaming);
+gboolean gnc_xml_get_streaming_load(void);
+
 sixtp* gnc_template_transaction_sixtp_parser_create(void);
 
 #endif /* GNC_XML_H */
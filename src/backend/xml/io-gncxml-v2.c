@@ -91,6 +91,7 @@ struct file_backend
     const char    * tag;
     sixtp         * parser;
     FILE          * out;
+    GString       * buf;    /* reused by xml_add_trn_data */
     QofBook       * book;
 };
 
@@ -1093,14 +1094,15 @@ static int
 xml_add_trn_data(Transaction *t, gpointer data)
 {
     struct file_backend *be_data = data;
-    xmlNodePtr node;
-
-    node = gnc_transaction_dom_tree_create(t);
+    GString *buf = be_data->buf;
 
-    xmlElemDump(be_data->out, NULL, node);
-    xmlFreeNode(node);
+    /* Write the text of the transaction's dom tree without building
+       it, there can be a lot of transactions. */
+    g_string_truncate(buf, 0);
+    gnc_transaction_to_xml_string(buf, t);
 
-    if (ferror(be_data->out) || fprintf(be_data->out, "\n") < 0)
+    if (fwrite(buf->str, 1, buf->len, be_data->out) != buf->len
+            || ferror(be_data->out))
         return -1;
 
     be_data->gd->counter.transactions_loaded++;
@@ -1112,13 +1114,17 @@ static gboolean
 write_transactions(FILE *out, QofBook *book, sixtp_gdv2 *gd)
 {
     struct file_backend be_data;
+    gboolean success;
 
     be_data.out = out;
     be_data.gd = gd;
-    return 0 ==
-           xaccAccountTreeForEachTransaction(gnc_book_get_root_account(book),
-                   xml_add_trn_data,
-                   (gpointer) &be_data);
+    be_data.buf = g_string_sized_new(4096);
+    success = (0 ==
+               xaccAccountTreeForEachTransaction(gnc_book_get_root_account(book),
+                       xml_add_trn_data,
+                       (gpointer) &be_data));
+    g_string_free(be_data.buf, TRUE);
+    return success;
 }
 
 static gboolean
@@ -1126,6 +1132,7 @@ write_template_transaction_data( FILE *out, QofBook *book, sixtp_gdv2 *gd )
 {
     Account *ra;
     struct file_backend be_data;
+    gboolean success = TRUE;
 
     be_data.out = out;
     be_data.gd = gd;
@@ -1133,15 +1140,17 @@ write_template_transaction_data( FILE *out, QofBook *book, sixtp_gdv2 *gd )
     ra = gnc_book_get_template_root(book);
     if ( gnc_account_n_descendants(ra) > 0 )
     {
+        be_data.buf = g_string_sized_new(4096);
         if (fprintf(out, "<%s>\n", TEMPLATE_TRANSACTION_TAG) < 0
                 || !write_account_tree(out, ra, gd)
                 || xaccAccountTreeForEachTransaction(ra, xml_add_trn_data, (gpointer)&be_data)
                 || fprintf(out, "</%s>\n", TEMPLATE_TRANSACTION_TAG) < 0)
 
-            return FALSE;
+            success = FALSE;
+        g_string_free(be_data.buf, TRUE);
     }
 
-    return TRUE;
+    return success;
 }
 
 static gboolean
@@ -1317,123 +1326,493 @@ gnc_book_write_accounts_to_xml_filehandle_v2(QofBackend *be, QofBook *book, FILE
     return success;
 }
 
-#define BUFLEN 4096
+/* The (de)compression thread works on blocks of GZ_BLOCK_SIZE.  Saving
+ * deflates the blocks in parallel, pigz style: each block is a raw
+ * deflate stream primed with the last GZ_DICT_SIZE bytes of the block
+ * before it and ended with a sync flush, so that their concatenation,
+ * between a gzip header and trailer, is a single gzip member any gzip
+ * reader understands.  Loading cannot inflate in parallel, but a read
+ * ahead thread keeps GZ_READ_AHEAD blocks of the file ready, so that
+ * reading the disk, inflating and parsing overlap. */
+#define GZ_BLOCK_SIZE (128 * 1024)
+#define GZ_DICT_SIZE 32768
+#define GZ_READ_AHEAD 8
+#define GZ_MAX_THREADS 16
+#define GZ_PIPE_SIZE (1024 * 1024)
 
-/* Compress or decompress function that is to be run in a separate thread.
- * Returns 1 on success or 0 otherwise, stuffed into a pointer type. */
-static gpointer
-gz_thread_func(gz_thread_params_t *params)
+typedef struct
 {
-    gchar buffer[BUFLEN];
-    gssize bytes;
-    gint gzval;
-    gzFile *file;
-    gint success = 1;
+    GMutex *mutex;
+    GCond *cond;
+} gz_deflate_ctx_t;
 
-#ifdef G_OS_WIN32
+typedef struct
+{
+    Bytef *in;
+    gsize in_len;
+    Bytef dict[GZ_DICT_SIZE];
+    gsize dict_len;
+    Bytef *out;
+    gsize out_len;
+    uLong crc;
+    gboolean ok;
+    gboolean done;
+} gz_block_t;
+
+typedef struct
+{
+    Bytef *data;
+    gssize len;    /* 0 at the end of the file, -1 on errors */
+} gz_chunk_t;
+
+typedef struct
+{
+    FILE *file;
+    GThread *thread;
+    GAsyncQueue *free_chunks;
+    GAsyncQueue *full_chunks;
+    gz_chunk_t *chunk;    /* used without a thread */
+    gint cancel;
+} gz_read_ahead_t;
+
+static gint
+gz_n_threads(void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n > 0)
+        return MIN(n, GZ_MAX_THREADS);
+#endif
+    return 2;
+}
+
+/* Read up to len bytes from the pipe.  Returns the number of bytes
+ * read, less than len only at its end, or -1 on errors. */
+static gssize
+gz_read_pipe(gint fd, Bytef *buffer, gsize len)
+{
+    gsize total = 0;
+
+    while (total < len)
     {
-        gchar *conv_name = g_win32_locale_filename_from_utf8(params->filename);
-        gchar *perms;
+        gssize bytes = read(fd, buffer + total, len - total);
 
-        if (!conv_name)
+        if (bytes == 0)
+            break;
+        if (bytes < 0)
         {
-            g_warning("Could not convert '%s' to system codepage",
-                      params->filename);
-            success = 0;
-            goto cleanup_gz_thread_func;
+            if (errno == EINTR)
+                continue;
+            g_warning("Could not read from pipe. The error is '%s' (errno %d)",
+                      g_strerror(errno) ? g_strerror(errno) : "", errno);
+            return -1;
         }
+        total += bytes;
+    }
+    return total;
+}
 
-        if (strchr(params->perms, 'b'))
-            perms = g_strdup(params->perms);
-        else
-            perms = g_strdup_printf("%cb%s", *params->perms, params->perms + 1);
+static gboolean
+gz_write_pipe(gint fd, const Bytef *buffer, gsize len)
+{
+    while (len > 0)
+    {
+        gssize bytes =
+#if COMPILER(MSVC)
+            _write
+#else
+            write
+#endif
+            (fd, buffer, len);
+
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            g_warning("Could not write to pipe. The error is '%s' (%d)",
+                      g_strerror(errno) ? g_strerror(errno) : "", errno);
+            return FALSE;
+        }
+        buffer += bytes;
+        len -= bytes;
+    }
+    return TRUE;
+}
+
+/* Run by the thread pool, or by the compression thread itself if
+ * there is no pool. */
+static void
+gz_deflate_block(gz_block_t *block, gz_deflate_ctx_t *ctx)
+{
+    z_stream strm;
+    gsize size;
+    gint zval = Z_STREAM_ERROR;
+
+    memset(&strm, 0, sizeof(strm));
+    block->crc = crc32(crc32(0L, Z_NULL, 0), block->in, block->in_len);
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+                     8, Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        if (block->dict_len > 0)
+            deflateSetDictionary(&strm, block->dict, block->dict_len);
+
+        /* The sync flush adds a few bytes to the bound. */
+        size = deflateBound(&strm, block->in_len) + 16;
+        block->out = g_malloc(size);
+        strm.next_in = block->in;
+        strm.avail_in = block->in_len;
+        strm.next_out = block->out;
+        strm.avail_out = size;
+        while ((zval = deflate(&strm, Z_SYNC_FLUSH)) == Z_OK
+                && strm.avail_out == 0)
+        {
+            block->out = g_realloc(block->out, 2 * size);
+            strm.next_out = block->out + size;
+            strm.avail_out = size;
+            size *= 2;
+        }
+        block->out_len = size - strm.avail_out;
+        deflateEnd(&strm);
+    }
+    block->ok = (zval == Z_OK);
 
-        file = gzopen(conv_name, perms);
-        g_free(perms);
-        g_free(conv_name);
+    g_mutex_lock(ctx->mutex);
+    block->done = TRUE;
+    g_cond_broadcast(ctx->cond);
+    g_mutex_unlock(ctx->mutex);
+}
+
+static void
+gz_put_le32(FILE *file, uLong val)
+{
+    gint i;
+
+    for (i = 0; i < 4; i++, val >>= 8)
+        putc((int)(val & 0xff), file);
+}
+
+/* Wait for the first block in the queue and write it, unless an earlier
+ * one failed.  Frees the block. */
+static gboolean
+gz_write_block(gz_block_t *block, gz_deflate_ctx_t *ctx, FILE *file,
+               uLong *crc, uLong *total, gboolean success)
+{
+    g_mutex_lock(ctx->mutex);
+    while (!block->done)
+        g_cond_wait(ctx->cond, ctx->mutex);
+    g_mutex_unlock(ctx->mutex);
+
+    if (success)
+    {
+        if (!block->ok)
+        {
+            g_warning("Could not compress a block of the file");
+            success = FALSE;
+        }
+        else if (fwrite(block->out, 1, block->out_len, file) != block->out_len)
+        {
+            success = FALSE;
+        }
+        *crc = crc32_combine(*crc, block->crc, block->in_len);
+        *total += block->in_len;
     }
-#else /* !G_OS_WIN32 */
-    file = gzopen(params->filename, params->perms);
-#endif /* G_OS_WIN32 */
 
+    g_free(block->in);
+    g_free(block->out);
+    g_free(block);
+    return success;
+}
+
+static gint
+gz_compress(gz_thread_params_t *params)
+{
+    static const Bytef header[10] =
+    { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xff };
+    /* A final, empty, fixed huffman block ends the deflate stream. */
+    static const Bytef last_block[2] = { 0x03, 0x00 };
+    gz_deflate_ctx_t ctx;
+    GThreadPool *pool;
+    GQueue *queue = g_queue_new();
+    gz_block_t *block, *prev = NULL;
+    gint n_threads = gz_n_threads();
+    uLong crc = crc32(0L, Z_NULL, 0);
+    uLong total = 0;
+    gboolean success = TRUE;
+    FILE *file;
+
+    file = g_fopen(params->filename, "wb");
     if (file == NULL)
     {
-        g_warning("Child threads gzopen failed");
-        success = 0;
-        goto cleanup_gz_thread_func;
+        g_warning("Could not open the compressed file '%s'. The error is '%s'",
+                  params->filename, g_strerror(errno) ? g_strerror(errno) : "");
+        g_queue_free(queue);
+        return 0;
     }
 
-    if (params->compress)
+    ctx.mutex = g_mutex_new();
+    ctx.cond = g_cond_new();
+    pool = g_thread_pool_new((GFunc)gz_deflate_block, &ctx, n_threads,
+                             FALSE, NULL);
+
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
+        success = FALSE;
+
+    while (success)
     {
-        while (success)
+        gssize bytes;
+
+        block = g_new0(gz_block_t, 1);
+        block->in = g_malloc(GZ_BLOCK_SIZE);
+        bytes = gz_read_pipe(params->fd, block->in, GZ_BLOCK_SIZE);
+        if (bytes <= 0)
         {
-            bytes = read(params->fd, buffer, BUFLEN);
-            if (bytes > 0)
-            {
-                if (gzwrite(file, buffer, bytes) <= 0)
-                {
-                    gint errnum;
-                    const gchar *error = gzerror(file, &errnum);
-                    g_warning("Could not write the compressed file '%s'. The error is: '%s' (%d)",
-                              params->filename, error, errnum);
-                    success = 0;
-                }
-            }
-            else if (bytes == 0)
+            success = (bytes == 0);
+            g_free(block->in);
+            g_free(block);
+            break;
+        }
+        block->in_len = bytes;
+        if (prev)
+        {
+            block->dict_len = MIN(prev->in_len, GZ_DICT_SIZE);
+            memcpy(block->dict, prev->in + prev->in_len - block->dict_len,
+                   block->dict_len);
+        }
+
+        if (pool)
+            g_thread_pool_push(pool, block, NULL);
+        else
+            gz_deflate_block(block, &ctx);
+        g_queue_push_tail(queue, block);
+        prev = block;
+
+        /* Keep all threads busy, but do not read the whole book ahead. */
+        while (g_queue_get_length(queue) > 2 * n_threads)
+            success = gz_write_block(g_queue_pop_head(queue), &ctx, file,
+                                     &crc, &total, success);
+    }
+
+    while (!g_queue_is_empty(queue))
+        success = gz_write_block(g_queue_pop_head(queue), &ctx, file,
+                                 &crc, &total, success);
+
+    if (success)
+    {
+        fwrite(last_block, 1, sizeof(last_block), file);
+        gz_put_le32(file, crc);
+        gz_put_le32(file, total);
+    }
+    if (ferror(file))
+        success = FALSE;
+    if (fclose(file) != 0 || !success)
+    {
+        g_warning("Could not write the compressed file '%s'", params->filename);
+        success = FALSE;
+    }
+
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
+    g_queue_free(queue);
+    g_cond_free(ctx.cond);
+    g_mutex_free(ctx.mutex);
+
+    return success ? 1 : 0;
+}
+
+static gpointer
+gz_read_ahead_func(gz_read_ahead_t *ra)
+{
+    gz_chunk_t *chunk;
+
+    do
+    {
+        chunk = g_async_queue_pop(ra->free_chunks);
+        if (g_atomic_int_get(&ra->cancel))
+        {
+            chunk->len = 0;
+        }
+        else
+        {
+            chunk->len = fread(chunk->data, 1, GZ_BLOCK_SIZE, ra->file);
+            if (chunk->len == 0 && ferror(ra->file))
+                chunk->len = -1;
+        }
+        g_async_queue_push(ra->full_chunks, chunk);
+    }
+    while (chunk->len > 0);
+
+    return NULL;
+}
+
+static gz_chunk_t *
+gz_read_ahead_next(gz_read_ahead_t *ra)
+{
+    gz_chunk_t *chunk;
+
+    if (ra->thread)
+        return g_async_queue_pop(ra->full_chunks);
+
+    chunk = ra->chunk;
+    chunk->len = fread(chunk->data, 1, GZ_BLOCK_SIZE, ra->file);
+    if (chunk->len == 0 && ferror(ra->file))
+        chunk->len = -1;
+    return chunk;
+}
+
+static void
+gz_read_ahead_done(gz_read_ahead_t *ra, gz_chunk_t *chunk)
+{
+    if (ra->thread)
+        g_async_queue_push(ra->free_chunks, chunk);
+}
+
+static gint
+gz_decompress(gz_thread_params_t *params)
+{
+    gz_read_ahead_t ra;
+    gz_chunk_t *chunk;
+    gz_chunk_t chunks[GZ_READ_AHEAD];
+    Bytef *out = g_malloc(GZ_BLOCK_SIZE);
+    z_stream strm;
+    gboolean first = TRUE, gzipped = FALSE, stream_end = FALSE;
+    gboolean finished = FALSE, reader_done = FALSE, success = TRUE;
+    gint i, zval;
+
+    memset(&ra, 0, sizeof(ra));
+    ra.file = g_fopen(params->filename, "rb");
+    if (ra.file == NULL)
+    {
+        g_warning("Could not open the compressed file '%s'. The error is '%s'",
+                  params->filename, g_strerror(errno) ? g_strerror(errno) : "");
+        g_free(out);
+        return 0;
+    }
+
+    ra.free_chunks = g_async_queue_new();
+    ra.full_chunks = g_async_queue_new();
+    for (i = 0; i < GZ_READ_AHEAD; i++)
+    {
+        chunks[i].data = g_malloc(GZ_BLOCK_SIZE);
+        g_async_queue_push(ra.free_chunks, &chunks[i]);
+    }
+    ra.chunk = &chunks[0];
+    ra.thread = g_thread_create((GThreadFunc)gz_read_ahead_func, &ra, TRUE, NULL);
+
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, MAX_WBITS + 16) != Z_OK)
+        success = FALSE;
+
+    while (success && !finished)
+    {
+        chunk = gz_read_ahead_next(&ra);
+        if (chunk->len <= 0)
+        {
+            finished = reader_done = TRUE;
+            if (chunk->len < 0)
             {
-                break;
+                g_warning("Could not read from compressed file '%s'. The error is '%s'",
+                          params->filename, g_strerror(errno) ? g_strerror(errno) : "");
+                success = FALSE;
             }
-            else
+            /* A truncated file */
+            else if (gzipped && !stream_end)
             {
-                g_warning("Could not read from pipe. The error is '%s' (errno %d)",
-                          g_strerror(errno) ? g_strerror(errno) : "", errno);
-                success = 0;
+                g_warning("Could not read from compressed file '%s'. "
+                          "The file ends too early", params->filename);
+                success = FALSE;
             }
+            break;
         }
-    }
-    else
-    {
-        while (success)
+
+        /* Like gzread, pass on files that are not compressed. */
+        if (first)
+        {
+            gzipped = (chunk->len >= 2 && chunk->data[0] == 0x1f
+                       && chunk->data[1] == 0x8b);
+            first = FALSE;
+        }
+        if (!gzipped)
+        {
+            success = gz_write_pipe(params->fd, chunk->data, chunk->len);
+            gz_read_ahead_done(&ra, chunk);
+            continue;
+        }
+
+        strm.next_in = chunk->data;
+        strm.avail_in = chunk->len;
+        do
         {
-            gzval = gzread(file, buffer, BUFLEN);
-            if (gzval > 0)
+            if (stream_end)
             {
-                if (
-#if COMPILER(MSVC)
-                    _write
-#else
-                    write
-#endif
-                    (params->fd, buffer, gzval) < 0)
+                /* Another member follows, or garbage to ignore. */
+                if (strm.next_in[0] != 0x1f)
                 {
-                    g_warning("Could not write to pipe. The error is '%s' (%d)",
-                              g_strerror(errno) ? g_strerror(errno) : "", errno);
-                    success = 0;
+                    finished = TRUE;
+                    break;
                 }
+                inflateReset(&strm);
+                stream_end = FALSE;
             }
-            else if (gzval == 0)
+            strm.next_out = out;
+            strm.avail_out = GZ_BLOCK_SIZE;
+            zval = inflate(&strm, Z_NO_FLUSH);
+            if (zval == Z_STREAM_END)
             {
-                break;
+                stream_end = TRUE;
             }
-            else
+            else if (zval != Z_OK && zval != Z_BUF_ERROR)
             {
-                gint errnum;
-                const gchar *error = gzerror(file, &errnum);
                 g_warning("Could not read from compressed file '%s'. The error is: '%s' (%d)",
-                          params->filename, error, errnum);
-                success = 0;
+                          params->filename, strm.msg ? strm.msg : "", zval);
+                success = FALSE;
+                break;
             }
+            success = gz_write_pipe(params->fd, out, GZ_BLOCK_SIZE - strm.avail_out);
         }
+        while (success && (strm.avail_in > 0
+                           || (strm.avail_out == 0 && !stream_end)));
+        gz_read_ahead_done(&ra, chunk);
     }
 
-    if ((gzval = gzclose(file)) != Z_OK)
+    if (ra.thread)
     {
-        g_warning("Could not close the compressed file '%s' (errnum %d)",
-                  params->filename, gzval);
-        success = 0;
+        /* Stop the reader, and let it have its chunks back until it is
+           done. */
+        g_atomic_int_set(&ra.cancel, 1);
+        while (!reader_done)
+        {
+            chunk = g_async_queue_pop(ra.full_chunks);
+            reader_done = (chunk->len <= 0);
+            if (!reader_done)
+                gz_read_ahead_done(&ra, chunk);
+        }
+        g_thread_join(ra.thread);
     }
 
-cleanup_gz_thread_func:
+    inflateEnd(&strm);
+    fclose(ra.file);
+    for (i = 0; i < GZ_READ_AHEAD; i++)
+        g_free(chunks[i].data);
+    g_async_queue_unref(ra.free_chunks);
+    g_async_queue_unref(ra.full_chunks);
+    g_free(out);
+
+    return success ? 1 : 0;
+}
+
+/* Compress or decompress function that is to be run in a separate thread.
+ * Returns 1 on success or 0 otherwise, stuffed into a pointer type. */
+static gpointer
+gz_thread_func(gz_thread_params_t *params)
+{
+    gint success;
+
+    if (params->compress)
+        success = gz_compress(params);
+    else
+        success = gz_decompress(params);
+
     close(params->fd);
     g_free(params->filename);
     g_free(params->perms);
@@ -1469,6 +1848,10 @@ try_gz_open (const char *filename, const char *perms, gboolean use_gzip,
             g_warning("Pipe call failed. Opening uncompressed file.");
             return g_fopen(filename, perms);
         }
+#ifdef F_SETPIPE_SZ
+        /* Let the parser and the (de)compression run further apart. */
+        fcntl(filedes[0], F_SETPIPE_SZ, GZ_PIPE_SIZE);
+#endif
 
         params = g_new(gz_thread_params_t, 1);
         params->fd = filedes[compress ? 0 : 1];
@@ -1495,6 +1878,8 @@ try_gz_open (const char *filename, const char *perms, gboolean use_gzip,
             file = fdopen(filedes[1], "w");
         else
             file = fdopen(filedes[0], "r");
+        if (file)
+            setvbuf(file, NULL, _IOFBF, GZ_BLOCK_SIZE);
 
         G_LOCK(threads);
         if (!threads)
@@ -261,7 +261,7 @@ add_text_to_node(xmlNodePtr node, gchar *type, gchar *val)
 
 
 static void
-add_kvp_slot(gpointer key, gpointer value, gpointer data);
+add_kvp_slot(const char *key, kvp_value *value, gpointer data);
 
 static void
 add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
@@ -351,11 +351,7 @@ add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
         xmlSetProp(val_node, BAD_CAST "type", BAD_CAST "frame");
 
         frame = kvp_value_get_frame (val);
-        if (!frame || !kvp_frame_get_hash (frame))
-            break;
-
-        g_hash_table_foreach_sorted(kvp_frame_get_hash(frame),
-                                    add_kvp_slot, val_node, (GCompareFunc)strcmp);
+        kvp_frame_for_each_slot_sorted(frame, add_kvp_slot, val_node);
     }
     break;
 
@@ -363,16 +359,16 @@ add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
 }
 
 static void
-add_kvp_slot(gpointer key, gpointer value, gpointer data)
+add_kvp_slot(const char *key, kvp_value *value, gpointer data)
 {
     xmlNodePtr slot_node;
     xmlNodePtr node = (xmlNodePtr)data;
 
     slot_node = xmlNewChild(node, NULL, BAD_CAST "slot", NULL);
 
-    xmlNewTextChild(slot_node, NULL, BAD_CAST "slot:key", (xmlChar*)key);
+    xmlNewTextChild(slot_node, NULL, BAD_CAST "slot:key", BAD_CAST key);
 
-    add_kvp_value_node(slot_node, "slot:value", (kvp_value*)value);
+    add_kvp_value_node(slot_node, "slot:value", value);
 }
 
 xmlNodePtr
@@ -380,26 +376,330 @@ kvp_frame_to_dom_tree(const char *tag, const kvp_frame *frame)
 {
     xmlNodePtr ret;
 
-    if (!frame)
+    if (kvp_frame_is_empty(frame))
     {
         return NULL;
     }
 
-    if (!kvp_frame_get_hash(frame))
+    ret = xmlNewNode(NULL, BAD_CAST tag);
+
+    kvp_frame_for_each_slot_sorted((kvp_frame *)frame, add_kvp_slot, ret);
+
+    return ret;
+}
+
+
+/***********************************************************************/
+/* Streaming generators
+
+   These append to out the text that xmlElemDump writes for the tree
+   built by the generator of the same name, as an element at the given
+   depth below the top level element, followed by a newline.  They let
+   the file backend write big objects without building a tree. */
+
+/* libxml2 indents by two spaces per level, up to 60 columns. */
+#define XML_INDENT_MAX_LEVEL 30
+
+void
+xml_string_indent(GString *out, int level)
+{
+    static const gchar spaces[2 * XML_INDENT_MAX_LEVEL + 1] =
+        "                                                            ";
+
+    g_string_append_len(out, spaces, 2 * MIN(level, XML_INDENT_MAX_LEVEL));
+}
+
+/* Escape text content like xmlEscapeContent does. */
+void
+xml_string_escape(GString *out, const char *str)
+{
+    const char *run = str;
+    const char *entity;
+
+    for (; *str; str++)
     {
-        return NULL;
+        switch (*str)
+        {
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        case '&':
+            entity = "&amp;";
+            break;
+        case '\r':
+            entity = "&#13;";
+            break;
+        default:
+            continue;
+        }
+        g_string_append_len(out, run, str - run);
+        g_string_append(out, entity);
+        run = str + 1;
     }
+    g_string_append_len(out, run, str - run);
+}
 
-    if (g_hash_table_size(kvp_frame_get_hash(frame)) == 0)
+static void
+xml_string_open(GString *out, int level, const char *tag, const char *type)
+{
+    xml_string_indent(out, level);
+    g_string_append_c(out, '<');
+    g_string_append(out, tag);
+    if (type)
     {
-        return NULL;
+        g_string_append(out, " type=\"");
+        g_string_append(out, type);
+        g_string_append_c(out, '"');
     }
+}
 
-    ret = xmlNewNode(NULL, BAD_CAST tag);
+void
+xml_string_start(GString *out, int level, const char *tag, const char *type)
+{
+    xml_string_open(out, level, tag, type);
+    g_string_append(out, ">\n");
+}
 
-    g_hash_table_foreach_sorted(kvp_frame_get_hash(frame),
-                                add_kvp_slot, ret, (GCompareFunc)strcmp);
+void
+xml_string_end(GString *out, int level, const char *tag)
+{
+    xml_string_indent(out, level);
+    g_string_append(out, "</");
+    g_string_append(out, tag);
+    g_string_append(out, ">\n");
+}
 
-    return ret;
+/* A NULL str gives an empty element, an empty one a start and an end
+   tag, as with xmlNewTextChild. */
+void
+text_to_xml_string(GString *out, int level, const char *tag,
+                   const char *type, const char *str)
+{
+    xml_string_open(out, level, tag, type);
+    if (!str)
+    {
+        g_string_append(out, "/>\n");
+        return;
+    }
+    g_string_append_c(out, '>');
+    xml_string_escape(out, str);
+    g_string_append(out, "</");
+    g_string_append(out, tag);
+    g_string_append(out, ">\n");
+}
+
+void
+guid_to_xml_string(GString *out, int level, const char *tag,
+                   const GncGUID *gid)
+{
+    char guid_str[GUID_ENCODING_LENGTH + 1];
+
+    if (!guid_to_string_buff(gid, guid_str))
+    {
+        PERR("guid_to_string_buff failed\n");
+        return;
+    }
+    text_to_xml_string(out, level, tag, "guid", guid_str);
+}
+
+void
+commodity_ref_to_xml_string(GString *out, int level, const char *tag,
+                            const gnc_commodity *c)
+{
+    g_return_if_fail(c);
+
+    if (!gnc_commodity_get_namespace(c) || !gnc_commodity_get_mnemonic(c))
+    {
+        return;
+    }
+
+    xml_string_start(out, level, tag, NULL);
+    text_to_xml_string(out, level + 1, "cmdty:space", NULL,
+                       gnc_commodity_get_namespace_compat(c));
+    text_to_xml_string(out, level + 1, "cmdty:id", NULL,
+                       gnc_commodity_get_mnemonic(c));
+    xml_string_end(out, level, tag);
 }
 
+void
+timespec_to_xml_string(GString *out, int level, const char *tag,
+                       const char *type, const Timespec *spec)
+{
+    gchar date_str[TIMESPEC_SEC_FORMAT_MAX];
+
+    g_return_if_fail(spec);
+
+    if (!timespec_secs_to_given_string(spec, date_str))
+    {
+        return;
+    }
+
+    xml_string_start(out, level, tag, type);
+    text_to_xml_string(out, level + 1, "ts:date", NULL, date_str);
+    if (spec->tv_nsec > 0)
+    {
+        xml_string_indent(out, level + 1);
+        g_string_append_printf(out, "<ts:ns>%ld</ts:ns>\n", spec->tv_nsec);
+    }
+    xml_string_end(out, level, tag);
+}
+
+void
+gnc_numeric_to_xml_string(GString *out, int level, const char *tag,
+                          const gnc_numeric *num)
+{
+    g_return_if_fail(num);
+
+    xml_string_indent(out, level);
+    g_string_append_printf(out, "<%s>%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT
+                           "</%s>\n", tag, num->num, num->denom, tag);
+}
+
+struct kvp_xml_string
+{
+    GString *out;
+    int level;
+};
+
+static void
+add_kvp_slot_xml_string(const char *key, kvp_value *value, gpointer data);
+
+/* The content set by xmlNodeSetContent in add_text_to_node: no text
+   node at all for an empty string. */
+static void
+add_kvp_text_xml_string(GString *out, int level, const char *tag,
+                        const char *type, gchar *val)
+{
+    text_to_xml_string(out, level, tag, type, (val && *val) ? val : NULL);
+    g_free(val);
+}
+
+static void
+add_kvp_value_xml_string(GString *out, int level, const char *tag,
+                         kvp_value *val)
+{
+    switch (kvp_value_get_type(val))
+    {
+    case KVP_TYPE_GINT64:
+        xml_string_open(out, level, tag, "integer");
+        g_string_append_printf(out, ">%" G_GINT64_FORMAT "</%s>\n",
+                               kvp_value_get_gint64(val), tag);
+        break;
+    case KVP_TYPE_DOUBLE:
+        add_kvp_text_xml_string(out, level, tag, "double",
+                                double_to_string(kvp_value_get_double(val)));
+        break;
+    case KVP_TYPE_NUMERIC:
+        add_kvp_text_xml_string(out, level, tag, "numeric",
+                                gnc_numeric_to_string(kvp_value_get_numeric(val)));
+        break;
+    case KVP_TYPE_STRING:
+        text_to_xml_string(out, level, tag, "string", kvp_value_get_string(val));
+        break;
+    case KVP_TYPE_GUID:
+    {
+        char guid_str[GUID_ENCODING_LENGTH + 1];
+
+        guid_to_string_buff(kvp_value_get_guid(val), guid_str);
+        text_to_xml_string(out, level, tag, "guid", guid_str);
+    }
+    break;
+    case KVP_TYPE_TIMESPEC:
+    {
+        Timespec ts = kvp_value_get_timespec (val);
+
+        timespec_to_xml_string(out, level, tag, "timespec", &ts);
+    }
+    break;
+    case KVP_TYPE_GDATE:
+    {
+        GDate d = kvp_value_get_gdate(val);
+        gchar date_str[512];
+
+        g_date_strftime(date_str, sizeof(date_str), "%Y-%m-%d", &d);
+        xml_string_start(out, level, tag, "gdate");
+        text_to_xml_string(out, level + 1, "gdate", NULL, date_str);
+        xml_string_end(out, level, tag);
+    }
+    break;
+    case KVP_TYPE_BINARY:
+    {
+        guint64 size;
+        void *binary_data = kvp_value_get_binary(val, &size);
+
+        if (!binary_data)
+            text_to_xml_string(out, level, tag, "binary", NULL);
+        g_return_if_fail(binary_data);
+        add_kvp_text_xml_string(out, level, tag, "binary",
+                                binary_to_string(binary_data, size));
+    }
+    break;
+    case KVP_TYPE_GLIST:
+    {
+        GList *cursor = kvp_value_get_glist(val);
+
+        if (!cursor)
+        {
+            text_to_xml_string(out, level, tag, "list", NULL);
+            break;
+        }
+        xml_string_start(out, level, tag, "list");
+        for (; cursor; cursor = cursor->next)
+            add_kvp_value_xml_string(out, level + 1, "slot:value",
+                                     (kvp_value*)cursor->data);
+        xml_string_end(out, level, tag);
+    }
+    break;
+    case KVP_TYPE_FRAME:
+    {
+        kvp_frame *frame = kvp_value_get_frame (val);
+        struct kvp_xml_string data;
+
+        if (kvp_frame_is_empty(frame))
+        {
+            text_to_xml_string(out, level, tag, "frame", NULL);
+            break;
+        }
+        data.out = out;
+        data.level = level + 1;
+        xml_string_start(out, level, tag, "frame");
+        kvp_frame_for_each_slot_sorted(frame, add_kvp_slot_xml_string, &data);
+        xml_string_end(out, level, tag);
+    }
+    break;
+    }
+}
+
+static void
+add_kvp_slot_xml_string(const char *key, kvp_value *value, gpointer data)
+{
+    struct kvp_xml_string *kdata = data;
+
+    xml_string_start(kdata->out, kdata->level, "slot", NULL);
+    text_to_xml_string(kdata->out, kdata->level + 1, "slot:key", NULL, key);
+    add_kvp_value_xml_string(kdata->out, kdata->level + 1, "slot:value",
+                             value);
+    xml_string_end(kdata->out, kdata->level, "slot");
+}
+
+void
+kvp_frame_to_xml_string(GString *out, int level, const char *tag,
+                        const kvp_frame *frame)
+{
+    struct kvp_xml_string data;
+
+    if (kvp_frame_is_empty(frame))
+    {
+        return;
+    }
+
+    data.out = out;
+    data.level = level + 1;
+    xml_string_start(out, level, tag, NULL);
+    kvp_frame_for_each_slot_sorted((kvp_frame *)frame, add_kvp_slot_xml_string,
+                                   &data);
+    xml_string_end(out, level, tag);
+}
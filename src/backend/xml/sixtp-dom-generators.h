@@ -49,4 +49,25 @@ xmlNodePtr recurrence_to_dom_tree(const gchar *tag, const Recurrence *r);
 
 gchar* double_to_string(double value);
 
+/* Streaming counterparts of the generators above: append to out what
+   xmlElemDump writes for their tree at the given depth, newline
+   included. */
+void xml_string_indent(GString *out, int level);
+void xml_string_escape(GString *out, const char *str);
+void xml_string_start(GString *out, int level, const char *tag,
+                      const char *type);
+void xml_string_end(GString *out, int level, const char *tag);
+void text_to_xml_string(GString *out, int level, const char *tag,
+                        const char *type, const char *str);
+void guid_to_xml_string(GString *out, int level, const char *tag,
+                        const GncGUID *gid);
+void commodity_ref_to_xml_string(GString *out, int level, const char *tag,
+                                 const gnc_commodity *c);
+void timespec_to_xml_string(GString *out, int level, const char *tag,
+                            const char *type, const Timespec *spec);
+void gnc_numeric_to_xml_string(GString *out, int level, const char *tag,
+                               const gnc_numeric *num);
+void kvp_frame_to_xml_string(GString *out, int level, const char *tag,
+                             const kvp_frame *frame);
+
 #endif /* _SIXTP_DOM_GENERATORS_H_ */
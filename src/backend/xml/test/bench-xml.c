@@ -0,0 +1,307 @@
+/***************************************************************************
+ *            bench-xml.c
+ *
+ *  Time the streaming and the dom writing and loading of xml files
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file bench-xml.c
+ * @brief Print the timings that test-xml-write and test-xml-load check.
+ *
+ * This is not run by "make check".  "bench-xml 1000000" writes the
+ * transactions of a synthetic book both ways, saves it plain and
+ * compressed and loads the files back both ways.  With "stream" or
+ * "dom" after the count only the plain file is loaded that way, and
+ * the time to close the book and the peak resident size are printed
+ * too, as the latter never goes down.  The book is then generated in
+ * a child process where possible, so that it does not count.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_WAIT_H
+# include <sys/wait.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/resource.h>
+#endif
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "gnc-xml-helper.h"
+#include "qof.h"
+#include "qofbackend-p.h"
+#include "cashobjects.h"
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-pricedb.h"
+#include "gnc-xml.h"
+#include "io-gncxml-v2.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define DEFAULT_TRANSACTIONS 200000
+#define NUM_ACCOUNTS 10
+
+static QofBook *
+make_book (guint count)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity_table *table = gnc_commodity_table_get_table (book);
+    gnc_commodity *usd, *stock;
+
+    usd = gnc_commodity_table_lookup (table, GNC_COMMODITY_NS_CURRENCY, "USD");
+    stock = gnc_commodity_new (book, "Acme Inc", "NASDAQ", "ACME", NULL, 10000);
+    stock = gnc_commodity_table_insert (table, stock);
+    g_ptr_array_free (make_test_book_transactions (book, usd, NUM_ACCOUNTS,
+                                                   count), TRUE);
+    make_test_book_prices (book, stock, usd, count / 100 + 1);
+    return book;
+}
+
+static gboolean
+write_book (const gchar *filename, guint count)
+{
+    QofBook *book = make_book (count);
+    gboolean ok = gnc_book_write_to_xml_file_v2 (book, filename, FALSE);
+
+    qof_book_destroy (book);
+    return ok;
+}
+
+/* Generate the file in a child, so that the parent's peak resident
+   size only covers the load. */
+static gboolean
+generate_file (const gchar *filename, guint count)
+{
+#ifdef HAVE_SYS_WAIT_H
+    int status;
+    pid_t pid = fork ();
+
+    if (pid == 0)
+        _exit (write_book (filename, count) ? 0 : 1);
+    if (pid > 0)
+        return (waitpid (pid, &status, 0) == pid && WIFEXITED (status)
+                && WEXITSTATUS (status) == 0);
+#endif
+    return write_book (filename, count);
+}
+
+static glong
+peak_rss_kb (void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return -1;
+}
+
+static int
+write_dom (Transaction *trans, gpointer data)
+{
+    FILE *out = data;
+    xmlNodePtr node = gnc_transaction_dom_tree_create (trans);
+
+    xmlElemDump (out, NULL, node);
+    xmlFreeNode (node);
+    return fprintf (out, "\n") < 0 ? -1 : 0;
+}
+
+typedef struct
+{
+    FILE *out;
+    GString *buf;
+} StreamData;
+
+static int
+write_stream (Transaction *trans, gpointer data)
+{
+    StreamData *stream = data;
+
+    g_string_truncate (stream->buf, 0);
+    gnc_transaction_to_xml_string (stream->buf, trans);
+    return fwrite (stream->buf->str, 1, stream->buf->len, stream->out)
+           == stream->buf->len ? 0 : -1;
+}
+
+static gdouble
+time_write_transactions (QofBook *book, const gchar *filename,
+                         gboolean streaming)
+{
+    Account *root = gnc_book_get_root_account (book);
+    FILE *out = g_fopen (filename, "w");
+    GTimer *timer = g_timer_new ();
+    gdouble seconds;
+
+    if (out && streaming)
+    {
+        StreamData stream;
+
+        stream.out = out;
+        stream.buf = g_string_sized_new (4096);
+        xaccAccountTreeForEachTransaction (root, write_stream, &stream);
+        g_string_free (stream.buf, TRUE);
+    }
+    else if (out)
+    {
+        xaccAccountTreeForEachTransaction (root, write_dom, out);
+    }
+    if (out)
+        fclose (out);
+    seconds = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+    return seconds;
+}
+
+static gdouble
+time_save (QofBook *book, const gchar *filename, gboolean compress)
+{
+    GTimer *timer = g_timer_new ();
+    gdouble seconds;
+
+    if (!gnc_book_write_to_xml_file_v2 (book, filename, compress))
+        fprintf (stderr, "saving %s failed\n", filename);
+    seconds = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+    return seconds;
+}
+
+static QofBook *
+load_book (const gchar *filename, gboolean streaming, gdouble *seconds)
+{
+    QofBook *book = qof_book_new ();
+    GTimer *timer = g_timer_new ();
+    FileBackend fbe;
+
+    memset (&fbe, 0, sizeof (fbe));
+    qof_backend_init (&fbe.be);
+    fbe.fullpath = (char*)filename;
+
+    gnc_xml_set_streaming_load (streaming);
+    if (!qof_session_load_from_xml_file_v2 (&fbe, book))
+        fprintf (stderr, "loading %s failed\n", filename);
+    *seconds = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+    return book;
+}
+
+static gdouble
+time_load (const gchar *filename, gboolean streaming)
+{
+    gdouble seconds;
+
+    qof_book_destroy (load_book (filename, streaming, &seconds));
+    return seconds;
+}
+
+static void
+bench_all (guint count, const gchar *prefix)
+{
+    gchar *dom_file = g_strdup_printf ("%s-dom.xml", prefix);
+    gchar *stream_file = g_strdup_printf ("%s-stream.xml", prefix);
+    gchar *book_file = g_strdup_printf ("%s.gnucash", prefix);
+    gchar *gz_file = g_strdup_printf ("%s.gnucash.gz", prefix);
+    QofBook *book = make_book (count);
+    gdouble dom_time, stream_time, save_time, gz_time;
+
+    dom_time = time_write_transactions (book, dom_file, FALSE);
+    stream_time = time_write_transactions (book, stream_file, TRUE);
+    save_time = time_save (book, book_file, FALSE);
+    gz_time = time_save (book, gz_file, TRUE);
+    qof_book_destroy (book);
+    printf ("%8u transactions: dom write %10.3f s, streaming write %10.3f s, "
+            "book save %10.3f s, compressed %10.3f s\n", count, dom_time,
+            stream_time, save_time, gz_time);
+
+    dom_time = time_load (book_file, FALSE);
+    stream_time = time_load (book_file, TRUE);
+    gz_time = time_load (gz_file, TRUE);
+    printf ("%8u transactions: dom load %10.3f s, streaming load %10.3f s, "
+            "compressed %10.3f s\n", count, dom_time, stream_time, gz_time);
+
+    g_unlink (dom_file);
+    g_unlink (stream_file);
+    g_unlink (book_file);
+    g_unlink (gz_file);
+    g_free (dom_file);
+    g_free (stream_file);
+    g_free (book_file);
+    g_free (gz_file);
+}
+
+static void
+bench_load (guint count, const gchar *prefix, gboolean streaming)
+{
+    gchar *filename = g_strdup_printf ("%s.gnucash", prefix);
+
+    if (generate_file (filename, count))
+    {
+        glong before = peak_rss_kb ();
+        gdouble load_time;
+        QofBook *book = load_book (filename, streaming, &load_time);
+        glong after = peak_rss_kb ();
+        GTimer *timer = g_timer_new ();
+
+        qof_book_destroy (book);
+        printf ("%8u transactions: %s load %10.3f s, close %10.3f s, "
+                "peak rss %ld kB (%ld kB before the load)\n", count,
+                streaming ? "streaming" : "dom", load_time,
+                g_timer_elapsed (timer, NULL), after, before);
+        g_timer_destroy (timer);
+    }
+    else
+    {
+        fprintf (stderr, "writing %s failed\n", filename);
+    }
+    g_unlink (filename);
+    g_free (filename);
+}
+
+int
+main (int argc, char **argv)
+{
+    guint count = DEFAULT_TRANSACTIONS;
+    gchar *prefix;
+
+    if (argc > 1)
+        count = MAX (atoi (argv[1]), 1);
+
+    qof_init ();
+    cashobjects_register ();
+    xaccLogDisable ();
+
+    prefix = g_strdup_printf ("%s/bench-xml-%d", g_get_tmp_dir (),
+                              (int)getpid ());
+    if (argc > 2)
+        bench_load (count, prefix, strcmp (argv[2], "dom") != 0);
+    else
+        bench_all (count, prefix);
+    g_free (prefix);
+
+    qof_close ();
+    return 0;
+}
@@ -0,0 +1,248 @@
+/***************************************************************************
+ *            test-xml-load.c
+ *
+ *  Compare the streaming and the dom load of transactions and prices
+ *  from an xml file
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-xml-load.c
+ * @brief Load the same synthetic file both ways.
+ *
+ * A book with a few accounts, balanced two-split transactions, some of
+ * them with slots, and prices is written to an uncompressed xml file.
+ * The file is loaded once with the streaming parsers and once with the
+ * dom parsers, and the two books have to hold the same transactions
+ * and prices.  A compressed copy of the file is loaded as well, and
+ * has to give the same book.  Both parsers have to reject the whole
+ * transaction of a split with a broken value.  bench-xml times the
+ * loads.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "qof.h"
+#include "qofbackend-p.h"
+#include "cashobjects.h"
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-pricedb.h"
+#include "gnc-xml.h"
+#include "io-gncxml-v2.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TRANSACTIONS 2000
+#define NUM_ACCOUNTS 10
+
+static gboolean
+write_book (const gchar *filename, const gchar *gz_filename, guint count)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity_table *table = gnc_commodity_table_get_table (book);
+    gnc_commodity *usd, *stock;
+    gboolean ok;
+
+    usd = gnc_commodity_table_lookup (table, GNC_COMMODITY_NS_CURRENCY, "USD");
+    stock = gnc_commodity_new (book, "Acme Inc", "NASDAQ", "ACME", NULL, 10000);
+    stock = gnc_commodity_table_insert (table, stock);
+    g_ptr_array_free (make_test_book_transactions (book, usd, NUM_ACCOUNTS,
+                                                   count), TRUE);
+    make_test_book_prices (book, stock, usd, count / 100 + 1);
+
+    ok = gnc_book_write_to_xml_file_v2 (book, filename, FALSE)
+         && gnc_book_write_to_xml_file_v2 (book, gz_filename, TRUE);
+    qof_book_destroy (book);
+    return ok;
+}
+
+static QofBook *
+load_book_ok (const gchar *filename, gboolean streaming, gboolean *ok)
+{
+    QofBook *book = qof_book_new ();
+    FileBackend fbe;
+
+    memset (&fbe, 0, sizeof (fbe));
+    qof_backend_init (&fbe.be);
+    fbe.fullpath = (char*)filename;
+
+    gnc_xml_set_streaming_load (streaming);
+    *ok = qof_session_load_from_xml_file_v2 (&fbe, book);
+    return book;
+}
+
+static QofBook *
+load_book (const gchar *filename, gboolean streaming)
+{
+    gboolean ok;
+    QofBook *book = load_book_ok (filename, streaming, &ok);
+
+    do_test (ok, streaming ? "streaming load" : "dom load");
+    return book;
+}
+
+/* Break the value of the first split in the file and check that both
+ * parsers reject its whole transaction the same way. */
+static void
+test_corrupt_split (const gchar *filename)
+{
+    static const gchar id_tag[] = "<trn:id type=\"guid\">";
+    gchar *contents, *value, *id, *corrupt_filename;
+    GncGUID guid;
+    QofBook *stream_book, *dom_book;
+    gboolean stream_ok, dom_ok;
+
+    if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+        failure ("reading the file failed");
+        return;
+    }
+    value = strstr (contents, "<split:value>");
+    id = value ? g_strrstr_len (contents, value - contents, id_tag) : NULL;
+    if (!id || !string_to_guid (id + strlen (id_tag), &guid))
+    {
+        failure ("no split value in the file");
+        g_free (contents);
+        return;
+    }
+    /* "<split:value>" is 13 characters; overwrite the number. */
+    memcpy (value + 13, "bad", 3);
+
+    corrupt_filename = g_strdup_printf ("%s-corrupt", filename);
+    if (!g_file_set_contents (corrupt_filename, contents, -1, NULL))
+    {
+        failure ("writing the corrupt file failed");
+    }
+    else
+    {
+        stream_book = load_book_ok (corrupt_filename, TRUE, &stream_ok);
+        dom_book = load_book_ok (corrupt_filename, FALSE, &dom_ok);
+        do_test (stream_ok == dom_ok, "corrupt split: same load result");
+        do_test (xaccTransLookup (&guid, stream_book) == NULL,
+                 "corrupt split: streaming load rejects the transaction");
+        do_test (xaccTransLookup (&guid, dom_book) == NULL,
+                 "corrupt split: dom load rejects the transaction");
+        qof_book_destroy (stream_book);
+        qof_book_destroy (dom_book);
+    }
+    g_unlink (corrupt_filename);
+    g_free (corrupt_filename);
+    g_free (contents);
+}
+
+typedef struct
+{
+    QofBook *book;
+    gboolean same;
+} CompareData;
+
+static void
+compare_single_trans (QofInstance *inst, gpointer user_data)
+{
+    CompareData *data = user_data;
+    Transaction *other = xaccTransLookup (qof_instance_get_guid (inst),
+                                          data->book);
+
+    if (!xaccTransEqual (GNC_TRANS (inst), other, TRUE, TRUE, TRUE, FALSE))
+        data->same = FALSE;
+}
+
+static gboolean
+compare_single_price (GNCPrice *price, gpointer user_data)
+{
+    CompareData *data = user_data;
+    GNCPrice *other = gnc_price_lookup (qof_instance_get_guid (price),
+                                        data->book);
+
+    if (!gnc_price_equal (price, other))
+        data->same = FALSE;
+    return TRUE;
+}
+
+static void
+compare_books (QofBook *book_1, QofBook *book_2, guint count)
+{
+    CompareData data;
+
+    do_test (qof_collection_count (qof_book_get_collection (book_1, GNC_ID_TRANS))
+             == count, "All transactions loaded");
+    do_test (qof_collection_count (qof_book_get_collection (book_1, GNC_ID_SPLIT))
+             == qof_collection_count (qof_book_get_collection (book_2, GNC_ID_SPLIT)),
+             "Split counts match");
+    do_test (gnc_pricedb_get_num_prices (gnc_pricedb_get_db (book_1)) == count / 100 + 1,
+             "All prices loaded");
+    data.book = book_2;
+    data.same = TRUE;
+    gnc_pricedb_foreach_price (gnc_pricedb_get_db (book_1), compare_single_price,
+                               &data, FALSE);
+    do_test (data.same, "Prices match");
+
+    data.same = TRUE;
+    qof_collection_foreach (qof_book_get_collection (book_1, GNC_ID_TRANS),
+                            compare_single_trans, &data);
+    do_test (data.same, "Transactions match");
+}
+
+int
+main (int argc, char **argv)
+{
+    gchar *filename, *gz_filename;
+    QofBook *stream_book, *dom_book, *gz_book;
+
+    qof_init ();
+    cashobjects_register ();
+    xaccLogDisable ();
+
+    filename = g_strdup_printf ("%s/test-xml-load-%d.gnucash", g_get_tmp_dir (),
+                                (int)getpid ());
+    gz_filename = g_strdup_printf ("%s.gz", filename);
+    if (!write_book (filename, gz_filename, NUM_TRANSACTIONS))
+    {
+        failure ("writing the file failed");
+    }
+    else
+    {
+        stream_book = load_book (filename, TRUE);
+        dom_book = load_book (filename, FALSE);
+        compare_books (stream_book, dom_book, NUM_TRANSACTIONS);
+        compare_books (dom_book, stream_book, NUM_TRANSACTIONS);
+        gz_book = load_book (gz_filename, TRUE);
+        compare_books (gz_book, stream_book, NUM_TRANSACTIONS);
+        test_corrupt_split (filename);
+
+        qof_book_destroy (stream_book);
+        qof_book_destroy (dom_book);
+        qof_book_destroy (gz_book);
+    }
+    g_unlink (filename);
+    g_unlink (gz_filename);
+    g_free (filename);
+    g_free (gz_filename);
+
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
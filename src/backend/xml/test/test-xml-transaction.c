@@ -366,6 +366,31 @@ test_add_transaction(const char *tag, gpointer globaldata, gpointer data)
     return retval;
 }
 
+/* The file backend writes transactions with the streaming writer, which
+   has to give what xmlElemDump gives for the tree, byte for byte. */
+static gboolean
+stream_equals_dom(xmlNodePtr node, Transaction *trn)
+{
+    xmlBufferPtr dom = xmlBufferCreate();
+    GString *stream = g_string_new(NULL);
+    gboolean same;
+
+    xmlNodeDump(dom, NULL, node, 0, 1);
+    xmlBufferCCat(dom, "\n");
+    gnc_transaction_to_xml_string(stream, trn);
+
+    same = (g_strcmp0((const char*)xmlBufferContent(dom), stream->str) == 0);
+    if (!same)
+    {
+        printf("dom:\n%s\nstreaming:\n%s\n",
+               (const char*)xmlBufferContent(dom), stream->str);
+        fflush(stdout);
+    }
+    xmlBufferFree(dom);
+    g_string_free(stream, TRUE);
+    return same;
+}
+
 static void
 test_transaction(void)
 {
@@ -440,6 +465,9 @@ test_transaction(void)
             success_args("transaction_xml", __FILE__, __LINE__, "%d", i );
         }
 
+        do_test_args(stream_equals_dom(test_node, ran_trn),
+                     "streaming transaction_xml", __FILE__, __LINE__, "%d", i);
+
         filename1 = g_strdup_printf("test_file_XXXXXX");
 
         fd = g_mkstemp(filename1);
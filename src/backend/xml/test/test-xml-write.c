@@ -0,0 +1,270 @@
+/***************************************************************************
+ *            test-xml-write.c
+ *
+ *  Compare the streaming and the dom writing of transactions
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-xml-write.c
+ * @brief Write the same transactions both ways.
+ *
+ * A book gets balanced two-split transactions, some of them with slots
+ * of every kvp type and with text that needs escaping.  All of them
+ * are written once the way the file backend used to, one dom tree
+ * each dumped with xmlElemDump, and once with the streaming writer,
+ * and the two files have to be identical.  The whole book is saved as
+ * well, plain and compressed, and zlib has to read the compressed file
+ * back to the plain one.  bench-xml times the writes and the saves.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+
+#include "gnc-xml-helper.h"
+#include "qof.h"
+#include "cashobjects.h"
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-xml.h"
+#include "io-gncxml-v2.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TRANSACTIONS 2000
+#define NUM_ACCOUNTS 10
+
+/* Slots of all the types, nested frames and lists included. */
+static void
+add_slots (KvpFrame *frame, guint i)
+{
+    static const guchar binary[] = { 0x00, 0x7f, 0x80, 0xff };
+    KvpFrame *sub = kvp_frame_new ();
+    GList *list = NULL;
+    GDate date;
+    Timespec ts;
+
+    ts.tv_sec = TEST_BOOK_START + i;
+    ts.tv_nsec = (i % 2) ? 500 : 0;
+    g_date_clear (&date, 1);
+    g_date_set_dmy (&date, 1 + i % 28, G_DATE_JANUARY, 2001);
+
+    kvp_frame_set_string (frame, "notes", "Line one\r\nA & B <c>");
+    kvp_frame_set_string (frame, "empty", "");
+    kvp_frame_set_gint64 (frame, "a/b/int64-val", i);
+    kvp_frame_set_double (frame, "a/double-val", i / 7.0);
+    kvp_frame_set_numeric (frame, "a/numeric-val", gnc_numeric_create (i, 100));
+    kvp_frame_set_timespec (frame, "date/timespec-val", ts);
+    kvp_frame_set_value_nc (frame, "date/gdate-val", kvp_value_new_gdate (date));
+    kvp_frame_set_value_nc (frame, "binary-val",
+                            kvp_value_new_binary (binary, sizeof (binary)));
+    kvp_frame_set_guid (frame, "guid-val", guid_null ());
+
+    list = g_list_append (list, kvp_value_new_string ("first"));
+    list = g_list_append (list, kvp_value_new_gint64 (i));
+    list = g_list_append (list, kvp_value_new_frame_nc (kvp_frame_new ()));
+    kvp_frame_set_value_nc (frame, "list-val", kvp_value_new_glist_nc (list));
+
+    kvp_frame_set_string (sub, "deep/string", "deep");
+    kvp_frame_set_frame_nc (frame, "sub", sub);
+    kvp_frame_set_frame_nc (frame, "empty-frame", kvp_frame_new ());
+}
+
+/* Every tenth transaction gets slots of all the types on itself and
+ * on its second split. */
+static void
+add_trans_slots (QofInstance *inst, gpointer user_data)
+{
+    Transaction *trans = GNC_TRANS (inst);
+    guint *i = user_data;
+
+    if ((*i)++ % 10 != 0)
+        return;
+    xaccTransBeginEdit (trans);
+    add_slots (xaccTransGetSlots (trans), *i);
+    add_slots (xaccSplitGetSlots (xaccTransGetSplit (trans, 1)), *i);
+    xaccTransCommitEdit (trans);
+}
+
+static QofBook *
+make_book (guint count)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity *usd;
+    guint i = 0;
+
+    usd = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                      GNC_COMMODITY_NS_CURRENCY, "USD");
+    g_ptr_array_free (make_test_book_transactions (book, usd, NUM_ACCOUNTS,
+                                                   count), TRUE);
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_TRANS),
+                            add_trans_slots, &i);
+    return book;
+}
+
+static int
+write_dom (Transaction *trans, gpointer data)
+{
+    FILE *out = data;
+    xmlNodePtr node = gnc_transaction_dom_tree_create (trans);
+
+    xmlElemDump (out, NULL, node);
+    xmlFreeNode (node);
+    return fprintf (out, "\n") < 0 ? -1 : 0;
+}
+
+typedef struct
+{
+    FILE *out;
+    GString *buf;
+} StreamData;
+
+static int
+write_stream (Transaction *trans, gpointer data)
+{
+    StreamData *stream = data;
+
+    g_string_truncate (stream->buf, 0);
+    gnc_transaction_to_xml_string (stream->buf, trans);
+    return fwrite (stream->buf->str, 1, stream->buf->len, stream->out)
+           == stream->buf->len ? 0 : -1;
+}
+
+static gboolean
+write_transactions (QofBook *book, const gchar *filename, gboolean streaming)
+{
+    Account *root = gnc_book_get_root_account (book);
+    FILE *out = g_fopen (filename, "w");
+    gboolean ok;
+
+    if (!out)
+        return FALSE;
+    if (streaming)
+    {
+        StreamData stream;
+
+        stream.out = out;
+        stream.buf = g_string_sized_new (4096);
+        ok = (xaccAccountTreeForEachTransaction (root, write_stream, &stream) == 0);
+        g_string_free (stream.buf, TRUE);
+    }
+    else
+    {
+        ok = (xaccAccountTreeForEachTransaction (root, write_dom, out) == 0);
+    }
+    return (fclose (out) == 0) && ok;
+}
+
+static gboolean
+same_contents (const gchar *filename_1, const gchar *filename_2)
+{
+    gchar *contents_1, *contents_2;
+    gsize length_1, length_2;
+    gboolean same = FALSE;
+
+    if (g_file_get_contents (filename_1, &contents_1, &length_1, NULL))
+    {
+        if (g_file_get_contents (filename_2, &contents_2, &length_2, NULL))
+        {
+            same = (length_1 == length_2
+                    && memcmp (contents_1, contents_2, length_1) == 0);
+            g_free (contents_2);
+        }
+        g_free (contents_1);
+    }
+    return same;
+}
+
+/* Read the compressed file with zlib rather than with the backend. */
+static gboolean
+same_uncompressed (const gchar *compressed, const gchar *filename)
+{
+    gchar *contents;
+    gsize length, offset = 0;
+    gchar buffer[4096];
+    gboolean same;
+    gzFile file;
+    gint bytes;
+
+    if (!g_file_get_contents (filename, &contents, &length, NULL))
+        return FALSE;
+    file = gzopen (compressed, "rb");
+    same = (file != NULL);
+    while (same && (bytes = gzread (file, buffer, sizeof (buffer))) != 0)
+    {
+        same = (bytes > 0 && offset + bytes <= length
+                && memcmp (contents + offset, buffer, bytes) == 0);
+        offset += bytes;
+    }
+    if (file && gzclose (file) != Z_OK)
+        same = FALSE;
+    g_free (contents);
+    return same && offset == length;
+}
+
+int
+main (int argc, char **argv)
+{
+    gchar *dom_file, *stream_file, *book_file, *gz_file;
+    QofBook *book;
+
+    qof_init ();
+    cashobjects_register ();
+    xaccLogDisable ();
+
+    dom_file = g_strdup_printf ("%s/test-xml-write-dom-%d.xml",
+                                g_get_tmp_dir (), (int)getpid ());
+    stream_file = g_strdup_printf ("%s/test-xml-write-stream-%d.xml",
+                                   g_get_tmp_dir (), (int)getpid ());
+    book_file = g_strdup_printf ("%s/test-xml-write-%d.gnucash",
+                                 g_get_tmp_dir (), (int)getpid ());
+    gz_file = g_strdup_printf ("%s/test-xml-write-%d.gnucash.gz",
+                               g_get_tmp_dir (), (int)getpid ());
+
+    book = make_book (NUM_TRANSACTIONS);
+    do_test (write_transactions (book, dom_file, FALSE), "dom write");
+    do_test (write_transactions (book, stream_file, TRUE), "streaming write");
+    do_test (same_contents (dom_file, stream_file), "Written files match");
+
+    do_test (gnc_book_write_to_xml_file_v2 (book, book_file, FALSE), "book save");
+    do_test (gnc_book_write_to_xml_file_v2 (book, gz_file, TRUE),
+             "compressed book save");
+    do_test (same_uncompressed (gz_file, book_file), "Compressed file matches");
+
+    qof_book_destroy (book);
+    g_unlink (dom_file);
+    g_unlink (stream_file);
+    g_unlink (book_file);
+    g_unlink (gz_file);
+    g_free (dom_file);
+    g_free (stream_file);
+    g_free (book_file);
+    g_free (gz_file);
+
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
@@ -44,6 +44,8 @@ static QofLogModule log_module = GNC_MOD_ACCOUNT;
 /* The Canonical Account Separator.  Pre-Initialized. */
 static gchar account_separator[8] = ".";
 static gunichar account_uc_separator = ':';
+/* Changes with the separator, and with it all the full names. */
+static guint account_separator_generation = 0;
 
 enum
 {
@@ -97,6 +99,11 @@ enum
 \********************************************************************/
 
 static void xaccAccountBringUpToDate (Account *acc);
+static void account_clear_splits (AccountPrivate *priv);
+static void account_set_balance_dirty_all (AccountPrivate *priv);
+static void account_full_names_changing (Account *acc);
+static void account_full_names_changed (Account *acc);
+static void account_drop_full_name_index (AccountPrivate *rpriv);
 
 
 /********************************************************************\
@@ -124,6 +131,7 @@ gnc_set_account_separator (const gchar *separator)
     gunichar uc;
     gint count;
 
+    account_separator_generation++;
     uc = g_utf8_get_char_validated(separator, -1);
     if ((uc == (gunichar) - 2) || (uc == (gunichar) - 1) || g_unichar_isalnum(uc))
     {
@@ -251,9 +259,13 @@ gnc_account_init(Account* acc)
     priv->starting_cleared_balance = gnc_numeric_zero();
     priv->starting_reconciled_balance = gnc_numeric_zero();
     priv->balance_dirty = FALSE;
+    priv->unbalanced_splits = NULL;
 
     priv->splits = NULL;
+    priv->split_order = g_sequence_new(NULL);
+    priv->split_index = g_hash_table_new(g_direct_hash, g_direct_equal);
     priv->sort_dirty = FALSE;
+    priv->unsorted_splits = NULL;
 }
 
 static void
@@ -265,6 +277,22 @@ gnc_account_dispose (GObject *acctp)
 static void
 gnc_account_finalize(GObject* acctp)
 {
+    AccountPrivate *priv;
+
+    priv = GET_PRIVATE(acctp);
+    g_list_free(priv->splits);
+    priv->splits = NULL;
+    g_sequence_free(priv->split_order);
+    priv->split_order = NULL;
+    g_hash_table_destroy(priv->split_index);
+    priv->split_index = NULL;
+    if (priv->unsorted_splits)
+        g_hash_table_destroy(priv->unsorted_splits);
+    priv->unsorted_splits = NULL;
+    if (priv->unbalanced_splits)
+        g_hash_table_destroy(priv->unbalanced_splits);
+    priv->unbalanced_splits = NULL;
+
     G_OBJECT_CLASS(gnc_account_parent_class)->finalize(acctp);
 }
 
@@ -1089,6 +1117,9 @@ xaccFreeAccount (Account *acc)
     CACHE_REPLACE(priv->accountName, NULL);
     CACHE_REPLACE(priv->accountCode, NULL);
     CACHE_REPLACE(priv->description, NULL);
+    g_free(priv->full_name);
+    priv->full_name = NULL;
+    account_drop_full_name_index(priv);
 
     /* zero out values, just in case stray
      * pointers are pointing here. */
@@ -1197,8 +1228,7 @@ xaccAccountCommitEdit (Account *acc)
         }
         else
         {
-            g_list_free(priv->splits);
-            priv->splits = NULL;
+            account_clear_splits(priv);
         }
 
         /* It turns out there's a case where this assertion does not hold:
@@ -1524,6 +1554,14 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+
+    /* We don't know which splits moved, so the next sort must be a
+     * full one. */
+    if (priv->unsorted_splits)
+    {
+        g_hash_table_destroy(priv->unsorted_splits);
+        priv->unsorted_splits = NULL;
+    }
 }
 
 gboolean
@@ -1544,49 +1582,261 @@ gnc_account_set_balance_dirty (Account *acc)
         return;
 
     priv = GET_PRIVATE(acc);
+    account_set_balance_dirty_all(priv);
+}
+
+/********************************************************************\
+ * The split containers.  The data of each GSequence entry is the    *
+ * GList link that holds the split in priv->splits, so the list and  *
+ * the tree always share their nodes and can be kept in step in      *
+ * O(log n) per operation.                                           *
+\********************************************************************/
+
+static gint
+split_link_order (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    return xaccSplitOrder(((const GList *) a)->data,
+                          ((const GList *) b)->data);
+}
+
+/* Forget about the individual splits; every running balance has to be
+ * recomputed. */
+static void
+account_set_balance_dirty_all (AccountPrivate *priv)
+{
     priv->balance_dirty = TRUE;
+    if (priv->unbalanced_splits)
+    {
+        g_hash_table_destroy(priv->unbalanced_splits);
+        priv->unbalanced_splits = NULL;
+    }
+}
+
+/* The running balance of this split, and of all splits after it,
+ * need to be recomputed. */
+static void
+account_mark_split_unbalanced (AccountPrivate *priv, Split *split)
+{
+    if (priv->balance_dirty && !priv->unbalanced_splits)
+        return;                 /* a full recompute is pending anyway */
+
+    if (!priv->unbalanced_splits)
+        priv->unbalanced_splits = g_hash_table_new(g_direct_hash,
+                                  g_direct_equal);
+    g_hash_table_insert(priv->unbalanced_splits, split, split);
+    priv->balance_dirty = TRUE;
+
+    if (g_hash_table_size(priv->unbalanced_splits) >
+            g_hash_table_size(priv->split_index) / 4 + 8)
+        account_set_balance_dirty_all(priv);
+}
+
+/* Link the list node held by the sequence entry 'iter' into
+ * priv->splits, right behind the node of the preceding entry. */
+static void
+account_splice_split_link (AccountPrivate *priv, GSequenceIter *iter)
+{
+    GList *link = g_sequence_get(iter);
+    GList *prev;
+
+    if (g_sequence_iter_is_begin(iter))
+    {
+        link->prev = NULL;
+        link->next = priv->splits;
+        if (priv->splits)
+            priv->splits->prev = link;
+        priv->splits = link;
+        return;
+    }
+
+    prev = g_sequence_get(g_sequence_iter_prev(iter));
+    link->prev = prev;
+    link->next = prev->next;
+    if (prev->next)
+        prev->next->prev = link;
+    prev->next = link;
+}
+
+static void
+account_insert_split_link_sorted (AccountPrivate *priv, GList *link)
+{
+    GSequenceIter *iter;
+
+    iter = g_sequence_insert_sorted(priv->split_order, link,
+                                    split_link_order, NULL);
+    account_splice_split_link(priv, iter);
+    g_hash_table_insert(priv->split_index, link->data, iter);
+    account_mark_split_unbalanced(priv, link->data);
+}
+
+/* Unhook the entry from both the tree and the list, and return the
+ * now free-standing list link.  The split_index is left alone.  The
+ * splits that followed it lose its amount from their running balance,
+ * so recomputing has to start at its predecessor. */
+static GList *
+account_detach_split_link (AccountPrivate *priv, GSequenceIter *iter)
+{
+    GList *link = g_sequence_get(iter);
+
+    if (g_sequence_iter_is_begin(iter))
+        account_set_balance_dirty_all(priv);
+    else
+        account_mark_split_unbalanced(priv, link->prev->data);
+
+    if (priv->unbalanced_splits)
+        g_hash_table_remove(priv->unbalanced_splits, link->data);
+
+    priv->splits = g_list_remove_link(priv->splits, link);
+    g_sequence_remove(iter);
+    return link;
+}
+
+static void
+account_clear_splits (AccountPrivate *priv)
+{
+    g_list_free(priv->splits);
+    priv->splits = NULL;
+    g_sequence_remove_range(g_sequence_get_begin_iter(priv->split_order),
+                            g_sequence_get_end_iter(priv->split_order));
+    g_hash_table_remove_all(priv->split_index);
+    if (priv->unsorted_splits)
+    {
+        g_hash_table_destroy(priv->unsorted_splits);
+        priv->unsorted_splits = NULL;
+    }
+    account_set_balance_dirty_all(priv);
+}
+
+/* Remember that this one split may be out of place.  Once a sizeable
+ * fraction of the account is involved, a full sort is cheaper than
+ * re-positioning the splits one at a time. */
+static void
+account_mark_split_unsorted (AccountPrivate *priv, Split *split)
+{
+    if (priv->sort_dirty && !priv->unsorted_splits)
+        return;                 /* a full sort is pending anyway */
+
+    if (!priv->unsorted_splits)
+        priv->unsorted_splits = g_hash_table_new(g_direct_hash,
+                                g_direct_equal);
+    g_hash_table_insert(priv->unsorted_splits, split, split);
+    priv->sort_dirty = TRUE;
+
+    if (g_hash_table_size(priv->unsorted_splits) >
+            g_hash_table_size(priv->split_index) / 4 + 8)
+    {
+        g_hash_table_destroy(priv->unsorted_splits);
+        priv->unsorted_splits = NULL;
+    }
+}
+
+static void
+account_resort_unsorted_splits (AccountPrivate *priv)
+{
+    GHashTableIter hiter;
+    gpointer split;
+    GList *links = NULL, *node;
+
+    /* Pull all of the suspects out first, so that every binary search
+     * below runs over a correctly ordered sequence. */
+    g_hash_table_iter_init(&hiter, priv->unsorted_splits);
+    while (g_hash_table_iter_next(&hiter, &split, NULL))
+    {
+        GSequenceIter *iter = g_hash_table_lookup(priv->split_index, split);
+        if (iter)
+            links = g_list_prepend(links,
+                                   account_detach_split_link(priv, iter));
+    }
+
+    for (node = links; node; node = node->next)
+        account_insert_split_link_sorted(priv, node->data);
+    g_list_free(links);
+}
+
+static void
+account_resort_all_splits (AccountPrivate *priv)
+{
+    GSequenceIter *iter, *end;
+    GList *prev = NULL;
+
+    /* g_sequence_sort moves the entries, so the iters in split_index
+     * stay valid; only the list needs relinking. */
+    g_sequence_sort(priv->split_order, split_link_order, NULL);
+    account_set_balance_dirty_all(priv);
+
+    priv->splits = NULL;
+    end = g_sequence_get_end_iter(priv->split_order);
+    for (iter = g_sequence_get_begin_iter(priv->split_order); iter != end;
+            iter = g_sequence_iter_next(iter))
+    {
+        GList *link = g_sequence_get(iter);
+
+        link->prev = prev;
+        link->next = NULL;
+        if (prev)
+            prev->next = link;
+        else
+            priv->splits = link;
+        prev = link;
+    }
 }
 
 /********************************************************************\
 \********************************************************************/
 
+guint
+gnc_account_get_split_count (const Account *acc)
+{
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), 0);
+    return g_hash_table_size(GET_PRIVATE(acc)->split_index);
+}
+
 gboolean
 gnc_account_find_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    return node ? TRUE : FALSE;
+    return g_hash_table_lookup(priv->split_index, s) ? TRUE : FALSE;
 }
 
 gboolean
 gnc_account_insert_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
+    GList *link;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (node)
+    if (g_hash_table_lookup(priv->split_index, s))
         return FALSE;
 
+    link = g_list_alloc();
+    link->data = s;
     if (qof_instance_get_editlevel(acc) == 0)
     {
-        priv->splits = g_list_insert_sorted(priv->splits, s,
-                                            (GCompareFunc)xaccSplitOrder);
+        account_insert_split_link_sorted(priv, link);
+
+        /* The neighbours may be some of the misplaced splits, in which
+         * case this position is only a guess. */
+        if (priv->unsorted_splits)
+            account_mark_split_unsorted(priv, s);
     }
     else
     {
-        priv->splits = g_list_prepend(priv->splits, s);
-        priv->sort_dirty = TRUE;
+        /* Park it at the end until the edit is done.  That is where
+         * most new splits end up anyway, and it keeps the running
+         * balances in front of it intact. */
+        GSequenceIter *iter = g_sequence_append(priv->split_order, link);
+        account_splice_split_link(priv, iter);
+        g_hash_table_insert(priv->split_index, s, iter);
+        account_mark_split_unsorted(priv, s);
+        account_mark_split_unbalanced(priv, s);
     }
 
     //FIXME: find better event
@@ -1594,7 +1844,6 @@ gnc_account_insert_split (Account *acc, Split *s)
     /* Also send an event based on the account */
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
 
-    priv->balance_dirty = TRUE;
 //  DRH: Should the below be added? It is present in the delete path.
 //  xaccAccountRecomputeBalance(acc);
     return TRUE;
@@ -1604,27 +1853,48 @@ gboolean
 gnc_account_remove_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
+    GSequenceIter *iter;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (NULL == node)
+    iter = g_hash_table_lookup(priv->split_index, s);
+    if (NULL == iter)
         return FALSE;
 
-    priv->splits = g_list_delete_link(priv->splits, node);
+    g_list_free_1(account_detach_split_link(priv, iter));
+    g_hash_table_remove(priv->split_index, s);
+    if (priv->unsorted_splits)
+        g_hash_table_remove(priv->unsorted_splits, s);
+
     //FIXME: find better event type
     qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
     // And send the account-based event, too
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_REMOVED, s);
 
-    priv->balance_dirty = TRUE;
     xaccAccountRecomputeBalance(acc);
     return TRUE;
 }
 
+void
+gnc_account_mark_split_dirty (Account *acc, Split *split)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    if (qof_instance_get_destroying(acc))
+        return;
+
+    priv = GET_PRIVATE(acc);
+    if (g_hash_table_lookup(priv->split_index, split))
+    {
+        account_mark_split_unsorted(priv, split);
+        account_mark_split_unbalanced(priv, split);
+    }
+}
+
 void
 xaccAccountSortSplits (Account *acc, gboolean force)
 {
@@ -1635,9 +1905,17 @@ xaccAccountSortSplits (Account *acc, gboolean force)
     priv = GET_PRIVATE(acc);
     if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
         return;
-    priv->splits = g_list_sort(priv->splits, (GCompareFunc)xaccSplitOrder);
+    if (priv->unsorted_splits)
+    {
+        account_resort_unsorted_splits(priv);
+        g_hash_table_destroy(priv->unsorted_splits);
+        priv->unsorted_splits = NULL;
+    }
+    else
+    {
+        account_resort_all_splits(priv);
+    }
     priv->sort_dirty = FALSE;
-    priv->balance_dirty = TRUE;
 }
 
 static void
@@ -1911,6 +2189,35 @@ xaccAccountMoveAllSplits (Account *accfrom, Account *accto)
  * Return: void                                                     *
 \********************************************************************/
 
+/* Find the position-wise earliest of the splits whose running balance
+ * is out of date.  The set is small, so a position lookup per split is
+ * much cheaper than walking the list. */
+static GSequenceIter *
+account_first_unbalanced_split (AccountPrivate *priv)
+{
+    GHashTableIter hiter;
+    gpointer split;
+    GSequenceIter *first = NULL;
+    gint first_pos = G_MAXINT;
+
+    g_hash_table_iter_init(&hiter, priv->unbalanced_splits);
+    while (g_hash_table_iter_next(&hiter, &split, NULL))
+    {
+        GSequenceIter *iter = g_hash_table_lookup(priv->split_index, split);
+        gint pos;
+
+        if (!iter)
+            continue;
+        pos = g_sequence_iter_get_position(iter);
+        if (pos < first_pos)
+        {
+            first_pos = pos;
+            first = iter;
+        }
+    }
+    return first;
+}
+
 void
 xaccAccountRecomputeBalance (Account * acc)
 {
@@ -1932,10 +2239,36 @@ xaccAccountRecomputeBalance (Account * acc)
     balance            = priv->starting_balance;
     cleared_balance    = priv->starting_cleared_balance;
     reconciled_balance = priv->starting_reconciled_balance;
+    lp = priv->splits;
+
+    /* Only some splits changed: the running balances in front of the
+     * earliest of them are still good, so pick up from there. */
+    if (priv->unbalanced_splits)
+    {
+        GSequenceIter *first = account_first_unbalanced_split(priv);
+
+        g_hash_table_destroy(priv->unbalanced_splits);
+        priv->unbalanced_splits = NULL;
+
+        if (!first)
+        {
+            priv->balance_dirty = FALSE;
+            return;
+        }
+
+        lp = g_sequence_get(first);
+        if (lp->prev)
+        {
+            Split *prev = lp->prev->data;
+            balance            = prev->balance;
+            cleared_balance    = prev->cleared_balance;
+            reconciled_balance = prev->reconciled_balance;
+        }
+    }
 
     PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
            priv->accountName, balance.num, balance.denom);
-    for (lp = priv->splits; lp; lp = lp->next)
+    for (; lp; lp = lp->next)
     {
         Split *split = (Split *) lp->data;
         gnc_numeric amt = xaccSplitGetAmount (split);
@@ -2079,7 +2412,8 @@ xaccAccountSetType (Account *acc, GNCAccountType tip)
 
     xaccAccountBeginEdit(acc);
     priv->type = tip;
-    priv->balance_dirty = TRUE; /* new type may affect balance computation */
+    /* new type may affect balance computation */
+    account_set_balance_dirty_all(priv);
     mark_account(acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2099,7 +2433,9 @@ xaccAccountSetName (Account *acc, const char *str)
         return;
 
     xaccAccountBeginEdit(acc);
+    account_full_names_changing(acc);
     CACHE_REPLACE(priv->accountName, str);
+    account_full_names_changed(acc);
     mark_account (acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2278,7 +2614,7 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
     }
 
     priv->sort_dirty = TRUE;  /* Not needed. */
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_all(priv);
     mark_account (acc);
 
     xaccAccountCommitEdit(acc);
@@ -2428,6 +2764,7 @@ gnc_account_append_child (Account *new_parent, Account *child)
     }
     cpriv->parent = new_parent;
     ppriv->children = g_list_append(ppriv->children, child);
+    account_full_names_changed(child);
     qof_instance_set_dirty(&new_parent->inst);
     qof_instance_set_dirty(&child->inst);
 
@@ -2473,6 +2810,7 @@ gnc_account_remove_child (Account *parent, Account *child)
     qof_event_gen(&child->inst, QOF_EVENT_REMOVE, &ed);
 
     /* clear the account's parent pointer after REMOVE event generation. */
+    account_full_names_changing(child);
     cpriv->parent = NULL;
 
     qof_event_gen (&parent->inst, QOF_EVENT_MODIFY, NULL);
@@ -2770,29 +3108,169 @@ gnc_account_lookup_by_full_name_helper (const Account *parent,
 }
 
 
+/* The full name index of a tree holds what the helper above would
+ * find: the first account with a full name in a depth first walk of
+ * the children in order.  Accounts with the separator in their name
+ * cannot be found that way, nor can their descendants. */
+
+static AccountPrivate *
+account_get_root_private (const Account *acc)
+{
+    AccountPrivate *rpriv = GET_PRIVATE(acc);
+
+    while (rpriv->parent)
+        rpriv = GET_PRIVATE(rpriv->parent);
+    return rpriv;
+}
+
+static void
+account_drop_full_name_index (AccountPrivate *rpriv)
+{
+    if (rpriv->full_name_index)
+        g_hash_table_destroy(rpriv->full_name_index);
+    rpriv->full_name_index = NULL;
+    rpriv->full_name_index_dups = FALSE;
+}
+
+/* Whether an account above acc, short of the root, has the separator
+ * in its name, so that acc is left out of the index. */
+static gboolean
+account_index_skips_ancestors (const Account *acc)
+{
+    AccountPrivate *ppriv;
+
+    for (ppriv = GET_PRIVATE(GET_PRIVATE(acc)->parent);
+            ppriv->parent; ppriv = GET_PRIVATE(ppriv->parent))
+        if (strstr(ppriv->accountName, account_separator))
+            return TRUE;
+    return FALSE;
+}
+
+/* Returns FALSE if another account already has one of the names. */
+static gboolean
+account_index_add_subtree (GHashTable *index, Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    const gchar *full_name;
+    gboolean unique = TRUE;
+    GList *node;
+
+    if (strstr(priv->accountName, account_separator))
+        return TRUE;
+
+    full_name = gnc_account_peek_full_name(acc);
+    if (g_hash_table_lookup(index, full_name))
+        unique = FALSE;
+    else
+        g_hash_table_insert(index, g_strdup(full_name), acc);
+
+    for (node = priv->children; node; node = node->next)
+        unique = account_index_add_subtree(index, node->data) && unique;
+    return unique;
+}
+
+static void
+account_index_remove_subtree (GHashTable *index, Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    const gchar *full_name = gnc_account_peek_full_name(acc);
+    GList *node;
+
+    if (g_hash_table_lookup(index, full_name) == acc)
+        g_hash_table_remove(index, full_name);
+
+    for (node = priv->children; node; node = node->next)
+        account_index_remove_subtree(index, node->data);
+}
+
+static void
+account_clear_full_names (Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    GList *node;
+
+    g_free(priv->full_name);
+    priv->full_name = NULL;
+    for (node = priv->children; node; node = node->next)
+        account_clear_full_names(node->data);
+}
+
+/* The index of the tree of acc, if it has a current one.  If changing
+ * is set, the tree is about to change, and an index that cannot follow
+ * is dropped. */
+static GHashTable *
+account_get_full_name_index (const Account *acc, gboolean changing)
+{
+    AccountPrivate *rpriv = account_get_root_private(acc);
+
+    if (rpriv->full_name_index
+            && ((changing && rpriv->full_name_index_dups)
+                || rpriv->full_name_index_generation != account_separator_generation))
+        account_drop_full_name_index(rpriv);
+    return rpriv->full_name_index;
+}
+
+/* Called before the full names of acc and its descendants change,
+ * either because it gets a new name or because it leaves its parent. */
+static void
+account_full_names_changing (Account *acc)
+{
+    GHashTable *index;
+
+    if (!GET_PRIVATE(acc)->parent)
+        return;
+    index = account_get_full_name_index(acc, TRUE);
+    if (index)
+        account_index_remove_subtree(index, acc);
+    account_clear_full_names(acc);
+}
+
+/* Called after acc got a new name or a new parent. */
+static void
+account_full_names_changed (Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    GHashTable *index;
+
+    account_clear_full_names(acc);
+    if (!priv->parent)
+        return;
+    /* It was the root of its own tree before. */
+    account_drop_full_name_index(priv);
+    index = account_get_full_name_index(acc, TRUE);
+    if (index && !account_index_skips_ancestors(acc)
+            && !account_index_add_subtree(index, acc))
+        account_drop_full_name_index(account_get_root_private(acc));
+}
+
 Account *
 gnc_account_lookup_by_full_name (const Account *any_acc,
                                  const gchar *name)
 {
-    const AccountPrivate *rpriv;
-    const Account *root;
-    Account *found;
-    gchar **names;
+    AccountPrivate *rpriv;
+    GHashTable *index;
+    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(any_acc), NULL);
     g_return_val_if_fail(name, NULL);
 
-    root = any_acc;
-    rpriv = GET_PRIVATE(root);
-    while (rpriv->parent)
+    /* The helper finds no account for an empty name. */
+    if (*name == '\0')
+        return NULL;
+
+    index = account_get_full_name_index(any_acc, FALSE);
+    if (!index)
     {
-        root = rpriv->parent;
-        rpriv = GET_PRIVATE(root);
+        rpriv = account_get_root_private(any_acc);
+        index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        rpriv->full_name_index = index;
+        rpriv->full_name_index_generation = account_separator_generation;
+        rpriv->full_name_index_dups = FALSE;
+        for (node = rpriv->children; node; node = node->next)
+            if (!account_index_add_subtree(index, node->data))
+                rpriv->full_name_index_dups = TRUE;
     }
-    names = g_strsplit(name, gnc_get_account_separator_string(), -1);
-    found = gnc_account_lookup_by_full_name_helper(root, names);
-    g_strfreev(names);
-    return found;
+    return g_hash_table_lookup(index, name);
 }
 
 void
@@ -2916,52 +3394,47 @@ xaccAccountGetName (const Account *acc)
     return GET_PRIVATE(acc)->accountName;
 }
 
-gchar *
-gnc_account_get_full_name(const Account *account)
+const gchar *
+gnc_account_peek_full_name(const Account *account)
 {
-    AccountPrivate *priv;
-    const Account *a;
-    char *fullname;
-    gchar **names;
-    int level;
+    AccountPrivate *priv, *ppriv;
 
-    /* So much for hardening the API. Too many callers to this function don't
-     * bother to check if they have a non-NULL pointer before calling. */
     if (NULL == account)
-        return g_strdup("");
+        return "";
 
     /* errors */
-    g_return_val_if_fail(GNC_IS_ACCOUNT(account), g_strdup(""));
+    g_return_val_if_fail(GNC_IS_ACCOUNT(account), "");
 
     /* optimizations */
     priv = GET_PRIVATE(account);
     if (!priv->parent)
-        return g_strdup("");
-
-    /* Figure out how much space is needed by counting the nodes up to
-     * the root. */
-    level = 0;
-    for (a = account; a; a = priv->parent)
-    {
-        priv = GET_PRIVATE(a);
-        level++;
-    }
-
-    /* Get all the pointers in the right order. The root node "entry"
-     * becomes the terminating NULL pointer for the array of strings. */
-    names = g_malloc(level * sizeof(gchar *));
-    names[--level] = NULL;
-    for (a = account; level > 0; a = priv->parent)
-    {
-        priv = GET_PRIVATE(a);
-        names[--level] = priv->accountName;
-    }
+        return "";
+
+    if (priv->full_name
+            && priv->full_name_generation == account_separator_generation)
+        return priv->full_name;
+
+    /* Build it from the parent's full name; the names of the top level
+     * accounts stand alone. */
+    g_free(priv->full_name);
+    ppriv = GET_PRIVATE(priv->parent);
+    if (!ppriv->parent)
+        priv->full_name = g_strdup(priv->accountName);
+    else
+        priv->full_name = g_strconcat(gnc_account_peek_full_name(priv->parent),
+                                      account_separator, priv->accountName,
+                                      NULL);
+    priv->full_name_generation = account_separator_generation;
 
-    /* Build the full name */
-    fullname =  g_strjoinv(account_separator, names);
-    g_free(names);
+    return priv->full_name;
+}
 
-    return fullname;
+gchar *
+gnc_account_get_full_name(const Account *account)
+{
+    /* So much for hardening the API. Too many callers to this function don't
+     * bother to check if they have a non-NULL pointer before calling. */
+    return g_strdup(gnc_account_peek_full_name(account));
 }
 
 const char *
@@ -3054,7 +3527,7 @@ gnc_account_set_start_balance (Account *acc, const gnc_numeric start_baln)
 
     priv = GET_PRIVATE(acc);
     priv->starting_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_all(priv);
 }
 
 gnc_numeric
@@ -3075,7 +3548,7 @@ gnc_account_set_start_cleared_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_cleared_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_all(priv);
 }
 
 gnc_numeric
@@ -3096,7 +3569,7 @@ gnc_account_set_start_reconciled_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_reconciled_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_all(priv);
 }
 
 gnc_numeric
@@ -3120,6 +3593,67 @@ xaccAccountGetReconciledBalance (const Account *acc)
     return GET_PRIVATE(acc)->reconciled_balance;
 }
 
+/********************************************************************\
+ * Date lookups.  The split tree is ordered by xaccSplitOrder, whose *
+ * first key is the posted date, and every split caches its running *
+ * balance, so the balance as of any date is a binary search away.   *
+\********************************************************************/
+
+typedef struct
+{
+    time_t date;
+    gboolean include_date;  /* splits posted at 'date' go before it */
+} SplitDateProbe;
+
+static gint
+split_link_date_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const SplitDateProbe *probe = user_data;
+    const GList *link = a;
+    gint sign = 1;
+    time_t posted;
+
+    if (a == (gconstpointer) probe)
+    {
+        link = b;
+        sign = -1;
+    }
+
+    posted = xaccTransGetDate (xaccSplitGetParent (link->data));
+    if (posted < probe->date || (posted == probe->date && probe->include_date))
+        return -sign;
+    return sign;
+}
+
+/* Return the list link of the last split posted before 'date', or on
+ * 'date' if include_date is set, or NULL if there is none.  Only valid
+ * while the splits are sorted. */
+static GList *
+account_last_split_link_before (AccountPrivate *priv, time_t date,
+                                gboolean include_date)
+{
+    SplitDateProbe probe;
+    GSequenceIter *iter;
+
+    probe.date = date;
+    probe.include_date = include_date;
+    iter = g_sequence_search (priv->split_order, &probe,
+                              split_link_date_cmp, &probe);
+    if (g_sequence_iter_is_begin (iter))
+        return NULL;
+    return g_sequence_get (g_sequence_iter_prev (iter));
+}
+
+static GList *
+account_last_split_link (AccountPrivate *priv)
+{
+    GSequenceIter *end = g_sequence_get_end_iter (priv->split_order);
+
+    if (g_sequence_iter_is_begin (end))
+        return NULL;
+    return g_sequence_get (g_sequence_iter_prev (end));
+}
+
 gnc_numeric
 xaccAccountGetProjectedMinimumBalance (const Account *acc)
 {
@@ -3133,7 +3667,7 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 
     priv = GET_PRIVATE(acc);
     today = gnc_timet_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+    for (node = account_last_split_link(priv); node; node = node->prev)
     {
         Split *split = node->data;
 
@@ -3169,8 +3703,6 @@ xaccAccountGetBalanceAsOfDate (Account *acc, time_t date)
      */
     AccountPrivate *priv;
     GList   *lp;
-    Timespec ts, trans_ts;
-    gboolean found = FALSE;
     gnc_numeric balance;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
@@ -3181,46 +3713,20 @@ xaccAccountGetBalanceAsOfDate (Account *acc, time_t date)
     priv = GET_PRIVATE(acc);
     balance = priv->balance;
 
-    /* Since transaction post times are stored as a Timespec,
-     * convert date into a Timespec as well rather than converting
-     * each transaction's Timespec into a time_t.
-     *
-     * FIXME: CAS: I think this comment is a bogus justification for
-     * using xaccTransGetDatePostedTS.  There's no benefit to using
-     * Timespec when the input argument is time_t, and it's hard to
-     * imagine that casting long long to long and comparing two longs is
-     * worse than comparing two long longs every time.  IMO,
-     * xaccAccountGetPresentBalance gets this right, and its algorithm
-     * should be used here.
-     */
-    ts.tv_sec = date;
-    ts.tv_nsec = 0;
-
-    lp = priv->splits;
-    while ( lp && !found )
-    {
-        xaccTransGetDatePostedTS( xaccSplitGetParent( (Split *)lp->data ),
-                                  &trans_ts );
-        if ( timespec_cmp( &trans_ts, &ts ) >= 0 )
-            found = TRUE;
-        else
-            lp = lp->next;
-    }
-
-    if ( lp )
+    /* Find the last split posted before the given date; the running
+     * balance of that split is the answer. */
+    if (priv->splits)
     {
-        if ( lp->prev )
-        {
-            /* Since lp is now pointing to a split which was past the reconcile
-             * date, get the running balance of the previous split.
-             */
-            balance = xaccSplitGetBalance( (Split *)lp->prev->data );
-        }
-        else
+        lp = account_last_split_link_before (priv, date, FALSE);
+        if (lp == NULL)
         {
             /* AsOf date must be before any entries, return zero. */
             balance = gnc_numeric_zero();
         }
+        else if (lp->next)
+        {
+            balance = xaccSplitGetBalance ((Split *)lp->data);
+        }
     }
 
     /* Otherwise there were no splits posted after the given date,
@@ -3249,7 +3755,16 @@ xaccAccountGetPresentBalance (const Account *acc)
 
     priv = GET_PRIVATE(acc);
     today = gnc_timet_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+
+    /* The binary search needs sorted splits; this function can't sort
+     * a const account, so fall back to walking from the tail. */
+    if (!priv->sort_dirty)
+    {
+        node = account_last_split_link_before (priv, today, TRUE);
+        return node ? xaccSplitGetBalance (node->data) : gnc_numeric_zero ();
+    }
+
+    for (node = account_last_split_link(priv); node; node = node->prev)
     {
         Split *split = node->data;
 
@@ -455,6 +455,12 @@ void xaccAccountSortSplits (Account *acc, gboolean force);
  */
 gchar * gnc_account_get_full_name (const Account *account);
 
+/** Like gnc_account_get_full_name(), but returns the full name the
+ *  account caches.  The string belongs to the account and is only
+ *  valid until the account, one of its ancestors or the account
+ *  separator changes; copy it to keep it. */
+const gchar * gnc_account_peek_full_name (const Account *account);
+
 /** Set a string that identifies the Finance::Quote backend that
  *  should be used to retrieve online prices.  See price-quotes.scm
  *  for more information
@@ -98,6 +98,22 @@ typedef struct AccountPrivate
     Account *parent;    /* back-pointer to parent */
     GList *children;    /* list of sub-accounts */
 
+    /* The full name, built from the parent's one.  It is NULL, or
+     * stale if full_name_generation differs from the separator's
+     * generation, until gnc_account_get_full_name needs it again. */
+    gchar *full_name;
+    guint full_name_generation;
+
+    /* Only used on the root of a tree: maps the full names of the
+     * accounts below it to the accounts, for
+     * gnc_account_lookup_by_full_name.  It is built on the first lookup
+     * and kept current as accounts are renamed and moved; if the tree
+     * has accounts with the same full name, or the separator changes,
+     * it is dropped and built again instead. */
+    GHashTable *full_name_index;
+    guint full_name_index_generation;
+    gboolean full_name_index_dups;
+
     /* protected data - should only be set by backends */
     gnc_numeric starting_balance;
     gnc_numeric starting_cleared_balance;
@@ -110,8 +126,32 @@ typedef struct AccountPrivate
 
     gboolean balance_dirty;     /* balances in splits incorrect */
 
+    /* If balance_dirty is set and unbalanced_splits is non-NULL, then
+     * the running balances are correct up to, but not including, the
+     * earliest of these splits, and xaccAccountRecomputeBalance() only
+     * needs to walk the list from there on.  If it is NULL, then all
+     * of the running balances must be recomputed.
+     */
+    GHashTable *unbalanced_splits;
+
+    /* The splits are kept in two structures.  The GList is what
+     * xaccAccountGetSplitList() hands out and what most of this file
+     * walks.  The GSequence is a balanced tree over the very same list
+     * links, ordered by xaccSplitOrder(), so that a split can be
+     * positioned or removed in O(log n).  The split_index hash maps each
+     * Split to its GSequenceIter, replacing the g_list_find() scans.
+     */
     GList *splits;              /* list of split pointers */
+    GSequence *split_order;     /* sorted tree of the links in 'splits' */
+    GHashTable *split_index;    /* Split* -> GSequenceIter* */
+
+    /* If sort_dirty is set and unsorted_splits is non-NULL, then only
+     * the splits in that set may be out of order and they can be
+     * re-positioned individually.  If sort_dirty is set and
+     * unsorted_splits is NULL, then the whole list needs to be sorted.
+     */
     gboolean sort_dirty;        /* sort order of splits is bad */
+    GHashTable *unsorted_splits;/* set of splits that may be misplaced */
 
     LotList   *lots;		/* list of lot pointers */
     GNCPolicy *policy;		/* Cached pointer to policy method */
@@ -135,6 +175,16 @@ void xaccAccountSetGUID (Account *account, const GncGUID *guid);
 /* Register Accounts with the engine */
 gboolean xaccAccountRegister (void);
 
+/* Tell the account that something affecting the sort position or the
+ * running balance of the split changed.  This is the split-specific
+ * variant of setting both the "sort-dirty" and "balance-dirty"
+ * properties; it lets the account re-position just this split instead
+ * of re-sorting the whole list. */
+void gnc_account_mark_split_dirty (Account *acc, Split *split);
+
+/* Return the number of splits in the account, in constant time. */
+guint gnc_account_get_split_count (const Account *acc);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
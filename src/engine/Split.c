@@ -50,6 +50,8 @@
 #include "gnc-engine.h"
 #include "gnc-lot.h"
 #include "gnc-event.h"
+#include "qofquerycore-p.h"
+#include "qofid-p.h"
 
 const char *void_former_amt_str = "void-former-amount";
 const char *void_former_val_str = "void-former-value";
@@ -59,6 +61,58 @@ const char *void_former_val_str = "void-former-value";
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_ENGINE;
 
+/* The splits whose account has been set in an edit that hasn't been
+ * committed yet, so that the account doesn't list them.  The query
+ * index on the split account has to offer these too.  Every book keeps
+ * its own table in the book data under this key. */
+#define GNC_MOVED_SPLITS "gnc-moved-splits"
+
+static void
+moved_splits_destroy (QofBook *book, gpointer key, gpointer user_data)
+{
+    if (user_data)
+        g_hash_table_destroy (user_data);
+    qof_book_set_data (book, key, NULL);
+}
+
+static GHashTable *
+moved_splits_lookup (const Split *s, gboolean create)
+{
+    QofBook *book = qof_instance_get_book (s);
+    GHashTable *moved;
+
+    if (!book) return NULL;
+    moved = qof_book_get_data (book, GNC_MOVED_SPLITS);
+    if (!moved && create && !qof_book_shutting_down (book))
+    {
+        moved = g_hash_table_new (g_direct_hash, g_direct_equal);
+        qof_book_set_data_fin (book, GNC_MOVED_SPLITS, moved,
+                               moved_splits_destroy);
+    }
+    return moved;
+}
+
+static void
+split_note_account_change (Split *s)
+{
+    GHashTable *moved = moved_splits_lookup (s, s->acc != s->orig_acc);
+
+    if (!moved) return;
+    if (s->acc != s->orig_acc)
+        g_hash_table_insert (moved, s, s);
+    else
+        g_hash_table_remove (moved, s);
+}
+
+/* The sorted query indexes on the split only see a change when the
+ * generation of the split collection moves on.  The setters that don't
+ * go through qof_instance_set_dirty() have to say so themselves. */
+static void
+split_sort_key_changed (Split *s)
+{
+    qof_collection_touch (qof_instance_get_collection (s));
+}
+
 enum
 {
     PROP_0,
@@ -467,6 +521,8 @@ xaccSplitDump (const Split *split, const char *tag)
 void
 xaccFreeSplit (Split *split)
 {
+    GHashTable *moved;
+
     if (!split) return;
 
     /* Debug double-free's */
@@ -488,6 +544,9 @@ xaccFreeSplit (Split *split)
     split->lot         = NULL;
     split->acc         = NULL;
     split->orig_acc    = NULL;
+    moved = moved_splits_lookup (split, FALSE);
+    if (moved)
+        g_hash_table_remove (moved, split);
 
     split->date_reconciled.tv_sec = 0;
     split->date_reconciled.tv_nsec = 0;
@@ -502,7 +561,7 @@ void mark_split (Split *s)
 {
     if (s->acc)
     {
-        g_object_set(s->acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_mark_split_dirty(s->acc, s);
     }
 
     /* set dirty flag on lot too. */
@@ -705,6 +764,7 @@ xaccSplitSetAccount (Split *s, Account *acc)
         xaccTransBeginEdit(trans);
 
     s->acc = acc;
+    split_note_account_change (s);
     qof_instance_set_dirty(QOF_INSTANCE(s));
 
     if (trans)
@@ -782,13 +842,14 @@ xaccSplitCommitEdit(Split *s)
        original and new transactions, for the _next_ begin/commit cycle. */
     s->orig_acc = s->acc;
     s->orig_parent = s->parent;
+    split_note_account_change (s);
     if (!qof_commit_edit_part2(QOF_INSTANCE(s), commit_err, NULL,
                                (void (*) (QofInstance *)) xaccFreeSplit))
         return;
 
     if (acc)
     {
-        g_object_set(acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_mark_split_dirty(acc, s);
         xaccAccountRecomputeBalance(acc);
     }
 }
@@ -802,7 +863,10 @@ xaccSplitRollbackEdit(Split *s)
        only because we don't emit events for changing accounts until
        the final commit. */
     if (s->acc != s->orig_acc)
+    {
         s->acc = s->orig_acc;
+        split_note_account_change (s);
+    }
 
     /* Undestroy if needed */
     if (qof_instance_get_destroying(s) && s->parent)
@@ -979,6 +1043,7 @@ qofSplitSetSharePrice (Split *split, gnc_numeric price)
     split->value = gnc_numeric_mul(xaccSplitGetAmount(split),
                                    price, get_currency_denom(split),
                                    GNC_HOW_RND_ROUND_HALF_UP);
+    split_sort_key_changed (split);
 }
 
 void
@@ -1047,6 +1112,7 @@ qofSplitSetAmount (Split *split, gnc_numeric amt)
     {
         split->amount = amt;
     }
+    split_sort_key_changed (split);
 }
 
 /* The amount of the split in the _account's_ commodity. */
@@ -1079,6 +1145,7 @@ qofSplitSetValue (Split *split, gnc_numeric amt)
     g_return_if_fail(split);
     split->value = gnc_numeric_convert(amt,
                                        get_currency_denom(split), GNC_HOW_RND_ROUND_HALF_UP);
+    split_sort_key_changed (split);
 }
 
 /* The value of the split in the _transaction's_ currency. */
@@ -1658,6 +1725,7 @@ qofSplitSetReconcile (Split *split, char recn)
     case VREC:
         split->reconciled = recn;
         mark_split (split);
+        split_sort_key_changed (split);
         xaccAccountRecomputeBalance (split->acc);
         break;
     default:
@@ -2093,6 +2161,83 @@ qofSplitSetAccount(Split *s, QofInstance *ent)
     xaccSplitSetAccount(s, acc);
 }
 
+/* Query index on the account of the split: the candidates for an
+ * account match are just the splits of the accounts. */
+static gint
+split_account_index_estimate (QofBook *book, const QofQueryPredData *pd)
+{
+    const query_guid_def *pdata = (const query_guid_def *)pd;
+    GHashTable *moved;
+    GList *node;
+    gint count = 0;
+
+    if (safe_strcmp (pd->type_name, QOF_TYPE_GUID) ||
+            pdata->options != QOF_GUID_MATCH_ANY)
+        return -1;
+
+    for (node = pdata->guids; node; node = node->next)
+    {
+        Account *acc = xaccAccountLookup (node->data, book);
+        if (acc)
+            count += gnc_account_get_split_count (acc);
+    }
+    moved = qof_book_get_data (book, GNC_MOVED_SPLITS);
+    if (moved)
+        count += g_hash_table_size (moved);
+    return count;
+}
+
+static void
+split_account_index_foreach (QofBook *book, const QofQueryPredData *pd,
+                             QofInstanceForeachCB cb, gpointer user_data)
+{
+    const query_guid_def *pdata = (const query_guid_def *)pd;
+    GHashTable *moved;
+    GHashTableIter iter;
+    gpointer split;
+    GList *node, *snode;
+
+    for (node = pdata->guids; node; node = node->next)
+    {
+        Account *acc = xaccAccountLookup (node->data, book);
+
+        /* The same account may be listed more than once. */
+        if (!acc || g_list_find_custom (pdata->guids, node->data,
+                                        (GCompareFunc)guid_compare) != node)
+            continue;
+        for (snode = xaccAccountGetSplitList (acc); snode; snode = snode->next)
+            cb (snode->data, user_data);
+    }
+
+    moved = qof_book_get_data (book, GNC_MOVED_SPLITS);
+    if (!moved) return;
+    g_hash_table_iter_init (&iter, moved);
+    while (g_hash_table_iter_next (&iter, &split, NULL))
+    {
+        /* Leave out the splits already offered by an account above. */
+        for (node = pdata->guids; node; node = node->next)
+        {
+            Account *acc = xaccAccountLookup (node->data, book);
+            if (acc && gnc_account_find_split (acc, split))
+                break;
+        }
+        if (!node)
+            cb (split, user_data);
+    }
+}
+
+/* The splits that see a change to their transaction. */
+static void
+split_trans_dependents (QofInstance *inst, QofInstanceForeachCB cb,
+                        gpointer user_data)
+{
+    GList *node;
+
+    for (node = xaccTransGetSplitList ((Transaction *)inst); node;
+            node = node->next)
+        cb (node->data, user_data);
+}
+
 gboolean xaccSplitRegister (void)
 {
     static const QofParam params[] =
@@ -2194,6 +2339,17 @@ gboolean xaccSplitRegister (void)
     qof_class_register (SPLIT_CORR_ACCT_CODE,
                         (QofSortFunc)xaccSplitCompareOtherAccountCodes, NULL);
 
+    qof_class_register_index (GNC_ID_SPLIT, split_account_index_estimate,
+                              split_account_index_foreach,
+                              SPLIT_ACCOUNT, QOF_PARAM_GUID, NULL);
+    qof_class_register_sorted_index (GNC_ID_SPLIT, SPLIT_TRANS,
+                                     TRANS_DATE_POSTED, NULL);
+    qof_class_register_sorted_index (GNC_ID_SPLIT, SPLIT_RECONCILE, NULL);
+    qof_class_register_sorted_index (GNC_ID_SPLIT, SPLIT_AMOUNT, NULL);
+    qof_class_register_sorted_index (GNC_ID_SPLIT, SPLIT_VALUE, NULL);
+    qof_class_register_dependents (GNC_ID_SPLIT, GNC_ID_TRANS,
+                                   split_trans_dependents);
+
     return qof_object_register (&split_object_def);
 }
 
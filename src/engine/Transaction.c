@@ -59,6 +59,7 @@ struct timeval
 #include "gnc-event.h"
 
 #include "qofbackend-p.h"
+#include "qofid-p.h"
 
 /* Notes about xaccTransBeginEdit(), xaccTransCommitEdit(), and
  *  xaccTransRollback():
@@ -1412,6 +1413,11 @@ xaccTransRollbackEdit (Transaction *trans)
     SWAP(trans->description, orig->description);
     trans->date_entered = orig->date_entered;
     trans->date_posted = orig->date_posted;
+    /* The dates and split amounts go back behind the setters, so the
+     * sorted query indexes have to be told. */
+    qof_collection_touch (qof_instance_get_collection (trans));
+    qof_collection_touch (qof_book_get_collection
+                          (qof_instance_get_book (trans), GNC_ID_SPLIT));
     SWAP(trans->common_currency, orig->common_currency);
     SWAP(trans->inst.kvp_data, orig->inst.kvp_data);
 
@@ -1783,6 +1789,7 @@ xaccTransSetDescription (Transaction *trans, const char *desc)
 
     CACHE_REPLACE(trans->description, desc);
     qof_instance_set_dirty(QOF_INSTANCE(trans));
+    mark_trans(trans);  /* The description is part of the split order */
     xaccTransCommitEdit(trans);
 }
 
@@ -1794,13 +1801,25 @@ qofTransSetNotes (Transaction *trans, const char *notes)
     qof_commit_edit(&trans->inst);
 }
 
+/* The notes are read for every transaction shown in a register, so
+ * their path is only parsed once. */
+static const KvpPath *
+trans_notes_path (void)
+{
+    static KvpPath *path = NULL;
+
+    if (!path)
+        path = kvp_path_new (trans_notes_str);
+    return path;
+}
+
 void
 xaccTransSetNotes (Transaction *trans, const char *notes)
 {
     if (!trans || !notes) return;
     xaccTransBeginEdit(trans);
 
-    kvp_frame_set_str (trans->inst.kvp_data, trans_notes_str, notes);
+    kvp_frame_set_string_at (trans->inst.kvp_data, trans_notes_path (), notes);
     qof_instance_set_dirty(QOF_INSTANCE(trans));
     xaccTransCommitEdit(trans);
 }
@@ -1873,7 +1892,7 @@ const char *
 xaccTransGetNotes (const Transaction *trans)
 {
     return trans ?
-           kvp_frame_get_string (trans->inst.kvp_data, trans_notes_str) : NULL;
+           kvp_frame_get_string_at (trans->inst.kvp_data, trans_notes_path ()) : NULL;
 }
 
 gboolean
@@ -55,8 +55,17 @@ struct _GncPriceClass
 struct gnc_price_db_s
 {
     QofInstance inst;              /* globally unique object identifier */
+    /* commodity -> (currency -> GPtrArray of GNCPrice*, oldest first) */
     GHashTable *commodity_hash;
     gboolean bulk_update;		 /* TRUE while reading XML file, etc. */
+
+    /* Balance conversions already worked out, and the graph of which
+     * commodities have prices in terms of which.  Both are flushed
+     * whenever a price is added, removed or changed. */
+    GHashTable *conversion_cache;  /* PriceConversionKey -> PriceConversion */
+    GHashTable *price_graph;       /* gnc_commodity -> GList of gnc_commodity */
+    guint conversion_hits;
+    guint conversion_misses;
 };
 
 struct _GncPriceDBClass
@@ -34,6 +34,9 @@ static QofLogModule log_module = GNC_MOD_PRICE;
 
 static gboolean add_price(GNCPriceDB *db, GNCPrice *p);
 static gboolean remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup);
+static void pricedb_invalidate_conversions(GNCPriceDB *db);
+static guint price_conversion_key_hash(gconstpointer key);
+static gboolean price_conversion_key_equal(gconstpointer a, gconstpointer b);
 
 enum
 {
@@ -473,6 +476,7 @@ gnc_price_set_value(GNCPrice *p, gnc_numeric value)
         p->value = value;
         gnc_price_set_dirty(p);
         gnc_price_commit_edit (p);
+        pricedb_invalidate_conversions (p->db);
     }
 }
 
@@ -719,15 +723,203 @@ gnc_price_list_equal(PriceList *prices1, PriceList *prices2)
     return TRUE;
 }
 
+/* ==================================================================== */
+/* price array manipulation functions
+
+   Inside the database the prices of one commodity/currency pair are
+   kept in a GPtrArray, sorted in the exact reverse of the PriceList
+   order, i.e. oldest first.  Quotes usually arrive in date order, so
+   adding one is an amortized append, and every lookup by time is a
+   binary search.  Walking the array backwards yields the prices in
+   PriceList order.
+ */
+
+static gint
+compare_prices_by_date_ascending(gconstpointer a, gconstpointer b)
+{
+    return compare_prices_by_date(b, a);
+}
+
+/* Return the number of prices that are earlier than t, or, if
+ * include_t is set, earlier than or at t. */
+static guint
+price_array_count_before(GPtrArray *prices, Timespec t, gboolean include_t)
+{
+    guint lo = 0, hi = prices->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        Timespec price_time = gnc_price_get_time(g_ptr_array_index(prices, mid));
+        gint cmp = timespec_cmp(&price_time, &t);
+
+        if (cmp < 0 || (include_t && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Return the index of the first price on the canonical day 'day', or
+ * of the first price after it if there is none. */
+static guint
+price_array_first_on_day(GPtrArray *prices, Timespec day)
+{
+    guint lo = 0, hi = prices->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        Timespec price_day =
+            timespecCanonicalDayTime(gnc_price_get_time(g_ptr_array_index(prices, mid)));
+
+        if (timespec_cmp(&price_day, &day) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Return the index at which p is, or would be, stored. */
+static guint
+price_array_position(GPtrArray *prices, GNCPrice *p)
+{
+    guint lo = 0, hi = prices->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (compare_prices_by_date_ascending(g_ptr_array_index(prices, mid), p) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* The GPtrArray counterpart of gnc_price_list_insert().  Only the prices
+ * of the same day need to be checked for duplicates. */
+static gboolean
+price_array_insert(GPtrArray *prices, GNCPrice *p, gboolean check_dupl)
+{
+    guint pos;
+
+    if (!prices || !p) return FALSE;
+    gnc_price_ref(p);
+
+    if (check_dupl)
+    {
+        PriceListIsDuplStruct dupl;
+        Timespec day = timespecCanonicalDayTime(gnc_price_get_time(p));
+        guint i;
+
+        dupl.pPrice = p;
+        dupl.isDupl = FALSE;
+        for (i = price_array_first_on_day(prices, day);
+                i < prices->len && !dupl.isDupl; i++)
+        {
+            GNCPrice *other = g_ptr_array_index(prices, i);
+            Timespec other_day = timespecCanonicalDayTime(gnc_price_get_time(other));
+
+            if (!timespec_equal(&other_day, &day))
+                break;
+            price_list_is_duplicate(other, &dupl);
+        }
+        if (dupl.isDupl)
+            return TRUE;
+    }
+
+    pos = price_array_position(prices, p);
+    g_ptr_array_add(prices, p);
+    if (pos < prices->len - 1)
+    {
+        memmove(&prices->pdata[pos + 1], &prices->pdata[pos],
+                (prices->len - 1 - pos) * sizeof(gpointer));
+        prices->pdata[pos] = p;
+    }
+    return TRUE;
+}
+
+/* The GPtrArray counterpart of gnc_price_list_remove(). */
+static gboolean
+price_array_remove(GPtrArray *prices, GNCPrice *p)
+{
+    guint pos;
+
+    if (!prices || !p) return FALSE;
+
+    pos = price_array_position(prices, p);
+    if (pos < prices->len && g_ptr_array_index(prices, pos) == p)
+        g_ptr_array_remove_index(prices, pos);
+    else if (!g_ptr_array_remove(prices, p))
+        return TRUE;
+
+    gnc_price_unref(p);
+    return TRUE;
+}
+
+/* Return the prices of the array as a PriceList, without adding refs. */
+static GList *
+price_array_to_list(GPtrArray *prices)
+{
+    GList *result = NULL;
+    guint i;
+
+    for (i = 0; i < prices->len; i++)
+        result = g_list_prepend(result, g_ptr_array_index(prices, i));
+    return result;
+}
+
+/* Return the price closest to t.  On a tie the older price is preferred
+ * if prefer_older is set, else the newer one. */
+static GNCPrice *
+price_array_nearest(GPtrArray *prices, Timespec t, gboolean prefer_older)
+{
+    guint pos = price_array_count_before(prices, t, TRUE);
+    GNCPrice *before, *after;
+    Timespec before_t, after_t, diff_before, diff_after, abs_before, abs_after;
+    gint cmp;
+
+    if (prices->len == 0) return NULL;
+    if (pos == 0) return g_ptr_array_index(prices, 0);
+    if (pos == prices->len) return g_ptr_array_index(prices, pos - 1);
+
+    before = g_ptr_array_index(prices, pos - 1);
+    after = g_ptr_array_index(prices, pos);
+    before_t = gnc_price_get_time(before);
+    after_t = gnc_price_get_time(after);
+    diff_before = timespec_diff(&before_t, &t);
+    diff_after = timespec_diff(&after_t, &t);
+    abs_before = timespec_abs(&diff_before);
+    abs_after = timespec_abs(&diff_after);
+
+    cmp = timespec_cmp(&abs_after, &abs_before);
+    if (cmp < 0 || (cmp == 0 && !prefer_older))
+        return after;
+    return before;
+}
+
+/* Return the latest price at or before t, or NULL if there is none. */
+static GNCPrice *
+price_array_latest_before(GPtrArray *prices, Timespec t)
+{
+    guint pos = price_array_count_before(prices, t, TRUE);
+
+    return pos ? g_ptr_array_index(prices, pos - 1) : NULL;
+}
+
 /* ==================================================================== */
 /* GNCPriceDB functions
 
    Structurally a GNCPriceDB contains a hash mapping price commodities
    (of type gnc_commodity*) to hashes mapping price currencies (of
-   type gnc_commodity*) to GNCPrice lists (see gnc-pricedb.h for a
-   description of GNCPrice lists).  The top-level key is the commodity
-   you want the prices for, and the second level key is the commodity
-   that the value is expressed in terms of.
+   type gnc_commodity*) to arrays of GNCPrices (see above).  The
+   top-level key is the commodity you want the prices for, and the
+   second level key is the commodity that the value is expressed in
+   terms of.
  */
 
 /* GObject Initialization */
@@ -778,6 +970,9 @@ gnc_pricedb_create(QofBook * book)
 
     result->commodity_hash = g_hash_table_new(NULL, NULL);
     g_return_val_if_fail (result->commodity_hash, NULL);
+    result->conversion_cache = g_hash_table_new_full(price_conversion_key_hash,
+                               price_conversion_key_equal,
+                               g_free, g_free);
     return result;
 }
 
@@ -786,18 +981,19 @@ destroy_pricedb_currency_hash_data(gpointer key,
                                    gpointer data,
                                    gpointer user_data)
 {
-    GList *price_list = (GList *) data;
-    GList *node;
+    GPtrArray *prices = (GPtrArray *) data;
     GNCPrice *p;
+    guint i;
 
-    for (node = price_list; node; node = node->next)
+    for (i = 0; i < prices->len; i++)
     {
-        p = node->data;
+        p = g_ptr_array_index(prices, i);
 
         p->db = NULL;
+        gnc_price_unref(p);
     }
 
-    gnc_price_list_destroy(price_list);
+    g_ptr_array_free(prices, TRUE);
 }
 
 static void
@@ -825,6 +1021,9 @@ gnc_pricedb_destroy(GNCPriceDB *db)
     }
     g_hash_table_destroy (db->commodity_hash);
     db->commodity_hash = NULL;
+    pricedb_invalidate_conversions (db);
+    g_hash_table_destroy (db->conversion_cache);
+    db->conversion_cache = NULL;
     /* qof_instance_release (&db->inst); */
     g_object_unref(db);
 }
@@ -907,7 +1106,7 @@ pricedb_equal_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
     GNCPriceDBEqualData *equal_data = user_data;
     gnc_commodity *currency = key;
-    GList *price_list1 = val;
+    GList *price_list1 = price_array_to_list (val);
     GList *price_list2;
 
     price_list2 = gnc_pricedb_get_prices (equal_data->db2,
@@ -917,6 +1116,7 @@ pricedb_equal_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
     if (!gnc_price_list_equal (price_list1, price_list2))
         equal_data->equal = FALSE;
 
+    g_list_free (price_list1);
     gnc_price_list_destroy (price_list2);
 }
 
@@ -966,7 +1166,7 @@ add_price(GNCPriceDB *db, GNCPrice *p)
 {
     /* This function will use p, adding a ref, so treat p as read-only
        if this function succeeds. */
-    GList *price_list;
+    GPtrArray *prices;
     gnc_commodity *commodity;
     gnc_commodity *currency;
     GHashTable *currency_hash;
@@ -1010,19 +1210,19 @@ add_price(GNCPriceDB *db, GNCPrice *p)
         g_hash_table_insert(db->commodity_hash, commodity, currency_hash);
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!gnc_price_list_insert(&price_list, p, !db->bulk_update))
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
-        LEAVE ("gnc_price_list_insert failed");
-        return FALSE;
+        prices = g_ptr_array_new();
+        g_hash_table_insert(currency_hash, currency, prices);
     }
-    if (!price_list)
+    if (!price_array_insert(prices, p, !db->bulk_update))
     {
-        LEAVE (" no price list");
+        LEAVE ("price_array_insert failed");
         return FALSE;
     }
-    g_hash_table_insert(currency_hash, currency, price_list);
     p->db = db;
+    pricedb_invalidate_conversions(db);
     qof_event_gen (&p->inst, QOF_EVENT_ADD, NULL);
 
     LEAVE ("db=%p, pr=%p dirty=%d dextroying=%d commodity=%s/%s currency_hash=%p",
@@ -1069,7 +1269,7 @@ gnc_pricedb_add_price(GNCPriceDB *db, GNCPrice *p)
 static gboolean
 remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
 {
-    GList *price_list;
+    GPtrArray *prices;
     gnc_commodity *commodity;
     gnc_commodity *currency;
     GHashTable *currency_hash;
@@ -1105,9 +1305,14 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
     }
 
     qof_event_gen (&p->inst, QOF_EVENT_REMOVE, NULL);
-    price_list = g_hash_table_lookup(currency_hash, currency);
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
+    {
+        LEAVE (" price not in the database");
+        return TRUE;
+    }
     gnc_price_ref(p);
-    if (!gnc_price_list_remove(&price_list, p))
+    if (!price_array_remove(prices, p))
     {
         gnc_price_unref(p);
         LEAVE (" cannot remove price list");
@@ -1116,13 +1321,10 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
 
     /* if the price list is empty, then remove this currency from the
        commodity hash */
-    if (price_list)
-    {
-        g_hash_table_insert(currency_hash, currency, price_list);
-    }
-    else
+    if (prices->len == 0)
     {
         g_hash_table_remove(currency_hash, currency);
+        g_ptr_array_free(prices, TRUE);
 
         if (cleanup)
         {
@@ -1138,6 +1340,7 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
         }
     }
 
+    pricedb_invalidate_conversions(db);
     gnc_price_unref(p);
     LEAVE ("db=%p, pr=%p", db, p);
     return TRUE;
@@ -1217,18 +1420,21 @@ pricedb_remove_foreach_pricelist (gpointer key,
                                   gpointer val,
                                   gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
     remove_info *data = (remove_info *) user_data;
+    guint count, i;
 
     ENTER("key %p, value %p, data %p", key, val, user_data);
 
-    /* The most recent price is the first in the list */
-    if (!data->delete_last)
-        node = g_list_next(node);
+    /* Only the prices before the cutoff can go.  The most recent price
+     * is the last in the array. */
+    count = price_array_count_before(prices, data->cutoff, FALSE);
+    if (!data->delete_last && count == prices->len)
+        count--;
 
-    /* now check each item in the list */
-    g_list_foreach(node, (GFunc)check_one_price_date, data);
+    /* now check each of those */
+    for (i = count; i > 0; i--)
+        check_one_price_date(g_ptr_array_index(prices, i - 1), data);
 
     LEAVE(" ");
 }
@@ -1297,7 +1503,7 @@ gnc_pricedb_lookup_latest(GNCPriceDB *db,
                           const gnc_commodity *commodity,
                           const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GNCPrice *result;
     GHashTable *currency_hash;
     QofBook *book;
@@ -1326,17 +1532,17 @@ gnc_pricedb_lookup_latest(GNCPriceDB *db,
         return NULL;
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!price_list)
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
         LEAVE (" no price list");
         return NULL;
     }
 
     /* This works magically because prices are inserted in date-sorted
-     * order, and the latest date always comes first. So return the
-     * first in the list.  */
-    result = price_list->data;
+     * order, and the latest date always comes last. So return the
+     * last in the array.  */
+    result = g_ptr_array_index(prices, prices->len - 1);
     gnc_price_ref(result);
     LEAVE(" ");
     return result;
@@ -1347,13 +1553,14 @@ static void
 lookup_latest(gpointer key, gpointer val, gpointer user_data)
 {
     //gnc_commodity *currency = (gnc_commodity *)key;
-    GList *price_list = (GList *)val;
+    GPtrArray *prices = (GPtrArray *)val;
     GList **return_list = (GList **)user_data;
 
-    if (!price_list) return;
+    if (!prices || prices->len == 0) return;
 
-    /* the latest price is the first in list */
-    gnc_price_list_insert(return_list, price_list->data, FALSE);
+    /* the latest price is the last in the array */
+    gnc_price_list_insert(return_list,
+                          g_ptr_array_index(prices, prices->len - 1), FALSE);
 }
 
 PriceList *
@@ -1408,7 +1615,7 @@ static void
 hash_values_helper(gpointer key, gpointer value, gpointer data)
 {
     GList ** l = data;
-    *l = g_list_concat(*l, g_list_copy (value));
+    *l = g_list_concat(*l, price_array_to_list (value));
 }
 
 gboolean
@@ -1416,7 +1623,7 @@ gnc_pricedb_has_prices(GNCPriceDB *db,
                        const gnc_commodity *commodity,
                        const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GHashTable *currency_hash;
     gint size;
     QofBook *book;
@@ -1446,8 +1653,8 @@ gnc_pricedb_has_prices(GNCPriceDB *db,
 
     if (currency)
     {
-        price_list = g_hash_table_lookup(currency_hash, currency);
-        if (price_list)
+        prices = g_hash_table_lookup(currency_hash, currency);
+        if (prices)
         {
             LEAVE("yes");
             return TRUE;
@@ -1467,7 +1674,7 @@ gnc_pricedb_get_prices(GNCPriceDB *db,
                        const gnc_commodity *commodity,
                        const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GList *result;
     GList *node;
     GHashTable *currency_hash;
@@ -1498,13 +1705,13 @@ gnc_pricedb_get_prices(GNCPriceDB *db,
 
     if (currency)
     {
-        price_list = g_hash_table_lookup(currency_hash, currency);
-        if (!price_list)
+        prices = g_hash_table_lookup(currency_hash, currency);
+        if (!prices)
         {
             LEAVE (" no price list");
             return NULL;
         }
-        result = g_list_copy (price_list);
+        result = price_array_to_list (prices);
     }
     else
     {
@@ -1525,9 +1732,9 @@ gnc_pricedb_lookup_day(GNCPriceDB *db,
                        const gnc_commodity *currency,
                        Timespec t)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GList *result = NULL;
-    GList *item = NULL;
+    guint first, last;
     GHashTable *currency_hash;
     QofBook *book;
     QofBackend *be;
@@ -1557,24 +1764,27 @@ gnc_pricedb_lookup_day(GNCPriceDB *db,
         return NULL;
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!price_list)
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
         LEAVE (" no price list");
         return NULL;
     }
 
-    item = price_list;
-    while (item)
+    first = price_array_first_on_day(prices, t);
+    for (last = first; last < prices->len; last++)
     {
-        GNCPrice *p = item->data;
+        GNCPrice *p = g_ptr_array_index(prices, last);
         Timespec price_time = timespecCanonicalDayTime(gnc_price_get_time(p));
-        if (timespec_equal(&price_time, &t))
-        {
-            result = g_list_prepend(result, p);
-            gnc_price_ref(p);
-        }
-        item = item->next;
+        if (!timespec_equal(&price_time, &t))
+            break;
+    }
+    /* The result is oldest first. */
+    while (last > first)
+    {
+        GNCPrice *p = g_ptr_array_index(prices, --last);
+        result = g_list_prepend(result, p);
+        gnc_price_ref(p);
     }
     LEAVE (" ");
     return result;
@@ -1585,22 +1795,19 @@ static void
 lookup_day(gpointer key, gpointer val, gpointer user_data)
 {
     //gnc_commodity *currency = (gnc_commodity *)key;
-    GList *price_list = (GList *)val;
-    GList *item = NULL;
+    GPtrArray *prices = (GPtrArray *)val;
     GNCPriceLookupHelper *lookup_helper = (GNCPriceLookupHelper *)user_data;
     GList **return_list = lookup_helper->return_list;
     Timespec t = lookup_helper->time;
+    guint i;
 
-    item = price_list;
-    while (item)
+    for (i = price_array_first_on_day(prices, t); i < prices->len; i++)
     {
-        GNCPrice *p = item->data;
+        GNCPrice *p = g_ptr_array_index(prices, i);
         Timespec price_time = timespecCanonicalDayTime(gnc_price_get_time(p));
-        if (timespec_equal(&price_time, &t))
-        {
-            gnc_price_list_insert(return_list, item->data, FALSE);
-        }
-        item = item->next;
+        if (!timespec_equal(&price_time, &t))
+            break;
+        gnc_price_list_insert(return_list, p, FALSE);
     }
 }
 
@@ -1663,9 +1870,9 @@ gnc_pricedb_lookup_at_time(GNCPriceDB *db,
                            const gnc_commodity *currency,
                            Timespec t)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GList *result = NULL;
-    GList *item = NULL;
+    guint first, last;
     GHashTable *currency_hash;
     QofBook *book;
     QofBackend *be;
@@ -1693,24 +1900,21 @@ gnc_pricedb_lookup_at_time(GNCPriceDB *db,
         return NULL;
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!price_list)
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
         LEAVE (" no price list");
         return NULL;
     }
 
-    item = price_list;
-    while (item)
+    first = price_array_count_before(prices, t, FALSE);
+    last = price_array_count_before(prices, t, TRUE);
+    /* The result is oldest first. */
+    while (last > first)
     {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
-        if (timespec_equal(&price_time, &t))
-        {
-            result = g_list_prepend(result, p);
-            gnc_price_ref(p);
-        }
-        item = item->next;
+        GNCPrice *p = g_ptr_array_index(prices, --last);
+        result = g_list_prepend(result, p);
+        gnc_price_ref(p);
     }
     LEAVE (" ");
     return result;
@@ -1720,23 +1924,15 @@ static void
 lookup_time(gpointer key, gpointer val, gpointer user_data)
 {
     //gnc_commodity *currency = (gnc_commodity *)key;
-    GList *price_list = (GList *)val;
-    GList *item = NULL;
+    GPtrArray *prices = (GPtrArray *)val;
     GNCPriceLookupHelper *lookup_helper = (GNCPriceLookupHelper *)user_data;
     GList **return_list = lookup_helper->return_list;
     Timespec t = lookup_helper->time;
+    guint i, last;
 
-    item = price_list;
-    while (item)
-    {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
-        if (timespec_equal(&price_time, &t))
-        {
-            gnc_price_list_insert(return_list, item->data, FALSE);
-        }
-        item = item->next;
-    }
+    last = price_array_count_before(prices, t, TRUE);
+    for (i = price_array_count_before(prices, t, FALSE); i < last; i++)
+        gnc_price_list_insert(return_list, g_ptr_array_index(prices, i), FALSE);
 }
 
 PriceList *
@@ -1796,11 +1992,8 @@ gnc_pricedb_lookup_nearest_in_time(GNCPriceDB *db,
                                    const gnc_commodity *currency,
                                    Timespec t)
 {
-    GList *price_list;
-    GNCPrice *current_price = NULL;
-    GNCPrice *next_price = NULL;
+    GPtrArray *prices;
     GNCPrice *result = NULL;
-    GList *item = NULL;
     GHashTable *currency_hash;
     QofBook *book;
     QofBackend *be;
@@ -1828,61 +2021,17 @@ gnc_pricedb_lookup_nearest_in_time(GNCPriceDB *db,
         return NULL;
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!price_list)
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
         LEAVE ("no price list");
         return NULL;
     }
 
-    item = price_list;
-
-    /* default answer */
-    current_price = item->data;
-
-    /* find the first candidate past the one we want.  Remember that
-       prices are in most-recent-first order. */
-    while (!next_price && item)
-    {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
-        if (timespec_cmp(&price_time, &t) <= 0)
-        {
-            next_price = item->data;
-            break;
-        }
-        current_price = item->data;
-        item = item->next;
-    }
-
-    if (current_price)
-    {
-        if (!next_price)
-        {
-            result = current_price;
-        }
-        else
-        {
-            Timespec current_t = gnc_price_get_time(current_price);
-            Timespec next_t = gnc_price_get_time(next_price);
-            Timespec diff_current = timespec_diff(&current_t, &t);
-            Timespec diff_next = timespec_diff(&next_t, &t);
-            Timespec abs_current = timespec_abs(&diff_current);
-            Timespec abs_next = timespec_abs(&diff_next);
-
-            /* Choose the price that is closest to the given time. In case of
-             * a tie, prefer the older price since it actually existed at the
-             * time. (This also fixes bug #541970.) */
-            if (timespec_cmp(&abs_current, &abs_next) < 0)
-            {
-                result = current_price;
-            }
-            else
-            {
-                result = next_price;
-            }
-        }
-    }
+    /* Choose the price that is closest to the given time. In case of
+     * a tie, prefer the older price since it actually existed at the
+     * time. (This also fixes bug #541970.) */
+    result = price_array_nearest(prices, t, TRUE);
 
     gnc_price_ref(result);
     LEAVE (" ");
@@ -1895,15 +2044,11 @@ gnc_pricedb_lookup_latest_before (GNCPriceDB *db,
                                   gnc_commodity *currency,
                                   Timespec t)
 {
-    GList *price_list;
+    GPtrArray *prices;
     GNCPrice *current_price = NULL;
-    /*  GNCPrice *next_price = NULL;
-        GNCPrice *result = NULL;*/
-    GList *item = NULL;
     GHashTable *currency_hash;
     QofBook *book;
     QofBackend *be;
-    Timespec price_time;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
@@ -1928,22 +2073,14 @@ gnc_pricedb_lookup_latest_before (GNCPriceDB *db,
         return NULL;
     }
 
-    price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!price_list)
+    prices = g_hash_table_lookup(currency_hash, currency);
+    if (!prices)
     {
         LEAVE ("no price list");
         return NULL;
     }
 
-    item = price_list;
-    do
-    {
-        price_time = gnc_price_get_time (item->data);
-        if (timespec_cmp(&price_time, &t) <= 0)
-            current_price = item->data;
-        item = item->next;
-    }
-    while (timespec_cmp(&price_time, &t) > 0 && item);
+    current_price = price_array_latest_before(prices, t);
     gnc_price_ref(current_price);
     LEAVE (" ");
     return current_price;
@@ -1954,62 +2091,13 @@ static void
 lookup_nearest(gpointer key, gpointer val, gpointer user_data)
 {
     //gnc_commodity *currency = (gnc_commodity *)key;
-    GList *price_list = (GList *)val;
-    GNCPrice *current_price = NULL;
-    GNCPrice *next_price = NULL;
-    GNCPrice *result = NULL;
-    GList *item = NULL;
+    GPtrArray *prices = (GPtrArray *)val;
     GNCPriceLookupHelper *lookup_helper = (GNCPriceLookupHelper *)user_data;
     GList **return_list = lookup_helper->return_list;
     Timespec t = lookup_helper->time;
 
-    item = price_list;
-
-    /* default answer */
-    current_price = item->data;
-
-    /* find the first candidate past the one we want.  Remember that
-       prices are in most-recent-first order. */
-    while (!next_price && item)
-    {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
-        if (timespec_cmp(&price_time, &t) <= 0)
-        {
-            next_price = item->data;
-            break;
-        }
-        current_price = item->data;
-        item = item->next;
-    }
-
-    if (current_price)
-    {
-        if (!next_price)
-        {
-            result = current_price;
-        }
-        else
-        {
-            Timespec current_t = gnc_price_get_time(current_price);
-            Timespec next_t = gnc_price_get_time(next_price);
-            Timespec diff_current = timespec_diff(&current_t, &t);
-            Timespec diff_next = timespec_diff(&next_t, &t);
-            Timespec abs_current = timespec_abs(&diff_current);
-            Timespec abs_next = timespec_abs(&diff_next);
-
-            if (timespec_cmp(&abs_current, &abs_next) <= 0)
-            {
-                result = current_price;
-            }
-            else
-            {
-                result = next_price;
-            }
-        }
-    }
-
-    gnc_price_list_insert(return_list, result, FALSE);
+    gnc_price_list_insert(return_list, price_array_nearest(prices, t, FALSE),
+                          FALSE);
 }
 
 
@@ -2017,28 +2105,14 @@ static void
 lookup_latest_before(gpointer key, gpointer val, gpointer user_data)
 {
     //gnc_commodity *currency = (gnc_commodity *)key;
-    GList *price_list = (GList *)val;
+    GPtrArray *prices = (GPtrArray *)val;
     GNCPrice *current_price = NULL;
-    /*  GNCPrice *next_price = NULL;
-        GNCPrice *result = NULL;*/
-    GList *item = NULL;
     GNCPriceLookupHelper *lookup_helper = (GNCPriceLookupHelper *)user_data;
     GList **return_list = lookup_helper->return_list;
     Timespec t = lookup_helper->time;
-    Timespec price_time;
 
-    if (price_list)
-    {
-        item = price_list;
-        do
-        {
-            price_time = gnc_price_get_time (item->data);
-            if (timespec_cmp(&price_time, &t) <= 0)
-                current_price = item->data;
-            item = item->next;
-        }
-        while (timespec_cmp(&price_time, &t) > 0 && item);
-    }
+    if (prices)
+        current_price = price_array_latest_before(prices, t);
 
     gnc_price_list_insert(return_list, current_price, FALSE);
 }
@@ -2146,300 +2220,472 @@ gnc_pricedb_lookup_latest_before_any_currency(GNCPriceDB *db,
 }
 
 
-/*
- * Convert a balance from one currency to another.
+/* ==================================================================== */
+/* balance conversion
+
+   A conversion is worked out once per (from, to, kind of lookup, time)
+   and kept in db->conversion_cache until a price is added, removed or
+   changed.  Only the rates are cached, not the converted amounts, and
+   they are applied with exactly the rounding the conversion functions
+   have always used, so a cached conversion gives the same result as a
+   fresh one.  The time is part of the key as is (it is ignored for the
+   latest price), because any coarser date bucket could pick a different
+   quote.
+
+   Like before, a direct price is tried first, then the reciprocal of a
+   price of the new currency in the balance currency, then two stages
+   through any currency the balance currency has a price in.  If all of
+   these fail, the shortest path through the graph of commodities that
+   have prices in terms of each other is used, with the rates along the
+   path multiplied into a single cross rate.
  */
-gnc_numeric
-gnc_pricedb_convert_balance_latest_price(GNCPriceDB *pdb,
-        gnc_numeric balance,
-        const gnc_commodity *balance_currency,
-        const gnc_commodity *new_currency)
+
+typedef enum
 {
-    GNCPrice *price, *currency_price;
-    GList *price_list, *list_helper;
-    gnc_numeric currency_price_value;
-    gnc_commodity *intermediate_currency;
+    CONVERT_LATEST,
+    CONVERT_NEAREST,
+    CONVERT_LATEST_BEFORE
+} PriceConversionType;
 
-    if (gnc_numeric_zero_p (balance) ||
-            gnc_commodity_equiv (balance_currency, new_currency))
-        return balance;
+typedef struct
+{
+    const gnc_commodity *from;
+    const gnc_commodity *to;
+    PriceConversionType type;
+    Timespec t;
+} PriceConversionKey;
 
-    /* Look for a direct price. */
-    price = gnc_pricedb_lookup_latest (pdb, balance_currency, new_currency);
-    if (price)
+/* How to get from the balance currency to the new currency.  The rates
+ * are applied in order; if reciprocal is set, the balance is divided by
+ * the last one instead.  n_rates is 0 if there is no conversion. */
+typedef struct
+{
+    gint n_rates;
+    gnc_numeric rates[2];
+    gboolean reciprocal;
+} PriceConversion;
+
+/* The cache is simply flushed when it grows past this many entries. */
+#define PRICE_CONVERSION_CACHE_MAX 16384
+
+static guint
+price_conversion_key_hash(gconstpointer key)
+{
+    const PriceConversionKey *k = key;
+
+    return g_direct_hash(k->from) ^ (g_direct_hash(k->to) << 1) ^
+           (guint) k->t.tv_sec ^ (guint) k->t.tv_nsec ^ k->type;
+}
+
+static gboolean
+price_conversion_key_equal(gconstpointer a, gconstpointer b)
+{
+    const PriceConversionKey *ka = a;
+    const PriceConversionKey *kb = b;
+
+    return ka->from == kb->from && ka->to == kb->to &&
+           ka->type == kb->type && timespec_equal(&ka->t, &kb->t);
+}
+
+static void
+price_graph_free_helper(gpointer key, gpointer val, gpointer user_data)
+{
+    g_list_free((GList *) val);
+}
+
+/* Forget all conversions; called whenever the prices change. */
+static void
+pricedb_invalidate_conversions(GNCPriceDB *db)
+{
+    if (!db) return;
+    if (db->conversion_cache)
+        g_hash_table_remove_all(db->conversion_cache);
+    if (db->price_graph)
     {
-        balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        g_hash_table_foreach(db->price_graph, price_graph_free_helper, NULL);
+        g_hash_table_destroy(db->price_graph);
+        db->price_graph = NULL;
     }
+}
 
-    /* Look for a price of the new currency in the balance currency and use
-     * the reciprocal if we find it
-     */
-    price = gnc_pricedb_lookup_latest (pdb, new_currency, balance_currency);
+void
+gnc_pricedb_get_conversion_stats(GNCPriceDB *db, guint *hits, guint *misses)
+{
+    if (hits) *hits = db ? db->conversion_hits : 0;
+    if (misses) *misses = db ? db->conversion_misses : 0;
+}
+
+static GNCPrice *
+price_conversion_lookup(GNCPriceDB *db, const gnc_commodity *c,
+                        const gnc_commodity *currency,
+                        PriceConversionType type, Timespec t)
+{
+    switch (type)
+    {
+    case CONVERT_LATEST:
+        return gnc_pricedb_lookup_latest(db, c, currency);
+    case CONVERT_NEAREST:
+        return gnc_pricedb_lookup_nearest_in_time(db, c, currency, t);
+    case CONVERT_LATEST_BEFORE:
+        return gnc_pricedb_lookup_latest_before(db, (gnc_commodity *) c,
+                                                (gnc_commodity *) currency, t);
+    }
+    return NULL;
+}
+
+static PriceList *
+price_conversion_lookup_any_currency(GNCPriceDB *db, const gnc_commodity *c,
+                                     PriceConversionType type, Timespec t)
+{
+    switch (type)
+    {
+    case CONVERT_LATEST:
+        return gnc_pricedb_lookup_latest_any_currency(db, c);
+    case CONVERT_NEAREST:
+        return gnc_pricedb_lookup_nearest_in_time_any_currency(db, c, t);
+    case CONVERT_LATEST_BEFORE:
+        return gnc_pricedb_lookup_latest_before_any_currency(db,
+                (gnc_commodity *) c, t);
+    }
+    return NULL;
+}
+
+/* Get the rate of 'from' in terms of 'to' from a price of either in
+ * terms of the other. */
+static gboolean
+price_conversion_edge_rate(GNCPriceDB *db, const gnc_commodity *from,
+                           const gnc_commodity *to, PriceConversionType type,
+                           Timespec t, gnc_numeric *rate)
+{
+    GNCPrice *price;
+
+    price = price_conversion_lookup(db, from, to, type, t);
     if (price)
     {
-        balance = gnc_numeric_div (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        *rate = gnc_price_get_value(price);
+        gnc_price_unref(price);
+        return TRUE;
+    }
+    price = price_conversion_lookup(db, to, from, type, t);
+    if (price)
+    {
+        *rate = gnc_numeric_div(gnc_numeric_create(1, 1),
+                                gnc_price_get_value(price), GNC_DENOM_AUTO,
+                                GNC_HOW_DENOM_SIGFIGS(12) | GNC_HOW_RND_ROUND_HALF_UP);
+        gnc_price_unref(price);
+        return TRUE;
     }
+    return FALSE;
+}
 
-    /*
-     * no direct price found, try if we find a price in another currency
-     * and convert in two stages
-     */
-    price_list = gnc_pricedb_lookup_latest_any_currency(pdb, balance_currency);
-    if (!price_list)
+static void
+price_graph_add_edge(GHashTable *graph, gnc_commodity *a, gnc_commodity *b)
+{
+    GList *neighbours = g_hash_table_lookup(graph, a);
+
+    if (g_list_find(neighbours, b)) return;
+    g_hash_table_insert(graph, a, g_list_prepend(neighbours, b));
+}
+
+static void
+price_graph_add_currencies(gpointer key, gpointer val, gpointer user_data)
+{
+    gnc_commodity *currency = key;
+    GPtrArray *prices = val;
+    GHashTable *graph = user_data;
+    gnc_commodity *commodity = gnc_price_get_commodity(g_ptr_array_index(prices, 0));
+
+    price_graph_add_edge(graph, commodity, currency);
+    price_graph_add_edge(graph, currency, commodity);
+}
+
+static void
+price_graph_add_commodity(gpointer key, gpointer val, gpointer user_data)
+{
+    g_hash_table_foreach((GHashTable *) val, price_graph_add_currencies,
+                         user_data);
+}
+
+/* The commodity graph: every commodity maps to the list of commodities
+ * it has a price with, in either direction.  It only depends on which
+ * pairs have prices, so it is built once and kept until the prices
+ * change. */
+static GHashTable *
+pricedb_get_price_graph(GNCPriceDB *db)
+{
+    if (!db->price_graph)
     {
-        balance =  gnc_numeric_zero ();
-        return balance;
+        db->price_graph = g_hash_table_new(NULL, NULL);
+        g_hash_table_foreach(db->commodity_hash, price_graph_add_commodity,
+                             db->price_graph);
     }
+    return db->price_graph;
+}
 
-    list_helper = price_list;
-    currency_price_value = gnc_numeric_zero();
+typedef struct
+{
+    const gnc_commodity *prev;
+    gnc_numeric rate;               /* of prev in terms of this one */
+} PriceGraphStep;
 
-    do
+/* Breadth first search for the shortest chain of prices from 'from' to
+ * 'to' that are all usable at time t, folded into a single rate. */
+static gboolean
+price_conversion_find_path(GNCPriceDB *db, const gnc_commodity *from,
+                           const gnc_commodity *to, PriceConversionType type,
+                           Timespec t, gnc_numeric *rate)
+{
+    GHashTable *graph = pricedb_get_price_graph(db);
+    GHashTable *steps;
+    GQueue queue = G_QUEUE_INIT;
+    gboolean found = FALSE;
+
+    if (!g_hash_table_lookup(graph, from) || !g_hash_table_lookup(graph, to))
+        return FALSE;
+
+    steps = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    g_hash_table_insert(steps, (gpointer) from, g_new0(PriceGraphStep, 1));
+    g_queue_push_tail(&queue, (gpointer) from);
+    while (!found && !g_queue_is_empty(&queue))
     {
-        price = (GNCPrice *)(list_helper->data);
+        const gnc_commodity *node = g_queue_pop_head(&queue);
+        GList *n;
 
-        intermediate_currency = gnc_price_get_currency(price);
-        currency_price = gnc_pricedb_lookup_latest(pdb, intermediate_currency,
-                         new_currency);
-        if (currency_price)
+        for (n = g_hash_table_lookup(graph, node); n && !found; n = n->next)
         {
-            currency_price_value = gnc_price_get_value(currency_price);
-            gnc_price_unref(currency_price);
+            PriceGraphStep *step;
+            gnc_numeric edge_rate;
+
+            if (g_hash_table_lookup(steps, n->data))
+                continue;
+            if (!price_conversion_edge_rate(db, node, n->data, type, t,
+                                            &edge_rate))
+                continue;
+            step = g_new0(PriceGraphStep, 1);
+            step->prev = node;
+            step->rate = edge_rate;
+            g_hash_table_insert(steps, n->data, step);
+            g_queue_push_tail(&queue, n->data);
+            found = (n->data == to);
         }
-        else
-        {
-            currency_price = gnc_pricedb_lookup_latest(pdb, new_currency,
-                             intermediate_currency);
-            if (currency_price)
-            {
-                /* here we need the reciprocal */
-                currency_price_value = gnc_numeric_div(gnc_numeric_create(1, 1),
-                                                       gnc_price_get_value(currency_price),
-                                                       GNC_DENOM_AUTO,
-                                                       GNC_HOW_DENOM_EXACT | GNC_HOW_RND_NEVER);
-                gnc_price_unref(currency_price);
-            }
-        }
-
-        list_helper = list_helper->next;
     }
-    while ((list_helper != NULL) &&
-            (gnc_numeric_zero_p(currency_price_value)));
+    g_queue_clear(&queue);
+
+    if (found)
+    {
+        const gnc_commodity *node = to;
 
-    balance = gnc_numeric_mul (balance, currency_price_value,
-                               GNC_DENOM_AUTO,
-                               GNC_HOW_DENOM_EXACT | GNC_HOW_RND_NEVER);
-    balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                               gnc_commodity_get_fraction (new_currency),
-                               GNC_HOW_RND_ROUND_HALF_UP);
+        *rate = gnc_numeric_create(1, 1);
+        while (node != from)
+        {
+            PriceGraphStep *step = g_hash_table_lookup(steps, node);
 
-    gnc_price_list_destroy(price_list);
-    return balance;
+            *rate = gnc_numeric_mul(*rate, step->rate, GNC_DENOM_AUTO,
+                                    GNC_HOW_DENOM_SIGFIGS(12) | GNC_HOW_RND_ROUND_HALF_UP);
+            node = step->prev;
+        }
+        found = !gnc_numeric_check(*rate) && !gnc_numeric_zero_p(*rate);
+    }
+    g_hash_table_destroy(steps);
+    return found;
 }
 
-gnc_numeric
-gnc_pricedb_convert_balance_nearest_price(GNCPriceDB *pdb,
-        gnc_numeric balance,
-        const gnc_commodity *balance_currency,
-        const gnc_commodity *new_currency,
-        Timespec t)
+/* Work out a conversion without the cache.  step_denom and step_how are
+ * the rounding each function has always used for the first stage of a
+ * two-stage conversion. */
+static void
+price_conversion_find(GNCPriceDB *db, const gnc_commodity *from,
+                      const gnc_commodity *to, PriceConversionType type,
+                      Timespec t, gint64 step_denom, gint step_how,
+                      PriceConversion *conv)
 {
     GNCPrice *price, *currency_price;
     GList *price_list, *list_helper;
     gnc_numeric currency_price_value;
     gnc_commodity *intermediate_currency;
+    PriceConversionType reverse_type;
 
-    if (gnc_numeric_zero_p (balance) ||
-            gnc_commodity_equiv (balance_currency, new_currency))
-        return balance;
+    conv->n_rates = 0;
+    conv->reciprocal = FALSE;
 
     /* Look for a direct price. */
-    price = gnc_pricedb_lookup_nearest_in_time (pdb, balance_currency, new_currency, t);
+    price = price_conversion_lookup(db, from, to, type, t);
     if (price)
     {
-        balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        conv->n_rates = 1;
+        conv->rates[0] = gnc_price_get_value(price);
+        gnc_price_unref(price);
+        return;
     }
 
     /* Look for a price of the new currency in the balance currency and use
      * the reciprocal if we find it
      */
-    price = gnc_pricedb_lookup_nearest_in_time (pdb, new_currency, balance_currency, t);
+    price = price_conversion_lookup(db, to, from, type, t);
     if (price)
     {
-        balance = gnc_numeric_div (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        conv->n_rates = 1;
+        conv->rates[0] = gnc_price_get_value(price);
+        conv->reciprocal = TRUE;
+        gnc_price_unref(price);
+        return;
     }
 
     /*
      * no direct price found, try if we find a price in another currency
      * and convert in two stages
      */
-    price_list = gnc_pricedb_lookup_nearest_in_time_any_currency(pdb, balance_currency, t);
-    if (!price_list)
-    {
-        balance =  gnc_numeric_zero ();
-        return balance;
-    }
-
-    list_helper = price_list;
-    currency_price_value = gnc_numeric_zero();
-
-    do
+    price_list = price_conversion_lookup_any_currency(db, from, type, t);
+    if (price_list)
     {
-        price = (GNCPrice *)(list_helper->data);
-
-        intermediate_currency = gnc_price_get_currency(price);
-        currency_price = gnc_pricedb_lookup_nearest_in_time(pdb, intermediate_currency,
-                         new_currency, t);
-        if (currency_price)
-        {
-            currency_price_value = gnc_price_get_value(currency_price);
-            gnc_price_unref(currency_price);
-        }
-        else
+        /* The reverse second stage of the latest-before conversion has
+         * always used the nearest price. */
+        reverse_type = (type == CONVERT_LATEST_BEFORE) ? CONVERT_NEAREST : type;
+        currency_price_value = gnc_numeric_zero();
+        list_helper = price_list;
+        do
         {
-            currency_price = gnc_pricedb_lookup_nearest_in_time(pdb, new_currency,
-                             intermediate_currency, t);
+            price = (GNCPrice *)(list_helper->data);
+
+            intermediate_currency = gnc_price_get_currency(price);
+            currency_price = price_conversion_lookup(db, intermediate_currency,
+                             to, type, t);
             if (currency_price)
             {
-                /* here we need the reciprocal */
-                currency_price_value = gnc_numeric_div(gnc_numeric_create(1, 1),
-                                                       gnc_price_get_value(currency_price),
-                                                       gnc_commodity_get_fraction (new_currency),
-                                                       GNC_HOW_RND_ROUND_HALF_UP);
+                currency_price_value = gnc_price_get_value(currency_price);
                 gnc_price_unref(currency_price);
             }
+            else
+            {
+                currency_price = price_conversion_lookup(db, to,
+                                 intermediate_currency, reverse_type, t);
+                if (currency_price)
+                {
+                    /* here we need the reciprocal */
+                    currency_price_value = gnc_numeric_div(gnc_numeric_create(1, 1),
+                                                           gnc_price_get_value(currency_price),
+                                                           step_denom, step_how);
+                    gnc_price_unref(currency_price);
+                }
+            }
+
+            list_helper = list_helper->next;
         }
+        while ((list_helper != NULL) &&
+                (gnc_numeric_zero_p(currency_price_value)));
 
-        list_helper = list_helper->next;
+        if (!gnc_numeric_zero_p(currency_price_value))
+        {
+            conv->n_rates = 2;
+            conv->rates[0] = currency_price_value;
+            conv->rates[1] = gnc_price_get_value(price);
+        }
+        gnc_price_list_destroy(price_list);
+        if (conv->n_rates)
+            return;
     }
-    while ((list_helper != NULL) &&
-            (gnc_numeric_zero_p(currency_price_value)));
 
-    balance = gnc_numeric_mul (balance, currency_price_value,
-                               gnc_commodity_get_fraction (new_currency),
-                               GNC_HOW_RND_ROUND_HALF_UP);
-
-    balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                               gnc_commodity_get_fraction (new_currency),
-                               GNC_HOW_RND_ROUND_HALF_UP);
-
-    gnc_price_list_destroy(price_list);
-    return balance;
+    /* Finally, try a longer chain of prices. */
+    if (price_conversion_find_path(db, from, to, type, t, &conv->rates[0]))
+        conv->n_rates = 1;
 }
 
-
-gnc_numeric
-gnc_pricedb_convert_balance_latest_before(GNCPriceDB *pdb,
-        gnc_numeric balance,
-        gnc_commodity *balance_currency,
-        gnc_commodity *new_currency,
-        Timespec t)
+static gnc_numeric
+pricedb_convert_balance(GNCPriceDB *db, gnc_numeric balance,
+                        const gnc_commodity *from, const gnc_commodity *to,
+                        PriceConversionType type, Timespec t,
+                        gint64 step_denom, gint step_how)
 {
-    GNCPrice *price, *currency_price;
-    GList *price_list, *list_helper;
-    gnc_numeric currency_price_value;
-    gnc_commodity *intermediate_currency;
+    PriceConversionKey key;
+    PriceConversion *conv;
+    gint64 fraction;
 
     if (gnc_numeric_zero_p (balance) ||
-            gnc_commodity_equiv (balance_currency, new_currency))
+            gnc_commodity_equiv (from, to))
         return balance;
+    if (!db || !from || !to)
+        return gnc_numeric_zero ();
 
-    /* Look for a direct price. */
-    price = gnc_pricedb_lookup_latest_before (pdb, balance_currency, new_currency, t);
+    key.from = from;
+    key.to = to;
+    key.type = type;
+    key.t = t;
+    if (type == CONVERT_LATEST)
+        key.t.tv_sec = key.t.tv_nsec = 0;
 
-    if (price)
+    conv = g_hash_table_lookup(db->conversion_cache, &key);
+    if (conv)
     {
-        balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        db->conversion_hits++;
     }
-
-    /* Look for a price of the new currency in the balance currency and use
-     * the reciprocal if we find it.
-     */
-    price = gnc_pricedb_lookup_latest_before (pdb, new_currency, balance_currency, t);
-    if (price)
+    else
     {
-        balance = gnc_numeric_div (balance, gnc_price_get_value (price),
-                                   gnc_commodity_get_fraction (new_currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
-        gnc_price_unref (price);
-        return balance;
+        db->conversion_misses++;
+        conv = g_new0(PriceConversion, 1);
+        price_conversion_find(db, from, to, type, t, step_denom, step_how,
+                              conv);
+        if (g_hash_table_size(db->conversion_cache) >= PRICE_CONVERSION_CACHE_MAX)
+            g_hash_table_remove_all(db->conversion_cache);
+        g_hash_table_insert(db->conversion_cache,
+                            g_memdup(&key, sizeof(key)), conv);
     }
 
-    /*
-     * no direct price found, try if we find a price in another currency
-     * and convert in two stages
-     */
-    price_list = gnc_pricedb_lookup_latest_before_any_currency(pdb, balance_currency, t);
-    if (!price_list)
-    {
-        balance =  gnc_numeric_zero ();
-        return balance;
-    }
+    if (conv->n_rates == 0)
+        return gnc_numeric_zero ();
 
-    list_helper = price_list;
-    currency_price_value = gnc_numeric_zero();
+    fraction = gnc_commodity_get_fraction (to);
+    if (conv->n_rates == 2)
+        balance = gnc_numeric_mul (balance, conv->rates[0],
+                                   step_denom, step_how);
+    if (conv->reciprocal)
+        return gnc_numeric_div (balance, conv->rates[conv->n_rates - 1],
+                                fraction, GNC_HOW_RND_ROUND_HALF_UP);
+    return gnc_numeric_mul (balance, conv->rates[conv->n_rates - 1],
+                            fraction, GNC_HOW_RND_ROUND_HALF_UP);
+}
 
-    do
-    {
-        price = (GNCPrice *)(list_helper->data);
+/*
+ * Convert a balance from one currency to another.
+ */
+gnc_numeric
+gnc_pricedb_convert_balance_latest_price(GNCPriceDB *pdb,
+        gnc_numeric balance,
+        const gnc_commodity *balance_currency,
+        const gnc_commodity *new_currency)
+{
+    Timespec t = {0, 0};
 
-        intermediate_currency = gnc_price_get_currency(price);
-        currency_price = gnc_pricedb_lookup_latest_before(pdb, intermediate_currency,
-                         new_currency, t);
-        if (currency_price)
-        {
-            currency_price_value = gnc_price_get_value(currency_price);
-            gnc_price_unref(currency_price);
-        }
-        else
-        {
-            currency_price = gnc_pricedb_lookup_nearest_in_time(pdb, new_currency,
-                             intermediate_currency, t);
-            if (currency_price)
-            {
-                /* here we need the reciprocal */
-                currency_price_value = gnc_numeric_div(gnc_numeric_create(1, 1),
-                                                       gnc_price_get_value(currency_price),
-                                                       gnc_commodity_get_fraction (new_currency),
-                                                       GNC_HOW_RND_ROUND_HALF_UP);
-                gnc_price_unref(currency_price);
-            }
-        }
+    return pricedb_convert_balance (pdb, balance, balance_currency,
+                                    new_currency, CONVERT_LATEST, t,
+                                    GNC_DENOM_AUTO,
+                                    GNC_HOW_DENOM_EXACT | GNC_HOW_RND_NEVER);
+}
 
-        list_helper = list_helper->next;
-    }
-    while ((list_helper != NULL) &&
-            (gnc_numeric_zero_p(currency_price_value)));
+gnc_numeric
+gnc_pricedb_convert_balance_nearest_price(GNCPriceDB *pdb,
+        gnc_numeric balance,
+        const gnc_commodity *balance_currency,
+        const gnc_commodity *new_currency,
+        Timespec t)
+{
+    return pricedb_convert_balance (pdb, balance, balance_currency,
+                                    new_currency, CONVERT_NEAREST, t,
+                                    gnc_commodity_get_fraction (new_currency),
+                                    GNC_HOW_RND_ROUND_HALF_UP);
+}
 
-    balance = gnc_numeric_mul (balance, currency_price_value,
-                               gnc_commodity_get_fraction (new_currency),
-                               GNC_HOW_RND_ROUND_HALF_UP);
-    balance = gnc_numeric_mul (balance, gnc_price_get_value (price),
-                               gnc_commodity_get_fraction (new_currency),
-                               GNC_HOW_RND_ROUND_HALF_UP);
 
-    gnc_price_list_destroy(price_list);
-    return balance;
+gnc_numeric
+gnc_pricedb_convert_balance_latest_before(GNCPriceDB *pdb,
+        gnc_numeric balance,
+        gnc_commodity *balance_currency,
+        gnc_commodity *new_currency,
+        Timespec t)
+{
+    return pricedb_convert_balance (pdb, balance, balance_currency,
+                                    new_currency, CONVERT_LATEST_BEFORE, t,
+                                    gnc_commodity_get_fraction (new_currency),
+                                    GNC_HOW_RND_ROUND_HALF_UP);
 }
 
 
@@ -2458,16 +2704,15 @@ typedef struct
 static void
 pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
+    guint i = prices->len;
     GNCPriceDBForeachData *foreach_data = (GNCPriceDBForeachData *) user_data;
 
     /* stop traversal when func returns FALSE */
-    while (foreach_data->ok && node)
+    while (foreach_data->ok && i > 0)
     {
-        GNCPrice *p = (GNCPrice *) node->data;
+        GNCPrice *p = (GNCPrice *) g_ptr_array_index(prices, --i);
         foreach_data->ok = foreach_data->func(p, foreach_data->user_data);
-        node = node->next;
     }
 }
 
@@ -2552,12 +2797,12 @@ stable_price_traversal(GNCPriceDB *db,
         for (j = price_lists; j; j = j->next)
         {
             GHashTableKVPair *pricelist_kvp = (GHashTableKVPair *) j->data;
-            GList *price_list = (GList *) pricelist_kvp->value;
-            GList *node;
+            GPtrArray *prices = (GPtrArray *) pricelist_kvp->value;
+            guint k;
 
-            for (node = (GList *) price_list; node; node = node->next)
+            for (k = prices->len; k > 0; k--)
             {
-                GNCPrice *price = (GNCPrice *) node->data;
+                GNCPrice *price = (GNCPrice *) g_ptr_array_index(prices, k - 1);
 
                 /* stop traversal when f returns FALSE */
                 if (FALSE == ok) break;
@@ -2779,15 +3024,14 @@ VoidGNCPriceDBForeachData;
 static void
 void_pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)
 {
-    GList *price_list = (GList *) val;
-    GList *node = price_list;
+    GPtrArray *prices = (GPtrArray *) val;
+    guint i = prices->len;
     VoidGNCPriceDBForeachData *foreach_data = (VoidGNCPriceDBForeachData *) user_data;
 
-    while (node)
+    while (i > 0)
     {
-        GNCPrice *p = (GNCPrice *) node->data;
+        GNCPrice *p = (GNCPrice *) g_ptr_array_index(prices, --i);
         foreach_data->func(p, foreach_data->user_data);
-        node = node->next;
     }
 }
 
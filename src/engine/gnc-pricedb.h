@@ -423,6 +423,12 @@ gnc_pricedb_convert_balance_latest_before(GNCPriceDB *pdb,
         Timespec t);
 
 
+/** gnc_pricedb_get_conversion_stats - report how many of the balance
+    conversions above were answered from the conversion cache (hits) and
+    how many had to be worked out from the prices (misses). */
+void gnc_pricedb_get_conversion_stats(GNCPriceDB *db, guint *hits,
+                                      guint *misses);
+
 /** gnc_pricedb_foreach_price - call f once for each price in db, until
      and unless f returns FALSE.  If stable_order is not FALSE, make
      sure the ordering of the traversal is stable (i.e. the same order
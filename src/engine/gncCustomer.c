@@ -231,6 +231,7 @@ gnc_customer_class_init (GncCustomerClass *klass)
     qof_class->get_display_name = impl_get_display_name;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -268,7 +269,9 @@ GncCustomer *gncCustomerCreate (QofBook *book)
 
     if (gs_address_event_handler_id == 0)
     {
-        gs_address_event_handler_id = qof_event_register_handler(listen_for_address_events, NULL);
+        gs_address_event_handler_id =
+            qof_event_register_filtered_handler(listen_for_address_events, NULL,
+                    GNC_ID_ADDRESS, QOF_EVENT_MODIFY);
     }
 
     qof_event_gen (&cust->inst, QOF_EVENT_CREATE, NULL);
@@ -358,6 +361,7 @@ void gncCustomerSetTerms (GncCustomer *cust, GncBillTerm *terms)
     gncCustomerBeginEdit (cust);
     if (cust->terms)
         gncBillTermDecRef (cust->terms);
+    qof_instance_reference_changed (QOF_INSTANCE(cust), cust->terms, terms);
     cust->terms = terms;
     if (cust->terms)
         gncBillTermIncRef (cust->terms);
@@ -435,6 +439,7 @@ void gncCustomerSetTaxTable (GncCustomer *customer, GncTaxTable *table)
         gncTaxTableDecRef (customer->taxtable);
     if (table)
         gncTaxTableIncRef (table);
+    qof_instance_reference_changed (QOF_INSTANCE(customer), customer->taxtable, table);
     customer->taxtable = table;
     mark_customer (customer);
     gncCustomerCommitEdit (customer);
@@ -213,6 +213,7 @@ gnc_employee_class_init (GncEmployeeClass *klass)
     qof_class->get_display_name = NULL;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -247,7 +248,9 @@ GncEmployee *gncEmployeeCreate (QofBook *book)
 
     if (gs_address_event_handler_id == 0)
     {
-        gs_address_event_handler_id = qof_event_register_handler(listen_for_address_events, NULL);
+        gs_address_event_handler_id =
+            qof_event_register_filtered_handler(listen_for_address_events, NULL,
+                    GNC_ID_ADDRESS, QOF_EVENT_MODIFY);
     }
 
     qof_event_gen (&employee->inst, QOF_EVENT_CREATE, NULL);
@@ -355,6 +358,7 @@ void gncEmployeeSetCurrency (GncEmployee *employee, gnc_commodity *currency)
             gnc_commodity_equal (employee->currency, currency))
         return;
     gncEmployeeBeginEdit (employee);
+    qof_instance_reference_changed (QOF_INSTANCE(employee), employee->currency, currency);
     employee->currency = currency;
     mark_employee (employee);
     gncEmployeeCommitEdit (employee);
@@ -375,6 +379,7 @@ void gncEmployeeSetCCard (GncEmployee *employee, Account* ccard_acc)
     if (!employee) return;
     if (ccard_acc == employee->ccard_acc) return;
     gncEmployeeBeginEdit (employee);
+    qof_instance_reference_changed (QOF_INSTANCE(employee), employee->ccard_acc, ccard_acc);
     employee->ccard_acc = ccard_acc;
     mark_employee (employee);
     gncEmployeeCommitEdit (employee);
@@ -342,6 +342,7 @@ gnc_entry_class_init (GncEntryClass *klass)
     qof_class->get_display_name = impl_get_display_name;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -510,6 +511,7 @@ void gncEntrySetInvAccount (GncEntry *entry, Account *acc)
     if (!entry) return;
     if (entry->i_account == acc) return;
     gncEntryBeginEdit (entry);
+    qof_instance_reference_changed (QOF_INSTANCE(entry), entry->i_account, acc);
     entry->i_account = acc;
     mark_entry (entry);
     gncEntryCommitEdit (entry);
@@ -557,6 +559,7 @@ void gncEntrySetInvTaxTable (GncEntry *entry, GncTaxTable *table)
         gncTaxTableDecRef (entry->i_tax_table);
     if (table)
         gncTaxTableIncRef (table);
+    qof_instance_reference_changed (QOF_INSTANCE(entry), entry->i_tax_table, table);
     entry->i_tax_table = table;
     entry->values_dirty = TRUE;
     mark_entry (entry);
@@ -634,6 +637,7 @@ void gncEntrySetBillAccount (GncEntry *entry, Account *acc)
     if (!entry) return;
     if (entry->b_account == acc) return;
     gncEntryBeginEdit (entry);
+    qof_instance_reference_changed (QOF_INSTANCE(entry), entry->b_account, acc);
     entry->b_account = acc;
     mark_entry (entry);
     gncEntryCommitEdit (entry);
@@ -681,6 +685,7 @@ void gncEntrySetBillTaxTable (GncEntry *entry, GncTaxTable *table)
         gncTaxTableDecRef (entry->b_tax_table);
     if (table)
         gncTaxTableIncRef (table);
+    qof_instance_reference_changed (QOF_INSTANCE(entry), entry->b_tax_table, table);
     entry->b_tax_table = table;
     entry->values_dirty = TRUE;
     mark_entry (entry);
@@ -770,6 +775,7 @@ void gncEntryCopy (const GncEntry *src, GncEntry *dest)
     gncEntrySetNotes (dest, src->notes);
     dest->quantity		= src->quantity;
 
+    qof_instance_reference_changed (QOF_INSTANCE(dest), dest->i_account, src->i_account);
     dest->i_account		= src->i_account;
     dest->i_price			= src->i_price;
     dest->i_taxable		= src->i_taxable;
@@ -779,6 +785,7 @@ void gncEntryCopy (const GncEntry *src, GncEntry *dest)
     dest->i_disc_how		= src->i_disc_how;
 
     /* vendor bill data */
+    qof_instance_reference_changed (QOF_INSTANCE(dest), dest->b_account, src->b_account);
     dest->b_account		= src->b_account;
     dest->b_price			= src->b_price;
     dest->b_taxable		= src->b_taxable;
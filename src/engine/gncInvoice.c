@@ -278,6 +278,7 @@ gnc_invoice_class_init (GncInvoiceClass *klass)
     qof_class->get_display_name = impl_get_display_name;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -339,17 +340,20 @@ GncInvoice *gncInvoiceCopy (const GncInvoice *from)
     is_cn = kvp_frame_get_gint64(from->inst.kvp_data, GNC_INVOICE_IS_CN);
     kvp_frame_set_gint64(invoice->inst.kvp_data, GNC_INVOICE_IS_CN, is_cn);
 
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->terms, from->terms);
     invoice->terms = from->terms;
     gncBillTermIncRef (invoice->terms);
 
     gncOwnerCopy(&from->billto, &invoice->billto);
     gncOwnerCopy(&from->owner, &invoice->owner);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->job, from->job);
     invoice->job = from->job; // FIXME: Need IncRef or similar here?!?
 
     invoice->to_charge_amount = from->to_charge_amount;
     invoice->date_opened = from->date_opened;
 
     // Oops. Do not forget to copy the pointer to the correct currency here.
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->currency, from->currency);
     invoice->currency = from->currency;
 
     // Copy all invoice->entries
@@ -485,6 +489,7 @@ void gncInvoiceSetTerms (GncInvoice *invoice, GncBillTerm *terms)
     gncInvoiceBeginEdit (invoice);
     if (invoice->terms)
         gncBillTermDecRef (invoice->terms);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->terms, terms);
     invoice->terms = terms;
     if (invoice->terms)
         gncBillTermIncRef (invoice->terms);
@@ -535,6 +540,7 @@ void gncInvoiceSetCurrency (GncInvoice *invoice, gnc_commodity *currency)
             gnc_commodity_equal (invoice->currency, currency))
         return;
     gncInvoiceBeginEdit (invoice);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->currency, currency);
     invoice->currency = currency;
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
@@ -567,6 +573,7 @@ void gncInvoiceSetPostedTxn (GncInvoice *invoice, Transaction *txn)
     g_return_if_fail (invoice->posted_txn == NULL);
 
     gncInvoiceBeginEdit (invoice);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_txn, txn);
     invoice->posted_txn = txn;
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
@@ -578,6 +585,7 @@ void gncInvoiceSetPostedLot (GncInvoice *invoice, GNCLot *lot)
     g_return_if_fail (invoice->posted_lot == NULL);
 
     gncInvoiceBeginEdit (invoice);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_lot, lot);
     invoice->posted_lot = lot;
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
@@ -589,6 +597,7 @@ void gncInvoiceSetPostedAcc (GncInvoice *invoice, Account *acc)
     g_return_if_fail (invoice->posted_acc == NULL);
 
     gncInvoiceBeginEdit (invoice);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_acc, acc);
     invoice->posted_acc = acc;
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
@@ -1079,6 +1088,7 @@ qofInvoiceSetJob (GncInvoice *invoice, GncJob *job)
     {
         return;
     }
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->job, job);
     invoice->job = job;
 }
 
@@ -1658,6 +1668,9 @@ gncInvoiceUnpost (GncInvoice *invoice, gboolean reset_tax_tables)
     /* Clear out the invoice posted information */
     gncInvoiceBeginEdit (invoice);
 
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_acc, NULL);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_txn, NULL);
+    qof_instance_reference_changed (QOF_INSTANCE(invoice), invoice->posted_lot, NULL);
     invoice->posted_acc = NULL;
     invoice->posted_txn = NULL;
     invoice->posted_lot = NULL;
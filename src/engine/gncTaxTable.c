@@ -347,6 +347,7 @@ gnc_taxtable_class_init (GncTaxTableClass *klass)
     qof_class->get_display_name = impl_get_display_name;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -512,6 +513,9 @@ void gncTaxTableEntrySetAccount (GncTaxTableEntry *entry, Account *account)
 {
     if (!entry || !account) return;
     if (entry->account == account) return;
+    if (entry->table)
+        qof_instance_reference_changed (QOF_INSTANCE(entry->table),
+                                        entry->account, account);
     entry->account = account;
     if (entry->table)
     {
@@ -554,6 +558,7 @@ void gncTaxTableAddEntry (GncTaxTable *table, GncTaxTableEntry *entry)
         gncTaxTableRemoveEntry (entry->table, entry);
 
     entry->table = table;
+    qof_instance_reference_changed (QOF_INSTANCE(table), NULL, entry->account);
     table->entries = g_list_insert_sorted (table->entries, entry,
                                            (GCompareFunc)gncTaxTableEntryCompare);
     mark_table (table);
@@ -566,6 +571,8 @@ void gncTaxTableRemoveEntry (GncTaxTable *table, GncTaxTableEntry *entry)
     if (!table || !entry) return;
     gncTaxTableBeginEdit (table);
     entry->table = NULL;
+    if (g_list_find (table->entries, entry))
+        qof_instance_reference_changed (QOF_INSTANCE(table), entry->account, NULL);
     table->entries = g_list_remove (table->entries, entry);
     mark_table (table);
     mod_table (table);
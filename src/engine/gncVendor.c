@@ -219,6 +219,7 @@ gnc_vendor_class_init (GncVendorClass *klass)
     qof_class->get_display_name = NULL;
     qof_class->refers_to_object = impl_refers_to_object;
     qof_class->get_typed_referring_object_list = impl_get_typed_referring_object_list;
+    qof_class->references_indexed = TRUE;
 
     g_object_class_install_property
     (gobject_class,
@@ -251,7 +252,9 @@ GncVendor *gncVendorCreate (QofBook *book)
 
     if (gs_address_event_handler_id == 0)
     {
-        gs_address_event_handler_id = qof_event_register_handler(listen_for_address_events, NULL);
+        gs_address_event_handler_id =
+            qof_event_register_filtered_handler(listen_for_address_events, NULL,
+                    GNC_ID_ADDRESS, QOF_EVENT_MODIFY);
     }
 
     qof_event_gen (&vendor->inst, QOF_EVENT_CREATE, NULL);
@@ -336,6 +339,7 @@ void gncVendorSetTerms (GncVendor *vendor, GncBillTerm *terms)
     gncVendorBeginEdit (vendor);
     if (vendor->terms)
         gncBillTermDecRef (vendor->terms);
+    qof_instance_reference_changed (QOF_INSTANCE(vendor), vendor->terms, terms);
     vendor->terms = terms;
     if (vendor->terms)
         gncBillTermIncRef (vendor->terms);
@@ -394,6 +398,7 @@ void gncVendorSetTaxTable (GncVendor *vendor, GncTaxTable *table)
         gncTaxTableDecRef (vendor->taxtable);
     if (table)
         gncTaxTableIncRef (table);
+    qof_instance_reference_changed (QOF_INSTANCE(vendor), vendor->taxtable, table);
     vendor->taxtable = table;
     mark_vendor (vendor);
     gncVendorCommitEdit (vendor);
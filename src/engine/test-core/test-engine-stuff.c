@@ -1969,6 +1969,135 @@ make_random_changes_to_session (QofSession *session)
     make_random_changes_to_book (qof_session_get_book (session));
 }
 
+/* ================================================================= */
+/* Synthetic books: plain accounts and balanced transactions in bulk. */
+
+time_t
+get_random_test_book_date (void)
+{
+    return TEST_BOOK_START +
+           (time_t)get_random_int_in_range (0, TEST_BOOK_DAYS - 1) * 86400;
+}
+
+Account *
+make_test_account (QofBook *book, Account *parent, GNCAccountType type,
+                   gnc_commodity *commodity, const char *name)
+{
+    Account *acc = xaccMallocAccount (book);
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetType (acc, type);
+    if (name)
+        xaccAccountSetName (acc, name);
+    xaccAccountSetCommodity (acc, commodity);
+    gnc_account_append_child (parent ? parent : gnc_book_get_root_account (book),
+                              acc);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+Transaction *
+make_test_transaction (QofBook *book, Account *from, Account *to,
+                       time_t date, gnc_numeric amount)
+{
+    Transaction *trans = xaccMallocTransaction (book);
+    Split *from_split = xaccMallocSplit (book);
+    Split *to_split = xaccMallocSplit (book);
+
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, xaccAccountGetCommodity (to));
+    xaccTransSetDatePostedSecs (trans, date);
+    xaccSplitSetParent (from_split, trans);
+    xaccSplitSetParent (to_split, trans);
+    xaccSplitSetAccount (from_split, from);
+    xaccSplitSetAccount (to_split, to);
+    xaccSplitSetValue (from_split, gnc_numeric_neg (amount));
+    xaccSplitSetAmount (from_split, gnc_numeric_neg (amount));
+    xaccSplitSetValue (to_split, amount);
+    xaccSplitSetAmount (to_split, amount);
+    return trans;
+}
+
+GPtrArray *
+make_test_book_transactions (QofBook *book, gnc_commodity *currency,
+                             guint num_accounts, guint count)
+{
+    GPtrArray *accounts = g_ptr_array_sized_new (num_accounts);
+    guint i;
+
+    for (i = 0; i < num_accounts; i++)
+    {
+        gchar *name = g_strdup_printf ("Account %u", i);
+
+        g_ptr_array_add (accounts, make_test_account (book, NULL,
+                                                      ACCT_TYPE_BANK,
+                                                      currency, name));
+        g_free (name);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        guint a = get_random_int_in_range (0, num_accounts - 1);
+        Transaction *trans = make_test_transaction
+                             (book, accounts->pdata[a],
+                              accounts->pdata[(a + 1) % num_accounts],
+                              get_random_test_book_date (),
+                              gnc_numeric_create
+                              (get_random_int_in_range (1, 100000), 100));
+        Split *from = xaccTransGetSplit (trans, 0);
+        Split *to = xaccTransGetSplit (trans, 1);
+
+        xaccTransSetDescription (trans, (i % 5) ?
+                                 "Synthetic <transaction> & co" : "");
+        if (i % 4 == 0)
+            xaccTransSetNum (trans, "1234");
+        xaccSplitSetMemo (to, "memo");
+        xaccSplitSetAction (from, (i % 2) ? "Buy" : "");
+        if (i % 3 == 0)
+        {
+            xaccSplitSetReconcile (from, YREC);
+            xaccSplitSetDateReconciledSecs (from, TEST_BOOK_START +
+                                            (TEST_BOOK_DAYS + 50) * 86400);
+        }
+        if (i % 10 == 0)
+        {
+            kvp_frame_set_string (xaccTransGetSlots (trans), "notes",
+                                  "A note");
+            kvp_frame_set_gint64 (xaccSplitGetSlots (to), "a/b/int64-val", i);
+        }
+        xaccTransCommitEdit (trans);
+    }
+    return accounts;
+}
+
+void
+make_test_book_prices (QofBook *book, gnc_commodity *commodity,
+                       gnc_commodity *currency, guint count)
+{
+    GNCPriceDB *db = gnc_pricedb_get_db (book);
+    guint i;
+
+    for (i = 0; i < count; i++)
+    {
+        GNCPrice *price = gnc_price_create (book);
+        Timespec ts;
+
+        ts.tv_sec = TEST_BOOK_START + (time_t)i * 86400;
+        ts.tv_nsec = 0;
+        gnc_price_begin_edit (price);
+        gnc_price_set_commodity (price, commodity);
+        gnc_price_set_currency (price, currency);
+        gnc_price_set_time (price, ts);
+        gnc_price_set_source (price, "Finance::Quote");
+        gnc_price_set_typestr (price, "last");
+        gnc_price_set_value (price, gnc_numeric_create
+                             (get_random_int_in_range (1, 100000), 100));
+        gnc_price_commit_edit (price);
+        gnc_pricedb_add_price (db, price);
+        gnc_price_unref (price);
+    }
+}
+
 typedef struct
 {
     QofIdType where;
@@ -89,6 +89,47 @@ void make_random_changes_to_level (QofBook *book, Account *parent);
 void make_random_changes_to_book (QofBook *book);
 void make_random_changes_to_session (QofSession *session);
 
+/** @name Synthetic books
+ *  Plain accounts and balanced transactions for the tests and
+ *  benchmarks that need many of them.
+ *  @{ */
+/** 2000-01-01 00:00 UTC, the first day of a synthetic book */
+#define TEST_BOOK_START ((time_t)946684800)
+/** The number of days a synthetic book spans */
+#define TEST_BOOK_DAYS 3650
+
+/** A random day of the synthetic book, at midnight */
+time_t get_random_test_book_date (void);
+
+/** A committed account, a child of parent or of the root account when
+ *  parent is NULL.  name may be NULL. */
+Account * make_test_account (QofBook *book, Account *parent,
+                             GNCAccountType type, gnc_commodity *commodity,
+                             const char *name);
+
+/** A transaction in the commodity of to, moving amount from one
+ *  account to the other.  The split in from is the first one.  The
+ *  transaction is left open for the caller to add to and commit. */
+Transaction * make_test_transaction (QofBook *book, Account *from,
+                                     Account *to, time_t date,
+                                     gnc_numeric amount);
+
+/** Fill book with num_accounts bank accounts named "Account <n>" in
+ *  currency, and with count committed transactions between
+ *  neighbouring ones.  The transactions carry text that needs
+ *  escaping, nums, memos, actions and reconcile dates, and every
+ *  tenth has a note and an int64 slot on its second split.  Returns
+ *  the accounts; free the array with g_ptr_array_free. */
+GPtrArray * make_test_book_transactions (QofBook *book,
+                                         gnc_commodity *currency,
+                                         guint num_accounts, guint count);
+
+/** Add count daily prices of commodity in currency to the price
+ *  database of book, from TEST_BOOK_START on. */
+void make_test_book_prices (QofBook *book, gnc_commodity *commodity,
+                            gnc_commodity *currency, guint count);
+/** @} */
+
 SchedXaction* add_daily_sx(gchar *name, const GDate *start, const GDate *end, const GDate *last_occur);
 SchedXaction* add_once_sx(gchar *name, const GDate *when);
 void remove_sx(SchedXaction *sx);
@@ -0,0 +1,470 @@
+/***************************************************************************
+ *            bench-engine.c
+ *
+ *  Time the engine containers and indexes on synthetic books.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file bench-engine.c
+ * @brief Print the timings the unit tests only check the results of.
+ *
+ * This is not run by "make check".  "bench-engine" runs every
+ * benchmark at its default size, "bench-engine split-index" only one,
+ * and "bench-engine query-planner 200000" one at another size.  The
+ * correctness checks live in the test program of the same name.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "qof.h"
+#include "qofquery-p.h"
+#include "Account.h"
+#include "AccountP.h"
+#include "Query.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "gnc-pricedb.h"
+#include "gncEntry.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_ACCOUNTS 50
+#define NUM_EDITS 100
+#define NUM_LOOKUPS 2000
+
+typedef void (*BenchFunc) (guint count);
+
+typedef struct
+{
+    const char *name;
+    BenchFunc run;
+    guint count;
+} Bench;
+
+static gnc_commodity *
+make_usd (QofBook *book)
+{
+    return gnc_commodity_new (book, "US Dollar", "ISO4217", "USD", "840", 100);
+}
+
+/* Splits in open transactions on random days, in random order. */
+static GPtrArray *
+make_open_splits (QofBook *book, guint count)
+{
+    GPtrArray *splits = g_ptr_array_sized_new (count);
+    guint i;
+
+    for (i = 0; i < count; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (book);
+        Split *split = xaccMallocSplit (book);
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, get_random_test_book_date ());
+        xaccSplitSetParent (split, trans);
+        xaccSplitSetAmount (split, gnc_numeric_create (i % 7 + 1, 100));
+        g_ptr_array_add (splits, split);
+    }
+    for (i = count; i > 1; i--)
+    {
+        guint j = get_random_int_in_range (0, i - 1);
+        gpointer tmp = splits->pdata[i - 1];
+
+        splits->pdata[i - 1] = splits->pdata[j];
+        splits->pdata[j] = tmp;
+    }
+    return splits;
+}
+
+/* Accounts with balanced transactions between random pairs of them. */
+static GPtrArray *
+make_book (QofBook *book, guint count)
+{
+    GPtrArray *accounts = g_ptr_array_new ();
+    gnc_commodity *usd = make_usd (book);
+    guint i;
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+        g_ptr_array_add (accounts, make_test_account (book, NULL,
+                                                      ACCT_TYPE_BANK, usd,
+                                                      NULL));
+    for (i = 0; i < count; i++)
+    {
+        guint a = get_random_int_in_range (0, NUM_ACCOUNTS - 1);
+        guint b = (a + get_random_int_in_range (1, NUM_ACCOUNTS - 1))
+                  % NUM_ACCOUNTS;
+        Transaction *trans = make_test_transaction
+                             (book, accounts->pdata[a], accounts->pdata[b],
+                              get_random_test_book_date (),
+                              gnc_numeric_create
+                              (get_random_int_in_range (1, 100000), 100));
+
+        if (i % 4 == 0)
+            xaccSplitSetReconcile (xaccTransGetSplit (trans, 0), YREC);
+        xaccTransCommitEdit (trans);
+    }
+    return accounts;
+}
+
+static void
+bench_split_index (guint count)
+{
+    guint size;
+
+    for (size = 1000; size <= count; size *= 2)
+    {
+        QofBook *book = qof_book_new ();
+        Account *acc = xaccMallocAccount (book);
+        GPtrArray *splits = make_open_splits (book, size);
+        GTimer *timer = g_timer_new ();
+        gdouble insert_time, remove_time;
+        guint i;
+
+        for (i = 0; i < splits->len; i++)
+            gnc_account_insert_split (acc, splits->pdata[i]);
+        insert_time = g_timer_elapsed (timer, NULL);
+
+        /* Keep the balance recompute out of the measurement. */
+        qof_instance_increase_editlevel (acc);
+        g_timer_start (timer);
+        for (i = 0; i < splits->len; i++)
+            gnc_account_remove_split (acc, splits->pdata[i]);
+        remove_time = g_timer_elapsed (timer, NULL);
+        qof_instance_decrease_editlevel (acc);
+
+        printf ("%8u splits: insert %8.3f us/split, remove %8.3f us/split\n",
+                size, insert_time * 1e6 / size, remove_time * 1e6 / size);
+
+        g_timer_destroy (timer);
+        g_ptr_array_free (splits, TRUE);
+        qof_book_destroy (book);
+    }
+}
+
+static void
+bench_recompute_balance (guint count)
+{
+    QofBook *book = qof_book_new ();
+    Account *acc = xaccMallocAccount (book);
+    GPtrArray *splits = make_open_splits (book, count);
+    GTimer *timer;
+    gdouble full_time, edit_time;
+    Split *last;
+    guint i;
+
+    xaccAccountSetCommoditySCU (acc, 100);
+    for (i = 0; i < splits->len; i++)
+    {
+        xaccSplitSetAccount (splits->pdata[i], acc);
+        gnc_account_insert_split (acc, splits->pdata[i]);
+    }
+    last = g_list_last (xaccAccountGetSplitList (acc))->data;
+
+    timer = g_timer_new ();
+    gnc_account_set_balance_dirty (acc);
+    xaccAccountRecomputeBalance (acc);
+    full_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (i = 0; i < NUM_EDITS; i++)
+    {
+        xaccSplitSetAmount (last, gnc_numeric_create (i + 1, 100));
+        xaccSplitSetReconcile (last, (i % 2) ? NREC : CREC);
+        xaccAccountRecomputeBalance (acc);
+    }
+    edit_time = g_timer_elapsed (timer, NULL) / NUM_EDITS;
+
+    printf ("%8u splits: full recompute %10.3f ms, "
+            "last-split edit %10.3f ms\n",
+            count, full_time * 1e3, edit_time * 1e3);
+
+    g_timer_destroy (timer);
+    g_ptr_array_free (splits, TRUE);
+    qof_book_destroy (book);
+}
+
+static void
+bench_pricedb_lookup (guint count)
+{
+    QofBook *book = qof_book_new ();
+    GNCPriceDB *db = gnc_pricedb_get_db (book);
+    gnc_commodity *c = gnc_commodity_new (book, "Test Stock", "NASDAQ",
+                                          "TSTK", NULL, 100);
+    gnc_commodity *currency = gnc_commodity_new (book, "Test Dollar",
+                                                 GNC_COMMODITY_NS_CURRENCY,
+                                                 "TSD", NULL, 100);
+    GTimer *timer = g_timer_new ();
+    gdouble add_time, lookup_time;
+    guint i;
+
+    for (i = 0; i < count; i++)
+    {
+        GNCPrice *p = gnc_price_create (book);
+        Timespec t;
+
+        /* Roughly two quotes per day, on the hour. */
+        t.tv_sec = TEST_BOOK_START +
+                   get_random_int_in_range (0, count / 2) * 86400 +
+                   get_random_int_in_range (0, 3) * 6 * 3600;
+        t.tv_nsec = 0;
+        gnc_price_begin_edit (p);
+        gnc_price_set_commodity (p, c);
+        gnc_price_set_currency (p, currency);
+        gnc_price_set_time (p, t);
+        gnc_price_set_source (p, "Finance::Quote");
+        gnc_price_set_value (p, gnc_numeric_create (i + 1, 100));
+        gnc_price_commit_edit (p);
+        gnc_pricedb_add_price (db, p);
+        gnc_price_unref (p);
+    }
+    add_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (i = 0; i < NUM_LOOKUPS; i++)
+    {
+        Timespec t;
+
+        t.tv_sec = TEST_BOOK_START +
+                   get_random_int_in_range (0, count / 2) * 86400 + 3 * 3600;
+        t.tv_nsec = 0;
+        gnc_pricedb_lookup_nearest_in_time (db, c, currency, t);
+        gnc_pricedb_lookup_latest_before (db, c, currency, t);
+        gnc_pricedb_lookup_at_time (db, c, currency, t);
+        gnc_pricedb_lookup_day (db, c, currency, t);
+    }
+    lookup_time = g_timer_elapsed (timer, NULL);
+
+    printf ("%8u prices: add %8.3f us/price, lookup %8.3f us/lookup\n",
+            count, add_time * 1e6 / count,
+            lookup_time * 1e6 / NUM_LOOKUPS / 4);
+
+    g_timer_destroy (timer);
+    qof_book_destroy (book);
+}
+
+static QofQuery *
+new_query (QofBook *book)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+
+    qof_query_set_book (q, book);
+    return q;
+}
+
+/* Takes over the query. */
+static void
+time_query (QofQuery *q, const char *name)
+{
+    GTimer *timer = g_timer_new ();
+    gdouble scan_time, first_time, planned_time;
+    guint found;
+
+    qof_query_set_use_indexes (FALSE);
+    found = g_list_length (qof_query_run (q));
+    scan_time = g_timer_elapsed (timer, NULL);
+
+    qof_query_set_use_indexes (TRUE);
+    g_timer_start (timer);
+    qof_query_run (q);
+    first_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    qof_query_run (q);
+    planned_time = g_timer_elapsed (timer, NULL);
+
+    printf ("%-20s %7u splits: scan %9.3f ms, first %9.3f ms, "
+            "planned %9.3f ms\n", name, found,
+            scan_time * 1e3, first_time * 1e3, planned_time * 1e3);
+
+    g_timer_destroy (timer);
+    qof_query_destroy (q);
+}
+
+static void
+bench_query_planner (guint count)
+{
+    QofBook *book = qof_book_new ();
+    GPtrArray *accounts = make_book (book, count);
+    Timespec start = {TEST_BOOK_START + 365 * 86400, 0};
+    Timespec end = {TEST_BOOK_START + 396 * 86400, 0};
+    QofQuery *q;
+
+    q = new_query (book);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[0], QOF_QUERY_AND);
+    time_query (q, "one account");
+
+    q = new_query (book);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[1], QOF_QUERY_AND);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    time_query (q, "account and month");
+
+    q = new_query (book);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    time_query (q, "month");
+
+    q = new_query (book);
+    xaccQueryAddClearedMatch (q, CLEARED_RECONCILED, QOF_QUERY_AND);
+    time_query (q, "reconciled");
+
+    q = new_query (book);
+    qof_query_set_max_results (q, 30);
+    time_query (q, "latest 30");
+
+    g_ptr_array_free (accounts, TRUE);
+    qof_book_destroy (book);
+}
+
+static void
+bench_query_live (guint count)
+{
+    QofBook *book = qof_book_new ();
+    GPtrArray *accounts = make_book (book, count);
+    Timespec start = {TEST_BOOK_START + 365 * 86400, 0};
+    Timespec end = {TEST_BOOK_START + 730 * 86400, 0};
+    GTimer *timer = g_timer_new ();
+    gdouble run_time, live_time;
+    GPtrArray *edited = g_ptr_array_new ();
+    GList *node;
+    QofQuery *q;
+    guint i;
+
+    q = new_query (book);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    qof_query_set_live (q, TRUE);
+    for (node = qof_query_run (q); node; node = node->next)
+        g_ptr_array_add (edited, node->data);
+
+    /* A register-like cycle: one edit, then read the results. */
+    g_timer_start (timer);
+    for (i = 0; i < NUM_EDITS; i++)
+    {
+        xaccSplitSetMemo (edited->pdata[i % edited->len], "edited");
+        qof_query_run (q);
+    }
+    live_time = g_timer_elapsed (timer, NULL) / NUM_EDITS;
+
+    qof_query_set_live (q, FALSE);
+    g_timer_start (timer);
+    for (i = 0; i < NUM_EDITS; i++)
+    {
+        xaccSplitSetMemo (edited->pdata[i % edited->len], "edited again");
+        qof_query_run (q);
+    }
+    run_time = g_timer_elapsed (timer, NULL) / NUM_EDITS;
+
+    printf ("%8u transactions, %5u results: rerun %9.3f ms, "
+            "live %9.3f ms per edit\n", count, edited->len,
+            run_time * 1e3, live_time * 1e3);
+
+    g_ptr_array_free (edited, TRUE);
+    qof_query_destroy (q);
+    g_timer_destroy (timer);
+    g_ptr_array_free (accounts, TRUE);
+    qof_book_destroy (book);
+}
+
+static void
+bench_references (guint count)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity *usd = make_usd (book);
+    Account *accounts[NUM_ACCOUNTS];
+    GTimer *timer;
+    guint i, found = 0;
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+        accounts[i] = make_test_account (book, NULL, ACCT_TYPE_EXPENSE, usd,
+                                         "Account");
+    for (i = 0; i < count; i++)
+    {
+        GncEntry *entry = gncEntryCreate (book);
+
+        gncEntrySetInvAccount (entry, accounts[get_random_int_in_range
+                                               (0, NUM_ACCOUNTS - 1)]);
+        gncEntrySetBillAccount (entry, accounts[get_random_int_in_range
+                                                (0, NUM_ACCOUNTS - 1)]);
+    }
+
+    timer = g_timer_new ();
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+    {
+        GList *list = qof_instance_get_referring_object_list
+                      (QOF_INSTANCE (accounts[i]));
+
+        found += g_list_length (list);
+        g_list_free (list);
+    }
+    printf ("%8u objects: %8.3f ms per account lookup, %u referrers\n",
+            count, g_timer_elapsed (timer, NULL) * 1e3 / NUM_ACCOUNTS, found);
+
+    g_timer_destroy (timer);
+    qof_book_destroy (book);
+}
+
+static const Bench benches[] =
+{
+    { "split-index", bench_split_index, 256000 },
+    { "recompute-balance", bench_recompute_balance, 500000 },
+    { "pricedb-lookup", bench_pricedb_lookup, 400000 },
+    { "query-planner", bench_query_planner, 200000 },
+    { "query-live", bench_query_live, 200000 },
+    { "references", bench_references, 100000 },
+    { NULL, NULL, 0 }
+};
+
+int
+main (int argc, char **argv)
+{
+    const Bench *bench;
+    gboolean found = FALSE;
+
+    qof_init ();
+    if (!cashobjects_register ())
+    {
+        fprintf (stderr, "can't register the engine objects\n");
+        return 1;
+    }
+    xaccLogDisable ();
+
+    for (bench = benches; bench->name; bench++)
+    {
+        guint count = bench->count;
+
+        if (argc > 1 && strcmp (argv[1], bench->name) != 0)
+            continue;
+        if (argc > 2)
+            count = MAX (atoi (argv[2]), 10);
+        printf ("%s:\n", bench->name);
+        bench->run (count);
+        found = TRUE;
+    }
+    qof_close ();
+
+    if (!found)
+    {
+        fprintf (stderr, "usage: bench-engine [name [count]]\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+/***************************************************************************
+ *            test-pricedb-lookup.c
+ *
+ *  Check the time based price lookups of GNCPriceDB against plain
+ *  scans of the price list.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-pricedb-lookup.c
+ * @brief Compare the price lookups with a linear search.
+ *
+ * Also checks the balance conversions and their cache.
+ *
+ * The prices of one commodity pair are added in random order, several
+ * of them sharing a time stamp, so that the ties are exercised too.
+ * The reference results are computed by walking the list returned by
+ * gnc_pricedb_get_prices(), the way the lookups used to work.
+ * bench-engine times the lookups on bigger databases.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "gnc-commodity.h"
+#include "gnc-pricedb.h"
+#include "TransLog.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_PRICES 5000
+#define NUM_LOOKUPS 2000
+
+static Timespec
+random_time (guint count)
+{
+    Timespec t;
+
+    /* Roughly two quotes per day, on the hour. */
+    t.tv_sec = TEST_BOOK_START + get_random_int_in_range (0, count / 2) * 86400 +
+               get_random_int_in_range (0, 3) * 6 * 3600;
+    t.tv_nsec = 0;
+    return t;
+}
+
+static void
+add_price (QofBook *book, GNCPriceDB *db, gnc_commodity *c,
+           gnc_commodity *currency, Timespec t, gnc_numeric value)
+{
+    GNCPrice *p = gnc_price_create (book);
+
+    gnc_price_begin_edit (p);
+    gnc_price_set_commodity (p, c);
+    gnc_price_set_currency (p, currency);
+    gnc_price_set_time (p, t);
+    gnc_price_set_source (p, "Finance::Quote");
+    gnc_price_set_value (p, value);
+    gnc_price_commit_edit (p);
+    gnc_pricedb_add_price (db, p);
+    gnc_price_unref (p);
+}
+
+static void
+add_prices (QofBook *book, GNCPriceDB *db, gnc_commodity *c,
+            gnc_commodity *currency, guint count)
+{
+    guint i;
+
+    for (i = 0; i < count; i++)
+        add_price (book, db, c, currency, random_time (count),
+                   gnc_numeric_create (i + 1, 100));
+}
+
+/* The list is sorted newest first.  This is the old list walk. */
+static GNCPrice *
+reference_nearest (GList *prices, Timespec t)
+{
+    GNCPrice *current_price = prices->data;
+    GNCPrice *next_price = NULL;
+    GList *item;
+
+    for (item = prices; item; item = item->next)
+    {
+        Timespec price_time = gnc_price_get_time (item->data);
+        if (timespec_cmp (&price_time, &t) <= 0)
+        {
+            next_price = item->data;
+            break;
+        }
+        current_price = item->data;
+    }
+    if (next_price)
+    {
+        Timespec current_t = gnc_price_get_time (current_price);
+        Timespec next_t = gnc_price_get_time (next_price);
+        Timespec diff_current = timespec_diff (&current_t, &t);
+        Timespec diff_next = timespec_diff (&next_t, &t);
+        Timespec abs_current = timespec_abs (&diff_current);
+        Timespec abs_next = timespec_abs (&diff_next);
+
+        if (timespec_cmp (&abs_current, &abs_next) >= 0)
+            return next_price;
+    }
+    return current_price;
+}
+
+static GNCPrice *
+reference_latest_before (GList *prices, Timespec t)
+{
+    GList *item;
+
+    for (item = prices; item; item = item->next)
+    {
+        Timespec price_time = gnc_price_get_time (item->data);
+        if (timespec_cmp (&price_time, &t) <= 0)
+            return item->data;
+    }
+    return NULL;
+}
+
+static guint
+reference_count_at (GList *prices, Timespec t, gboolean same_day)
+{
+    guint count = 0;
+    GList *item;
+
+    if (same_day)
+        t = timespecCanonicalDayTime (t);
+    for (item = prices; item; item = item->next)
+    {
+        Timespec price_time = gnc_price_get_time (item->data);
+        if (same_day)
+            price_time = timespecCanonicalDayTime (price_time);
+        if (timespec_equal (&price_time, &t))
+            count++;
+    }
+    return count;
+}
+
+static gboolean
+list_in_order (GList *prices, guint expected)
+{
+    guint count = 0;
+
+    for (; prices; prices = prices->next, count++)
+    {
+        Timespec t1, t2;
+
+        if (!prices->next)
+            continue;
+        t1 = gnc_price_get_time (prices->data);
+        t2 = gnc_price_get_time (prices->next->data);
+        if (timespec_cmp (&t1, &t2) < 0)
+            return FALSE;
+    }
+    return count == expected;
+}
+
+static void
+run_test (guint count)
+{
+    QofBook *book = qof_book_new ();
+    GNCPriceDB *db = gnc_pricedb_get_db (book);
+    gnc_commodity *c = gnc_commodity_new (book, "Test Stock", "NASDAQ",
+                                          "TSTK", NULL, 1);
+    gnc_commodity *currency = gnc_commodity_new (book, "Test Dollar",
+                                                 GNC_COMMODITY_NS_CURRENCY,
+                                                 "TSD", NULL, 100);
+    GList *prices;
+    GNCPrice *latest;
+    gboolean nearest_ok = TRUE, before_ok = TRUE, at_ok = TRUE, day_ok = TRUE;
+    guint i, total;
+
+    add_prices (book, db, c, currency, count);
+
+    prices = gnc_pricedb_get_prices (db, c, currency);
+    total = g_list_length (prices);
+    do_test (total == gnc_pricedb_get_num_prices (db), "price count");
+    do_test (list_in_order (prices, total), "prices newest first");
+    latest = gnc_pricedb_lookup_latest (db, c, currency);
+    do_test (latest == prices->data, "latest price");
+    gnc_price_unref (latest);
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+    {
+        Timespec t = random_time (count);
+        GNCPrice *nearest, *before;
+        PriceList *at, *day;
+
+        /* Probe between the quotes, before and after all of them, too. */
+        if (i % 3 == 1)
+            t.tv_sec += 3 * 3600;
+        if (i == 0)
+            t.tv_sec = TEST_BOOK_START - 86400;
+        if (i == 1)
+            t.tv_sec = TEST_BOOK_START + (count + 4) * 86400;
+
+        nearest = gnc_pricedb_lookup_nearest_in_time (db, c, currency, t);
+        before = gnc_pricedb_lookup_latest_before (db, c, currency, t);
+        at = gnc_pricedb_lookup_at_time (db, c, currency, t);
+        day = gnc_pricedb_lookup_day (db, c, currency, t);
+
+        nearest_ok = nearest_ok && nearest == reference_nearest (prices, t);
+        before_ok = before_ok && before == reference_latest_before (prices, t);
+        at_ok = at_ok && g_list_length (at) ==
+                reference_count_at (prices, t, FALSE);
+        day_ok = day_ok && g_list_length (day) ==
+                 reference_count_at (prices, t, TRUE);
+
+        gnc_price_unref (nearest);
+        gnc_price_unref (before);
+        gnc_price_list_destroy (at);
+        gnc_price_list_destroy (day);
+    }
+    do_test (nearest_ok, "lookup nearest in time");
+    do_test (before_ok, "lookup latest before");
+    do_test (at_ok, "lookup at time");
+    do_test (day_ok, "lookup day");
+
+    /* Remove every other price and check the order again. */
+    for (i = 0; prices; i++)
+    {
+        if (i % 2)
+            gnc_pricedb_remove_price (db, prices->data);
+        gnc_price_unref (prices->data);
+        prices = g_list_delete_link (prices, prices);
+    }
+    prices = gnc_pricedb_get_prices (db, c, currency);
+    do_test (list_in_order (prices, total - total / 2), "prices removed");
+    gnc_price_list_destroy (prices);
+
+    qof_book_destroy (book);
+}
+
+static gnc_commodity *
+make_currency (QofBook *book, const char *mnemonic)
+{
+    return gnc_commodity_new (book, mnemonic, GNC_COMMODITY_NS_CURRENCY,
+                              mnemonic, NULL, 100);
+}
+
+/* A stock priced in EUR, EUR priced in USD, and a chain CHF -> GBP <- USD
+ * that only the commodity graph can follow. */
+static void
+run_conversion_test (void)
+{
+    QofBook *book = qof_book_new ();
+    GNCPriceDB *db = gnc_pricedb_get_db (book);
+    gnc_commodity *stock = gnc_commodity_new (book, "Test Stock", "NASDAQ",
+                                              "TSTK", NULL, 1000);
+    gnc_commodity *usd = make_currency (book, "USD");
+    gnc_commodity *eur = make_currency (book, "EUR");
+    gnc_commodity *gbp = make_currency (book, "GBP");
+    gnc_commodity *chf = make_currency (book, "CHF");
+    Timespec t = {TEST_BOOK_START, 0};
+    Timespec later = {TEST_BOOK_START + 86400, 0};
+    Timespec earlier = {TEST_BOOK_START - 86400, 0};
+    guint hits, misses;
+    gnc_numeric result;
+
+    add_price (book, db, stock, eur, t, gnc_numeric_create (10, 1));
+    add_price (book, db, eur, usd, t, gnc_numeric_create (12, 10));
+    add_price (book, db, usd, gbp, t, gnc_numeric_create (8, 10));
+    add_price (book, db, chf, gbp, t, gnc_numeric_create (9, 10));
+
+    result = gnc_pricedb_convert_balance_latest_price (
+                 db, gnc_numeric_create (2, 1), stock, usd);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (24, 1)),
+             "two stage conversion");
+    result = gnc_pricedb_convert_balance_nearest_price (
+                 db, gnc_numeric_create (100, 1), usd, eur, later);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (8333, 100)),
+             "reciprocal conversion");
+    result = gnc_pricedb_convert_balance_latest_before (
+                 db, gnc_numeric_create (100, 1), chf, stock, later);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (9375, 1000)),
+             "conversion through the commodity graph");
+    result = gnc_pricedb_convert_balance_latest_before (
+                 db, gnc_numeric_create (100, 1), chf, stock, t);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (9375, 1000)),
+             "conversion at the time of the prices");
+
+    gnc_pricedb_get_conversion_stats (db, &hits, &misses);
+    result = gnc_pricedb_convert_balance_latest_before (
+                 db, gnc_numeric_create (100, 1), chf, stock, later);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (9375, 1000)),
+             "cached conversion");
+    gnc_pricedb_get_conversion_stats (db, &hits, NULL);
+    do_test (hits == 1 && misses == 4, "conversion cache hit");
+
+    /* A new price must not be hidden by the cache. */
+    add_price (book, db, stock, usd, t, gnc_numeric_create (11, 1));
+    result = gnc_pricedb_convert_balance_latest_price (
+                 db, gnc_numeric_create (2, 1), stock, usd);
+    do_test (gnc_numeric_equal (result, gnc_numeric_create (22, 1)),
+             "conversion cache flushed by a new price");
+    result = gnc_pricedb_convert_balance_latest_before (
+                 db, gnc_numeric_create (100, 1), chf, stock, t);
+    do_test (gnc_numeric_zero_p (result) == FALSE, "conversion still found");
+    result = gnc_pricedb_convert_balance_latest_before (
+                 db, gnc_numeric_create (100, 1), chf, stock, earlier);
+    do_test (gnc_numeric_zero_p (result), "no prices yet");
+
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        run_test (NUM_PRICES);
+        run_conversion_test ();
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
@@ -0,0 +1,233 @@
+/***************************************************************************
+ *            test-query-live.c
+ *
+ *  Check that a live split query follows the changes to the book.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-query-live.c
+ * @brief Compare a live query with a fresh copy after every change.
+ *
+ * The live query asks for the splits of one account in a given year,
+ * sorted by the default split order.  After every kind of change --
+ * new transactions, changed dates and amounts, splits moved between
+ * accounts, deleted transactions, changes made while events are
+ * suspended -- its results have to be identical to those of a copy
+ * of the query run from scratch.  bench-engine times reading it
+ * against running the query again.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "Account.h"
+#include "Query.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TRANSACTIONS 2000
+#define NUM_EDITS 200
+
+static Account *acc_a = NULL;
+static Account *acc_b = NULL;
+
+static void
+add_transaction (QofBook *book, time_t date)
+{
+    xaccTransCommitEdit (make_test_transaction
+                         (book, get_random_boolean () ? acc_a : acc_b, acc_b,
+                          date, gnc_numeric_create
+                          (get_random_int_in_range (1, 100000), 100)));
+}
+
+static gboolean
+same_list (GList *a, GList *b)
+{
+    for (; a && b; a = a->next, b = b->next)
+        if (a->data != b->data)
+            return FALSE;
+    return a == NULL && b == NULL;
+}
+
+/* Run a copy of the live query from scratch and compare. */
+static gboolean
+live_ok (QofQuery *live)
+{
+    QofQuery *fresh = qof_query_copy (live);
+    gboolean ok = same_list (qof_query_run (live), qof_query_run (fresh));
+
+    qof_query_destroy (fresh);
+    return ok;
+}
+
+static Split *
+random_split (Account *acc)
+{
+    GList *splits = xaccAccountGetSplitList (acc);
+
+    return g_list_nth_data (splits, get_random_int_in_range
+                            (0, g_list_length (splits) - 1));
+}
+
+static void
+run_test (guint count)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Timespec start, end;
+    GPtrArray *edited;
+    GList *node;
+    QofQuery *q;
+    guint i;
+
+    acc_a = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    acc_b = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    for (i = 0; i < count; i++)
+        add_transaction (book, get_random_test_book_date ());
+
+    start.tv_sec = TEST_BOOK_START + 365 * 86400;
+    start.tv_nsec = 0;
+    end.tv_sec = TEST_BOOK_START + 730 * 86400;
+    end.tv_nsec = 0;
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc_a, QOF_QUERY_AND);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    qof_query_set_live (q, TRUE);
+    do_test (live_ok (q), "initial run");
+
+    for (i = 0; i < 20; i++)
+        add_transaction (book, start.tv_sec + i * 86400);
+    do_test (live_ok (q), "new transactions");
+
+    for (i = 0; i < 20; i++)
+    {
+        Transaction *trans = xaccSplitGetParent (random_split (acc_a));
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, get_random_test_book_date ());
+        xaccTransCommitEdit (trans);
+    }
+    do_test (live_ok (q), "changed dates");
+
+    for (i = 0; i < 20; i++)
+    {
+        Split *split = random_split (acc_a);
+        Transaction *trans = xaccSplitGetParent (split);
+        xaccTransBeginEdit (trans);
+        xaccSplitSetValue (split, gnc_numeric_create (i, 100));
+        xaccSplitSetAmount (split, gnc_numeric_create (i, 100));
+        xaccTransCommitEdit (trans);
+    }
+    do_test (live_ok (q), "changed amounts");
+
+    for (i = 0; i < 20; i++)
+    {
+        Split *split = random_split (i % 2 ? acc_a : acc_b);
+        xaccSplitSetAccount (split, i % 2 ? acc_b : acc_a);
+    }
+    do_test (live_ok (q), "moved splits");
+
+    for (i = 0; i < 20; i++)
+    {
+        Transaction *trans = xaccSplitGetParent (random_split (acc_a));
+        xaccTransBeginEdit (trans);
+        xaccTransDestroy (trans);
+        xaccTransCommitEdit (trans);
+    }
+    do_test (live_ok (q), "deleted transactions");
+
+    qof_event_suspend ();
+    add_transaction (book, start.tv_sec + 86400);
+    qof_event_resume ();
+    do_test (live_ok (q), "changes with events suspended");
+
+    qof_query_set_max_results (q, 10);
+    do_test (live_ok (q), "cropped");
+    add_transaction (book, end.tv_sec);
+    do_test (live_ok (q), "cropped after a change");
+    qof_query_set_max_results (q, -1);
+
+    /* A register-like cycle: one edit, then read the results. */
+    edited = g_ptr_array_new ();
+    for (node = qof_query_run (q); node; node = node->next)
+        g_ptr_array_add (edited, node->data);
+    for (i = 0; i < NUM_EDITS; i++)
+    {
+        xaccSplitSetMemo (edited->pdata[i % edited->len], "edited");
+        qof_query_run (q);
+    }
+    do_test (live_ok (q), "after edits read back one by one");
+
+    g_ptr_array_free (edited, TRUE);
+    qof_query_destroy (q);
+
+    /* Without the account match both splits of a transaction match, and
+     * a new date moves both of them at once. */
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    qof_query_set_live (q, TRUE);
+    do_test (live_ok (q), "both splits: initial run");
+
+    for (i = 0; i < 20; i++)
+    {
+        Transaction *trans = xaccSplitGetParent (random_split (acc_b));
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, start.tv_sec +
+                                    get_random_int_in_range (0, 364) * 86400);
+        xaccTransCommitEdit (trans);
+    }
+    do_test (live_ok (q), "both splits: changed dates");
+
+    /* Edit the objects while walking the results of the run. */
+    for (node = qof_query_run (q), i = 0; node; node = node->next, i++)
+    {
+        Transaction *trans = xaccSplitGetParent (node->data);
+
+        if (i % 10) continue;
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, (i % 20) ? get_random_test_book_date ()
+                                    : start.tv_sec + i * 3600);
+        xaccTransCommitEdit (trans);
+    }
+    do_test (live_ok (q), "both splits: edited while walking the results");
+
+    qof_query_destroy (q);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        run_test (NUM_TRANSACTIONS);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
@@ -0,0 +1,279 @@
+/***************************************************************************
+ *            test-query-planner.c
+ *
+ *  Compare split queries run through the query indexes and run as a
+ *  scan over all of the splits of the book.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-query-planner.c
+ * @brief Check that indexed queries find what a scan finds.
+ *
+ * The book gets a number of accounts and balanced two-split
+ * transactions spread over ten years.  Every query is run once with
+ * the indexes switched off, and then twice with them switched on: the
+ * sorted indexes are only built when they are asked for a second time.
+ * The result sets have to be the same.  bench-engine times both ways.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "qofquery-p.h"
+#include "Account.h"
+#include "Query.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TRANSACTIONS 2000
+#define NUM_ACCOUNTS 50
+
+typedef void (*NumericSetter) (gpointer, gnc_numeric);
+
+static GPtrArray *
+make_book (QofBook *book, guint count)
+{
+    GPtrArray *accounts = g_ptr_array_new ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    guint i;
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+        g_ptr_array_add (accounts, make_test_account (book, NULL,
+                                                      ACCT_TYPE_BANK, usd,
+                                                      NULL));
+
+    for (i = 0; i < count; i++)
+    {
+        guint a = get_random_int_in_range (0, NUM_ACCOUNTS - 1);
+        guint b = (a + get_random_int_in_range (1, NUM_ACCOUNTS - 1))
+                  % NUM_ACCOUNTS;
+        Transaction *trans = make_test_transaction
+                             (book, accounts->pdata[a], accounts->pdata[b],
+                              get_random_test_book_date (),
+                              gnc_numeric_create
+                              (get_random_int_in_range (1, 100000), 100));
+
+        if (i % 4 == 0)
+            xaccSplitSetReconcile (xaccTransGetSplit (trans, 0), YREC);
+        if (i % 3 == 0)
+            xaccSplitSetReconcile (xaccTransGetSplit (trans, 1), CREC);
+        xaccTransCommitEdit (trans);
+    }
+    return accounts;
+}
+
+static gboolean
+same_results (GList *a, GList *b)
+{
+    GHashTable *set = g_hash_table_new (g_direct_hash, g_direct_equal);
+    gboolean same = (g_list_length (a) == g_list_length (b));
+
+    for (; a; a = a->next)
+        g_hash_table_insert (set, a->data, a->data);
+    for (; same && b; b = b->next)
+        same = g_hash_table_lookup (set, b->data) != NULL;
+    g_hash_table_destroy (set);
+    return same;
+}
+
+/* Run the query as a scan and through the indexes and check the
+ * results.  Takes over the query. */
+static void
+run_query (QofQuery *q, const char *name)
+{
+    GList *scanned;
+
+    qof_query_set_use_indexes (FALSE);
+    scanned = g_list_copy (qof_query_run (q));
+
+    qof_query_set_use_indexes (TRUE);
+    qof_query_run (q);
+    do_test (same_results (scanned, qof_query_last_run (q)), name);
+    do_test (same_results (scanned, qof_query_run (q)), name);
+
+    g_list_free (scanned);
+    qof_query_destroy (q);
+}
+
+/* Run the query for its last count results and check them against the
+ * tail of the whole sorted result.  Takes over the query. */
+static void
+run_top_query (QofQuery *q, gint count, const char *name)
+{
+    GList *all, *a, *b;
+    gboolean same;
+
+    qof_query_set_use_indexes (FALSE);
+    qof_query_set_max_results (q, -1);
+    all = g_list_copy (qof_query_run (q));
+    qof_query_set_max_results (q, count);
+    b = qof_query_run (q);
+    qof_query_set_use_indexes (TRUE);
+
+    same = ((gint)g_list_length (all) > count
+            && (gint)g_list_length (b) == count);
+    for (a = g_list_nth (all, g_list_length (all) - count);
+            same && a; a = a->next, b = b->next)
+        same = (a->data == b->data);
+    do_test (same, name);
+
+    g_list_free (all);
+    qof_query_destroy (q);
+}
+
+static QofQuery *
+new_query (QofBook *book)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+
+    qof_query_set_book (q, book);
+    return q;
+}
+
+static void
+run_test (guint count)
+{
+    QofBook *book = qof_book_new ();
+    GPtrArray *accounts = make_book (book, count);
+    Transaction *trans;
+    Split *split;
+    Timespec start, end;
+    gnc_numeric amount;
+    NumericSetter set_numeric;
+    QofQuery *q;
+
+    start.tv_sec = TEST_BOOK_START + 365 * 86400;
+    start.tv_nsec = 0;
+    end.tv_sec = TEST_BOOK_START + 396 * 86400;
+    end.tv_nsec = 0;
+
+    q = new_query (book);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[0], QOF_QUERY_AND);
+    run_query (q, "one account");
+
+    q = new_query (book);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[1], QOF_QUERY_AND);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[2], QOF_QUERY_OR);
+    run_query (q, "two accounts");
+
+    q = new_query (book);
+    xaccQueryAddSingleAccountMatch (q, accounts->pdata[3], QOF_QUERY_AND);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    run_query (q, "account and month");
+
+    q = new_query (book);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    run_query (q, "month");
+
+    q = new_query (book);
+    xaccQueryAddClearedMatch (q, CLEARED_RECONCILED, QOF_QUERY_AND);
+    run_query (q, "reconciled");
+
+    q = new_query (book);
+    xaccQueryAddSharesMatch (q, gnc_numeric_create (12345, 100),
+                             QOF_COMPARE_EQUAL, QOF_QUERY_AND);
+    run_query (q, "amount equal");
+
+    q = new_query (book);
+    xaccQueryAddValueMatch (q, gnc_numeric_create (99900, 100),
+                            QOF_NUMERIC_MATCH_ANY, QOF_COMPARE_GTE,
+                            QOF_QUERY_AND);
+    run_query (q, "value at least");
+
+    /* Not indexed: the scan has to be used. */
+    q = new_query (book);
+    xaccQueryAddClearedMatch (q, CLEARED_NO | CLEARED_CLEARED, QOF_QUERY_AND);
+    xaccQueryAddMemoMatch (q, "", TRUE, FALSE, QOF_QUERY_OR);
+    run_query (q, "no index");
+
+    /* The top of a sorted scan. */
+    q = new_query (book);
+    qof_query_set_max_results (q, 30);
+    run_query (q, "latest 30");
+
+    /* A sort with many ties has to keep the same objects, in the same
+     * order, as sorting and cropping all of them. */
+    q = new_query (book);
+    qof_query_set_sort_order (q, qof_query_build_param_list (SPLIT_RECONCILE,
+                                                             NULL),
+                              NULL, NULL);
+    run_top_query (q, 30, "last 30 by reconcile state");
+
+    /* A changed book must not be served from a stale sorted index: move
+     * the earliest transaction of an account into the month. */
+    q = new_query (book);
+    xaccQueryAddDateMatchTS (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    qof_query_run (q);
+    qof_query_run (q);
+    trans = xaccSplitGetParent (xaccAccountGetSplitList (accounts->pdata[0])->data);
+    xaccTransBeginEdit (trans);
+    xaccTransSetDatePostedSecs (trans, start.tv_sec + 86400);
+    xaccTransCommitEdit (trans);
+    run_query (q, "month after edit");
+
+    /* The same for the setters that don't mark the split dirty, and for
+     * a rollback that puts back the old amount. */
+    split = xaccAccountGetSplitList (accounts->pdata[1])->data;
+    amount = gnc_numeric_create (4242424, 100);
+    q = new_query (book);
+    xaccQueryAddSharesMatch (q, amount, QOF_COMPARE_EQUAL, QOF_QUERY_AND);
+    qof_query_run (q);
+    qof_query_run (q);
+    set_numeric = (NumericSetter)qof_class_get_parameter_setter
+                  (GNC_ID_SPLIT, SPLIT_AMOUNT);
+    set_numeric (split, amount);
+    run_query (q, "amount after setter");
+
+    split = xaccAccountGetSplitList (accounts->pdata[2])->data;
+    amount = xaccSplitGetAmount (split);
+    q = new_query (book);
+    xaccQueryAddSharesMatch (q, amount, QOF_COMPARE_EQUAL, QOF_QUERY_AND);
+    trans = xaccSplitGetParent (split);
+    xaccTransBeginEdit (trans);
+    xaccSplitSetAmount (split, gnc_numeric_add (amount, gnc_numeric_create
+                                                (1, 100), GNC_DENOM_AUTO,
+                                                GNC_HOW_DENOM_REDUCE));
+    qof_query_run (q);
+    qof_query_run (q);
+    xaccTransRollbackEdit (trans);
+    run_query (q, "amount after rollback");
+
+    g_ptr_array_free (accounts, TRUE);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        run_test (NUM_TRANSACTIONS);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
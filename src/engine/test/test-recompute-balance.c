@@ -0,0 +1,151 @@
+/***************************************************************************
+ *            test-recompute-balance.c
+ *
+ *  Check the incremental running-balance maintenance of
+ *  xaccAccountRecomputeBalance().
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-recompute-balance.c
+ * @brief Edit splits of an account and check the running balances.
+ *
+ * The account gets a full recompute, then the amount and reconcile
+ * state of the most recent split are changed a number of times, the
+ * first split is changed and the last one removed.  After every step
+ * the running balances have to match a plain summation.  bench-engine
+ * compares the cost of the full recompute and of the last-split edit.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "AccountP.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_SPLITS 5000
+#define NUM_EDITS 100
+
+/* The transactions are left open, so that nothing gets committed,
+ * scrubbed or balanced behind our back. */
+static Account *
+make_account (QofBook *book, guint count)
+{
+    Account *acc = xaccMallocAccount (book);
+    guint i;
+
+    xaccAccountSetCommoditySCU (acc, 100);
+    for (i = 0; i < count; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (book);
+        Split *split = xaccMallocSplit (book);
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, TEST_BOOK_START + i * 3600);
+        xaccSplitSetParent (split, trans);
+        xaccSplitSetAmount (split, gnc_numeric_create (i % 7 + 1, 100));
+        xaccSplitSetAccount (split, acc);
+        if (i % 3 == 0)
+            xaccSplitSetReconcile (split, CREC);
+        gnc_account_insert_split (acc, split);
+    }
+    xaccAccountRecomputeBalance (acc);
+    return acc;
+}
+
+/* Walk the account and check every running balance against a plain
+ * summation. */
+static gboolean
+balances_ok (Account *acc)
+{
+    gnc_numeric balance = gnc_numeric_zero ();
+    gnc_numeric cleared = gnc_numeric_zero ();
+    GList *node;
+
+    for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+    {
+        Split *split = node->data;
+
+        balance = gnc_numeric_add_fixed (balance, xaccSplitGetAmount (split));
+        if (xaccSplitGetReconcile (split) != NREC)
+            cleared = gnc_numeric_add_fixed (cleared,
+                                             xaccSplitGetAmount (split));
+        if (!gnc_numeric_equal (balance, xaccSplitGetBalance (split)) ||
+                !gnc_numeric_equal (cleared, xaccSplitGetClearedBalance (split)))
+            return FALSE;
+    }
+    return gnc_numeric_equal (balance, xaccAccountGetBalance (acc)) &&
+           gnc_numeric_equal (cleared, xaccAccountGetClearedBalance (acc));
+}
+
+static void
+run_test (guint count)
+{
+    QofBook *book = qof_book_new ();
+    Account *acc = make_account (book, count);
+    Split *first = xaccAccountGetSplitList (acc)->data;
+    Split *last = g_list_last (xaccAccountGetSplitList (acc))->data;
+    guint i;
+
+    do_test (balances_ok (acc), "initial balances");
+
+    gnc_account_set_balance_dirty (acc);
+    xaccAccountRecomputeBalance (acc);
+    do_test (balances_ok (acc), "full recompute");
+
+    for (i = 0; i < NUM_EDITS; i++)
+    {
+        xaccSplitSetAmount (last, gnc_numeric_create (i + 1, 100));
+        xaccSplitSetReconcile (last, (i % 2) ? NREC : CREC);
+        xaccAccountRecomputeBalance (acc);
+    }
+    do_test (balances_ok (acc), "edits of the last split");
+
+    /* An edit at the front must still ripple through everything. */
+    xaccSplitSetAmount (first, gnc_numeric_create (12345, 100));
+    xaccAccountRecomputeBalance (acc);
+    do_test (balances_ok (acc), "edit of the first split");
+
+    /* Removing the last split leaves the balance of its predecessor. */
+    qof_instance_increase_editlevel (acc);
+    gnc_account_remove_split (acc, last);
+    qof_instance_decrease_editlevel (acc);
+    xaccAccountRecomputeBalance (acc);
+    do_test (balances_ok (acc), "removal of the last split");
+
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        run_test (NUM_SPLITS);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
@@ -0,0 +1,302 @@
+/***************************************************************************
+ *            test-references.c
+ *
+ *  Check the book's index of the objects referring to an object.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-references.c
+ * @brief Compare qof_instance_get_referring_object_list with a scan.
+ *
+ * A book gets accounts, tax tables, bill terms, and vendors, customers,
+ * employees, entries and invoices pointing at them through their
+ * setters.  Some of the references are changed and some of the objects
+ * destroyed, and after each step the index has to agree with
+ * refers_to_object, both through qof_instance_check_reference_index
+ * and by comparing the referring object list of every account, tax
+ * table and bill term with a scan of the whole book.  bench-engine
+ * times the lookups on bigger books.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "gncBillTerm.h"
+#include "gncCustomer.h"
+#include "gncEmployee.h"
+#include "gncEntry.h"
+#include "gncInvoice.h"
+#include "gncTaxTable.h"
+#include "gncVendor.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_OBJECTS 200
+#define NUM_ACCOUNTS 20
+#define NUM_TABLES 5
+#define NUM_TERMS 5
+
+typedef struct
+{
+    QofBook *book;
+    gnc_commodity *usd;
+    Account *accounts[NUM_ACCOUNTS];
+    GncTaxTable *tables[NUM_TABLES];
+    GncBillTerm *terms[NUM_TERMS];
+    GPtrArray *entries;
+    GPtrArray *invoices;
+    GPtrArray *employees;
+} TestBook;
+
+static Account *
+random_account (TestBook *tb)
+{
+    return tb->accounts[get_random_int_in_range (0, NUM_ACCOUNTS - 1)];
+}
+
+static GncTaxTable *
+random_table (TestBook *tb)
+{
+    return tb->tables[get_random_int_in_range (0, NUM_TABLES - 1)];
+}
+
+static GncBillTerm *
+random_terms (TestBook *tb)
+{
+    return tb->terms[get_random_int_in_range (0, NUM_TERMS - 1)];
+}
+
+static void
+make_book (TestBook *tb, guint count)
+{
+    guint i;
+
+    tb->book = qof_book_new ();
+    tb->usd = gnc_commodity_table_lookup (gnc_commodity_table_get_table (tb->book),
+                                          GNC_COMMODITY_NS_CURRENCY, "USD");
+    tb->entries = g_ptr_array_new ();
+    tb->invoices = g_ptr_array_new ();
+    tb->employees = g_ptr_array_new ();
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+        tb->accounts[i] = make_test_account (tb->book, NULL, ACCT_TYPE_EXPENSE,
+                                             tb->usd, "Account");
+    for (i = 0; i < NUM_TABLES; i++)
+    {
+        GncTaxTableEntry *entry = gncTaxTableEntryCreate ();
+
+        tb->tables[i] = gncTaxTableCreate (tb->book);
+        gncTaxTableBeginEdit (tb->tables[i]);
+        gncTaxTableSetName (tb->tables[i], "Tax table");
+        gncTaxTableEntrySetAccount (entry, random_account (tb));
+        gncTaxTableEntrySetType (entry, GNC_AMT_TYPE_PERCENT);
+        gncTaxTableEntrySetAmount (entry, gnc_numeric_create (5, 100));
+        gncTaxTableAddEntry (tb->tables[i], entry);
+        gncTaxTableCommitEdit (tb->tables[i]);
+    }
+    for (i = 0; i < NUM_TERMS; i++)
+    {
+        tb->terms[i] = gncBillTermCreate (tb->book);
+        gncBillTermBeginEdit (tb->terms[i]);
+        gncBillTermSetDueDays (tb->terms[i], 30);
+        gncBillTermCommitEdit (tb->terms[i]);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        GncVendor *vendor = gncVendorCreate (tb->book);
+        GncCustomer *customer = gncCustomerCreate (tb->book);
+        GncEmployee *employee = gncEmployeeCreate (tb->book);
+        GncEntry *entry = gncEntryCreate (tb->book);
+        GncInvoice *invoice = gncInvoiceCreate (tb->book);
+
+        gncVendorSetTerms (vendor, random_terms (tb));
+        gncVendorSetTaxTable (vendor, random_table (tb));
+        gncCustomerSetTerms (customer, random_terms (tb));
+        gncCustomerSetTaxTable (customer, random_table (tb));
+        gncEmployeeSetCurrency (employee, tb->usd);
+        gncEmployeeSetCCard (employee, random_account (tb));
+        gncEntrySetInvAccount (entry, random_account (tb));
+        gncEntrySetBillAccount (entry, random_account (tb));
+        gncEntrySetInvTaxTable (entry, random_table (tb));
+        gncEntrySetBillTaxTable (entry, random_table (tb));
+        gncInvoiceSetTerms (invoice, random_terms (tb));
+        gncInvoiceSetCurrency (invoice, tb->usd);
+        if (i % 2)
+            gncInvoiceSetPostedAcc (invoice, random_account (tb));
+
+        g_ptr_array_add (tb->employees, employee);
+        g_ptr_array_add (tb->entries, entry);
+        g_ptr_array_add (tb->invoices, invoice);
+    }
+}
+
+/* Point a third of everything somewhere else, and some of it nowhere. */
+static void
+change_references (TestBook *tb)
+{
+    guint i;
+
+    for (i = 0; i < tb->entries->len; i += 3)
+    {
+        GncEntry *entry = tb->entries->pdata[i];
+
+        gncEntrySetInvAccount (entry, (i % 2) ? NULL : random_account (tb));
+        gncEntrySetBillTaxTable (entry, (i % 2) ? random_table (tb) : NULL);
+        gncEmployeeSetCCard (tb->employees->pdata[i], random_account (tb));
+        gncInvoiceSetTerms (tb->invoices->pdata[i], random_terms (tb));
+    }
+    for (i = 0; i < NUM_TABLES; i++)
+    {
+        GncTaxTableEntry *entry = gncTaxTableGetEntries (tb->tables[i])->data;
+
+        gncTaxTableBeginEdit (tb->tables[i]);
+        gncTaxTableEntrySetAccount (entry, random_account (tb));
+        gncTaxTableCommitEdit (tb->tables[i]);
+    }
+}
+
+/* Destroy a third of the entries and employees, and one account. */
+static void
+destroy_some (TestBook *tb)
+{
+    Account *acc = tb->accounts[0];
+    guint i;
+
+    for (i = tb->entries->len; i-- > 0; )
+    {
+        if (i % 3 != 1)
+            continue;
+        gncEntryBeginEdit (tb->entries->pdata[i]);
+        gncEntryDestroy (tb->entries->pdata[i]);
+        g_ptr_array_remove_index (tb->entries, i);
+        gncEmployeeBeginEdit (tb->employees->pdata[i]);
+        gncEmployeeDestroy (tb->employees->pdata[i]);
+        g_ptr_array_remove_index (tb->employees, i);
+    }
+
+    /* Nothing may point at it any more, or the scan would find it. */
+    for (i = 0; i < tb->entries->len; i++)
+    {
+        if (gncEntryGetInvAccount (tb->entries->pdata[i]) == acc)
+            gncEntrySetInvAccount (tb->entries->pdata[i], NULL);
+        if (gncEntryGetBillAccount (tb->entries->pdata[i]) == acc)
+            gncEntrySetBillAccount (tb->entries->pdata[i], NULL);
+        if (gncEmployeeGetCCard (tb->employees->pdata[i]) == acc)
+            gncEmployeeSetCCard (tb->employees->pdata[i], NULL);
+    }
+    xaccAccountBeginEdit (acc);
+    xaccAccountDestroy (acc);
+    tb->accounts[0] = tb->accounts[1];
+}
+
+typedef struct
+{
+    const QofInstance *ref;
+    GList *list;
+} ScanData;
+
+static void
+scan_instance (QofInstance *inst, gpointer user_data)
+{
+    ScanData *data = user_data;
+
+    if (qof_instance_refers_to_object (inst, data->ref))
+        data->list = g_list_prepend (data->list, inst);
+}
+
+static void
+scan_collection (QofCollection *col, gpointer user_data)
+{
+    qof_collection_foreach (col, scan_instance, user_data);
+}
+
+static gboolean
+same_referrers (QofInstance *ref)
+{
+    GList *list = qof_instance_get_referring_object_list (ref);
+    GList *node;
+    ScanData data;
+    gboolean same;
+
+    data.ref = ref;
+    data.list = NULL;
+    qof_book_foreach_collection (qof_instance_get_book (ref), scan_collection,
+                                 &data);
+    same = (g_list_length (list) == g_list_length (data.list));
+    for (node = data.list; same && node; node = node->next)
+        same = (g_list_find (list, node->data) != NULL);
+    g_list_free (list);
+    g_list_free (data.list);
+    return same;
+}
+
+static void
+check_book (TestBook *tb, const char *step)
+{
+    gboolean same = TRUE;
+    gchar *title;
+    guint i;
+
+    title = g_strdup_printf ("%s: index matches refers_to_object", step);
+    do_test (qof_instance_check_reference_index (tb->book) == 0, title);
+    g_free (title);
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+        same = same_referrers (QOF_INSTANCE (tb->accounts[i])) && same;
+    for (i = 0; i < NUM_TABLES; i++)
+        same = same_referrers (QOF_INSTANCE (tb->tables[i])) && same;
+    for (i = 0; i < NUM_TERMS; i++)
+        same = same_referrers (QOF_INSTANCE (tb->terms[i])) && same;
+    same = same_referrers (QOF_INSTANCE (tb->usd)) && same;
+    title = g_strdup_printf ("%s: referring objects match a scan", step);
+    do_test (same, title);
+    g_free (title);
+}
+
+int
+main (int argc, char **argv)
+{
+    TestBook tb;
+
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        make_book (&tb, NUM_OBJECTS);
+        check_book (&tb, "created");
+        change_references (&tb);
+        check_book (&tb, "changed");
+        destroy_some (&tb);
+        check_book (&tb, "destroyed");
+
+        g_ptr_array_free (tb.entries, TRUE);
+        g_ptr_array_free (tb.invoices, TRUE);
+        g_ptr_array_free (tb.employees, TRUE);
+        qof_book_destroy (tb.book);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
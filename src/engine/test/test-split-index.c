@@ -0,0 +1,158 @@
+/***************************************************************************
+ *            test-split-index.c
+ *
+ *  Exercise the ordered split container behind
+ *  gnc_account_insert_split() and gnc_account_remove_split().
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-split-index.c
+ * @brief Check the split order of an account after insert/remove.
+ *
+ * The splits are inserted straight into the account in random order,
+ * and have to come out sorted and be found again.  Two of them are
+ * moved to either end and only marked dirty, and at last all of them
+ * are removed.  bench-engine times the same operations on bigger
+ * accounts.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include "qof.h"
+#include "AccountP.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_SPLITS 4000
+
+/* The transactions are deliberately left open, so that nothing gets
+ * committed, scrubbed or balanced behind our back. */
+static GPtrArray *
+make_splits (QofBook *book, guint count)
+{
+    GPtrArray *splits = g_ptr_array_sized_new (count);
+    guint i;
+
+    for (i = 0; i < count; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (book);
+        Split *split = xaccMallocSplit (book);
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetDatePostedSecs (trans, get_random_test_book_date ());
+        xaccSplitSetParent (split, trans);
+        g_ptr_array_add (splits, split);
+    }
+    return splits;
+}
+
+static void
+shuffle_splits (GPtrArray *splits)
+{
+    guint i;
+
+    for (i = splits->len - 1; i > 0; i--)
+    {
+        guint j = get_random_int_in_range (0, i);
+        gpointer tmp = splits->pdata[i];
+        splits->pdata[i] = splits->pdata[j];
+        splits->pdata[j] = tmp;
+    }
+}
+
+static gboolean
+splits_in_order (Account *acc, guint expected)
+{
+    GList *node = xaccAccountGetSplitList (acc);
+    guint count = 0;
+
+    for (; node; node = node->next, count++)
+    {
+        if (node->next && xaccSplitOrder (node->data, node->next->data) > 0)
+            return FALSE;
+        if (node->next && node->next->prev != node)
+            return FALSE;
+    }
+    return count == expected;
+}
+
+static void
+run_test (guint count)
+{
+    QofBook *book = qof_book_new ();
+    Account *acc = xaccMallocAccount (book);
+    GPtrArray *splits = make_splits (book, count);
+    gboolean found = TRUE;
+    guint i;
+
+    shuffle_splits (splits);
+
+    for (i = 0; i < splits->len; i++)
+        gnc_account_insert_split (acc, splits->pdata[i]);
+
+    do_test (splits_in_order (acc, count), "splits inserted in order");
+    for (i = 0; i < splits->len; i++)
+        found = found && gnc_account_find_split (acc, splits->pdata[i]);
+    do_test (found, "every split can be found");
+
+    /* Move one split to the front and one to the back, and make sure
+     * that only re-positioning those two gives the right order. */
+    xaccTransSetDatePostedSecs (xaccSplitGetParent (splits->pdata[0]), 0);
+    xaccTransSetDatePostedSecs (xaccSplitGetParent (splits->pdata[1]),
+                                2000000000);
+    gnc_account_mark_split_dirty (acc, splits->pdata[0]);
+    gnc_account_mark_split_dirty (acc, splits->pdata[1]);
+    do_test (gnc_account_get_sort_dirty (acc), "marked splits dirty the sort");
+    do_test (splits_in_order (acc, count), "marked splits re-positioned");
+    do_test (xaccAccountGetSplitList (acc)->data == splits->pdata[0],
+             "earliest split first");
+    do_test (g_list_last (xaccAccountGetSplitList (acc))->data ==
+             splits->pdata[1], "latest split last");
+
+    shuffle_splits (splits);
+
+    /* Removing a split recomputes the balance unless the account is
+     * being edited. */
+    qof_instance_increase_editlevel (acc);
+    for (i = 0; i < splits->len; i++)
+        gnc_account_remove_split (acc, splits->pdata[i]);
+    do_test (xaccAccountGetSplitList (acc) == NULL, "all splits removed");
+    qof_instance_decrease_editlevel (acc);
+
+    g_ptr_array_free (splits, TRUE);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        run_test (NUM_SPLITS);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
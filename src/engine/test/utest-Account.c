@@ -1621,6 +1621,56 @@ test_gnc_account_lookup_by_full_name (Fixture *fixture, gconstpointer pData)
     g_free (code);
 }
 
+/* The full name index and the cached full names follow renames, moves
+ * and separator changes. */
+static void
+test_gnc_account_lookup_by_full_name_changes (Fixture *fixture,
+        gconstpointer pData)
+{
+    Account *root, *target, *parent, *exempt;
+    gchar *code;
+
+    root = gnc_account_get_root (fixture->acct);
+    target = gnc_account_lookup_by_full_name (root, "income:taxable:int");
+    g_assert (target != NULL);
+    parent = gnc_account_get_parent (target);
+    g_assert (gnc_account_lookup_by_full_name (root, "") == NULL);
+
+    xaccAccountSetName (parent, "taxed");
+    g_assert (gnc_account_lookup_by_full_name (root, "income:taxable:int") == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:taxed:int") == target);
+    g_assert_cmpstr (gnc_account_peek_full_name (target), ==, "income:taxed:int");
+
+    /* The first of two accounts with the same full name is found. */
+    exempt = gnc_account_lookup_by_full_name (root, "income:exempt");
+    g_assert (exempt != NULL);
+    gnc_account_append_child (exempt, target);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:taxed:int") == NULL);
+    g_assert_cmpstr (gnc_account_peek_full_name (target), ==, "income:exempt:int");
+    g_object_get (gnc_account_lookup_by_full_name (root, "income:exempt:int"),
+                  "code", &code, NULL);
+    g_assert_cmpstr (code, ==, "4210");
+    g_free (code);
+
+    gnc_account_remove_child (exempt, target);
+    g_assert_cmpstr (gnc_account_peek_full_name (target), ==, "");
+    gnc_account_append_child (root, target);
+    g_assert (gnc_account_lookup_by_full_name (root, "int") == target);
+
+    gnc_set_account_separator ("/");
+    g_assert (gnc_account_lookup_by_full_name (root, "income/taxed") == parent);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:taxed") == NULL);
+    g_assert_cmpstr (gnc_account_peek_full_name (parent), ==, "income/taxed");
+    gnc_set_account_separator (":");
+    g_assert (gnc_account_lookup_by_full_name (root, "income:taxed") == parent);
+
+    /* Nor is an account below a name with the separator in it. */
+    xaccAccountSetName (parent, "tax:ed");
+    gnc_account_append_child (parent, target);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:tax:ed:int") == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root, "int") == NULL);
+}
+
 static void
 thunk (Account *s, gpointer data)
 {
@@ -1811,6 +1861,12 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
     val = xaccAccountGetBalanceAsOfDate (fixture->acct, (time (0) - offset));
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, ==, dbal);
+/* Before the first and after the last transaction */
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct, 0);
+    g_assert (gnc_numeric_zero_p (val));
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct,
+					 time (0) + 24 * 3600 * 365);
+    g_assert (gnc_numeric_eq (val, xaccAccountGetBalance (fixture->acct)));
 }
 /* xaccAccountGetPresentBalance
 gnc_numeric
@@ -2407,6 +2463,7 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "gnc account lookup by code", Fixture, &complex, setup, test_gnc_account_lookup_by_code,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name helper", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name_helper,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account lookup by full name changes", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name_changes,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach child", Fixture, &complex, setup, test_gnc_account_foreach_child,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach child until", Fixture, &complex, setup, test_gnc_account_foreach_child_until,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach descendant", Fixture, &complex, setup, test_gnc_account_foreach_descendant,  teardown );
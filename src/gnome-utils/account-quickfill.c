@@ -185,7 +185,9 @@ build_shared_quickfill (QofBook *book, Account *root, const char * key,
     qfb->load_list_store = FALSE;
 
     qfb->listener =
-        qof_event_register_handler (listen_for_account_events, qfb);
+        qof_event_register_filtered_handler (listen_for_account_events, qfb,
+                GNC_ID_ACCOUNT,
+                QOF_EVENT_MODIFY | QOF_EVENT_ADD | QOF_EVENT_REMOVE);
 
     qof_book_set_data_fin (book, key, qfb, shared_quickfill_destroy);
 
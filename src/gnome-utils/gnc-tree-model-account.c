@@ -90,13 +90,53 @@ static void gnc_tree_model_account_event_handler (QofInstance *entity,
         GncTreeModelAccount *model,
         GncEventData *ed);
 
+static void gnc_tree_model_account_price_event_handler (QofInstance *entity,
+        QofEventId event_type,
+        GncTreeModelAccount *model,
+        GncEventData *ed);
+
+/** The balances shown by the balance columns.  All of them except
+ *  the period balance include the sub-accounts. */
+typedef enum
+{
+    ACCOUNT_BALANCE_PRESENT,
+    ACCOUNT_BALANCE_TOTAL,
+    ACCOUNT_BALANCE_CLEARED,
+    ACCOUNT_BALANCE_RECONCILED,
+    ACCOUNT_BALANCE_FUTURE_MIN,
+    ACCOUNT_BALANCE_PERIOD,
+    ACCOUNT_BALANCE_TOTAL_PERIOD,
+    NUM_ACCOUNT_BALANCES
+} AccountBalanceType;
+
+/** The cached balances of one account, both in the account's commodity
+ *  and in the report currency.  Bit (type * 2 + in_report) of valid is
+ *  set once that balance has been computed. */
+typedef struct
+{
+    guint32 valid;
+    gnc_numeric balance[NUM_ACCOUNT_BALANCES][2];
+} AccountBalances;
+
 /** The instance private data for an account tree model. */
 typedef struct GncTreeModelAccountPrivate
 {
     QofBook *book;
     Account *root;
     gint event_handler_id;
+    gint price_handler_id;
     const gchar *negative_color;
+
+    /* Account -> AccountBalances.  An entry is dropped when a split in
+     * the account's subtree changes, and the whole cache when anything
+     * the balances were computed for changes, or when events that might
+     * have said so were dropped by qof_event_suspend(). */
+    GHashTable *balance_cache;
+    guint cache_dropped;
+    time_t cache_day;
+    time_t period_start;
+    time_t period_end;
+    gnc_commodity *report_currency;
 } GncTreeModelAccountPrivate;
 
 #define GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(o)  \
@@ -208,6 +248,8 @@ gnc_tree_model_account_init (GncTreeModelAccount *model)
     priv->book = NULL;
     priv->root = NULL;
     priv->negative_color = red ? "red" : "black";
+    priv->balance_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                          NULL, g_free);
 
     gnc_gconf_general_register_cb(KEY_NEGATIVE_IN_RED,
                                   gnc_tree_model_account_update_color,
@@ -235,6 +277,7 @@ gnc_tree_model_account_finalize (GObject *object)
                                 model);
 
     priv->book = NULL;
+    g_hash_table_destroy (priv->balance_cache);
 
     if (G_OBJECT_CLASS (parent_class)->finalize)
         G_OBJECT_CLASS(parent_class)->finalize (object);
@@ -260,6 +303,11 @@ gnc_tree_model_account_dispose (GObject *object)
         qof_event_unregister_handler (priv->event_handler_id);
         priv->event_handler_id = 0;
     }
+    if (priv->price_handler_id)
+    {
+        qof_event_unregister_handler (priv->price_handler_id);
+        priv->price_handler_id = 0;
+    }
 
     gnc_gconf_general_remove_cb(KEY_NEGATIVE_IN_RED,
                                 gnc_tree_model_account_update_color,
@@ -303,8 +351,12 @@ gnc_tree_model_account_new (Account *root)
     priv->book = gnc_get_current_book();
     priv->root = root;
 
-    priv->event_handler_id = qof_event_register_handler
-                             ((QofEventHandler)gnc_tree_model_account_event_handler, model);
+    priv->event_handler_id = qof_event_register_filtered_handler
+                             ((QofEventHandler)gnc_tree_model_account_event_handler, model,
+                              GNC_ID_ACCOUNT, QOF_EVENT_NONE);
+    priv->price_handler_id = qof_event_register_filtered_handler
+                             ((QofEventHandler)gnc_tree_model_account_price_event_handler, model,
+                              GNC_ID_PRICE, QOF_EVENT_NONE);
 
     LEAVE("model %p", model);
     return GTK_TREE_MODEL (model);
@@ -558,6 +610,138 @@ gnc_tree_model_account_set_color(GncTreeModelAccount *model,
         g_value_set_static_string (value, "black");
 }
 
+/** Drop the cached balances if they were computed for another day,
+ *  accounting period or report currency, or if any event has been
+ *  dropped since. */
+static void
+gnc_tree_model_account_check_balance_cache (GncTreeModelAccountPrivate *priv)
+{
+    guint dropped = qof_event_get_dropped_count ();
+    time_t today = gnc_timet_get_today_start ();
+    time_t t1 = gnc_accounting_period_fiscal_start ();
+    time_t t2 = gnc_accounting_period_fiscal_end ();
+    gnc_commodity *report_currency = gnc_default_report_currency ();
+
+    if (dropped == priv->cache_dropped && today == priv->cache_day &&
+            t1 == priv->period_start && t2 == priv->period_end &&
+            report_currency == priv->report_currency)
+        return;
+
+    g_hash_table_remove_all (priv->balance_cache);
+    priv->cache_dropped = dropped;
+    priv->cache_day = today;
+    priv->period_start = t1;
+    priv->period_end = t2;
+    priv->report_currency = report_currency;
+}
+
+/** Return a balance of the account, from the cache if it has been
+ *  computed since the last change to the account's subtree. */
+static gnc_numeric
+gnc_tree_model_account_get_balance (GncTreeModelAccount *model,
+                                    Account *acct,
+                                    AccountBalanceType type,
+                                    gboolean in_report)
+{
+    GncTreeModelAccountPrivate *priv;
+    AccountBalances *balances;
+    gnc_commodity *currency;
+    guint32 bit;
+
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    gnc_tree_model_account_check_balance_cache (priv);
+
+    balances = g_hash_table_lookup (priv->balance_cache, acct);
+    if (!balances)
+    {
+        balances = g_new0 (AccountBalances, 1);
+        g_hash_table_insert (priv->balance_cache, acct, balances);
+    }
+
+    in_report = in_report ? 1 : 0;
+    bit = 1 << (type * 2 + in_report);
+    if (balances->valid & bit)
+        return balances->balance[type][in_report];
+
+    currency = in_report ? priv->report_currency : NULL;
+    switch (type)
+    {
+    case ACCOUNT_BALANCE_PRESENT:
+        balances->balance[type][in_report] =
+            xaccAccountGetPresentBalanceInCurrency (acct, currency, TRUE);
+        break;
+    case ACCOUNT_BALANCE_TOTAL:
+        balances->balance[type][in_report] =
+            xaccAccountGetBalanceInCurrency (acct, currency, TRUE);
+        break;
+    case ACCOUNT_BALANCE_CLEARED:
+        balances->balance[type][in_report] =
+            xaccAccountGetClearedBalanceInCurrency (acct, currency, TRUE);
+        break;
+    case ACCOUNT_BALANCE_RECONCILED:
+        balances->balance[type][in_report] =
+            xaccAccountGetReconciledBalanceInCurrency (acct, currency, TRUE);
+        break;
+    case ACCOUNT_BALANCE_FUTURE_MIN:
+        balances->balance[type][in_report] =
+            xaccAccountGetProjectedMinimumBalanceInCurrency (acct, currency, TRUE);
+        break;
+    case ACCOUNT_BALANCE_PERIOD:
+    case ACCOUNT_BALANCE_TOTAL_PERIOD:
+        balances->balance[type][in_report] =
+            xaccAccountGetBalanceChangeForPeriod (acct, priv->period_start,
+                    priv->period_end,
+                    type == ACCOUNT_BALANCE_TOTAL_PERIOD);
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+    balances->valid |= bit;
+    return balances->balance[type][in_report];
+}
+
+/** Forget the cached balances of the account and of all its
+ *  ancestors, as they all include the account's splits. */
+static void
+gnc_tree_model_account_invalidate_balances (GncTreeModelAccount *model,
+        Account *acct)
+{
+    GncTreeModelAccountPrivate *priv;
+
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    for ( ; acct; acct = gnc_account_get_parent (acct))
+        g_hash_table_remove (priv->balance_cache, acct);
+}
+
+/** The cached replacement for gnc_ui_account_get_print_balance and
+ *  gnc_ui_account_get_print_report_balance. */
+static gchar *
+gnc_tree_model_account_print_balance (GncTreeModelAccount *model,
+                                      Account *acct,
+                                      AccountBalanceType type,
+                                      gboolean in_report,
+                                      gboolean *negative)
+{
+    GncTreeModelAccountPrivate *priv;
+    GNCPrintAmountInfo print_info;
+    gnc_numeric balance;
+
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    balance = gnc_tree_model_account_get_balance (model, acct, type, in_report);
+
+    /* reverse sign if needed */
+    if (gnc_reverse_balance (acct))
+        balance = gnc_numeric_neg (balance);
+    if (negative)
+        *negative = gnc_numeric_negative_p (balance);
+
+    if (in_report)
+        print_info = gnc_commodity_print_info (priv->report_currency, TRUE);
+    else
+        print_info = gnc_account_print_info (acct, TRUE);
+    return g_strdup (xaccPrintAmount (balance, print_info));
+}
+
 static gchar *
 gnc_tree_model_account_compute_period_balance(GncTreeModelAccount *model,
         Account *acct,
@@ -565,8 +749,6 @@ gnc_tree_model_account_compute_period_balance(GncTreeModelAccount *model,
         gboolean *negative)
 {
     GncTreeModelAccountPrivate *priv;
-    time_t t1, t2;
-    gnc_numeric b3;
 
     if ( negative )
         *negative = FALSE;
@@ -575,20 +757,13 @@ gnc_tree_model_account_compute_period_balance(GncTreeModelAccount *model,
     if (acct == priv->root)
         return g_strdup("");
 
-    t1 = gnc_accounting_period_fiscal_start();
-    t2 = gnc_accounting_period_fiscal_end();
-
-    if (t1 > t2)
+    gnc_tree_model_account_check_balance_cache (priv);
+    if (priv->period_start > priv->period_end)
         return g_strdup("");
 
-    b3 = xaccAccountGetBalanceChangeForPeriod(acct, t1, t2, recurse);
-    if (gnc_reverse_balance (acct))
-        b3 = gnc_numeric_neg (b3);
-
-    if (negative)
-        *negative = gnc_numeric_negative_p(b3);
-
-    return g_strdup(xaccPrintAmount(b3, gnc_account_print_info(acct, TRUE)));
+    return gnc_tree_model_account_print_balance (model, acct,
+            recurse ? ACCOUNT_BALANCE_TOTAL_PERIOD : ACCOUNT_BALANCE_PERIOD,
+            FALSE, negative);
 }
 
 static void
@@ -645,40 +820,40 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
 
     case GNC_TREE_MODEL_ACCOUNT_COL_PRESENT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_PRESENT,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_PRESENT_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_PRESENT,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_PRESENT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_PRESENT,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free(string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_BALANCE:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_BALANCE_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_BALANCE:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free(string);
         break;
@@ -696,34 +871,34 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
 
     case GNC_TREE_MODEL_ACCOUNT_COL_CLEARED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_CLEARED,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_CLEARED_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_CLEARED,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_CLEARED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_CLEARED,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free(string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_RECONCILED,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_RECONCILED,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED_DATE:
@@ -736,48 +911,48 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
 
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_RECONCILED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_RECONCILED,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_FUTURE_MIN:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_FUTURE_MIN_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_FUTURE_MIN:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_TOTAL:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 FALSE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_TOTAL_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 TRUE, &negative);
         g_value_take_string (value, string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_TOTAL:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        string = gnc_tree_model_account_print_balance(model, account, ACCOUNT_BALANCE_TOTAL,
+                 FALSE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
         g_free (string);
         break;
@@ -1261,7 +1436,8 @@ propagate_change(GtkTreeModel *model, GtkTreePath *path, gint toggle_if_num)
  *  an account is added to the engine or deleted from the engine.
  *  This change to the model is then propagated to any/all overlying
  *  filters and views.  This function listens to the ADD, REMOVE, and
- *  DESTROY events.
+ *  DESTROY events.  The split events of an account and MODIFY drop
+ *  the cached balances of the account and its ancestors.
  *
  *  @internal
  *
@@ -1305,6 +1481,8 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
     priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
 
     account = GNC_ACCOUNT(entity);
+    if (event_type == QOF_EVENT_DESTROY)
+        g_hash_table_remove (priv->balance_cache, account);
     if (gnc_account_get_book(account) != priv->book)
     {
         LEAVE("not in this book");
@@ -1321,6 +1499,7 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
     case QOF_EVENT_ADD:
         /* Tell the filters/views where the new account was added. */
         DEBUG("add account %p (%s)", account, xaccAccountGetName(account));
+        gnc_tree_model_account_invalidate_balances(model, account);
         path = gnc_tree_model_account_get_path_from_account(model, account);
         if (!path)
         {
@@ -1343,6 +1522,7 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
         parent = ed->node ? GNC_ACCOUNT(ed->node) : priv->root;
         parent_name = ed->node ? xaccAccountGetName(parent) : "Root";
         DEBUG("remove child %d of account %p (%s)", ed->idx, parent, parent_name);
+        gnc_tree_model_account_invalidate_balances(model, parent);
         path = gnc_tree_model_account_get_path_from_account(model, parent);
         if (!path)
         {
@@ -1356,7 +1536,12 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
         break;
 
     case QOF_EVENT_MODIFY:
+    case GNC_EVENT_ITEM_ADDED:
+    case GNC_EVENT_ITEM_REMOVED:
+    case GNC_EVENT_ITEM_CHANGED:
+        /* A split in the account changed, or the account itself. */
         DEBUG("modify  account %p (%s)", account, xaccAccountGetName(account));
+        gnc_tree_model_account_invalidate_balances(model, account);
         path = gnc_tree_model_account_get_path_from_account(model, account);
         if (!path)
         {
@@ -1382,3 +1567,25 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
     LEAVE(" ");
     return;
 }
+
+/** Prices go into the balances shown in another commodity, so any
+ *  change to them drops all of the cached balances.  The view picks up
+ *  the new values the next time it draws the rows, as it always has.
+ *
+ *  @internal
+ */
+static void
+gnc_tree_model_account_price_event_handler (QofInstance *entity,
+        QofEventId event_type,
+        GncTreeModelAccount *model,
+        GncEventData *ed)
+{
+    GncTreeModelAccountPrivate *priv;
+
+    g_return_if_fail(model);	/* Required */
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    if (qof_instance_get_book(entity) != priv->book)
+        return;
+    if (event_type & (QOF_EVENT_ADD | QOF_EVENT_REMOVE | QOF_EVENT_MODIFY))
+        g_hash_table_remove_all (priv->balance_cache);
+}
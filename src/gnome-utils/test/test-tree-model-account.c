@@ -0,0 +1,164 @@
+/***************************************************************************
+ *            test-tree-model-account.c
+ *
+ *  Check that the account tree model does not show stale balances
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-tree-model-account.c
+ * @brief Change splits under the cached balances of the model.
+ *
+ * A bank account with a sub-account gets a transaction, and the
+ * balance and total columns of both are read from the model, which
+ * caches them.  Both columns include the sub-accounts.  Then the split is changed, the transaction moved to
+ * another day and a second one added, once with events delivered and
+ * once with events suspended as the register does for reversing and
+ * shifting transactions.  Every time the columns have to show what the
+ * engine computes.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "qof.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "gnc-session.h"
+#include "gnc-ui-util.h"
+#include "gnc-tree-model-account.h"
+#include "cashobjects.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+static void
+make_transaction (QofBook *book, Account *from, Account *to, gint64 cents)
+{
+    xaccTransCommitEdit (make_test_transaction (book, from, to, TEST_BOOK_START,
+                                                gnc_numeric_create (cents, 100)));
+}
+
+static gboolean
+column_is (GtkTreeModel *model, Account *acc, gint column,
+           gnc_numeric balance)
+{
+    GtkTreeIter iter;
+    gchar *shown;
+    gboolean same;
+
+    if (!gnc_tree_model_account_get_iter_from_account
+            (GNC_TREE_MODEL_ACCOUNT (model), acc, &iter))
+        return FALSE;
+    gtk_tree_model_get (model, &iter, column, &shown, -1);
+    same = (shown != NULL &&
+            strcmp (shown, xaccPrintAmount (balance,
+                                            gnc_account_print_info (acc, TRUE))) == 0);
+    g_free (shown);
+    return same;
+}
+
+static void
+check_balances (GtkTreeModel *model, Account *parent, Account *child,
+                const char *step)
+{
+    gchar *title;
+
+    title = g_strdup_printf ("%s: balances shown", step);
+    do_test (column_is (model, parent, GNC_TREE_MODEL_ACCOUNT_COL_BALANCE,
+                        xaccAccountGetBalanceInCurrency (parent, NULL, TRUE))
+             && column_is (model, child, GNC_TREE_MODEL_ACCOUNT_COL_BALANCE,
+                           xaccAccountGetBalanceInCurrency (child, NULL, TRUE)),
+             title);
+    g_free (title);
+
+    title = g_strdup_printf ("%s: totals shown", step);
+    do_test (column_is (model, parent, GNC_TREE_MODEL_ACCOUNT_COL_TOTAL,
+                        xaccAccountGetBalanceInCurrency (parent, NULL, TRUE))
+             && column_is (model, child, GNC_TREE_MODEL_ACCOUNT_COL_TOTAL,
+                           xaccAccountGetBalanceInCurrency (child, NULL, TRUE)),
+             title);
+    g_free (title);
+}
+
+/* What the register's reverse and shift forward commands do to the
+ * transaction, and a new one like a duplicate. */
+static void
+change_transaction (QofBook *book, Transaction *trans, Account *from,
+                    Account *to, gint64 cents)
+{
+    Split *split = xaccTransGetSplit (trans, 0);
+
+    xaccTransBeginEdit (trans);
+    xaccSplitSetValue (split, gnc_numeric_neg (xaccSplitGetValue (split)));
+    xaccSplitSetAmount (split, gnc_numeric_neg (xaccSplitGetAmount (split)));
+    split = xaccTransGetSplit (trans, 1);
+    xaccSplitSetValue (split, gnc_numeric_neg (xaccSplitGetValue (split)));
+    xaccSplitSetAmount (split, gnc_numeric_neg (xaccSplitGetAmount (split)));
+    xaccTransSetDatePostedSecs (trans, xaccTransGetDate (trans) + 86400);
+    xaccTransCommitEdit (trans);
+    make_transaction (book, from, to, cents);
+}
+
+int
+main (int argc, char **argv)
+{
+    QofBook *book;
+    Account *root, *parent, *child, *other;
+    gnc_commodity *usd;
+    GtkTreeModel *model;
+    Transaction *trans;
+
+    g_type_init ();
+    qof_init ();
+    if (!cashobjects_register ())
+    {
+        failure ("can't register objects");
+        exit (get_rv ());
+    }
+    xaccLogDisable ();
+
+    book = gnc_get_current_book ();
+    root = gnc_book_get_root_account (book);
+    usd = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                      GNC_COMMODITY_NS_CURRENCY, "USD");
+    parent = make_test_account (book, root, ACCT_TYPE_BANK, usd, "Bank");
+    child = make_test_account (book, parent, ACCT_TYPE_BANK, usd, "Savings");
+    other = make_test_account (book, root, ACCT_TYPE_BANK, usd, "Other");
+    trans = make_test_transaction (book, other, child, TEST_BOOK_START,
+                                   gnc_numeric_create (12345, 100));
+    xaccTransCommitEdit (trans);
+
+    model = gnc_tree_model_account_new (root);
+    check_balances (model, parent, child, "created");
+
+    change_transaction (book, trans, other, child, 500);
+    check_balances (model, parent, child, "changed");
+
+    qof_event_suspend ();
+    change_transaction (book, trans, other, child, 700);
+    qof_event_resume ();
+    check_balances (model, parent, child, "changed while suspended");
+
+    g_object_unref (model);
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
@@ -1098,6 +1098,26 @@ static int gnc_csv_preview_errors(GncCsvPreview* preview)
         return 1;
 }
 
+/** The generic importer GUI and how many transactions it got from
+ * gnc_csv_stream_to_trans. */
+typedef struct
+{
+    GNCImportMainMatcher* gui;
+    int count;
+} StreamedTrans;
+
+/** Adds a transaction made by gnc_csv_stream_to_trans to the
+ * generic importer GUI.
+ * @param trans The transaction
+ * @param user_data The StreamedTrans of the importer GUI
+ */
+static void add_streamed_trans(Transaction* trans, gpointer user_data)
+{
+    StreamedTrans* streamed = user_data;
+    gnc_gen_trans_list_add_trans(streamed->gui, trans);
+    streamed->count++;
+}
+
 /** Lets the user import a CSV/Fixed-Width file. */
 void gnc_file_csv_import(void)
 {
@@ -1122,6 +1142,7 @@ void gnc_file_csv_import(void)
         GList* transactions; /* A list of the transactions we create */
         GncCsvParseData* parse_data;
         GncCsvPreview* preview;
+        StreamedTrans streamed;
 
         /* Remember the directory of the selected file as the default. */
         default_dir = g_path_get_dirname(selected_filename);
@@ -1187,7 +1208,31 @@ void gnc_file_csv_import(void)
         /* Create the genereic transaction importer GUI. */
         gnc_csv_importer_gui = gnc_gen_trans_list_new(NULL, NULL, FALSE, 42);
 
-        /* Get the list of the transactions that were created. */
+        /* The rows after the ones in the preview go to the importer GUI
+         * straight from the file, a piece at a time. */
+        streamed.gui = gnc_csv_importer_gui;
+        streamed.count = 0;
+        g_clear_error(&error);
+        if (gnc_csv_stream_to_trans(parse_data, account, add_streamed_trans,
+                                    &streamed, &error))
+        {
+            gnc_error_dialog(NULL, "%s", error->message);
+            g_clear_error(&error);
+        }
+        if (parse_data->stream_error_rows > 0)
+        {
+            gnc_info_dialog(NULL, ngettext
+                            ("%d row after the ones in the preview could not be "
+                             "understood and was skipped.",
+                             "%d rows after the ones in the preview could not be "
+                             "understood and were skipped.",
+                             parse_data->stream_error_rows),
+                            parse_data->stream_error_rows);
+        }
+
+        /* Get the list of the transactions that were created. Their
+         * amounts may have been worked out again from a balance column
+         * while streaming, so they go only now. */
         transactions = parse_data->transactions;
         /* Copy all of the transactions to the importer GUI. */
         while (transactions != NULL)
@@ -1197,9 +1242,10 @@ void gnc_file_csv_import(void)
                                          trans_line->trans);
             transactions = g_list_next(transactions);
         }
+
         /* Let the user load those transactions into the account, so long
          * as there is at least one transaction to be loaded. */
-        if (parse_data->transactions != NULL)
+        if (parse_data->transactions != NULL || streamed.count > 0)
             gnc_gen_trans_list_run(gnc_csv_importer_gui);
         else
             gnc_gen_trans_list_delete(gnc_csv_importer_gui);
@@ -2,6 +2,7 @@
 
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include <goffice/goffice-features.h>
 #if (GO_VERSION_EPOCH == 0) && (GO_VERSION_MAJOR == 7) && (GO_VERSION_MINOR == 8)
@@ -11,21 +12,24 @@
 #endif
 #include <goffice/utils/go-glib-extras.h>
 
+#include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <regex.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <math.h>
 #include <time.h>
 #ifndef HAVE_LOCALTIME_R
 #include "localtime_r.h"
 #endif
 
+#include "gnc-locale-utils.h"
+
 static QofLogModule log_module = GNC_MOD_IMPORT;
 
 const int num_date_formats = 5;
@@ -58,125 +62,154 @@ static StfParseOptions_t* default_parse_options(void)
     return options;
 }
 
-/** Parses a string into a date, given a format. The format must
- * include the year. This function should only be called by
- * parse_date.
- * @param date_str The string containing a date being parsed
+/* The separators allowed between the fields of a date. */
+#define DATE_SEPARATORS "-/.'"
+
+/* The fields of a date are at most this long, except in the form
+ * without separators. */
+#define DATE_FIELD_MAX_DIGITS 4
+
+/** Compiles a date format for gnc_csv_date_parser_parse. This
+ * requires only knowing the order in which the year, month and day
+ * appear. For example, 01-02-2003 will be parsed the same way as
+ * 01/02/2003.
+ * @param parser The parser to initialize
  * @param format An index specifying a format in date_format_user
- * @return The parsed value of date_str on success or -1 on failure
  */
-static time_t parse_date_with_year(const char* date_str, int format)
+void gnc_csv_date_parser_init(GncCsvDateParser* parser, int format)
 {
-    time_t rawtime; /* The integer time */
-    struct tm retvalue, test_retvalue; /* The time in a broken-down structure */
-
-    int i, j, mem_length, orig_year = -1, orig_month = -1, orig_day = -1;
-
-    /* Buffer for containing individual parts (e.g. year, month, day) of a date */
-    char date_segment[5];
+    time_t rawtime;
+    int i;
 
-    /* The compiled regular expression */
-    regex_t preg = {0};
+    parser->n_fields = 0;
+    for (i = 0; date_format_user[format][i] && parser->n_fields < 3; i++)
+    {
+        char segment_type = date_format_user[format][i];
+        /* Only do something if this is a meaningful character */
+        if (segment_type == 'y' || segment_type == 'm' || segment_type == 'd')
+            parser->order[parser->n_fields++] = segment_type;
+    }
 
-    /* An array containing indices specifying the matched substrings in date_str */
-    regmatch_t pmatch[4] = { {0}, {0}, {0}, {0} };
+    /* Put some sane values in the non-year-month-day parts of the
+     * dates by using the current time. */
+    time(&rawtime);
+    localtime_r(&rawtime, &parser->now);
+    parser->last_year = parser->last_month = parser->last_day = -1;
+    parser->last_time = -1;
+}
 
-    /* The regular expression for parsing dates */
-    const char* regex = "^ *([0-9]+) *[-/.'] *([0-9]+) *[-/.'] *([0-9]+).*$|^ *([0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9]).*$";
+/** Reads the digits of one field of a date.
+ * @param str Points to the first digit, and is moved past the last one
+ * @param max_digits The most digits to read
+ * @return The value of the field, or -1 if there are no digits or more than max_digits
+ */
+static int read_date_field(const char** str, int max_digits)
+{
+    int value = 0, digits = 0;
 
-    /* We get our matches using the regular expression. */
-    regcomp(&preg, regex, REG_EXTENDED);
-    regexec(&preg, date_str, 4, pmatch, 0);
-    regfree(&preg);
+    while (g_ascii_isdigit(**str))
+    {
+        if (++digits > max_digits)
+            return -1;
+        value = value * 10 + (**str - '0');
+        (*str)++;
+    }
+    return digits ? value : -1;
+}
 
-    /* If there wasn't a match, there was an error. */
-    if (pmatch[0].rm_eo == 0)
-        return -1;
+/** Parses a string into a date. The fields are numbers in the order
+ * of the format, separated by one of DATE_SEPARATORS and possibly
+ * spaces; anything after the last field is ignored. A format with a
+ * year also accepts 8 digits without separators, with 4 of them for
+ * the year. Consecutive cells with the same date are converted only
+ * once.
+ * @param parser The parser for the format of the column
+ * @param date_str The string containing a date being parsed
+ * @return The parsed value of date_str on success or -1 on failure
+ */
+time_t gnc_csv_date_parser_parse(GncCsvDateParser* parser, const char* date_str)
+{
+    const char *str = date_str, *start;
+    int values[3];
+    int i, year = -1, month = -1, day = -1;
+    struct tm retvalue, test_retvalue;
+    time_t rawtime;
+
+    while (*str == ' ')
+        str++;
+    start = str;
+    for (i = 0; i < parser->n_fields; i++)
+    {
+        if (i > 0)
+        {
+            while (*str == ' ')
+                str++;
+            if (*str == '\0' || strchr(DATE_SEPARATORS, *str) == NULL)
+                break;
+            str++;
+            while (*str == ' ')
+                str++;
+        }
+        values[i] = read_date_field(&str, DATE_FIELD_MAX_DIGITS);
+        if (values[i] < 0)
+            break;
+    }
 
     /* If this is a string without separators ... */
-    if (pmatch[1].rm_so == -1)
+    if (i < parser->n_fields)
     {
-        /* ... we will fill in the indices based on the user's selection. */
-        int k = 0; /* k traverses date_str by keeping track of where separators "should" be. */
-        j = 1; /* j traverses pmatch. */
-        for (i = 0; date_format_user[format][i]; i++)
+        if (parser->n_fields < 3)
+            return -1;
+        for (str = start; g_ascii_isdigit(*str); str++);
+        if (str - start < 8)
+            return -1;
+        /* ... the user's selection tells where the fields are. */
+        for (i = 0, str = start; i < parser->n_fields; i++)
         {
-            char segment_type = date_format_user[format][i];
-            /* Only do something if this is a meaningful character */
-            if (segment_type == 'y' || segment_type == 'm' || segment_type == 'd')
-            {
-                pmatch[j].rm_so = k;
-                switch (segment_type)
-                {
-                case 'm':
-                case 'd':
-                    k += 2;
-                    break;
-
-                case 'y':
-                    k += 4;
-                    break;
-                }
-
-                pmatch[j].rm_eo = k;
-                j++;
-            }
+            const char* field_end = str + (parser->order[i] == 'y' ? 4 : 2);
+            for (values[i] = 0; str < field_end; str++)
+                values[i] = values[i] * 10 + (*str - '0');
         }
     }
 
-    /* Put some sane values in retvalue by using the current time for
-     * the non-year-month-day parts of the date. */
-    time(&rawtime);
-    localtime_r(&rawtime, &retvalue);
-
-    /* j traverses pmatch (index 0 contains the entire string, so we
-     * start at index 1 for the first meaningful match). */
-    j = 1;
-    /* Go through the date format and interpret the matches in order of
-     * the sections in the date format. */
-    for (i = 0; date_format_user[format][i]; i++)
+    for (i = 0; i < parser->n_fields; i++)
     {
-        char segment_type = date_format_user[format][i];
-        /* Only do something if this is a meaningful character */
-        if (segment_type == 'y' || segment_type == 'm' || segment_type == 'd')
+        switch (parser->order[i])
         {
-            /* Copy the matching substring into date_segment so that we can
-             * convert it into an integer. */
-            mem_length = pmatch[j].rm_eo - pmatch[j].rm_so;
-            memcpy(date_segment, date_str + pmatch[j].rm_so, mem_length);
-            date_segment[mem_length] = '\0';
-
-            /* Set the appropriate member of retvalue. Save the original
-             * values so that we can check if the change when we use mktime
-             * below. */
-            switch (segment_type)
+        case 'y':
+            year = values[i];
+            /* Handle two-digit years. */
+            if (year < 100)
             {
-            case 'y':
-                retvalue.tm_year = atoi(date_segment);
-
-                /* Handle two-digit years. */
-                if (retvalue.tm_year < 100)
-                {
-                    /* We allow two-digit years in the range 1969 - 2068. */
-                    if (retvalue.tm_year < 69)
-                        retvalue.tm_year += 100;
-                }
-                else
-                    retvalue.tm_year -= 1900;
-                orig_year = retvalue.tm_year;
-                break;
+                /* We allow two-digit years in the range 1969 - 2068. */
+                if (year < 69)
+                    year += 100;
+            }
+            else
+                year -= 1900;
+            break;
 
-            case 'm':
-                orig_month = retvalue.tm_mon = atoi(date_segment) - 1;
-                break;
+        case 'm':
+            month = values[i] - 1;
+            break;
 
-            case 'd':
-                orig_day = retvalue.tm_mday = atoi(date_segment);
-                break;
-            }
-            j++;
+        case 'd':
+            day = values[i];
+            break;
         }
     }
+    if (parser->n_fields < 3)
+        year = parser->now.tm_year;
+
+    if (year == parser->last_year && month == parser->last_month &&
+            day == parser->last_day)
+        return parser->last_time;
+
+    retvalue = parser->now;
+    retvalue.tm_year = year;
+    retvalue.tm_mon = month;
+    retvalue.tm_mday = day;
+
     /* Convert back to an integer. If mktime leaves retvalue unchanged,
      * everything is okay; otherwise, an error has occurred. */
     /* We have to use a "test" date value to account for changes in
@@ -187,130 +220,138 @@ static time_t parse_date_with_year(const char* date_str, int format)
     mktime(&test_retvalue);
     retvalue.tm_isdst = test_retvalue.tm_isdst;
     rawtime = mktime(&retvalue);
-    if (retvalue.tm_mday == orig_day &&
-    retvalue.tm_mon == orig_month &&
-    retvalue.tm_year == orig_year)
-    {
-        return rawtime;
-    }
-    else
-    {
+    if (retvalue.tm_mday != day ||
+            retvalue.tm_mon != month ||
+            retvalue.tm_year != year)
         return -1;
-    }
+
+    parser->last_year = year;
+    parser->last_month = month;
+    parser->last_day = day;
+    parser->last_time = rawtime;
+    return rawtime;
 }
 
-/** Parses a string into a date, given a format. The format cannot
- * include the year. This function should only be called by
- * parse_date.
- * @param date_str The string containing a date being parsed
- * @param format An index specifying a format in date_format_user
- * @return The parsed value of date_str on success or -1 on failure
+/** Gets the separators for gnc_csv_amount_parser_parse from the locale.
+ * @param parser The parser to initialize
+ * @param scu The smallest commodity unit of the account
  */
-static time_t parse_date_without_year(const char* date_str, int format)
+void gnc_csv_amount_parser_init(GncCsvAmountParser* parser, int scu)
 {
-    time_t rawtime; /* The integer time */
-    struct tm retvalue, test_retvalue; /* The time in a broken-down structure */
-
-    int i, j, mem_length, orig_year = -1, orig_month = -1, orig_day = -1;
-
-    /* Buffer for containing individual parts (e.g. year, month, day) of a date */
-    gchar* date_segment;
+    struct lconv* lc = gnc_localeconv();
 
-    /* The compiled regular expression */
-    regex_t preg = {0};
+    parser->decimal_point = g_utf8_get_char(lc->decimal_point);
+    parser->thousands_sep = g_utf8_get_char(lc->thousands_sep);
+    g_strlcpy(parser->grouping, lc->grouping, sizeof(parser->grouping));
+    parser->scu = scu;
+}
 
-    /* An array containing indices specifying the matched substrings in date_str */
-    regmatch_t pmatch[3] = { {0}, {0}, {0} };
+/** Checks the digit groups of the integer part of an amount against
+ * the locale's grouping, see localeconv(3).
+ * @param parser The parser for the account
+ * @param groups The digits before each thousands separator, left to right
+ * @param n_groups The number of thousands separators
+ * @param tail The digits after the last separator
+ * @return TRUE if all separators sit between groups of the right size
+ */
+static gboolean amount_grouping_ok(const GncCsvAmountParser* parser,
+                                   const int* groups, int n_groups, int tail)
+{
+    const char* g = parser->grouping;
+    int size = 0, i;
 
-    /* The regular expression for parsing dates */
-    const char* regex = "^ *([0-9]+) *[-/.'] *([0-9]+).*$";
+    /* From the right; the last size repeats, CHAR_MAX ends the grouping. */
+    for (i = 0; i <= n_groups; i++)
+    {
+        int len = (i == 0) ? tail : groups[n_groups - i];
 
-    /* We get our matches using the regular expression. */
-    regcomp(&preg, regex, REG_EXTENDED);
-    regexec(&preg, date_str, 3, pmatch, 0);
-    regfree(&preg);
+        if (*g == CHAR_MAX)
+            return FALSE;
+        if (*g)
+            size = *g++;
+        if (size <= 0)
+            return FALSE;
+        /* Only the leftmost group may be short. */
+        if (i < n_groups ? len != size : (len < 1 || len > size))
+            return FALSE;
+    }
+    return TRUE;
+}
 
-    /* If there wasn't a match, there was an error. */
-    if (pmatch[0].rm_eo == 0)
-        return -1;
+/** Parses an amount with the locale's separators straight into a
+ * gnc_numeric. One currency symbol is allowed anywhere in the
+ * string, and thousands separators between the digit groups of the
+ * integer part that the locale's grouping describes, so that "1,50"
+ * is no amount where the separator is ",".
+ * @param parser The parser for the account
+ * @param str The string to be parsed
+ * @param amount Set to the amount rounded to the account's
+ * commodity, zero for a string that is empty but for a currency symbol
+ * @return TRUE on success, FALSE if str is not an amount
+ */
+gboolean gnc_csv_amount_parser_parse(const GncCsvAmountParser* parser,
+                                     const char* str, gnc_numeric* amount)
+{
+    gint64 mantissa = 0, denom = 1;
+    gboolean negative = FALSE, signed_ = FALSE, digits = FALSE;
+    gboolean fraction = FALSE, currency = FALSE, other = FALSE;
+    int groups[20], n_groups = 0, group = 0;
 
-    /* Put some sane values in retvalue by using the current time for
-     * the non-year-month-day parts of the date. */
-    time(&rawtime);
-    localtime_r(&rawtime, &retvalue);
-    orig_year = retvalue.tm_year;
-
-    /* j traverses pmatch (index 0 contains the entire string, so we
-     * start at index 1 for the first meaningful match). */
-    j = 1;
-    /* Go through the date format and interpret the matches in order of
-     * the sections in the date format. */
-    for (i = 0; date_format_user[format][i]; i++)
+    for ( ; *str; str = g_utf8_next_char(str))
     {
-        char segment_type = date_format_user[format][i];
-        /* Only do something if this is a meaningful character */
-        if (segment_type == 'm' || segment_type == 'd')
-        {
-            /* Copy the matching substring into date_segment so that we can
-             * convert it into an integer. */
-            mem_length = pmatch[j].rm_eo - pmatch[j].rm_so;
-            date_segment = g_new(gchar, mem_length);
-            memcpy(date_segment, date_str + pmatch[j].rm_so, mem_length);
-            date_segment[mem_length] = '\0';
-
-            /* Set the appropriate member of retvalue. Save the original
-             * values so that we can check if the change when we use mktime
-             * below. */
-            switch (segment_type)
-            {
-            case 'm':
-                orig_month = retvalue.tm_mon = atoi(date_segment) - 1;
-                break;
+        gunichar c = g_utf8_get_char(str);
 
-            case 'd':
-                orig_day = retvalue.tm_mday = atoi(date_segment);
-                break;
-            }
-            g_free(date_segment);
-            j++;
+        if (g_ascii_isdigit(*str))
+        {
+            /* Keep 18 digits at most, so that neither overflows. */
+            if (mantissa > (G_MAXINT64 / 10 - 9) || denom > G_MAXINT64 / 10)
+                return FALSE;
+            mantissa = mantissa * 10 + (*str - '0');
+            if (fraction)
+                denom *= 10;
+            else
+                group++;
+            digits = TRUE;
         }
+        else if (c == parser->decimal_point && !fraction)
+            fraction = other = TRUE;
+        else if (c == parser->thousands_sep && group > 0 && !fraction
+                 && n_groups < (int)G_N_ELEMENTS(groups))
+        {
+            groups[n_groups++] = group;
+            group = 0;
+        }
+        else if ((c == '-' || c == '+') && !signed_ && !digits && !fraction)
+        {
+            negative = (c == '-');
+            signed_ = other = TRUE;
+        }
+        else if (g_ascii_isspace(*str) && !digits && !fraction)
+            other = TRUE;
+        else if (!currency && g_unichar_type(c) == G_UNICODE_CURRENCY_SYMBOL)
+            currency = TRUE;
+        else
+            break;
     }
-    /* Convert back to an integer. If mktime leaves retvalue unchanged,
-     * everything is okay; otherwise, an error has occurred. */
-    /* We have to use a "test" date value to account for changes in
-     * daylight savings time, which can cause a date change with mktime
-     * near midnight, causing the code to incorrectly think a date is
-     * incorrect. */
-    test_retvalue = retvalue;
-    mktime(&test_retvalue);
-    retvalue.tm_isdst = test_retvalue.tm_isdst;
-    rawtime = mktime(&retvalue);
-    if (retvalue.tm_mday == orig_day &&
-    retvalue.tm_mon == orig_month &&
-    retvalue.tm_year == orig_year)
-    {
-        return rawtime;
-    }
-    else
+    /* Only spaces may follow the number. */
+    while (g_ascii_isspace(*str))
+        str++;
+    if (*str)
+        return FALSE;
+    if (n_groups > 0 && !amount_grouping_ok(parser, groups, n_groups, group))
+        return FALSE;
+
+    if (!digits)
     {
-        return -1;
+        /* An empty cell has no amount, but is no error. */
+        *amount = gnc_numeric_zero();
+        return !other;
     }
-}
 
-/** Parses a string into a date, given a format. This function
- * requires only knowing the order in which the year, month and day
- * appear. For example, 01-02-2003 will be parsed the same way as
- * 01/02/2003.
- * @param date_str The string containing a date being parsed
- * @param format An index specifying a format in date_format_user
- * @return The parsed value of date_str on success or -1 on failure
- */
-static time_t parse_date(const char* date_str, int format)
-{
-    if (strchr(date_format_user[format], 'y'))
-        return parse_date_with_year(date_str, format);
-    else
-        return parse_date_without_year(date_str, format);
+    *amount = gnc_numeric_convert(gnc_numeric_create(negative ? -mantissa : mantissa,
+                                  denom),
+                                  parser->scu, GNC_HOW_RND_ROUND_HALF_UP);
+    return TRUE;
 }
 
 /** Constructor for GncCsvParseData.
@@ -323,14 +364,17 @@ GncCsvParseData* gnc_csv_new_parse_data(void)
     /* All of the data pointers are initially NULL. This is so that, if
      * gnc_csv_parse_data_free is called before all of the data is
      * initialized, only the data that needs to be freed is freed. */
+    parse_data->filename = NULL;
     parse_data->raw_str.begin = parse_data->raw_str.end
     = parse_data->file_str.begin = parse_data->file_str.end = NULL;
+    parse_data->truncated = parse_data->more_rows = FALSE;
     parse_data->orig_lines = NULL;
     parse_data->orig_row_lengths = NULL;
     parse_data->column_types = NULL;
     parse_data->error_lines = parse_data->transactions = NULL;
     parse_data->options = default_parse_options();
     parse_data->date_format = -1;
+    parse_data->stream_error_rows = 0;
     parse_data->chunk = g_string_chunk_new(100 * 1024);
     return parse_data;
 }
@@ -342,8 +386,10 @@ void gnc_csv_parse_data_free(GncCsvParseData* parse_data)
 {
     /* All non-NULL pointers have been initialized and must be freed. */
 
-    if (parse_data->raw_mapping != NULL)
-        g_mapped_file_free(parse_data->raw_mapping);
+    g_free(parse_data->filename);
+
+    if (parse_data->raw_str.begin != NULL)
+        g_free(parse_data->raw_str.begin);
 
     if (parse_data->file_str.begin != NULL)
         g_free(parse_data->file_str.begin);
@@ -377,7 +423,7 @@ void gnc_csv_parse_data_free(GncCsvParseData* parse_data)
         g_list_free(parse_data->transactions);
     }
 
-    g_free(parse_data->chunk);
+    g_string_chunk_free(parse_data->chunk);
     g_free(parse_data);
 }
 
@@ -417,13 +463,15 @@ GError** error)
     return 0;
 }
 
-/** Loads a file into a GncCsvParseData. This is the first function
- * that must be called after createing a new GncCsvParseData. If this
- * fails because the file couldn't be opened, no more functions can be
- * called on the parse data until this succeeds (or until it fails
- * because of an encoding guess error). If it fails because the
- * encoding could not be guessed, gnc_csv_convert_encoding must be
- * called until it succeeds.
+/** Loads the head of a file into a GncCsvParseData. This is the first
+ * function that must be called after createing a new
+ * GncCsvParseData. Only the first GNC_CSV_HEAD_BYTES of the file are
+ * read, which is plenty for the preview; gnc_csv_stream_to_trans reads
+ * the rest of it a piece at a time. If this fails because the file
+ * couldn't be opened, no more functions can be called on the parse
+ * data until this succeeds (or until it fails because of an encoding
+ * guess error). If it fails because the encoding could not be guessed,
+ * gnc_csv_convert_encoding must be called until it succeeds.
  * @param parse_data Data that is being parsed
  * @param filename Name of the file that should be opened
  * @param error Will contain an error if there is a failure
@@ -433,21 +481,43 @@ int gnc_csv_load_file(GncCsvParseData* parse_data, const char* filename,
 GError** error)
 {
     const char* guess_enc;
+    FILE* file;
+    size_t length;
 
     /* Get the raw data first and handle an error if one occurs. */
-    parse_data->raw_mapping = g_mapped_file_new(filename, FALSE, error);
-    if (parse_data->raw_mapping == NULL)
+    file = g_fopen(filename, "rb");
+    if (file != NULL)
+    {
+        parse_data->raw_str.begin = g_new(char, GNC_CSV_HEAD_BYTES);
+        length = fread(parse_data->raw_str.begin, 1, GNC_CSV_HEAD_BYTES, file);
+        parse_data->truncated = (length == GNC_CSV_HEAD_BYTES && getc(file) != EOF);
+        if (ferror(file))
+        {
+            g_free(parse_data->raw_str.begin);
+            parse_data->raw_str.begin = NULL;
+        }
+        fclose(file);
+    }
+    if (parse_data->raw_str.begin == NULL)
     {
         /* TODO Handle file opening errors more specifically,
          * e.g. inexistent file versus no read permission. */
-        parse_data->raw_str.begin = NULL;
         g_set_error(error, 0, GNC_CSV_FILE_OPEN_ERR, "%s", _("File opening failed."));
         return 1;
     }
+    parse_data->filename = g_strdup(filename);
 
-    /* Copy the mapping's contents into parse-data->raw_str. */
-    parse_data->raw_str.begin = g_mapped_file_get_contents(parse_data->raw_mapping);
-    parse_data->raw_str.end = parse_data->raw_str.begin + g_mapped_file_get_length(parse_data->raw_mapping);
+    /* Don't let the head end in the middle of a character, which would
+     * throw off the guess. */
+    if (parse_data->truncated)
+    {
+        size_t end = length;
+        while (end > 0 && parse_data->raw_str.begin[end - 1] != '\n')
+            end--;
+        if (end > 0)
+            length = end;
+    }
+    parse_data->raw_str.end = parse_data->raw_str.begin + length;
 
     /* Make a guess at the encoding of the data. */
     guess_enc = go_guess_encoding((const char*)(parse_data->raw_str.begin),
@@ -471,7 +541,8 @@ GError** error)
         return 0;
 }
 
-/** Parses a file into cells. This requires having an encoding that
+/** Parses the first rows of a file into cells, at most
+ * GNC_CSV_PREVIEW_ROWS of them. This requires having an encoding that
  * works (see gnc_csv_convert_encoding). parse_data->options should be
  * set according to how the user wants before calling this
  * function. (Note: this function must be called with guessColTypes as
@@ -491,20 +562,38 @@ int gnc_csv_parse(GncCsvParseData* parse_data, gboolean guessColTypes, GError**
     if (parse_data->orig_lines != NULL)
     {
         stf_parse_general_free(parse_data->orig_lines);
+        g_string_chunk_clear(parse_data->chunk);
     }
 
     /* If everything is fine ... */
     if (parse_data->file_str.begin != NULL)
     {
-        /* Do the actual parsing. */
-        parse_data->orig_lines = stf_parse_general(parse_data->options, parse_data->chunk,
+        const char* next;
+
+        /* Do the actual parsing. Unless we have the whole file, the last
+         * row of file_str may be cut short, so it is left to
+         * gnc_csv_stream_to_trans along with the rows after it. */
+        parse_data->orig_lines = stf_parse_general_partial(parse_data->options,
+        parse_data->chunk,
         parse_data->file_str.begin,
-        parse_data->file_str.end);
+        parse_data->file_str.end,
+        GNC_CSV_PREVIEW_ROWS,
+        !parse_data->truncated, &next);
+        parse_data->more_rows = parse_data->truncated
+        || (parse_data->orig_lines != NULL && next < parse_data->file_str.end);
     }
     /* If we couldn't get the encoding right, we just want an empty array. */
     else
     {
         parse_data->orig_lines = g_ptr_array_new();
+        parse_data->more_rows = FALSE;
+    }
+
+    /* If it failed, generate an error. */
+    if (parse_data->orig_lines == NULL)
+    {
+        g_set_error(error, 0, 0, "Parsing failed.");
+        return 1;
     }
 
     /* Record the original row lengths of parse_data->orig_lines. */
@@ -523,13 +612,6 @@ int gnc_csv_parse(GncCsvParseData* parse_data, gboolean guessColTypes, GError**
             parse_data->orig_max_row = length;
     }
 
-    /* If it failed, generate an error. */
-    if (parse_data->orig_lines == NULL)
-    {
-        g_set_error(error, 0, 0, "Parsing failed.");
-        return 1;
-    }
-
     /* Now that we have data, let's set max_cols. */
     for (i = 0; i < parse_data->orig_lines->len; i++)
     {
@@ -572,12 +654,15 @@ int gnc_csv_parse(GncCsvParseData* parse_data, gboolean guessColTypes, GError**
     return 0;
 }
 
-/** A struct containing TransProperties that all describe a single transaction. */
+/** A struct containing TransProperties that all describe a single
+ * transaction. The same list is used for all of the rows, so that
+ * parsing a row allocates nothing. */
 typedef struct
 {
-    int date_format; /**< The format for parsing dates */
+    GncCsvDateParser date_parser; /**< The compiled format for parsing dates */
+    GncCsvAmountParser amount_parser; /**< The separators for parsing amounts */
     Account* account; /**< The account the transaction belongs to */
-    GList* properties; /**< List of TransProperties */
+    GArray* properties; /**< TransProperties of the current row */
 } TransPropertyList;
 
 /** A struct encapsulating a property of a transaction. */
@@ -585,113 +670,43 @@ typedef struct
 {
     int type; /**< A value from the GncCsvColumnType enum except
              * GNC_CSV_NONE and GNC_CSV_NUM_COL_TYPES */
-    void* value; /**< Pointer to the data that will be used to configure a transaction */
-    TransPropertyList* list; /**< The list the property belongs to */
-} TransProperty;
-
-/** Constructor for TransProperty.
- * @param type The type of the new property (see TransProperty.type for possible values)
- */
-static TransProperty* trans_property_new(int type, TransPropertyList* list)
-{
-    TransProperty* prop = g_new(TransProperty, 1);
-    prop->type = type;
-    prop->list = list;
-    prop->value = NULL;
-    return prop;
-}
-
-/** Destructor for TransProperty.
- * @param prop The property to be freed
- */
-static void trans_property_free(TransProperty* prop)
-{
-    switch (prop->type)
+    gboolean value_set; /**< FALSE for an amount cell that was empty */
+    union
     {
-        /* The types for "Date" and "Balance" (time_t and gnc_numeric,
-         * respectively) are typically not pointed to, we have to free
-         * them, unlike types like char* ("Description"). */
-    case GNC_CSV_DATE:
-    case GNC_CSV_BALANCE:
-    case GNC_CSV_DEPOSIT:
-    case GNC_CSV_WITHDRAWAL:
-        if (prop->value != NULL)
-            g_free(prop->value);
-        break;
-    }
-    g_free(prop);
-}
+        time_t date;
+        gnc_numeric amount;
+        const char* str; /**< Points into the row, which outlives the list */
+    } value; /**< The data that will be used to configure a transaction */
+} TransProperty;
 
-/** Sets the value of the property by parsing str. Note: this should
- * only be called once on an instance of TransProperty, as calling it
- * more than once can cause memory leaks.
- * @param prop The property being set
+/** Sets the value of the property by parsing str.
+ * @param list The list the property will be added to
+ * @param prop The property being set; its type must be set
  * @param str The string to be parsed
  * @return TRUE on success, FALSE on failure
  */
-static gboolean trans_property_set(TransProperty* prop, char* str)
+static gboolean trans_property_set(TransPropertyList* list, TransProperty* prop,
+                                   const char* str)
 {
-    char *endptr, *possible_currency_symbol, *str_dupe;
-    double value;
+    prop->value_set = TRUE;
     switch (prop->type)
     {
     case GNC_CSV_DATE:
-        prop->value = g_new(time_t, 1);
-        *((time_t*)(prop->value)) = parse_date(str, prop->list->date_format);
-        return *((time_t*)(prop->value)) != -1;
+        prop->value.date = gnc_csv_date_parser_parse(&list->date_parser, str);
+        return prop->value.date != -1;
 
     case GNC_CSV_DESCRIPTION:
     case GNC_CSV_NUM:
-        prop->value = g_strdup(str);
+        prop->value.str = str;
         return TRUE;
 
     case GNC_CSV_BALANCE:
     case GNC_CSV_DEPOSIT:
     case GNC_CSV_WITHDRAWAL:
-        str_dupe = g_strdup(str); /* First, we make a copy so we can't mess up real data. */
-
-        /* Go through str_dupe looking for currency symbols. */
-        for (possible_currency_symbol = str_dupe; *possible_currency_symbol;
-        possible_currency_symbol = g_utf8_next_char(possible_currency_symbol))
-        {
-            if (g_unichar_type(g_utf8_get_char(possible_currency_symbol)) == G_UNICODE_CURRENCY_SYMBOL)
-            {
-                /* If we find a currency symbol, save the position just ahead
-                 * of the currency symbol (next_symbol), and find the null
-                 * terminator of the string (last_symbol). */
-                char *next_symbol = g_utf8_next_char(possible_currency_symbol), *last_symbol = next_symbol;
-                while (*last_symbol)
-                    last_symbol = g_utf8_next_char(last_symbol);
-
-                /* Move all of the string (including the null byte, which is
-                 * why we have +1 in the size parameter) following the
-                 * currency symbol back one character, thereby overwriting the
-                 * currency symbol. */
-                memmove(possible_currency_symbol, next_symbol, last_symbol - next_symbol + 1);
-                break;
-            }
-        }
-
-        /* Translate the string (now clean of currency symbols) into a number. */
-        value = strtod(str_dupe, &endptr);
-
-        /* If this isn't a valid numeric string, this is an error. */
-        if (endptr != str_dupe + strlen(str_dupe))
-        {
-            g_free(str_dupe);
+        if (!gnc_csv_amount_parser_parse(&list->amount_parser, str,
+                                         &prop->value.amount))
             return FALSE;
-        }
-
-        g_free(str_dupe);
-
-        /* Change abs to fabs, to fix bug 586805 */
-        if (fabs(value) > 0.00001)
-        {
-            prop->value = g_new(gnc_numeric, 1);
-            *((gnc_numeric*)(prop->value)) =
-            double_to_gnc_numeric(value, xaccAccountGetCommoditySCU(prop->list->account),
-            GNC_HOW_RND_ROUND_HALF_UP);
-        }
+        prop->value_set = !gnc_numeric_zero_p(prop->value.amount);
         return TRUE;
     }
     return FALSE; /* We should never actually get here. */
@@ -706,8 +721,10 @@ static TransPropertyList* trans_property_list_new(Account* account, int date_for
 {
     TransPropertyList* list = g_new(TransPropertyList, 1);
     list->account = account;
-    list->date_format = date_format;
-    list->properties = NULL;
+    gnc_csv_date_parser_init(&list->date_parser, date_format);
+    gnc_csv_amount_parser_init(&list->amount_parser,
+                               xaccAccountGetCommoditySCU(account));
+    list->properties = g_array_new(FALSE, FALSE, sizeof(TransProperty));
     return list;
 }
 
@@ -716,27 +733,10 @@ static TransPropertyList* trans_property_list_new(Account* account, int date_for
  */
 static void trans_property_list_free(TransPropertyList* list)
 {
-    /* Free all of the properties in this list before freeeing the list itself. */
-    GList* properties_begin = list->properties;
-    while (list->properties != NULL)
-    {
-        trans_property_free((TransProperty*)(list->properties->data));
-        list->properties = g_list_next(list->properties);
-    }
-    g_list_free(properties_begin);
+    g_array_free(list->properties, TRUE);
     g_free(list);
 }
 
-/** Adds a property to the list it's linked with.
- * (The TransPropertyList is not passed as a parameter because the property is
- * associated with a list when it's constructed.)
- * @param property The property to be added to its list
- */
-static void trans_property_list_add(TransProperty* property)
-{
-    property->list->properties = g_list_append(property->list->properties, property);
-}
-
 /** Adds a split to a transaction.
  * @param trans The transaction to add a split to
  * @param account The account used for the split
@@ -772,12 +772,12 @@ static gboolean trans_property_list_verify_essentials(TransPropertyList* list, g
         N_("No balance, deposit, or withdrawal column.")
     };
     int possible_error_lengths[NUM_OF_POSSIBLE_ERRORS] = {0};
-    GList *properties_begin = list->properties, *errors_list = NULL;
+    GList *errors_list = NULL;
 
     /* Go through each of the properties and erase possible errors. */
-    while (list->properties)
+    for (i = 0; i < list->properties->len; i++)
     {
-        switch (((TransProperty*)(list->properties->data))->type)
+        switch (g_array_index(list->properties, TransProperty, i).type)
         {
         case GNC_CSV_DATE:
             possible_errors[NO_DATE] = NULL;
@@ -789,9 +789,7 @@ static gboolean trans_property_list_verify_essentials(TransPropertyList* list, g
             possible_errors[NO_AMOUNT] = NULL;
             break;
         }
-        list->properties = g_list_next(list->properties);
     }
-    list->properties = properties_begin;
 
     /* Accumulate a list of the actual errors. */
     for (i = 0; i < NUM_OF_POSSIBLE_ERRORS; i++)
@@ -855,11 +853,11 @@ static gboolean trans_property_list_verify_essentials(TransPropertyList* list, g
 static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gchar** error)
 {
     GncCsvTransLine* trans_line = g_new(GncCsvTransLine, 1);
-    GList* properties_begin = list->properties;
     QofBook* book = gnc_account_get_book(list->account);
     gnc_commodity* currency = xaccAccountGetCommodity(list->account);
     gnc_numeric amount = double_to_gnc_numeric(0.0, xaccAccountGetCommoditySCU(list->account),
                          GNC_HOW_RND_ROUND_HALF_UP);
+    guint i;
 
     /* This flag is set to TRUE if we can use the "Deposit" or "Withdrawal" column. */
     gboolean amount_set = FALSE;
@@ -885,28 +883,27 @@ static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gc
     xaccTransSetCurrency(trans_line->trans, currency);
 
     /* Go through each of the properties and edit the transaction accordingly. */
-    list->properties = properties_begin;
-    while (list->properties != NULL)
+    for (i = 0; i < list->properties->len; i++)
     {
-        TransProperty* prop = (TransProperty*)(list->properties->data);
+        TransProperty* prop = &g_array_index(list->properties, TransProperty, i);
         switch (prop->type)
         {
         case GNC_CSV_DATE:
-            xaccTransSetDatePostedSecs(trans_line->trans, *((time_t*)(prop->value)));
+            xaccTransSetDatePostedSecs(trans_line->trans, prop->value.date);
             break;
 
         case GNC_CSV_DESCRIPTION:
-            xaccTransSetDescription(trans_line->trans, (char*)(prop->value));
+            xaccTransSetDescription(trans_line->trans, prop->value.str);
             break;
 
         case GNC_CSV_NUM:
-            xaccTransSetNum(trans_line->trans, (char*)(prop->value));
+            xaccTransSetNum(trans_line->trans, prop->value.str);
             break;
 
         case GNC_CSV_DEPOSIT: /* Add deposits to the existing amount. */
-            if (prop->value != NULL)
+            if (prop->value_set)
             {
-                amount = gnc_numeric_add(*((gnc_numeric*)(prop->value)),
+                amount = gnc_numeric_add(prop->value.amount,
                                          amount,
                                          xaccAccountGetCommoditySCU(list->account),
                                          GNC_HOW_RND_ROUND_HALF_UP);
@@ -917,9 +914,9 @@ static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gc
             break;
 
         case GNC_CSV_WITHDRAWAL: /* Withdrawals are just negative deposits. */
-            if (prop->value != NULL)
+            if (prop->value_set)
             {
-                amount = gnc_numeric_add(gnc_numeric_neg(*((gnc_numeric*)(prop->value))),
+                amount = gnc_numeric_add(gnc_numeric_neg(prop->value.amount),
                                          amount,
                                          xaccAccountGetCommoditySCU(list->account),
                                          GNC_HOW_RND_ROUND_HALF_UP);
@@ -931,15 +928,14 @@ static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gc
 
         case GNC_CSV_BALANCE: /* The balance gets stored in a separate field in trans_line. */
             /* We will use the "Deposit" and "Withdrawal" columns in preference to "Balance". */
-            if (!amount_set && prop->value != NULL)
+            if (!amount_set && prop->value_set)
             {
                 /* This gets put into the actual transaction at the end of gnc_csv_parse_to_trans. */
-                trans_line->balance = *((gnc_numeric*)(prop->value));
+                trans_line->balance = prop->value.amount;
                 trans_line->balance_set = TRUE;
             }
             break;
         }
-        list->properties = g_list_next(list->properties);
     }
 
     /* Add a split with the cumulative amount value. */
@@ -948,6 +944,172 @@ static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gc
     return trans_line;
 }
 
+/** Creates a transaction from a parsed row.
+ * @param list The list used for the properties of the row
+ * @param column_types The types of the columns of the row
+ * @param line The cells of the row
+ * @param error Contains an error message on failure
+ * @return On success, a GncCsvTransLine; on failure, NULL
+ */
+static GncCsvTransLine* trans_property_list_row_to_trans(TransPropertyList* list,
+        GArray* column_types,
+        GPtrArray* line,
+        gchar** error)
+{
+    int j;
+
+    g_array_set_size(list->properties, 0);
+    for (j = 0; j < line->len && j < column_types->len; j++)
+    {
+        /* We do nothing in "None" columns. */
+        if (column_types->data[j] != GNC_CSV_NONE)
+        {
+            /* Affect the transaction appropriately. */
+            TransProperty property;
+            property.type = column_types->data[j];
+            /* TODO Maybe move error handling to within TransPropertyList functions? */
+            if (!trans_property_set(list, &property, line->pdata[j]))
+            {
+                *error = g_strdup_printf(_("%s column could not be understood."),
+                                         _(gnc_csv_column_type_strs[property.type]));
+                return NULL;
+            }
+            g_array_append_val(list->properties, property);
+        }
+    }
+    return trans_property_list_to_trans(list, error);
+}
+
+/** Adds a transaction to a list of transactions sorted by date.
+ * @param transactions The list
+ * @param last_transaction The last element of the list, or NULL if it is empty
+ * @param trans_line The transaction to add
+ */
+static void trans_line_list_insert(GList** transactions, GList** last_transaction,
+                                   GncCsvTransLine* trans_line)
+{
+    /* We start at the end of the list and go backward, simply because
+     * the file itself is probably also sorted by date (but we need to
+     * handle the exception anyway). */
+
+    /* If we can just put it at the end, do so and increment last_transaction. */
+    if (*last_transaction == NULL ||
+            xaccTransGetDate(((GncCsvTransLine*)((*last_transaction)->data))->trans) <= xaccTransGetDate(trans_line->trans))
+    {
+        /* If this is the first transaction, we need to get last_transaction on track. */
+        if (*last_transaction == NULL)
+        {
+            *transactions = g_list_append(NULL, trans_line);
+            *last_transaction = *transactions;
+        }
+        else /* Otherwise, we can just continue, without walking the whole list. */
+        {
+            g_list_append(*last_transaction, trans_line);
+            *last_transaction = g_list_next(*last_transaction);
+        }
+    }
+    /* Otherwise, search backward for the correct spot. */
+    else
+    {
+        GList* insertion_spot = *last_transaction;
+        while (insertion_spot != NULL &&
+                xaccTransGetDate(((GncCsvTransLine*)(insertion_spot->data))->trans) > xaccTransGetDate(trans_line->trans))
+        {
+            insertion_spot = g_list_previous(insertion_spot);
+        }
+        /* Move insertion_spot one location forward since we have to
+         * use the g_list_insert_before function. */
+        if (insertion_spot == NULL) /* We need to handle the case of inserting at the beginning of the list. */
+            insertion_spot = *transactions;
+        else
+            insertion_spot = g_list_next(insertion_spot);
+
+        *transactions = g_list_insert_before(*transactions, insertion_spot, trans_line);
+    }
+}
+
+/** Tells whether one of the columns is a balance column.
+ * @param column_types The types of the columns
+ * @return TRUE if there is a GNC_CSV_BALANCE column
+ */
+static gboolean column_types_have_balance(GArray* column_types)
+{
+    int i;
+
+    for (i = 0; i < column_types->len; i++)
+    {
+        if (column_types->data[i] == GNC_CSV_BALANCE)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/** Compares two transactions by date, for g_list_sort.
+ * @param a The first GncCsvTransLine
+ * @param b The second GncCsvTransLine
+ * @return Less than, equal to or greater than 0 as a is before, at or after b
+ */
+static gint trans_line_date_compare(gconstpointer a, gconstpointer b)
+{
+    time_t date_a = xaccTransGetDate(((const GncCsvTransLine*)a)->trans);
+    time_t date_b = xaccTransGetDate(((const GncCsvTransLine*)b)->trans);
+    return (date_a > date_b) - (date_a < date_b);
+}
+
+/** Sets the amounts of the transactions that only have a balance to
+ * the difference from the balance before them. As every amount depends
+ * on all the transactions before it, this has to be given all of the
+ * transactions of the file at once.
+ * @param transactions All the transactions, sorted by date
+ * @param account Account with which transactions are created
+ */
+static void trans_line_list_set_balances(GList* transactions, Account* account)
+{
+    /* balance_offset is how much the balance currently in the account
+     * differs from what it will be after the transactions are
+     * imported. This will be sum of all the previous transactions for
+     * any given transaction. */
+    gnc_numeric balance_offset = double_to_gnc_numeric(0.0,
+                                 xaccAccountGetCommoditySCU(account),
+                                 GNC_HOW_RND_ROUND_HALF_UP);
+    while (transactions != NULL)
+    {
+        GncCsvTransLine* trans_line = (GncCsvTransLine*)transactions->data;
+        if (trans_line->balance_set)
+        {
+            time_t date = xaccTransGetDate(trans_line->trans);
+            /* Find what the balance should be by adding the offset to the actual balance. */
+            gnc_numeric existing_balance = gnc_numeric_add(balance_offset,
+                                           xaccAccountGetBalanceAsOfDate(account, date),
+                                           xaccAccountGetCommoditySCU(account),
+                                           GNC_HOW_RND_ROUND_HALF_UP);
+
+            /* The amount of the transaction is the difference between the new and existing balance. */
+            gnc_numeric amount = gnc_numeric_sub(trans_line->balance,
+                                                 existing_balance,
+                                                 xaccAccountGetCommoditySCU(account),
+                                                 GNC_HOW_RND_ROUND_HALF_UP);
+
+            SplitList* splits = xaccTransGetSplitList(trans_line->trans);
+            while (splits)
+            {
+                SplitList* next_splits = g_list_next(splits);
+                xaccSplitDestroy((Split*)splits->data);
+                splits = next_splits;
+            }
+
+            trans_add_split(trans_line->trans, account, gnc_account_get_book(account), amount);
+
+            /* This new transaction needs to be added to the balance offset. */
+            balance_offset = gnc_numeric_add(balance_offset,
+                                              amount,
+                                              xaccAccountGetCommoditySCU(account),
+                                              GNC_HOW_RND_ROUND_HALF_UP);
+        }
+        transactions = g_list_next(transactions);
+    }
+}
+
 /** Creates a list of transactions from parsed data. Transactions that
  * could be created from rows are placed in parse_data->transactions;
  * rows that fail are placed in parse_data->error_lines. (Note: there
@@ -961,10 +1123,9 @@ static GncCsvTransLine* trans_property_list_to_trans(TransPropertyList* list, gc
 int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
                            gboolean redo_errors)
 {
-    gboolean hasBalanceColumn;
-    int i, j, max_cols = 0;
-    GArray* column_types = parse_data->column_types;
+    int i, max_cols = 0;
     GList *error_lines = NULL, *begin_error_lines = NULL;
+    TransPropertyList* list;
 
     /* last_transaction points to the last element in
      * parse_data->transactions, or NULL if it's empty. */
@@ -985,10 +1146,15 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
         if (parse_data->transactions != NULL)
         {
             g_list_free(parse_data->transactions);
+            parse_data->transactions = NULL;
         }
     }
     parse_data->error_lines = NULL;
 
+    /* The date format and the separators are worked out once for all
+     * of the rows. */
+    list = trans_property_list_new(account, parse_data->date_format);
+
     if (redo_errors) /* If we're looking only at error data ... */
     {
         if (parse_data->transactions == NULL)
@@ -998,11 +1164,7 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
         else
         {
             /* Move last_transaction to the end. */
-            last_transaction = parse_data->transactions;
-            while (g_list_next(last_transaction) != NULL)
-            {
-                last_transaction = g_list_next(last_transaction);
-            }
+            last_transaction = g_list_last(parse_data->transactions);
         }
         /* ... we use only the lines in error_lines. */
         if (error_lines == NULL)
@@ -1020,50 +1182,17 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
     while (i < parse_data->orig_lines->len)
     {
         GPtrArray* line = parse_data->orig_lines->pdata[i];
-        /* This flag is TRUE if there are any errors in this row. */
-        gboolean errors = FALSE;
         gchar* error_message = NULL;
-        TransPropertyList* list = trans_property_list_new(account, parse_data->date_format);
-        GncCsvTransLine* trans_line = NULL;
-
-        for (j = 0; j < line->len; j++)
-        {
-            /* We do nothing in "None" columns. */
-            if (column_types->data[j] != GNC_CSV_NONE)
-            {
-                /* Affect the transaction appropriately. */
-                TransProperty* property = trans_property_new(column_types->data[j], list);
-                gboolean succeeded = trans_property_set(property, line->pdata[j]);
-                /* TODO Maybe move error handling to within TransPropertyList functions? */
-                if (succeeded)
-                {
-                    trans_property_list_add(property);
-                }
-                else
-                {
-                    errors = TRUE;
-                    error_message = g_strdup_printf(_("%s column could not be understood."),
-                                                    _(gnc_csv_column_type_strs[property->type]));
-                    trans_property_free(property);
-                    break;
-                }
-            }
-        }
-
-        /* If we had success, add the transaction to parse_data->transaction. */
-        if (!errors)
-        {
-            trans_line = trans_property_list_to_trans(list, &error_message);
-            errors = trans_line == NULL;
-        }
+        GncCsvTransLine* trans_line = trans_property_list_row_to_trans(list,
+                                      parse_data->column_types,
+                                      line, &error_message);
 
-        trans_property_list_free(list);
-
-        /* If there were errors, add this line to parse_data->error_lines. */
-        if (errors)
+        /* If there were errors, add this line to parse_data->error_lines
+         * (which is reversed at the end). */
+        if (trans_line == NULL)
         {
-            parse_data->error_lines = g_list_append(parse_data->error_lines,
-                                                    GINT_TO_POINTER(i));
+            parse_data->error_lines = g_list_prepend(parse_data->error_lines,
+                                     GINT_TO_POINTER(i));
             /* If there's already an error message, we need to replace it. */
             if (line->len > (int)(parse_data->orig_row_lengths->data[i]))
             {
@@ -1078,43 +1207,11 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
         }
         else
         {
-            /* If all went well, add this transaction to the list. */
+            /* If all went well, add this transaction to the list, which
+             * we keep sorted by date. */
             trans_line->line_no = i;
-
-            /* We keep the transactions sorted by date. We start at the end
-             * of the list and go backward, simply because the file itself
-             * is probably also sorted by date (but we need to handle the
-             * exception anyway). */
-
-            /* If we can just put it at the end, do so and increment last_transaction. */
-            if (last_transaction == NULL ||
-                    xaccTransGetDate(((GncCsvTransLine*)(last_transaction->data))->trans) <= xaccTransGetDate(trans_line->trans))
-            {
-                parse_data->transactions = g_list_append(parse_data->transactions, trans_line);
-                /* If this is the first transaction, we need to get last_transaction on track. */
-                if (last_transaction == NULL)
-                    last_transaction = parse_data->transactions;
-                else /* Otherwise, we can just continue. */
-                    last_transaction = g_list_next(last_transaction);
-            }
-            /* Otherwise, search backward for the correct spot. */
-            else
-            {
-                GList* insertion_spot = last_transaction;
-                while (insertion_spot != NULL &&
-                        xaccTransGetDate(((GncCsvTransLine*)(insertion_spot->data))->trans) > xaccTransGetDate(trans_line->trans))
-                {
-                    insertion_spot = g_list_previous(insertion_spot);
-                }
-                /* Move insertion_spot one location forward since we have to
-                 * use the g_list_insert_before function. */
-                if (insertion_spot == NULL) /* We need to handle the case of inserting at the beginning of the list. */
-                    insertion_spot = parse_data->transactions;
-                else
-                    insertion_spot = g_list_next(insertion_spot);
-
-                parse_data->transactions = g_list_insert_before(parse_data->transactions, insertion_spot, trans_line);
-            }
+            trans_line_list_insert(&parse_data->transactions, &last_transaction,
+                                   trans_line);
         }
 
         /* Increment to the next row. */
@@ -1133,64 +1230,15 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
         }
     }
 
-    /* If we have a balance column, set the appropriate amounts on the transactions. */
-    hasBalanceColumn = FALSE;
-    for (i = 0; i < parse_data->column_types->len; i++)
-    {
-        if (parse_data->column_types->data[i] == GNC_CSV_BALANCE)
-        {
-            hasBalanceColumn = TRUE;
-            break;
-        }
-    }
+    trans_property_list_free(list);
+    parse_data->error_lines = g_list_reverse(parse_data->error_lines);
 
-    if (hasBalanceColumn)
+    /* If we have a balance column, set the appropriate amounts on the
+     * transactions. If the file goes on after the preview,
+     * gnc_csv_stream_to_trans works them out again with the rest. */
+    if (column_types_have_balance(parse_data->column_types))
     {
-        GList* transactions = parse_data->transactions;
-
-        /* balance_offset is how much the balance currently in the account
-         * differs from what it will be after the transactions are
-         * imported. This will be sum of all the previous transactions for
-         * any given transaction. */
-        gnc_numeric balance_offset = double_to_gnc_numeric(0.0,
-                                     xaccAccountGetCommoditySCU(account),
-                                     GNC_HOW_RND_ROUND_HALF_UP);
-        while (transactions != NULL)
-        {
-            GncCsvTransLine* trans_line = (GncCsvTransLine*)transactions->data;
-            if (trans_line->balance_set)
-            {
-                time_t date = xaccTransGetDate(trans_line->trans);
-                /* Find what the balance should be by adding the offset to the actual balance. */
-                gnc_numeric existing_balance = gnc_numeric_add(balance_offset,
-                                               xaccAccountGetBalanceAsOfDate(account, date),
-                                               xaccAccountGetCommoditySCU(account),
-                                               GNC_HOW_RND_ROUND_HALF_UP);
-
-                /* The amount of the transaction is the difference between the new and existing balance. */
-                gnc_numeric amount = gnc_numeric_sub(trans_line->balance,
-                                                     existing_balance,
-                                                     xaccAccountGetCommoditySCU(account),
-                                                     GNC_HOW_RND_ROUND_HALF_UP);
-
-                SplitList* splits = xaccTransGetSplitList(trans_line->trans);
-                while (splits)
-                {
-                    SplitList* next_splits = g_list_next(splits);
-                    xaccSplitDestroy((Split*)splits->data);
-                    splits = next_splits;
-                }
-
-                trans_add_split(trans_line->trans, account, gnc_account_get_book(account), amount);
-
-                /* This new transaction needs to be added to the balance offset. */
-                balance_offset = gnc_numeric_add(balance_offset,
-                                                 amount,
-                                                 xaccAccountGetCommoditySCU(account),
-                                                 GNC_HOW_RND_ROUND_HALF_UP);
-            }
-            transactions = g_list_next(transactions);
-        }
+        trans_line_list_set_balances(parse_data->transactions, account);
     }
 
     if (redo_errors) /* Now that we're at the end, we do the freeing. */
@@ -1213,3 +1261,176 @@ int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account,
 
     return 0;
 }
+
+/** Creates transactions from the rows of the file after the ones in
+ * parse_data->orig_lines, that is, the rows gnc_csv_parse left out of
+ * the preview. The file is read and converted GNC_CSV_STREAM_BYTES at
+ * a time, and the transactions made from each piece are handed to func
+ * before the next one is read, so that the memory used does not grow
+ * with the size of the file. The pieces are sorted by date one by
+ * one. Rows with errors are skipped and counted in
+ * parse_data->stream_error_rows. This must be called after
+ * gnc_csv_parse_to_trans, with the same account.
+ *
+ * The amounts from a balance column depend on every transaction before
+ * them in date order, wherever in the file those are. So if there is a
+ * balance column, all the transactions are kept until the end of the
+ * file, sorted together with parse_data->transactions, and the amounts
+ * of both are worked out again before any is handed to func. The
+ * transactions of parse_data->transactions should then only be used
+ * after this returns.
+ * @param parse_data Data that is being parsed
+ * @param account Account with which transactions are created
+ * @param func Function that gets each transaction
+ * @param user_data Data passed to func
+ * @param error Will contain an error if there is a failure
+ * @return 0 on success, 1 on failure
+ */
+int gnc_csv_stream_to_trans(GncCsvParseData* parse_data, Account* account,
+                            GncCsvTransFunc func, gpointer user_data,
+                            GError** error)
+{
+    /* The rows in orig_lines have already been dealt with. */
+    int line_no = 0, skip_rows = parse_data->orig_lines->len, result = 0;
+    gboolean at_eof = FALSE, has_balance;
+    GList *held = NULL, *node;
+    GString *raw, *text;
+    GStringChunk* chunk;
+    TransPropertyList* list;
+    GIConv converter;
+    FILE* file;
+
+    parse_data->stream_error_rows = 0;
+    if (!parse_data->more_rows)
+        return 0;
+
+    file = g_fopen(parse_data->filename, "rb");
+    if (file == NULL)
+    {
+        g_set_error(error, 0, GNC_CSV_FILE_OPEN_ERR, "%s", _("File opening failed."));
+        return 1;
+    }
+    converter = g_iconv_open("UTF-8", parse_data->encoding);
+    if (converter == (GIConv) - 1)
+    {
+        fclose(file);
+        g_set_error(error, 0, GNC_CSV_ENCODING_ERR, "%s", _("Unknown encoding."));
+        return 1;
+    }
+
+    raw = g_string_sized_new(GNC_CSV_STREAM_BYTES);
+    text = g_string_sized_new(2 * GNC_CSV_STREAM_BYTES);
+    chunk = g_string_chunk_new(GNC_CSV_STREAM_BYTES);
+    list = trans_property_list_new(account, parse_data->date_format);
+    has_balance = column_types_have_balance(parse_data->column_types);
+
+    while (!at_eof)
+    {
+        gsize kept = raw->len, length, bytes_read, bytes_written;
+        GList *transactions = NULL, *last_transaction = NULL;
+        const char* next;
+        GPtrArray* lines;
+        gchar* converted;
+        int i;
+
+        /* Read the next piece after what is left of the last one,
+         * which is at most the start of a character. */
+        g_string_set_size(raw, kept + GNC_CSV_STREAM_BYTES);
+        length = fread(raw->str + kept, 1, GNC_CSV_STREAM_BYTES, file);
+        g_string_set_size(raw, kept + length);
+        if (ferror(file))
+        {
+            g_set_error(error, 0, GNC_CSV_FILE_OPEN_ERR, "%s", _("File opening failed."));
+            result = 1;
+            break;
+        }
+        at_eof = (length < GNC_CSV_STREAM_BYTES);
+
+        /* Translate as much as there are whole characters for; the
+         * rest waits for the next piece, or is dropped at the end as
+         * gnc_csv_convert_encoding does. */
+        converted = g_convert_with_iconv(raw->str, raw->len, converter,
+                                         &bytes_read, &bytes_written, error);
+        if (converted == NULL)
+        {
+            result = 1;
+            break;
+        }
+        g_string_append_len(text, converted, bytes_written);
+        g_free(converted);
+        g_string_erase(raw, 0, bytes_read);
+
+        /* Parse the complete rows, leaving the one that runs into the
+         * end of the text unless the file has ended. */
+        lines = stf_parse_general_partial(parse_data->options, chunk, text->str,
+                                          text->str + text->len, G_MAXINT,
+                                          at_eof, &next);
+        if (lines == NULL)
+        {
+            g_set_error(error, 0, 0, "Parsing failed.");
+            result = 1;
+            break;
+        }
+
+        for (i = 0; i < lines->len; i++, line_no++)
+        {
+            GncCsvTransLine* trans_line;
+            gchar* error_message = NULL;
+
+            if (line_no < skip_rows)
+                continue;
+            trans_line = trans_property_list_row_to_trans(list,
+                         parse_data->column_types,
+                         lines->pdata[i], &error_message);
+            if (trans_line == NULL)
+            {
+                g_free(error_message);
+                parse_data->stream_error_rows++;
+                continue;
+            }
+            trans_line->line_no = line_no;
+            if (has_balance)
+                held = g_list_prepend(held, trans_line);
+            else
+                trans_line_list_insert(&transactions, &last_transaction, trans_line);
+        }
+        stf_parse_general_free(lines);
+        g_string_chunk_clear(chunk);
+        g_string_erase(text, 0, next - text->str);
+
+        for (node = transactions; node != NULL; node = g_list_next(node))
+        {
+            GncCsvTransLine* trans_line = node->data;
+            func(trans_line->trans, user_data);
+            g_free(trans_line);
+        }
+        g_list_free(transactions);
+    }
+
+    if (has_balance)
+    {
+        /* g_list_sort is stable, and the preview rows come first, so
+         * rows of the same date stay in the order of the file. */
+        GList* all = g_list_concat(g_list_copy(parse_data->transactions),
+                                   g_list_reverse(held));
+        all = g_list_sort(all, trans_line_date_compare);
+        trans_line_list_set_balances(all, account);
+        for (node = all; node != NULL; node = g_list_next(node))
+        {
+            GncCsvTransLine* trans_line = node->data;
+            if (trans_line->line_no < skip_rows)
+                continue;
+            func(trans_line->trans, user_data);
+            g_free(trans_line);
+        }
+        g_list_free(all);
+    }
+
+    trans_property_list_free(list);
+    g_string_chunk_free(chunk);
+    g_string_free(text, TRUE);
+    g_string_free(raw, TRUE);
+    g_iconv_close(converter);
+    fclose(file);
+    return result;
+}
@@ -82,6 +82,14 @@ typedef struct
     gboolean balance_set; /**< TRUE if balance has been set from user data, FALSE otherwise */
 } GncCsvTransLine;
 
+/** The most rows gnc_csv_parse reads for the preview; the rest of the
+ * file is left for gnc_csv_stream_to_trans. */
+#define GNC_CSV_PREVIEW_ROWS 10000
+/** How much of the file gnc_csv_load_file reads for the preview */
+#define GNC_CSV_HEAD_BYTES (2 * 1024 * 1024)
+/** How much of the file gnc_csv_stream_to_trans reads at a time */
+#define GNC_CSV_STREAM_BYTES (256 * 1024)
+
 extern const int num_date_formats;
 /* A set of date formats that the user sees. */
 extern const gchar* date_format_user[];
@@ -93,10 +101,13 @@ extern gchar* gnc_csv_column_type_strs[];
 typedef struct
 {
     gchar* encoding;
-    GMappedFile* raw_mapping; /**< The mapping containing raw_str */
-    GncCsvStr raw_str; /**< Untouched data from the file as a string */
+    gchar* filename; /**< The file, which gnc_csv_stream_to_trans reads again */
+    GncCsvStr raw_str; /**< Untouched data from the head of the file as a string */
+    gboolean truncated; /**< TRUE if raw_str is not the whole file */
     GncCsvStr file_str; /**< raw_str translated into UTF-8 */
-    GPtrArray* orig_lines; /**< file_str parsed into a two-dimensional array of strings */
+    GPtrArray* orig_lines; /**< The first rows of file_str parsed into a
+                            * two-dimensional array of strings */
+    gboolean more_rows; /**< TRUE if the file has rows after orig_lines */
     GArray* orig_row_lengths; /**< The lengths of rows in orig_lines
                              * before error messages are appended */
     int orig_max_row; /**< Holds the maximum value in orig_row_lengths */
@@ -106,8 +117,41 @@ typedef struct
     GList* error_lines; /**< List of row numbers in orig_lines that have errors */
     GList* transactions; /**< List of GncCsvTransLine*s created using orig_lines and column_types */
     int date_format; /**< The format of the text in the date columns from date_format_internal. */
+    int stream_error_rows; /**< The rows gnc_csv_stream_to_trans had to skip */
 } GncCsvParseData;
 
+/** The function gnc_csv_stream_to_trans hands each transaction to. */
+typedef void (*GncCsvTransFunc)(Transaction* trans, gpointer user_data);
+
+/** A date format from date_format_user compiled for parsing a whole
+ * column, see gnc_csv_date_parser_init. */
+typedef struct
+{
+    int n_fields; /**< 3 for a format with a year, 2 otherwise */
+    char order[3]; /**< 'y', 'm' and 'd' in the order they appear in the format */
+    struct tm now; /**< Supplies the time of day, and the year of formats without one */
+    int last_year, last_month, last_day; /**< The last date converted ... */
+    time_t last_time; /**< ... and what it was converted to */
+} GncCsvDateParser;
+
+/** The separators for parsing amounts, taken from the locale once. */
+typedef struct
+{
+    gunichar decimal_point;
+    gunichar thousands_sep;
+    char grouping[8]; /**< The sizes of the digit groups, as in struct lconv */
+    int scu; /**< The amounts get rounded to 1/scu */
+} GncCsvAmountParser;
+
+void gnc_csv_date_parser_init(GncCsvDateParser* parser, int format);
+
+time_t gnc_csv_date_parser_parse(GncCsvDateParser* parser, const char* date_str);
+
+void gnc_csv_amount_parser_init(GncCsvAmountParser* parser, int scu);
+
+gboolean gnc_csv_amount_parser_parse(const GncCsvAmountParser* parser,
+                                     const char* str, gnc_numeric* amount);
+
 GncCsvParseData* gnc_csv_new_parse_data(void);
 
 void gnc_csv_parse_data_free(GncCsvParseData* parse_data);
@@ -121,4 +165,8 @@ int gnc_csv_parse(GncCsvParseData* parse_data, gboolean guessColTypes, GError**
 
 int gnc_csv_parse_to_trans(GncCsvParseData* parse_data, Account* account, gboolean redo_errors);
 
+int gnc_csv_stream_to_trans(GncCsvParseData* parse_data, Account* account,
+                            GncCsvTransFunc func, gpointer user_data,
+                            GError** error);
+
 #endif
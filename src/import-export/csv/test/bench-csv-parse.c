@@ -0,0 +1,159 @@
+/***************************************************************************
+ *            bench-csv-parse.c
+ *
+ *  Time the conversion of a csv statement into transactions, both for
+ *  the preview and streamed a piece at a time.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file bench-csv-parse.c
+ * @brief Print the rows per second of the steps test-csv-parse checks.
+ *
+ * This is not run by "make check".  A statement with a date,
+ * description, num, deposit and withdrawal column is written to a
+ * temporary file, and the rows per second of gnc_csv_parse,
+ * gnc_csv_parse_to_trans and gnc_csv_stream_to_trans are printed.
+ * Pass a row count to time bigger files, e.g. "bench-csv-parse 300000".
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "qof.h"
+#include "cashobjects.h"
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-csv-model.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define DEFAULT_ROWS 100000
+
+static gboolean
+write_statement (const gchar* filename, guint rows)
+{
+    FILE* out = g_fopen (filename, "w");
+    GDate date;
+    guint i;
+
+    if (!out)
+        return FALSE;
+    g_date_clear (&date, 1);
+    for (i = 0; i < rows; i++)
+    {
+        gint64 cents = get_random_int_in_range (1, 10000000);
+
+        g_date_set_dmy (&date, 1, G_DATE_JANUARY, 2000);
+        g_date_add_days (&date, (guint)((guint64)i * 3650 / rows));
+        fprintf (out, "%04d-%02d-%02d,\"Payee %u, Inc.\",%u,%s%" G_GINT64_FORMAT ".%02d,%s\n",
+                 g_date_get_year (&date), g_date_get_month (&date),
+                 g_date_get_day (&date), i, i, (i % 2) ? "$" : "",
+                 cents / 100, (int)(cents % 100), (i % 3) ? "" : "12.00");
+    }
+    return fclose (out) == 0;
+}
+
+static void
+count_row (Transaction* trans, gpointer user_data)
+{
+    (*(guint*)user_data)++;
+}
+
+static void
+bench_statement (guint rows)
+{
+    QofBook* book = qof_book_new ();
+    gnc_commodity* usd = gnc_commodity_table_lookup
+                         (gnc_commodity_table_get_table (book),
+                          GNC_COMMODITY_NS_CURRENCY, "USD");
+    Account* acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, "Bank");
+    gchar* filename = g_strdup_printf ("%s/bench-csv-parse-%d.csv",
+                                       g_get_tmp_dir (), (int)getpid ());
+    guint preview_rows = MIN (rows, GNC_CSV_PREVIEW_ROWS);
+    GncCsvParseData* parse_data;
+    GError* error = NULL;
+    gdouble parse_time, trans_time, stream_time;
+    guint streamed = 0;
+    GTimer* timer;
+
+    if (!write_statement (filename, rows))
+    {
+        fprintf (stderr, "writing %s failed\n", filename);
+        g_free (filename);
+        qof_book_destroy (book);
+        return;
+    }
+
+    parse_data = gnc_csv_new_parse_data ();
+    gnc_csv_load_file (parse_data, filename, &error);
+    timer = g_timer_new ();
+    gnc_csv_parse (parse_data, TRUE, &error);
+    parse_time = g_timer_elapsed (timer, NULL);
+
+    parse_data->column_types->data[0] = GNC_CSV_DATE;
+    parse_data->column_types->data[1] = GNC_CSV_DESCRIPTION;
+    parse_data->column_types->data[2] = GNC_CSV_NUM;
+    parse_data->column_types->data[3] = GNC_CSV_DEPOSIT;
+    parse_data->column_types->data[4] = GNC_CSV_WITHDRAWAL;
+    parse_data->date_format = 0;
+
+    g_timer_start (timer);
+    gnc_csv_parse_to_trans (parse_data, acc, FALSE);
+    trans_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    gnc_csv_stream_to_trans (parse_data, acc, count_row, &streamed, &error);
+    stream_time = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    printf ("%8u rows: parse %10.0f rows/s, to transactions %10.0f rows/s, "
+            "streamed %10.0f rows/s\n", rows,
+            preview_rows / MAX (parse_time, 1e-6),
+            preview_rows / MAX (trans_time, 1e-6),
+            streamed / MAX (stream_time, 1e-6));
+
+    gnc_csv_parse_data_free (parse_data);
+    g_unlink (filename);
+    g_free (filename);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char** argv)
+{
+    guint rows = DEFAULT_ROWS;
+
+    if (argc > 1)
+        rows = MAX (atoi (argv[1]), 1);
+
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        bench_statement (rows);
+    }
+    qof_close ();
+    return 0;
+}
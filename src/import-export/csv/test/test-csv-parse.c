@@ -0,0 +1,575 @@
+/***************************************************************************
+ *            test-csv-parse.c
+ *
+ *  Check the date and amount parsers of the csv importer and the
+ *  conversion of a file into transactions, both for the preview and
+ *  streamed a piece at a time.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+/**
+ * @file test-csv-parse.c
+ * @brief Parse dates, amounts and a synthetic statement.
+ *
+ * The dates of every format in date_format_user and a set of amounts
+ * are checked against their expected values, and a text cut in two
+ * anywhere has to give the same rows as the whole of it.  Then a
+ * statement with a date, description, num, deposit and withdrawal
+ * column is written to a temporary file and loaded.  The rows of the
+ * preview are turned into transactions by gnc_csv_parse_to_trans and
+ * the rest by gnc_csv_stream_to_trans, and together they have to add
+ * up to the statement.  A statement with only a balance column, newest
+ * first and longer than the preview, has to give every transaction the
+ * amount it was written with.  bench-csv-parse times the conversion.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "qof.h"
+#include "cashobjects.h"
+#include "TransLog.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-csv-model.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_ROWS 20000
+
+typedef struct
+{
+    int format;
+    const char* str;
+    int year, month, day; /* day 0 for a string that must fail */
+} DateCase;
+
+/* A year of -1 stands for the current year, which the formats without
+ * a year use. */
+static const DateCase date_cases[] =
+{
+    { 0, "1999-12-31", 1999, 12, 31 },
+    { 0, " 2001 / 6 . 17 trailing text", 2001, 6, 17 },
+    { 0, "20020726", 2002, 7, 26 },
+    { 0, "99/1/6", 1999, 1, 6 },
+    { 0, "04'3'5", 2004, 3, 5 },
+    { 0, "2001-02-29", 0, 0, 0 },
+    { 0, "2001-13-01", 0, 0, 0 },
+    { 0, "2001-1", 0, 0, 0 },
+    { 0, "12345-1-1", 0, 0, 0 },
+    { 0, "", 0, 0, 0 },
+    { 1, "31-12-1999", 1999, 12, 31 },
+    { 1, "17011976", 1976, 1, 17 },
+    { 1, "1.2.68", 2068, 2, 1 },
+    { 1, "1.2.69", 1969, 2, 1 },
+    { 2, "12/31/1999", 1999, 12, 31 },
+    { 2, "01171983", 1983, 1, 17 },
+    { 3, "17-6", -1, 6, 17 },
+    { 3, "31/4", 0, 0, 0 },
+    { 3, "1706", 0, 0, 0 },
+    { 4, "6/17", -1, 6, 17 },
+    { 4, " 12 - 1 ", -1, 12, 1 },
+};
+
+typedef struct
+{
+    const char* str;
+    gboolean valid;
+    gint64 hundredths;
+} AmountCase;
+
+static const AmountCase amount_cases[] =
+{
+    { "12.34", TRUE, 1234 },
+    { "-12.5", TRUE, -1250 },
+    { "+3", TRUE, 300 },
+    { "$1,234.56", TRUE, 123456 },
+    { "-$1,000,000.01", TRUE, -100000001 },
+    { "1 234.00", FALSE, 0 },
+    { "1.005", TRUE, 101 },
+    { "-0.004", TRUE, 0 },
+    { " 7.10 ", TRUE, 710 },
+    { "\xe2\x82\xac" "5", TRUE, 500 },
+    { "", TRUE, 0 },
+    { "$", TRUE, 0 },
+    { " ", FALSE, 0 },
+    { "-", FALSE, 0 },
+    { "1.2.3", FALSE, 0 },
+    { "12abc", FALSE, 0 },
+    { "1234567890123456789012", FALSE, 0 },
+    { "1,234", TRUE, 123400 },
+    { "123,456.7", TRUE, 12345670 },
+    { "1,50", FALSE, 0 },
+    { "1,2345", FALSE, 0 },
+    { "12,34,567", FALSE, 0 },
+    { "1,234,", FALSE, 0 },
+    { "1,,234", FALSE, 0 },
+    { ",123", FALSE, 0 },
+    { "1.234,5", FALSE, 0 },
+};
+
+/* Parsed with "," as the decimal point and "." between groups of 3. */
+static const AmountCase comma_amount_cases[] =
+{
+    { "12,50", TRUE, 1250 },
+    { "1.234,56", TRUE, 123456 },
+    { "-1.000.000", TRUE, -100000000 },
+    { "12.50", FALSE, 0 },
+    { "1.2345,6", FALSE, 0 },
+};
+
+/* Parsed with a group of 3 and then groups of 2, as in India. */
+static const AmountCase lakh_amount_cases[] =
+{
+    { "12,34,567.89", TRUE, 123456789 },
+    { "1,00,000", TRUE, 10000000 },
+    { "123,456", FALSE, 0 },
+    { "1,2,345", FALSE, 0 },
+};
+
+static void
+test_dates (void)
+{
+    GDate today;
+    guint i;
+
+    g_date_clear (&today, 1);
+    g_date_set_time_t (&today, time (NULL));
+    for (i = 0; i < G_N_ELEMENTS (date_cases); i++)
+    {
+        const DateCase* dc = &date_cases[i];
+        GncCsvDateParser parser;
+        gchar* title = g_strdup_printf ("date \"%s\" as %s", dc->str,
+                                        date_format_user[dc->format]);
+        time_t t;
+
+        gnc_csv_date_parser_init (&parser, dc->format);
+        t = gnc_csv_date_parser_parse (&parser, dc->str);
+        if (dc->day == 0)
+        {
+            do_test (t == -1, title);
+        }
+        else
+        {
+            GDate date;
+            int year = dc->year < 0 ? g_date_get_year (&today) : dc->year;
+
+            g_date_clear (&date, 1);
+            g_date_set_time_t (&date, t);
+            do_test (t != -1 && g_date_get_year (&date) == year
+                     && g_date_get_month (&date) == dc->month
+                     && g_date_get_day (&date) == dc->day, title);
+            /* The second time around it comes from the parser's cache */
+            do_test (gnc_csv_date_parser_parse (&parser, dc->str) == t, title);
+        }
+        g_free (title);
+    }
+}
+
+static void
+test_amount_cases (const GncCsvAmountParser* parser, const AmountCase* cases,
+                   guint n_cases)
+{
+    guint i;
+
+    for (i = 0; i < n_cases; i++)
+    {
+        const AmountCase* ac = &cases[i];
+        gchar* title = g_strdup_printf ("amount \"%s\"", ac->str);
+        gnc_numeric amount;
+        gboolean valid = gnc_csv_amount_parser_parse (parser, ac->str, &amount);
+
+        do_test (valid == ac->valid, title);
+        if (valid && ac->valid)
+            do_test (gnc_numeric_equal (amount, gnc_numeric_create (ac->hundredths, 100)),
+                     title);
+        g_free (title);
+    }
+}
+
+static void
+test_amounts (void)
+{
+    GncCsvAmountParser parser;
+
+    /* The tests run in the C locale, which gnc_localeconv gives "."
+     * and "," with groups of 3. */
+    gnc_csv_amount_parser_init (&parser, 100);
+    test_amount_cases (&parser, amount_cases, G_N_ELEMENTS (amount_cases));
+
+    parser.decimal_point = ',';
+    parser.thousands_sep = '.';
+    test_amount_cases (&parser, comma_amount_cases,
+                       G_N_ELEMENTS (comma_amount_cases));
+
+    parser.decimal_point = '.';
+    parser.thousands_sep = ',';
+    g_strlcpy (parser.grouping, "\003\002", sizeof (parser.grouping));
+    test_amount_cases (&parser, lakh_amount_cases,
+                       G_N_ELEMENTS (lakh_amount_cases));
+}
+
+/* Quoted line breaks, doubled quotes, an empty row and both line ends. */
+static const char partial_text[] =
+    "a,\"b\nc\",d\r\n1,2,3\n\n\"x\"\"y\", z \r\nlast";
+
+static void
+append_rows (GString* rows, GPtrArray* lines)
+{
+    guint i, j;
+
+    for (i = 0; i < lines->len; i++)
+    {
+        GPtrArray* line = lines->pdata[i];
+
+        for (j = 0; j < line->len; j++)
+            g_string_append_printf (rows, "%s|", (char*)line->pdata[j]);
+        g_string_append (rows, ";");
+    }
+}
+
+static void
+test_partial_parse (void)
+{
+    GncCsvParseData* parse_data = gnc_csv_new_parse_data ();
+    GStringChunk* chunk = g_string_chunk_new (1024);
+    gsize length = strlen (partial_text), cut;
+    GString* whole = g_string_new (NULL);
+    GString* pieces = g_string_new (NULL);
+    const char* next;
+    GPtrArray* lines;
+    gboolean same = TRUE;
+
+    lines = stf_parse_general_partial (parse_data->options, chunk, partial_text,
+                                       partial_text + length, G_MAXINT, TRUE, &next);
+    append_rows (whole, lines);
+    stf_parse_general_free (lines);
+    do_test (strcmp (whole->str, "a|b\nc|d|;1|2|3|;;x\"y|z|;last|;") == 0,
+             "whole text parsed");
+    do_test (next == partial_text + length, "whole text used");
+
+    lines = stf_parse_general_partial (parse_data->options, chunk, partial_text,
+                                       partial_text + length, 2, TRUE, &next);
+    do_test (lines->len == 2 && strncmp (next, "\n\"x", 3) == 0,
+             "parsing stops after the most rows");
+    stf_parse_general_free (lines);
+
+    for (cut = 0; cut <= length; cut++)
+    {
+        gchar* first = g_strndup (partial_text, cut);
+        gsize used;
+
+        g_string_truncate (pieces, 0);
+        lines = stf_parse_general_partial (parse_data->options, chunk, first,
+                                           first + cut, G_MAXINT, FALSE, &next);
+        append_rows (pieces, lines);
+        stf_parse_general_free (lines);
+        used = next - first;
+        g_free (first);
+
+        lines = stf_parse_general_partial (parse_data->options, chunk,
+                                           partial_text + used,
+                                           partial_text + length, G_MAXINT,
+                                           TRUE, &next);
+        append_rows (pieces, lines);
+        stf_parse_general_free (lines);
+        if (strcmp (whole->str, pieces->str) != 0)
+        {
+            same = FALSE;
+            printf ("cut at %u: %s\n", (guint)cut, pieces->str);
+        }
+    }
+    do_test (same, "text cut anywhere parses the same");
+
+    g_string_free (whole, TRUE);
+    g_string_free (pieces, TRUE);
+    g_string_chunk_free (chunk);
+    gnc_csv_parse_data_free (parse_data);
+}
+
+/* The sum of the amounts goes to total_cents. */
+static gboolean
+write_statement (const gchar* filename, guint rows, gint64* total_cents)
+{
+    FILE* out = g_fopen (filename, "w");
+    GDate date;
+    guint i;
+
+    if (!out)
+        return FALSE;
+    *total_cents = 0;
+    g_date_clear (&date, 1);
+    for (i = 0; i < rows; i++)
+    {
+        gint64 cents = get_random_int_in_range (1, 10000000);
+        guint day = (guint)((guint64)i * 3650 / rows);
+
+        /* Mostly in date order, as statements are */
+        if (i % 50 == 49)
+            day = get_random_int_in_range (0, 3650);
+        g_date_set_dmy (&date, 1, G_DATE_JANUARY, 2000);
+        g_date_add_days (&date, day);
+        *total_cents += cents - ((i % 3) ? 0 : 1200);
+        fprintf (out, "%04d-%02d-%02d,\"Payee %u, Inc.\",%u,%s%s%" G_GINT64_FORMAT ".%02d,%s\n",
+                 g_date_get_year (&date), g_date_get_month (&date),
+                 g_date_get_day (&date), i, i, (i % 2) ? "$" : "",
+                 (cents >= 100000) ? "" : " ", cents / 100, (int)(cents % 100),
+                 (i % 3) ? "" : "12.00");
+    }
+    return fclose (out) == 0;
+}
+
+static gboolean
+transactions_in_order (GList* transactions)
+{
+    GList* node;
+
+    for (node = transactions; node && node->next; node = node->next)
+    {
+        GncCsvTransLine* a = node->data;
+        GncCsvTransLine* b = node->next->data;
+
+        if (xaccTransGetDate (a->trans) > xaccTransGetDate (b->trans))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+typedef struct
+{
+    guint count;
+    gnc_numeric total;
+} StreamData;
+
+static void
+add_amount (Transaction* trans, gpointer user_data)
+{
+    StreamData* data = user_data;
+    Split* split = xaccTransGetSplit (trans, 0);
+
+    data->count++;
+    data->total = gnc_numeric_add (data->total, xaccSplitGetAmount (split),
+                                   100, GNC_HOW_RND_ROUND_HALF_UP);
+}
+
+static void
+test_statement (guint rows)
+{
+    QofBook* book = qof_book_new ();
+    gnc_commodity* usd = gnc_commodity_table_lookup
+                         (gnc_commodity_table_get_table (book),
+                          GNC_COMMODITY_NS_CURRENCY, "USD");
+    Account* acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, "Bank");
+    gchar* filename = g_strdup_printf ("%s/test-csv-parse-%d.csv",
+                                       g_get_tmp_dir (), (int)getpid ());
+    GncCsvParseData* parse_data;
+    GError* error = NULL;
+    guint preview_rows = MIN (rows, GNC_CSV_PREVIEW_ROWS);
+    gint64 total_cents;
+    StreamData data;
+    GList* node;
+
+    if (!write_statement (filename, rows, &total_cents))
+    {
+        failure ("writing the statement failed");
+        g_free (filename);
+        qof_book_destroy (book);
+        return;
+    }
+
+    parse_data = gnc_csv_new_parse_data ();
+    do_test (gnc_csv_load_file (parse_data, filename, &error) == 0, "load statement");
+    do_test (gnc_csv_parse (parse_data, TRUE, &error) == 0, "parse statement");
+    do_test (parse_data->orig_lines->len == preview_rows, "preview rows parsed");
+    do_test (parse_data->more_rows == (rows > preview_rows), "rest of the rows left");
+    do_test (parse_data->column_types->len == 5, "five columns");
+
+    parse_data->column_types->data[0] = GNC_CSV_DATE;
+    parse_data->column_types->data[1] = GNC_CSV_DESCRIPTION;
+    parse_data->column_types->data[2] = GNC_CSV_NUM;
+    parse_data->column_types->data[3] = GNC_CSV_DEPOSIT;
+    parse_data->column_types->data[4] = GNC_CSV_WITHDRAWAL;
+    parse_data->date_format = 0;
+
+    gnc_csv_parse_to_trans (parse_data, acc, FALSE);
+
+    do_test (parse_data->error_lines == NULL, "no error rows");
+    do_test (g_list_length (parse_data->transactions) == preview_rows,
+             "a transaction per preview row");
+    do_test (transactions_in_order (parse_data->transactions),
+             "transactions sorted by date");
+
+    data.count = 0;
+    data.total = gnc_numeric_zero ();
+    for (node = parse_data->transactions; node; node = node->next)
+        add_amount (((GncCsvTransLine*)node->data)->trans, &data);
+    do_test (gnc_csv_stream_to_trans (parse_data, acc, add_amount, &data,
+                                      &error) == 0, "stream the rest");
+    do_test (parse_data->stream_error_rows == 0, "no streamed error rows");
+    do_test (data.count == rows, "a transaction per row");
+    do_test (gnc_numeric_equal (data.total, gnc_numeric_create (total_cents, 100)),
+             "amounts add up");
+
+    gnc_csv_parse_data_free (parse_data);
+    g_unlink (filename);
+    g_free (filename);
+    qof_book_destroy (book);
+}
+
+/* Newest first, as many banks export, with the amount of each row in
+ * the description and the balance after it in the last column. */
+static gboolean
+write_balance_statement (const gchar* filename, guint rows)
+{
+    FILE* out = g_fopen (filename, "w");
+    gint64* balances = g_new (gint64, rows);
+    gint64* amounts = g_new (gint64, rows);
+    gint64 balance = 0;
+    GDate date;
+    guint i;
+
+    if (!out)
+    {
+        g_free (balances);
+        g_free (amounts);
+        return FALSE;
+    }
+    for (i = 0; i < rows; i++)
+    {
+        amounts[i] = get_random_int_in_range (1, 1000000) - 500000;
+        balance += amounts[i];
+        balances[i] = balance;
+    }
+    g_date_clear (&date, 1);
+    for (i = rows; i-- > 0; )
+    {
+        gint64 b = balances[i];
+
+        /* A day each, so that the order is the date order. */
+        g_date_set_dmy (&date, 1, G_DATE_JANUARY, 1980);
+        g_date_add_days (&date, i);
+        fprintf (out, "%04d-%02d-%02d,%" G_GINT64_FORMAT ",%s%" G_GINT64_FORMAT ".%02d\n",
+                 g_date_get_year (&date), g_date_get_month (&date),
+                 g_date_get_day (&date), amounts[i], (b < 0) ? "-" : "",
+                 ABS (b) / 100, (int)(ABS (b) % 100));
+    }
+    g_free (balances);
+    g_free (amounts);
+    return fclose (out) == 0;
+}
+
+static gboolean
+amount_as_written (Transaction* trans)
+{
+    Split* split = xaccTransGetSplit (trans, 0);
+    gint64 cents = g_ascii_strtoll (xaccTransGetDescription (trans), NULL, 10);
+
+    return split != NULL
+           && gnc_numeric_equal (xaccSplitGetAmount (split),
+                                 gnc_numeric_create (cents, 100));
+}
+
+static void
+check_balance_amount (Transaction* trans, gpointer user_data)
+{
+    StreamData* data = user_data;
+
+    if (amount_as_written (trans))
+        data->count++;
+}
+
+static void
+test_balance_statement (void)
+{
+    QofBook* book = qof_book_new ();
+    gnc_commodity* usd = gnc_commodity_table_lookup
+                         (gnc_commodity_table_get_table (book),
+                          GNC_COMMODITY_NS_CURRENCY, "USD");
+    Account* acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, "Bank");
+    gchar* filename = g_strdup_printf ("%s/test-csv-balance-%d.csv",
+                                       g_get_tmp_dir (), (int)getpid ());
+    guint rows = GNC_CSV_PREVIEW_ROWS + GNC_CSV_PREVIEW_ROWS / 2;
+    GncCsvParseData* parse_data;
+    GError* error = NULL;
+    StreamData data;
+    GList* node;
+
+    if (!write_balance_statement (filename, rows))
+    {
+        failure ("writing the balance statement failed");
+        g_free (filename);
+        qof_book_destroy (book);
+        return;
+    }
+
+    parse_data = gnc_csv_new_parse_data ();
+    do_test (gnc_csv_load_file (parse_data, filename, &error) == 0,
+             "load balance statement");
+    do_test (gnc_csv_parse (parse_data, TRUE, &error) == 0,
+             "parse balance statement");
+    do_test (parse_data->more_rows, "balance statement longer than the preview");
+    do_test (parse_data->column_types->len == 3, "three columns");
+
+    parse_data->column_types->data[0] = GNC_CSV_DATE;
+    parse_data->column_types->data[1] = GNC_CSV_DESCRIPTION;
+    parse_data->column_types->data[2] = GNC_CSV_BALANCE;
+    parse_data->date_format = 0;
+    gnc_csv_parse_to_trans (parse_data, acc, FALSE);
+    do_test (parse_data->error_lines == NULL, "no balance error rows");
+
+    data.count = 0;
+    do_test (gnc_csv_stream_to_trans (parse_data, acc, check_balance_amount,
+                                      &data, &error) == 0,
+             "stream the rest of the balance statement");
+    do_test (data.count == rows - parse_data->orig_lines->len,
+             "streamed amounts from the balance");
+    data.count = 0;
+    for (node = parse_data->transactions; node; node = node->next)
+        check_balance_amount (((GncCsvTransLine*)node->data)->trans, &data);
+    do_test (data.count == parse_data->orig_lines->len,
+             "preview amounts from the balance");
+
+    gnc_csv_parse_data_free (parse_data);
+    g_unlink (filename);
+    g_free (filename);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char** argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        test_dates ();
+        test_amounts ();
+        test_partial_parse ();
+        test_statement (NUM_ROWS);
+        test_balance_statement ();
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
@@ -67,6 +67,9 @@ static void
 matchmap_store_destination (GncImportMatchMap *matchmap,
                             GNCImportTransInfo *trans_info,
                             gboolean use_match);
+static void
+trans_info_select_match (GNCImportTransInfo *trans_info,
+                         GNCImportSettings *settings);
 
 
 /********************************************************************\
@@ -257,6 +260,10 @@ void gnc_import_TransInfo_delete (GNCImportTransInfo *info)
 {
     if (info)
     {
+        GList *node;
+
+        for (node = info->match_list; node; node = node->next)
+            g_free (node->data);
         g_list_free (info->match_list);
         /*If the transaction exists and is still open, it must be destroyed*/
         if (info->trans && xaccTransIsOpen(info->trans))
@@ -266,8 +273,6 @@ void gnc_import_TransInfo_delete (GNCImportTransInfo *info)
         }
         if (info->match_tokens)
         {
-            GList *node;
-
             for (node = info->match_tokens; node; node = node->next)
                 g_free (node->data);
 
@@ -836,7 +841,8 @@ void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
            have to change its behaviour: Accept the imported txns via
            gnc_gen_trans_list_add_trans(), and only when
            gnc_gen_trans_list_run() is called, then calculate all the
-           different match candidates. That's too much work for now.
+           different match candidates. That is what
+           gnc_import_find_split_matches_batch does.
         */
     }
 
@@ -854,6 +860,293 @@ void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
 }
 
 
+/* The batch matcher.  All transactions imported into the same account
+ * share one query over the union of their date ranges.  The splits it
+ * returns are bucketed by day, and sorted by amount in cents within a
+ * day, so that every imported transaction only has to look at the
+ * splits that can possibly reach the display threshold. */
+
+typedef struct
+{
+    Split *split;
+    time_t date;
+    gint64 cents;
+    guint order;        /* position in the query results */
+} MatchCandidate;
+
+typedef struct
+{
+    Account *account;
+    time_t min_date;
+    time_t max_date;
+    GList *trans_infos;
+    GHashTable *days;   /* day number -> GArray of MatchCandidate */
+} MatchBatch;
+
+typedef struct
+{
+    gint process_threshold;
+    double fuzzy_amount_difference;
+    gint match_date_hardlimit;
+} MatchParams;
+
+static gint
+match_day (time_t date)
+{
+    return (gint)((date - (date < 0 ? 86399 : 0)) / 86400);
+}
+
+static gint64
+match_cents (Split *split)
+{
+    return (gint64)floor (gnc_numeric_to_double (xaccSplitGetAmount (split))
+                          * 100.0 + 0.5);
+}
+
+/* The largest score split_find_match can give for the date of a split
+ * in a bucket that is day_offset days away. */
+static gint
+match_date_score_max (gint day_offset)
+{
+    gint datediff_day = MAX (ABS (day_offset) - 1, 0);
+
+    if (datediff_day == 0)
+        return 3;
+    if (datediff_day <= MATCH_DATE_THRESHOLD)
+        return 2;
+    if (datediff_day > MATCH_DATE_NOT_THRESHOLD)
+        return -5;
+    return 0;
+}
+
+/* The largest score split_find_match can give for the number, memo and
+ * description of any split. */
+static gint
+match_text_score_max (GNCImportTransInfo *trans_info)
+{
+    Transaction *trans = gnc_import_TransInfo_get_trans (trans_info);
+    const char *str;
+    gint score = 0;
+
+    str = xaccTransGetNum (trans);
+    if (str && *str)
+        score += 4;
+    str = xaccSplitGetMemo (gnc_import_TransInfo_get_fsplit (trans_info));
+    if (str && *str)
+        score += 2;
+    str = xaccTransGetDescription (trans);
+    if (str && *str)
+        score += 2;
+    return score;
+}
+
+static gint
+compare_candidate_cents (gconstpointer a, gconstpointer b)
+{
+    gint64 ca = ((const MatchCandidate *)a)->cents;
+    gint64 cb = ((const MatchCandidate *)b)->cents;
+
+    return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static gint
+compare_candidate_order (gconstpointer a, gconstpointer b)
+{
+    const MatchCandidate *ca = *(MatchCandidate * const *)a;
+    const MatchCandidate *cb = *(MatchCandidate * const *)b;
+
+    return (gint)ca->order - (gint)cb->order;
+}
+
+static void
+match_batch_free (gpointer data)
+{
+    MatchBatch *batch = data;
+
+    g_list_free (batch->trans_infos);
+    if (batch->days)
+        g_hash_table_destroy (batch->days);
+    g_free (batch);
+}
+
+static void
+match_day_free (gpointer data)
+{
+    g_array_free (data, TRUE);
+}
+
+/* Run the one query of the batch and bucket its splits. */
+static void
+match_batch_fill (MatchBatch *batch, const MatchParams *params)
+{
+    Query *query = qof_query_create_for (GNC_ID_SPLIT);
+    GList *node;
+    guint order = 0;
+
+    batch->days = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                         NULL, match_day_free);
+    qof_query_set_book (query, gnc_account_get_book (batch->account));
+    xaccQueryAddSingleAccountMatch (query, batch->account, QOF_QUERY_AND);
+    xaccQueryAddDateMatchTT (query,
+                             TRUE, batch->min_date - params->match_date_hardlimit * 86400,
+                             TRUE, batch->max_date + params->match_date_hardlimit * 86400,
+                             QOF_QUERY_AND);
+
+    for (node = qof_query_run (query); node; node = node->next, order++)
+    {
+        MatchCandidate candidate;
+        GArray *day;
+        gint day_num;
+
+        /* split_find_match ignores these anyway. */
+        if (xaccTransIsOpen (xaccSplitGetParent (node->data)))
+            continue;
+
+        candidate.split = node->data;
+        candidate.date = xaccTransGetDate (xaccSplitGetParent (node->data));
+        candidate.cents = match_cents (node->data);
+        candidate.order = order;
+
+        day_num = match_day (candidate.date);
+        day = g_hash_table_lookup (batch->days, GINT_TO_POINTER (day_num));
+        if (day == NULL)
+        {
+            day = g_array_new (FALSE, FALSE, sizeof (MatchCandidate));
+            g_hash_table_insert (batch->days, GINT_TO_POINTER (day_num), day);
+        }
+        g_array_append_val (day, candidate);
+    }
+    qof_query_destroy (query);
+
+    {
+        GHashTableIter iter;
+        gpointer day;
+
+        g_hash_table_iter_init (&iter, batch->days);
+        while (g_hash_table_iter_next (&iter, NULL, &day))
+            g_array_sort (day, compare_candidate_cents);
+    }
+}
+
+/* Score one imported transaction against the neighbourhood of its date
+ * and amount.  A split whose amount is off by more than the fuzzy
+ * amount difference gets a -5 from split_find_match, so the whole day
+ * is only looked at when the date and text heuristics could make up
+ * for that. */
+static void
+match_batch_trans_info (MatchBatch *batch, GNCImportTransInfo *trans_info,
+                        const MatchParams *params)
+{
+    time_t download_time = xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+    time_t first = download_time - params->match_date_hardlimit * 86400;
+    time_t last = download_time + params->match_date_hardlimit * 86400;
+    gint download_day = match_day (download_time);
+    gint text_max = match_text_score_max (trans_info);
+    double amount = gnc_numeric_to_double
+                    (xaccSplitGetAmount (gnc_import_TransInfo_get_fsplit (trans_info)));
+    gint64 low_cents = (gint64)floor ((amount - params->fuzzy_amount_difference) * 100.0) - 1;
+    gint64 high_cents = (gint64)ceil ((amount + params->fuzzy_amount_difference) * 100.0) + 1;
+    GPtrArray *found = g_ptr_array_new ();
+    gint day_num;
+    guint i;
+
+    for (day_num = match_day (first); day_num <= match_day (last); day_num++)
+    {
+        GArray *day = g_hash_table_lookup (batch->days, GINT_TO_POINTER (day_num));
+        gboolean whole_day;
+        guint lo = 0, hi;
+
+        if (day == NULL)
+            continue;
+        whole_day = (text_max + match_date_score_max (day_num - download_day) - 5
+                     >= params->process_threshold);
+
+        if (!whole_day)
+        {
+            /* Only the splits with a close enough amount can match. */
+            hi = day->len;
+            while (lo < hi)
+            {
+                guint mid = lo + (hi - lo) / 2;
+                if (g_array_index (day, MatchCandidate, mid).cents < low_cents)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+        }
+
+        for (i = lo; i < day->len; i++)
+        {
+            MatchCandidate *candidate = &g_array_index (day, MatchCandidate, i);
+
+            if (!whole_day && candidate->cents > high_cents)
+                break;
+            if (candidate->date >= first && candidate->date <= last)
+                g_ptr_array_add (found, candidate);
+        }
+    }
+
+    /* Score them in query order, to get the same match list as
+       gnc_import_find_split_matches. */
+    g_ptr_array_sort (found, compare_candidate_order);
+    for (i = 0; i < found->len; i++)
+        split_find_match (trans_info,
+                          ((MatchCandidate *)g_ptr_array_index (found, i))->split,
+                          params->process_threshold,
+                          params->fuzzy_amount_difference);
+    g_ptr_array_free (found, TRUE);
+}
+
+static void
+match_batch_run (gpointer key, gpointer value, gpointer user_data)
+{
+    MatchBatch *batch = value;
+    GList *node;
+
+    match_batch_fill (batch, user_data);
+    for (node = batch->trans_infos; node; node = node->next)
+        match_batch_trans_info (batch, node->data, user_data);
+}
+
+void gnc_import_find_split_matches_batch (GList *trans_infos,
+        gint process_threshold,
+        double fuzzy_amount_difference,
+        gint match_date_hardlimit)
+{
+    GHashTable *batches = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                          NULL, match_batch_free);
+    MatchParams params;
+    GList *node;
+
+    params.process_threshold = process_threshold;
+    params.fuzzy_amount_difference = fuzzy_amount_difference;
+    params.match_date_hardlimit = match_date_hardlimit;
+
+    for (node = trans_infos; node; node = node->next)
+    {
+        GNCImportTransInfo *trans_info = node->data;
+        Account *importaccount =
+            xaccSplitGetAccount (gnc_import_TransInfo_get_fsplit (trans_info));
+        time_t download_time = xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+        MatchBatch *batch = g_hash_table_lookup (batches, importaccount);
+
+        if (batch == NULL)
+        {
+            batch = g_new0 (MatchBatch, 1);
+            batch->account = importaccount;
+            batch->min_date = batch->max_date = download_time;
+            g_hash_table_insert (batches, importaccount, batch);
+        }
+        batch->min_date = MIN (batch->min_date, download_time);
+        batch->max_date = MAX (batch->max_date, download_time);
+        batch->trans_infos = g_list_prepend (batch->trans_infos, trans_info);
+    }
+
+    g_hash_table_foreach (batches, match_batch_run, &params);
+    g_hash_table_destroy (batches);
+}
+
+
 /***********************************************************************
  */
 
@@ -1070,54 +1363,10 @@ gnc_import_process_trans_item (GncImportMatchMap *matchmap,
     return FALSE;
 }
 
-/********************************************************************\
- * check_trans_online_id() Callback function used by
- * gnc_import_exists_online_id.  Takes pointers to transaction and split,
- * returns 0 if their online_id kvp_frames do NOT match, or if the split
- * belongs to the transaction
-\********************************************************************/
-static gint check_trans_online_id(Transaction *trans1, void *user_data)
-{
-    Account *account;
-    Split *split1;
-    Split *split2 = user_data;
-    const gchar *online_id1;
-    const gchar *online_id2;
-
-    account = xaccSplitGetAccount(split2);
-    split1 = xaccTransFindSplitByAccount(trans1, account);
-    if (split1 == split2)
-        return 0;
-
-    /* hack - we really want to iterate over the _splits_ of the account
-       instead of the transactions */
-    g_assert(split1 != NULL);
-
-    if (gnc_import_split_has_online_id(split1))
-        online_id1 = gnc_import_get_split_online_id(split1);
-    else
-        online_id1 = gnc_import_get_trans_online_id(trans1);
-
-    online_id2 = gnc_import_get_split_online_id(split2);
-
-    if ((online_id1 == NULL) ||
-            (online_id2 == NULL) ||
-            (strcmp(online_id1, online_id2) != 0))
-    {
-        return 0;
-    }
-    else
-    {
-        /*printf("test_trans_online_id(): Duplicate found\n");*/
-        return 1;
-    }
-}
-
 /** Checks whether the given transaction's online_id already exists in
   its parent account. */
 gboolean gnc_import_exists_online_id (Transaction *trans)
 {
-    int i;
     gboolean online_id_exists = FALSE;
     Account *dest_acct;
     Split *source_split;
@@ -1128,9 +1377,10 @@ gboolean gnc_import_exists_online_id (Transaction *trans)
 
     /* DEBUG("%s%d%s","Checking split ",i," for duplicates"); */
     dest_acct = xaccSplitGetAccount(source_split);
-    online_id_exists = xaccAccountForEachTransaction(dest_acct,
-                       check_trans_online_id,
-                       source_split);
+    online_id_exists =
+        (gnc_import_find_trans_by_online_id(dest_acct,
+                gnc_import_get_split_online_id(source_split),
+                trans) != NULL);
 
     /* If it does, abort the process for this transaction, since it is
        already in the system. */
@@ -1140,6 +1390,11 @@ gboolean gnc_import_exists_online_id (Transaction *trans)
         xaccTransDestroy(trans);
         xaccTransCommitEdit(trans);
     }
+    else
+    {
+        /* Later duplicates in the same import have to find it. */
+        gnc_import_index_trans_online_id(trans);
+    }
     return online_id_exists;
 }
 
@@ -1188,7 +1443,6 @@ void
 gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                    GNCImportSettings *settings)
 {
-    GNCImportMatchInfo * best_match = NULL;
     g_assert (trans_info);
 
 
@@ -1198,6 +1452,31 @@ gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                   gnc_import_Settings_get_fuzzy_amount (settings),
                                   gnc_import_Settings_get_match_date_hardlimit (settings));
 
+    trans_info_select_match (trans_info, settings);
+}
+
+void
+gnc_import_TransInfo_init_matches_batch (GList *trans_infos,
+        GNCImportSettings *settings)
+{
+    GList *node;
+
+    gnc_import_find_split_matches_batch (trans_infos,
+                                         gnc_import_Settings_get_display_threshold (settings),
+                                         gnc_import_Settings_get_fuzzy_amount (settings),
+                                         gnc_import_Settings_get_match_date_hardlimit (settings));
+
+    for (node = trans_infos; node; node = node->next)
+        trans_info_select_match (node->data, settings);
+}
+
+/* Sort the match list and pick the best match and the action. */
+static void
+trans_info_select_match (GNCImportTransInfo *trans_info,
+                         GNCImportSettings *settings)
+{
+    GNCImportMatchInfo * best_match = NULL;
+
     if (trans_info->match_list != NULL)
     {
         trans_info->match_list = g_list_sort(trans_info->match_list,
@@ -88,6 +88,22 @@ void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
                                    double fuzzy_amount_difference,
                                    gint match_date_hardlimit);
 
+/** Find the matching splits of many imported transactions at once.
+ * This gives the same match lists as calling
+ * gnc_import_find_split_matches on each of them, but runs only one
+ * query per import account and scores every transaction only against
+ * the splits close enough in date and amount to reach the
+ * process_threshold.
+ *
+ * @param trans_infos A GList of the GNCImportTransInfo's to match.
+ *
+ * The other parameters are those of gnc_import_find_split_matches.
+ */
+void gnc_import_find_split_matches_batch (GList *trans_infos,
+        gint process_threshold,
+        double fuzzy_amount_difference,
+        gint match_date_hardlimit);
+
 /** Iterates through all splits of the originating account of
  * trans_info. Sorts the resulting list and sets the selected_match
  * and action fields in the trans_info.
@@ -101,6 +117,13 @@ void
 gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                    GNCImportSettings *settings);
 
+/** Like gnc_import_TransInfo_init_matches, for a whole GList of
+ * GNCImportTransInfo's, using gnc_import_find_split_matches_batch.
+ */
+void
+gnc_import_TransInfo_init_matches_batch (GList *trans_infos,
+        GNCImportSettings *settings);
+
 /** This function is intended to be called when the importer dialog is
  * finished. It should be called once for each imported transaction
  * and processes each ImportTransInfo according to its selected action:
@@ -33,6 +33,7 @@
 #include "import-main-matcher.h"
 
 #include "dialog-utils.h"
+#include "gnc-component-manager.h"
 #include "gnc-ui.h"
 #include "gnc-ui-util.h"
 #include "gnc-engine.h"
@@ -55,6 +56,9 @@ struct _main_matcher_info
     int selected_row;
     GNCTransactionProcessedCB transaction_processed_cb;
     gpointer user_data;
+    /* Added transactions whose matches have not been looked for yet. */
+    GList *pending;
+    guint pending_id;
 };
 
 enum downloaded_cols
@@ -89,16 +93,38 @@ automatch_store_transactions(GNCImportMainMatcher *info,
 static void
 refresh_model_row(GNCImportMainMatcher *gui, GtkTreeModel *model,
                   GtkTreeIter *iter, GNCImportTransInfo *info);
+static void
+match_pending_transactions(GNCImportMainMatcher *gui);
+static gboolean
+match_pending_idle(gpointer user_data);
 
 void gnc_gen_trans_list_delete (GNCImportMainMatcher *info)
 {
     GtkTreeModel *model;
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
+    GList *node;
 
     if (info == NULL)
         return;
 
+    /* The pending transactions were never matched nor shown, there is
+       no need to match them now. */
+    if (info->pending_id)
+        g_source_remove(info->pending_id);
+    info->pending = g_list_reverse(info->pending);
+    for (node = info->pending; node; node = node->next)
+    {
+        if (info->transaction_processed_cb)
+        {
+            info->transaction_processed_cb(node->data,
+                                           FALSE,
+                                           info->user_data);
+        }
+        gnc_import_TransInfo_delete(node->data);
+    }
+    g_list_free(info->pending);
+
     model = gtk_tree_view_get_model(info->view);
     if (gtk_tree_model_get_iter_first(model, &iter))
     {
@@ -141,10 +167,17 @@ on_matcher_ok_clicked (GtkButton *button,
 
     /*   DEBUG ("Begin") */
 
+    match_pending_transactions(info);
     model = gtk_tree_view_get_model(info->view);
     if (!gtk_tree_model_get_iter_first(model, &iter))
         return;
 
+    /* Every transaction sends several events per split; fold them and
+     * refresh the registers once at the end.  The batch is resumed
+     * first, so the held events reach the suspended component manager
+     * before it refreshes. */
+    gnc_suspend_gui_refresh();
+    qof_event_batch();
     do
     {
         gtk_tree_model_get(model, &iter,
@@ -176,6 +209,8 @@ on_matcher_ok_clicked (GtkButton *button,
 
     }
     while (gtk_tree_model_iter_next (model, &iter));
+    qof_event_resume();
+    gnc_resume_gui_refresh();
 
     /* DEBUG ("Deleting") */
     /* DRH: Is this necessary. Isn't the call to trans_list_delete at
@@ -591,6 +626,7 @@ gboolean gnc_gen_trans_list_run (GNCImportMainMatcher *info)
     gboolean result;
 
     /* DEBUG("Begin"); */
+    match_pending_transactions(info);
     result = gtk_dialog_run (GTK_DIALOG (info->dialog));
     /* DEBUG("Result was %d", result); */
 
@@ -825,8 +861,6 @@ void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans)
 void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transaction *trans, guint32 ref_id)
 {
     GNCImportTransInfo * transaction_info = NULL;
-    GtkTreeModel *model;
-    GtkTreeIter iter;
     g_assert (gui);
     g_assert (trans);
 
@@ -838,16 +872,56 @@ void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transac
         transaction_info = gnc_import_TransInfo_new(trans, NULL);
         gnc_import_TransInfo_set_ref_id(transaction_info, ref_id);
 
-        gnc_import_TransInfo_init_matches(transaction_info,
-                                          gui->user_settings);
-
-        model = gtk_tree_view_get_model(gui->view);
-        gtk_list_store_append(GTK_LIST_STORE(model), &iter);
-        refresh_model_row (gui, model, &iter, transaction_info);
+        /* The matches are looked for all at once, when the main loop
+           gets idle or the dialog is run. */
+        gui->pending = g_list_prepend(gui->pending, transaction_info);
+        if (!gui->pending_id)
+            gui->pending_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                                              match_pending_idle, gui, NULL);
     }
     return;
 }/* end gnc_import_add_trans_with_ref_id() */
 
+/* Find the matches of all pending transactions and show them. */
+static void
+match_pending_transactions(GNCImportMainMatcher *gui)
+{
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    GList *node;
+
+    if (gui->pending_id)
+    {
+        g_source_remove(gui->pending_id);
+        gui->pending_id = 0;
+    }
+    if (gui->pending == NULL)
+        return;
+
+    gui->pending = g_list_reverse(gui->pending);
+    gnc_import_TransInfo_init_matches_batch(gui->pending,
+                                            gui->user_settings);
+
+    model = gtk_tree_view_get_model(gui->view);
+    for (node = gui->pending; node; node = node->next)
+    {
+        gtk_list_store_append(GTK_LIST_STORE(model), &iter);
+        refresh_model_row (gui, model, &iter, node->data);
+    }
+    g_list_free(gui->pending);
+    gui->pending = NULL;
+}
+
+static gboolean
+match_pending_idle(gpointer user_data)
+{
+    GNCImportMainMatcher *gui = user_data;
+
+    gui->pending_id = 0;
+    match_pending_transactions(gui);
+    return FALSE;
+}
+
 /* Iterate through the rows of the clist and try to automatch each of them */
 static void
 automatch_store_transactions (GNCImportMainMatcher *info,
@@ -83,6 +83,9 @@ void gnc_gen_trans_list_delete (GNCImportMainMatcher *info);
  * Only the first split will be used for matching.  The transaction
  * must NOT be commited. The Importer takes over ownership of the
  * passed transaction.
+ *
+ * The matches of the added transactions are looked for together, once
+ * the main loop gets idle or gnc_gen_trans_list_run is called.
  */
 void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans);
 
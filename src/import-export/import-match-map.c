@@ -50,6 +50,14 @@ struct _GncImportMatchMap
 
 #define IMAP_FRAME		"import-map"
 #define IMAP_FRAME_BAYES	"import-map-bayes"
+#define IMAP_BAYES_MODEL	"gnc-imap-bayes-model"
+
+/* The account or book whose kvp frame this is */
+static gpointer
+imap_owner (GncImportMatchMap *imap)
+{
+    return imap->acc ? (gpointer)imap->acc : (gpointer)imap->book;
+}
 
 static GncImportMatchMap *
 gnc_imap_create_from_frame (kvp_frame *frame, Account *acc, QofBook *book)
@@ -100,6 +108,7 @@ GncImportMatchMap * gnc_imap_create_from_book (QofBook *book)
 void gnc_imap_destroy (GncImportMatchMap *imap)
 {
     if (!imap) return;
+    gnc_imap_commit (imap);
     g_free (imap);
 }
 
@@ -111,8 +120,9 @@ void gnc_imap_clear (GncImportMatchMap *imap)
     /* Clear the IMAP_FRAME kvp */
     kvp_frame_set_slot_path (imap->frame, NULL, IMAP_FRAME);
 
-    /* Clear the bayes kvp, IMAP_FRAME_BAYES */
+    /* Clear the bayes kvp, IMAP_FRAME_BAYES, and its model */
     kvp_frame_set_slot_path (imap->frame, NULL, IMAP_FRAME_BAYES);
+    g_object_set_data (G_OBJECT (imap_owner (imap)), IMAP_BAYES_MODEL, NULL);
 
     /* XXX: mark the account (or book) as dirty! */
 }
@@ -168,141 +178,235 @@ void gnc_imap_add_account (GncImportMatchMap *imap, const char *category,
 --------------------------------------------------------------------------*/
 
 
-struct account_token_count
+/* The bayes data of a match map is kept in memory, in a compact form,
+ * after it was first read from the kvp frame: the tokens are interned
+ * in a string chunk, the account full names are numbered, and every
+ * token holds an array of (account number, count) pairs and the total
+ * of its counts.  Finding an account then needs no allocations.  New
+ * counts are added in memory and written back to the kvp frame by
+ * gnc_imap_commit().
+ *
+ * The model belongs to the account or book that owns the kvp frame,
+ * so that it survives the short-lived GncImportMatchMap objects. */
+
+typedef struct
 {
-    char* account_name;
-    gint64 token_count; /**< occurances of a given token for this account_name */
-};
+    guint account;      /* index into BayesModel.accounts */
+    gint64 count;       /**< occurances of the token for this account */
+    gboolean dirty;
+} BayesCount;
 
-/** total_count and the token_count for a given account let us calculate the
+/** total_count and the count for a given account let us calculate the
  * probability of a given account with any single token
  */
-struct token_accounts_info
+typedef struct
 {
-    GList *accounts; /**< array of struct account_token_count */
+    const char *token;  /* interned */
     gint64 total_count;
-};
+    guint n_counts;
+    guint size;
+    BayesCount *counts;
+    gboolean dirty;
+} BayesToken;
 
-/** gpointer is a pointer to a struct token_accounts_info
- * \note Can always assume that keys are unique, reduces code in this function
+/** intermediate values used to calculate the bayes probability of a given account
+  where p(AB) = (a*b)/[a*b + (1-a)(1-b)], product is (a*b),
+  product_difference is (1-a) * (1-b)
  */
-static void buildTokenInfo(const char *key, kvp_value *value, gpointer data)
+typedef struct
 {
-    struct token_accounts_info *tokenInfo = (struct token_accounts_info*)data;
-    struct account_token_count* this_account;
+    double product; /* product of probabilities */
+    double product_difference; /* product of (1-probabilities) */
+    guint stamp;    /* the lookup that last touched these */
+} BayesScore;
 
-    //  PINFO("buildTokenInfo: account '%s', token_count: '%ld'\n", (char*)key,
-    //			(long)kvp_value_get_gint64(value));
+typedef struct
+{
+    kvp_frame *source;          /* the IMAP_FRAME_BAYES frame read */
+    GStringChunk *strings;
+    GHashTable *tokens;         /* interned token -> BayesToken */
+    GPtrArray *accounts;        /* account full names, interned */
+    GHashTable *account_ids;    /* account full name -> index + 1 */
+    GArray *scores;             /* of BayesScore, one per account */
+    GArray *touched;            /* of guint, accounts of the lookup */
+    guint stamp;
+    GPtrArray *dirty;           /* of BayesToken */
+} BayesModel;
+
+static guint
+bayes_model_account (BayesModel *model, const char *account_name)
+{
+    guint id = GPOINTER_TO_UINT (g_hash_table_lookup (model->account_ids,
+                                 account_name));
+    BayesScore score = { 0.0, 0.0, 0 };
+    char *name;
+
+    if (id)
+        return id - 1;
+
+    name = g_string_chunk_insert_const (model->strings, account_name);
+    g_ptr_array_add (model->accounts, name);
+    g_hash_table_insert (model->account_ids, name,
+                         GUINT_TO_POINTER (model->accounts->len));
+    /* Sized here, so that lookups need not allocate. */
+    g_array_append_val (model->scores, score);
+    g_array_set_size (model->touched, model->accounts->len);
+    return model->accounts->len - 1;
+}
 
-    /* add the count to the total_count */
-    tokenInfo->total_count += kvp_value_get_gint64(value);
+static BayesToken *
+bayes_model_token (BayesModel *model, const char *token)
+{
+    BayesToken *info = g_hash_table_lookup (model->tokens, token);
+
+    if (info)
+        return info;
 
-    /* allocate a new structure for this account and it's token count */
-    this_account = (struct account_token_count*)
-                   g_new0(struct account_token_count, 1);
+    info = g_slice_new0 (BayesToken);
+    info->token = g_string_chunk_insert_const (model->strings, token);
+    g_hash_table_insert (model->tokens, (gpointer)info->token, info);
+    return info;
+}
 
-    /* fill in the account name and number of tokens found for this account name */
-    this_account->account_name = (char*)key;
-    this_account->token_count = kvp_value_get_gint64(value);
+static BayesCount *
+bayes_token_count (BayesToken *info, guint account)
+{
+    guint i;
 
-    /* append onto the glist a pointer to the new account_token_count structure */
-    tokenInfo->accounts = g_list_prepend(tokenInfo->accounts, this_account);
+    for (i = 0; i < info->n_counts; i++)
+        if (info->counts[i].account == account)
+            return &info->counts[i];
+
+    if (info->n_counts == info->size)
+    {
+        info->size = info->size ? 2 * info->size : 2;
+        info->counts = g_renew (BayesCount, info->counts, info->size);
+    }
+    info->counts[info->n_counts].account = account;
+    info->counts[info->n_counts].count = 0;
+    info->counts[info->n_counts].dirty = FALSE;
+    return &info->counts[info->n_counts++];
 }
 
-/** intermediate values used to calculate the bayes probability of a given account
-  where p(AB) = (a*b)/[a*b + (1-a)(1-b)], product is (a*b),
-  product_difference is (1-a) * (1-b)
- */
-struct account_probability
+typedef struct
 {
-    double product; /* product of probabilities */
-    double product_difference; /* product of (1-probabilities) */
-};
+    BayesModel *model;
+    BayesToken *token;
+} BayesLoadData;
 
-/** convert a hash table of account names and (struct account_probability*)
-  into a hash table of 100000x the percentage match value, ie. 10% would be
-  0.10 * 100000 = 10000
- */
-#define PROBABILITY_FACTOR 100000
-static void buildProbabilities(gpointer key, gpointer value, gpointer data)
+static void
+bayes_load_account (const char *key, kvp_value *value, gpointer data)
 {
-    GHashTable *final_probabilities = (GHashTable*)data;
-    struct account_probability *account_p = (struct account_probability*)value;
+    BayesLoadData *load = data;
+    BayesCount *count = bayes_token_count
+                        (load->token, bayes_model_account (load->model, key));
 
-    /* P(AB) = A*B / [A*B + (1-A)*(1-B)]
-     * NOTE: so we only keep track of a running product(A*B*C...)
-     * and product difference ((1-A)(1-B)...)
-     */
-    gint32 probability =
-        (account_p->product /
-         (account_p->product + account_p->product_difference))
-        * PROBABILITY_FACTOR;
+    count->count += kvp_value_get_gint64 (value);
+    load->token->total_count += kvp_value_get_gint64 (value);
+}
 
-    PINFO("P('%s') = '%d'\n", (char*)key, probability);
+static void
+bayes_load_token (const char *key, kvp_value *value, gpointer data)
+{
+    BayesLoadData *load = data;
+    kvp_frame *token_frame = kvp_value_get_frame (value);
 
-    g_hash_table_insert(final_probabilities, key, GINT_TO_POINTER(probability));
+    /* token_frame should NEVER be null */
+    if (!token_frame)
+    {
+        PERR("token '%s' has no accounts", key);
+        return;
+    }
+    load->token = bayes_model_token (load->model, key);
+    kvp_frame_for_each_slot (token_frame, bayes_load_account, load);
 }
 
-/** Frees an array of the same time that buildProperties built */
-static void freeProbabilities(gpointer key, gpointer value, gpointer data)
+static void
+bayes_token_free (gpointer data)
 {
-    /* free up the struct account_probability that was allocated
-     * in gnc_imap_find_account_bayes()
-     */
-    g_free(value);
+    BayesToken *info = data;
+
+    g_free (info->counts);
+    g_slice_free (BayesToken, info);
 }
 
-/** holds an account name and its corresponding integer probability
-  the integer probability is some factor of 10
- */
-struct account_info
+static void
+bayes_model_free (gpointer data)
 {
-    char* account_name;
-    gint32 probability;
-};
+    BayesModel *model = data;
+
+    g_hash_table_destroy (model->tokens);
+    g_hash_table_destroy (model->account_ids);
+    g_ptr_array_free (model->accounts, TRUE);
+    g_array_free (model->scores, TRUE);
+    g_array_free (model->touched, TRUE);
+    g_ptr_array_free (model->dirty, TRUE);
+    g_string_chunk_free (model->strings);
+    g_free (model);
+}
 
-/** Find the highest probability and the corresponding account name
-    store in data, a (struct account_info*)
-    NOTE: this is a g_hash_table_foreach() function for a hash table of entries
-    key is a  pointer to the account name, value is a gint32, 100000x
-    the probability for this account
-*/
-static void highestProbability(gpointer key, gpointer value, gpointer data)
+static kvp_frame *
+bayes_frame (GncImportMatchMap *imap)
 {
-    struct account_info *account_i = (struct account_info*)data;
+    kvp_value *value = kvp_frame_get_slot_path (imap->frame, IMAP_FRAME_BAYES,
+                       NULL);
+    return value ? kvp_value_get_frame (value) : NULL;
+}
 
-    /* if the current probability is greater than the stored, store the current */
-    if (GPOINTER_TO_INT(value) > account_i->probability)
+/** Get the model of the map, reading it from the kvp frame if there is
+ * none yet or if the frame was replaced since. */
+static BayesModel *
+bayes_model_get (GncImportMatchMap *imap)
+{
+    BayesModel *model = g_object_get_data (G_OBJECT (imap_owner (imap)),
+                                           IMAP_BAYES_MODEL);
+    kvp_frame *frame = bayes_frame (imap);
+    BayesLoadData load;
+
+    if (model && model->source == frame)
+        return model;
+
+    ENTER(" ");
+    model = g_new0 (BayesModel, 1);
+    model->source = frame;
+    model->strings = g_string_chunk_new (4096);
+    model->tokens = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           NULL, bayes_token_free);
+    model->accounts = g_ptr_array_new ();
+    model->account_ids = g_hash_table_new (g_str_hash, g_str_equal);
+    model->scores = g_array_new (FALSE, FALSE, sizeof (BayesScore));
+    model->touched = g_array_new (FALSE, FALSE, sizeof (guint));
+    model->dirty = g_ptr_array_new ();
+
+    if (frame)
     {
-        /* Save the new highest probability and the assoaciated account name */
-        account_i->probability = GPOINTER_TO_INT(value);
-        account_i->account_name = key;
+        load.model = model;
+        load.token = NULL;
+        kvp_frame_for_each_slot (frame, bayes_load_token, &load);
     }
+    g_object_set_data_full (G_OBJECT (imap_owner (imap)), IMAP_BAYES_MODEL,
+                            model, bayes_model_free);
+    LEAVE("%u tokens, %u accounts", g_hash_table_size (model->tokens),
+          model->accounts->len);
+    return model;
 }
 
-
+/** convert the product and product difference of an account into
+  100000x the percentage match value, ie. 10% would be
+  0.10 * 100000 = 10000
+ */
+#define PROBABILITY_FACTOR 100000
 #define threshold (.90 * PROBABILITY_FACTOR) /* 90% */
 
 /** Look up an Account in the map */
 Account* gnc_imap_find_account_bayes(GncImportMatchMap *imap, GList *tokens)
 {
-    struct token_accounts_info tokenInfo; /**< holds the accounts and total
-					 * token count for a single token */
-    GList *current_token;		        /**< pointer to the current token from the
-				         * input GList *tokens */
-    GList *current_account_token;		/**< pointer to the struct
-					 * account_token_count */
-    struct account_token_count *account_c; /**< an account name and the number
-					  * of times a token has appeared
-					  * for the account */
-    struct account_probability *account_p; /**< intermediate storage of values
-					  * to compute the bayes probability
-					  * of an account */
-    GHashTable *running_probabilities = g_hash_table_new(g_str_hash, g_str_equal);
-    GHashTable *final_probabilities = g_hash_table_new(g_str_hash, g_str_equal);
-    struct account_info account_i;
-    kvp_value* value;
-    kvp_frame* token_frame;
+    BayesModel *model;
+    GList *current_token;
+    const char *account_name = NULL;
+    gint32 best_probability = 0;
+    guint n_touched = 0;
+    guint i;
 
     ENTER(" ");
 
@@ -314,140 +418,80 @@ Account* gnc_imap_find_account_bayes(GncImportMatchMap *imap, GList *tokens)
         return NULL;
     }
 
+    model = bayes_model_get (imap);
+    model->stamp++;
+
     /* find the probability for each account that contains any of the tokens
      * in the input tokens list
      */
     for (current_token = tokens; current_token; current_token = current_token->next)
     {
-        /* zero out the token_accounts_info structure */
-        memset(&tokenInfo, 0, sizeof(struct token_accounts_info));
+        BayesToken *info;
 
-        PINFO("token: '%s'", (char*)current_token->data);
-
-        /* find the slot for the given token off of the source account
-         * for these tokens, search off of the IMAP_FRAME_BAYES path so
-         * we aren't looking from the parent of the entire kvp tree
-         */
-        value = kvp_frame_get_slot_path(imap->frame, IMAP_FRAME_BAYES,
-                                        (char*)current_token->data, NULL);
-
-        /* if value is null we should skip over this token */
-        if (!value)
+        if (!current_token->data)
+            continue;
+        info = g_hash_table_lookup (model->tokens, current_token->data);
+        /* if there is no such token we should skip over it */
+        if (!info)
             continue;
 
-        /* convert the slot(value) into a the frame that contains the
-         * list of accounts
-         */
-        token_frame = kvp_value_get_frame(value);
-
-        /* token_frame should NEVER be null */
-        if (!token_frame)
-        {
-            PERR("token '%s' has no accounts", (char*)current_token->data);
-            continue; /* skip over this token */
-        }
-
-        /* process the accounts for this token, adding the account if it
-         * doesn't already exist or adding to the existing accounts token
-         * count if it does
-         */
-        kvp_frame_for_each_slot(token_frame, buildTokenInfo, &tokenInfo);
+        PINFO("token: '%s'", info->token);
 
-        /* for each account we have just found, see if the account already exists
-         * in the list of account probabilities, if not add it
-         */
-        for (current_account_token = tokenInfo.accounts; current_account_token;
-                current_account_token = current_account_token->next)
+        for (i = 0; i < info->n_counts; i++)
         {
-            /* get the account name and corresponding token count */
-            account_c = (struct account_token_count*)current_account_token->data;
+            BayesScore *score = &g_array_index (model->scores, BayesScore,
+                                                info->counts[i].account);
+            double p = (double)info->counts[i].count / (double)info->total_count;
 
-            PINFO("account_c->account_name('%s'), "
-                  "account_c->token_count('%ld')/total_count('%ld')",
-                  account_c->account_name, (long)account_c->token_count,
-                  (long)tokenInfo.total_count);
-
-            account_p = g_hash_table_lookup(running_probabilities,
-                                            account_c->account_name);
-
-            /* if the account exists in the list then continue
-             * the running probablities
-             */
-            if (account_p)
+            if (score->stamp == model->stamp)
             {
-                account_p->product =
-                    ((double)account_c->token_count / (double)tokenInfo.total_count)
-                    * account_p->product;
-                account_p->product_difference =
-                    ((double)1 - ((double)account_c->token_count /
-                                  (double)tokenInfo.total_count))
-                    * account_p->product_difference;
-                PINFO("product == %f, product_difference == %f",
-                      account_p->product, account_p->product_difference);
+                /* continue the running probablities */
+                score->product *= p;
+                score->product_difference *= (double)1 - p;
             }
             else
             {
-                /* add a new entry */
-                PINFO("adding a new entry for this account");
-                account_p = (struct account_probability*)
-                            g_new0(struct account_probability, 1);
-
-                /* set the product and product difference values */
-                account_p->product = ((double)account_c->token_count /
-                                      (double)tokenInfo.total_count);
-                account_p->product_difference =
-                    (double)1 - ((double)account_c->token_count /
-                                 (double)tokenInfo.total_count);
-
-                PINFO("product == %f, product_difference == %f",
-                      account_p->product, account_p->product_difference);
-
-                /* add the account name and (struct account_probability*)
-                 * to the hash table */
-                g_hash_table_insert(running_probabilities,
-                                    account_c->account_name, account_p);
+                score->stamp = model->stamp;
+                score->product = p;
+                score->product_difference = (double)1 - p;
+                g_array_index (model->touched, guint, n_touched++) =
+                    info->counts[i].account;
             }
-        } /* for all accounts in tokenInfo */
-
-        /* free the data in tokenInfo */
-        for (current_account_token = tokenInfo.accounts; current_account_token;
-                current_account_token = current_account_token->next)
-        {
-            /* free up each struct account_token_count we allocated */
-            g_free((struct account_token_count*)current_account_token->data);
         }
-
-        g_list_free(tokenInfo.accounts); /* free the accounts GList */
     }
 
-    /* build a hash table of account names and their final probabilities
-     * from each entry in the running_probabilties hash table
-     */
-    g_hash_table_foreach(running_probabilities, buildProbabilities,
-                         final_probabilities);
-
     /* find the highest probabilty and the corresponding account */
-    memset(&account_i, 0, sizeof(struct account_info));
-    g_hash_table_foreach(final_probabilities, highestProbability, &account_i);
-
-    /* free each element of the running_probabilities hash */
-    g_hash_table_foreach(running_probabilities, freeProbabilities, NULL);
+    for (i = 0; i < n_touched; i++)
+    {
+        guint account = g_array_index (model->touched, guint, i);
+        BayesScore *score = &g_array_index (model->scores, BayesScore, account);
+        /* P(AB) = A*B / [A*B + (1-A)*(1-B)]
+         * NOTE: so we only keep track of a running product(A*B*C...)
+         * and product difference ((1-A)(1-B)...)
+         */
+        gint32 probability =
+            (score->product / (score->product + score->product_difference))
+            * PROBABILITY_FACTOR;
 
-    /* free the hash tables */
-    g_hash_table_destroy(running_probabilities);
-    g_hash_table_destroy(final_probabilities);
+        PINFO("P('%s') = '%d'", (char*)g_ptr_array_index (model->accounts, account),
+              probability);
+        if (probability > best_probability)
+        {
+            best_probability = probability;
+            account_name = g_ptr_array_index (model->accounts, account);
+        }
+    }
 
     PINFO("highest P('%s') = '%d'",
-          account_i.account_name ? account_i.account_name : "(null)",
-          account_i.probability);
+          account_name ? account_name : "(null)", best_probability);
 
     /* has this probability met our threshold? */
-    if (account_i.probability >= threshold)
+    if (best_probability >= threshold)
     {
         PINFO("found match");
         LEAVE(" ");
         return gnc_account_lookup_by_full_name(gnc_book_get_root_account(imap->book),
-                                               account_i.account_name);
+                                               account_name);
     }
 
     PINFO("no match");
@@ -460,11 +504,10 @@ Account* gnc_imap_find_account_bayes(GncImportMatchMap *imap, GList *tokens)
 /** Updates the imap for a given account using a list of tokens */
 void gnc_imap_add_account_bayes(GncImportMatchMap *imap, GList *tokens, Account *acc)
 {
+    BayesModel *model;
     GList *current_token;
-    kvp_value *value;
-    gint64 token_count;
     char* account_fullname;
-    kvp_value *new_value; /* the value that will be added back into the kvp tree */
+    guint account;
 
     ENTER(" ");
 
@@ -475,7 +518,9 @@ void gnc_imap_add_account_bayes(GncImportMatchMap *imap, GList *tokens, Account
         return;
     }
 
+    model = bayes_model_get (imap);
     account_fullname = gnc_account_get_full_name(acc);
+    account = bayes_model_account (model, account_fullname);
 
     PINFO("account name: '%s'\n", account_fullname);
 
@@ -483,6 +528,9 @@ void gnc_imap_add_account_bayes(GncImportMatchMap *imap, GList *tokens, Account
     for (current_token = g_list_first(tokens); current_token;
             current_token = current_token->next)
     {
+        BayesToken *info;
+        BayesCount *count;
+
         /* Jump to next iteration if the pointer is not valid or if the
         	 string is empty. In HBCI import we almost always get an empty
         	 string, which doesn't work in the kvp loopkup later. So we
@@ -490,50 +538,74 @@ void gnc_imap_add_account_bayes(GncImportMatchMap *imap, GList *tokens, Account
         if (!current_token->data || (*((char*)current_token->data) == '\0'))
             continue;
 
-        /* start off with no tokens for this account */
-        token_count = 0;
-
         PINFO("adding token '%s'\n", (char*)current_token->data);
 
-        /* is this token/account_name already in the kvp tree? */
-        value = kvp_frame_get_slot_path(imap->frame, IMAP_FRAME_BAYES,
-                                        (char*)current_token->data, account_fullname,
-                                        NULL);
+        info = bayes_model_token (model, current_token->data);
+        count = bayes_token_count (info, account);
 
-        /* if the token/account is already in the tree, read the current
-         * value from the tree and use this for the basis of the value we
-         * are putting back
-         */
-        if (value)
+        /* increment the token count */
+        count->count++;
+        info->total_count++;
+        count->dirty = TRUE;
+        if (!info->dirty)
         {
-            PINFO("found existing value of '%ld'\n",
-                  (long)kvp_value_get_gint64(value));
-
-            /* convert this value back into an integer */
-            token_count += kvp_value_get_gint64(value);
+            info->dirty = TRUE;
+            g_ptr_array_add (model->dirty, info);
         }
+    }
 
-        /* increment the token count */
-        token_count++;
+    /* free up the account fullname string */
+    g_free(account_fullname);
 
-        /* create a new value */
-        new_value = kvp_value_new_gint64(token_count);
+    LEAVE(" ");
+}
 
-        /* insert the value into the kvp tree at
-         * /imap->frame/IMAP_FRAME/token_string/account_name_string
-         */
-        kvp_frame_set_slot_path(imap->frame, new_value, IMAP_FRAME_BAYES,
-                                (char*)current_token->data, account_fullname, NULL);
+/** Write the changed counts back to the kvp frame */
+void gnc_imap_commit (GncImportMatchMap *imap)
+{
+    BayesModel *model;
+    guint i, j;
 
-        /* kvp_frame_set_slot_path() copied the value so we
-         * need to delete this one ;-) */
-        kvp_value_delete(new_value);
-    }
+    if (!imap) return;
+    model = g_object_get_data (G_OBJECT (imap_owner (imap)), IMAP_BAYES_MODEL);
+    if (!model || model->dirty->len == 0) return;
 
-    /* free up the account fullname string */
-    g_free(account_fullname);
+    ENTER("%u tokens", model->dirty->len);
+    for (i = 0; i < model->dirty->len; i++)
+    {
+        BayesToken *info = g_ptr_array_index (model->dirty, i);
+
+        for (j = 0; j < info->n_counts; j++)
+        {
+            BayesCount *count = &info->counts[j];
+            kvp_value *new_value;
+
+            if (!count->dirty)
+                continue;
 
+            /* insert the value into the kvp tree at
+             * /imap->frame/IMAP_FRAME/token_string/account_name_string
+             */
+            new_value = kvp_value_new_gint64 (count->count);
+            kvp_frame_set_slot_path (imap->frame, new_value, IMAP_FRAME_BAYES,
+                                     info->token,
+                                     (char*)g_ptr_array_index (model->accounts,
+                                             count->account),
+                                     NULL);
+            /* kvp_frame_set_slot_path() copied the value so we
+             * need to delete this one ;-) */
+            kvp_value_delete (new_value);
+            count->dirty = FALSE;
+        }
+        info->dirty = FALSE;
+    }
+    g_ptr_array_set_size (model->dirty, 0);
+
+    /* The first write may have created the frame. */
+    model->source = bayes_frame (imap);
     LEAVE(" ");
+
+    /* XXX Mark the account (or book) as dirty! */
 }
 
 /** @} */
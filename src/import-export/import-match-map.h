@@ -39,8 +39,9 @@ GncImportMatchMap * gnc_imap_create_from_account (Account *acc);
 GncImportMatchMap * gnc_imap_create_from_book (QofBook *book);
 /*@}*/
 
-/** Destroy an import map. But all stored entries will still continue
- to exist in the underlying kvp frame of the account or book. */
+/** Destroy an import map, committing it first. All stored entries
+ will still continue to exist in the underlying kvp frame of the
+ account or book. */
 void gnc_imap_destroy (GncImportMatchMap *imap);
 
 /** Clear an import map -- this removes ALL entries in the map */
@@ -60,12 +61,16 @@ void gnc_imap_add_account (GncImportMatchMap *imap, const char *category,
   from the current transaction */
 Account* gnc_imap_find_account_bayes (GncImportMatchMap *imap, GList* tokens);
 
-/** Store an Account in the map. This mapping is immediatly stored in
-  the underlying kvp frame, regardless of whether the MatchMap is
-  destroyed later or not. */
+/** Store an Account in the map.  The bayes data is kept in memory;
+  this mapping is stored in the underlying kvp frame by
+  gnc_imap_commit, or when the MatchMap is destroyed. */
 void gnc_imap_add_account_bayes (GncImportMatchMap *imap, GList* tokens,
                                  Account *acc);
 
+/** Write the bayes mappings added since the last commit to the
+  underlying kvp frame. */
+void gnc_imap_commit (GncImportMatchMap *imap);
+
 
 /** @name Some well-known categories
 
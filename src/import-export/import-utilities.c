@@ -40,11 +40,21 @@
  * Account, Transaction and Split
 \********************************************************************/
 
+/* Matching looks up the online_id of every split and transaction
+ * in the accounts, so the path is only parsed once. */
+static const KvpPath * online_id_path(void)
+{
+    static KvpPath *path = NULL;
+    if (!path)
+        path = kvp_path_new("online_id");
+    return path;
+}
+
 const gchar * gnc_import_get_acc_online_id(Account * account)
 {
     kvp_frame * frame;
     frame = xaccAccountGetSlots(account);
-    return kvp_frame_get_string(frame, "online_id");
+    return kvp_frame_get_string_at(frame, online_id_path());
 }
 
 void gnc_import_set_acc_online_id(Account * account,
@@ -52,14 +62,14 @@ void gnc_import_set_acc_online_id(Account * account,
 {
     kvp_frame * frame;
     frame = xaccAccountGetSlots(account);
-    kvp_frame_set_str(frame, "online_id", string_value);
+    kvp_frame_set_string_at(frame, online_id_path(), string_value);
 }
 
 const gchar * gnc_import_get_trans_online_id(Transaction * transaction)
 {
     kvp_frame * frame;
     frame = xaccTransGetSlots(transaction);
-    return kvp_frame_get_string(frame, "online_id");
+    return kvp_frame_get_string_at(frame, online_id_path());
 }
 
 void gnc_import_set_trans_online_id(Transaction * transaction,
@@ -67,7 +77,7 @@ void gnc_import_set_trans_online_id(Transaction * transaction,
 {
     kvp_frame * frame;
     frame = xaccTransGetSlots(transaction);
-    kvp_frame_set_str (frame, "online_id", string_value);
+    kvp_frame_set_string_at(frame, online_id_path(), string_value);
 }
 
 gboolean gnc_import_trans_has_online_id(Transaction * transaction)
@@ -81,7 +91,7 @@ const gchar * gnc_import_get_split_online_id(Split * split)
 {
     kvp_frame * frame;
     frame = xaccSplitGetSlots(split);
-    return kvp_frame_get_string(frame, "online_id");
+    return kvp_frame_get_string_at(frame, online_id_path());
 }
 
 void gnc_import_set_split_online_id(Split * split,
@@ -89,7 +99,7 @@ void gnc_import_set_split_online_id(Split * split,
 {
     kvp_frame * frame;
     frame = xaccSplitGetSlots(split);
-    kvp_frame_set_str (frame, "online_id", string_value);
+    kvp_frame_set_string_at(frame, online_id_path(), string_value);
 }
 
 gboolean gnc_import_split_has_online_id(Split * split)
@@ -99,4 +109,266 @@ gboolean gnc_import_split_has_online_id(Split * split)
     return (online_id != NULL && strlen(online_id) > 0);
 }
 
+/********************************************************************\
+ * The online_id index.  Looking for an online_id used to mean
+ * reading the kvp frames of every transaction in the account, once
+ * for every imported transaction.  The index maps the online_id's of
+ * an account to its transactions.  It is built for an account the
+ * first time it is asked about that account, and kept current by
+ * listening for transaction events.
+\********************************************************************/
+
+#define ONLINE_ID_INDEX "gnc-import-online-id-index"
+
+typedef struct
+{
+    /* Account -> GHashTable of online_id -> GList of Transaction */
+    GHashTable *accounts;
+    /* Transaction -> GList of OnlineIdEntry, to forget it again */
+    GHashTable *entries;
+    gint trans_listener;
+    gint account_listener;
+} OnlineIdIndex;
+
+typedef struct
+{
+    Account *account;
+    gchar *online_id;
+} OnlineIdEntry;
+
+/* The online_id of trans in account, the way the importers store it:
+   on the split if it has one, otherwise on the transaction. */
+static const gchar *
+trans_online_id_in_account(Transaction *trans, Account *account)
+{
+    Split *split = xaccTransFindSplitByAccount(trans, account);
+    const gchar *online_id;
+
+    if (split == NULL)
+        return NULL;
+    if (gnc_import_split_has_online_id(split))
+        return gnc_import_get_split_online_id(split);
+    online_id = gnc_import_get_trans_online_id(trans);
+    return (online_id != NULL && *online_id) ? online_id : NULL;
+}
+
+static void
+free_online_id_list(gpointer key, gpointer value, gpointer user_data)
+{
+    g_list_free(value);
+}
+
+static void
+destroy_account_ids(gpointer data)
+{
+    GHashTable *ids = data;
+
+    g_hash_table_foreach(ids, free_online_id_list, NULL);
+    g_hash_table_destroy(ids);
+}
+
+static void
+index_add(OnlineIdIndex *index, GHashTable *ids, Account *account,
+          Transaction *trans)
+{
+    const gchar *online_id = trans_online_id_in_account(trans, account);
+    OnlineIdEntry *entry;
+    GList *list;
+
+    if (online_id == NULL)
+        return;
+
+    list = g_hash_table_lookup(ids, online_id);
+    g_hash_table_insert(ids, g_strdup(online_id), g_list_prepend(list, trans));
+
+    entry = g_new(OnlineIdEntry, 1);
+    entry->account = account;
+    entry->online_id = g_strdup(online_id);
+    g_hash_table_insert(index->entries, trans,
+                        g_list_prepend(g_hash_table_lookup(index->entries, trans),
+                                       entry));
+}
+
+static void
+index_forget(OnlineIdIndex *index, Transaction *trans)
+{
+    GList *entries = g_hash_table_lookup(index->entries, trans);
+    GList *node;
+
+    for (node = entries; node; node = node->next)
+    {
+        OnlineIdEntry *entry = node->data;
+        GHashTable *ids = g_hash_table_lookup(index->accounts, entry->account);
+        GList *list;
+
+        if (ids && (list = g_hash_table_lookup(ids, entry->online_id)))
+        {
+            list = g_list_remove(list, trans);
+            if (list)
+                g_hash_table_insert(ids, g_strdup(entry->online_id), list);
+            else
+                g_hash_table_remove(ids, entry->online_id);
+        }
+        g_free(entry->online_id);
+        g_free(entry);
+    }
+    g_list_free(entries);
+    g_hash_table_remove(index->entries, trans);
+}
+
+/* Index trans again in all the indexed accounts it has splits in. */
+static void
+index_update(OnlineIdIndex *index, Transaction *trans)
+{
+    GList *node;
+
+    index_forget(index, trans);
+    for (node = xaccTransGetSplitList(trans); node; node = node->next)
+    {
+        Account *account = xaccSplitGetAccount(node->data);
+        GHashTable *ids;
+
+        if (account == NULL ||
+                (ids = g_hash_table_lookup(index->accounts, account)) == NULL)
+            continue;
+        /* Only once for every account. */
+        if (xaccTransFindSplitByAccount(trans, account) != node->data)
+            continue;
+        index_add(index, ids, account, trans);
+    }
+}
+
+static void
+listen_for_trans_events(QofInstance *entity, QofEventId event_type,
+                        gpointer user_data, gpointer event_data)
+{
+    OnlineIdIndex *index = user_data;
+    Transaction *trans = GNC_TRANS(entity);
+
+    if ((event_type & QOF_EVENT_DESTROY) || qof_instance_get_destroying(trans))
+        index_forget(index, trans);
+    else
+        index_update(index, trans);
+}
+
+static void
+listen_for_account_events(QofInstance *entity, QofEventId event_type,
+                          gpointer user_data, gpointer event_data)
+{
+    OnlineIdIndex *index = user_data;
+
+    /* The entries of its transactions are forgotten with them. */
+    g_hash_table_remove(index->accounts, entity);
+}
+
+static void
+free_entries(gpointer key, gpointer value, gpointer user_data)
+{
+    GList *node;
+
+    for (node = value; node; node = node->next)
+    {
+        OnlineIdEntry *entry = node->data;
+        g_free(entry->online_id);
+        g_free(entry);
+    }
+    g_list_free(value);
+}
+
+static void
+online_id_index_destroy(QofBook *book, gpointer key, gpointer user_data)
+{
+    OnlineIdIndex *index = user_data;
+
+    qof_event_unregister_handler(index->trans_listener);
+    qof_event_unregister_handler(index->account_listener);
+    g_hash_table_foreach(index->entries, free_entries, NULL);
+    g_hash_table_destroy(index->entries);
+    g_hash_table_destroy(index->accounts);
+    g_free(index);
+}
+
+static OnlineIdIndex *
+online_id_index_get(QofBook *book)
+{
+    OnlineIdIndex *index = qof_book_get_data(book, ONLINE_ID_INDEX);
+
+    if (index)
+        return index;
+
+    index = g_new0(OnlineIdIndex, 1);
+    index->accounts = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                            NULL, destroy_account_ids);
+    index->entries = g_hash_table_new(g_direct_hash, g_direct_equal);
+    index->trans_listener =
+        qof_event_register_filtered_handler(listen_for_trans_events, index,
+                                            GNC_ID_TRANS,
+                                            QOF_EVENT_MODIFY | QOF_EVENT_DESTROY);
+    index->account_listener =
+        qof_event_register_filtered_handler(listen_for_account_events, index,
+                                            GNC_ID_ACCOUNT, QOF_EVENT_DESTROY);
+    qof_book_set_data_fin(book, ONLINE_ID_INDEX, index, online_id_index_destroy);
+    return index;
+}
+
+typedef struct
+{
+    OnlineIdIndex *index;
+    GHashTable *ids;
+    Account *account;
+} IndexBuildData;
+
+static gint
+index_build_cb(Transaction *trans, void *user_data)
+{
+    IndexBuildData *data = user_data;
+
+    index_add(data->index, data->ids, data->account, trans);
+    return 0;
+}
+
+static GHashTable *
+online_id_index_get_account(OnlineIdIndex *index, Account *account)
+{
+    GHashTable *ids = g_hash_table_lookup(index->accounts, account);
+    IndexBuildData data;
+
+    if (ids)
+        return ids;
+
+    ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_insert(index->accounts, account, ids);
+    data.index = index;
+    data.ids = ids;
+    data.account = account;
+    xaccAccountForEachTransaction(account, index_build_cb, &data);
+    return ids;
+}
+
+Transaction *
+gnc_import_find_trans_by_online_id(Account *account, const gchar *online_id,
+                                   Transaction *exclude)
+{
+    OnlineIdIndex *index;
+    GList *node;
+
+    if (account == NULL || online_id == NULL || *online_id == '\0')
+        return NULL;
+
+    index = online_id_index_get(gnc_account_get_book(account));
+    node = g_hash_table_lookup(online_id_index_get_account(index, account),
+                               online_id);
+    for (; node; node = node->next)
+        if (node->data != exclude)
+            return node->data;
+    return NULL;
+}
+
+void
+gnc_import_index_trans_online_id(Transaction *trans)
+{
+    g_return_if_fail(trans);
+    index_update(online_id_index_get(qof_instance_get_book(trans)), trans);
+}
+
 /* @} */
@@ -60,6 +60,34 @@ void gnc_import_set_split_online_id(Split * split,
 
 gboolean gnc_import_split_has_online_id(Split * split);
 
+/** @name Online_id index
+    Finding transactions by their online_id without reading the
+    kvp_frames of the whole account.  The index is built for an account
+    when it is first asked about it, and then follows the changes to
+    the transactions.
+	@{
+*/
+/** Find a transaction of account whose online_id is online_id.  The
+    online_id of a transaction is the one of its split in account, or
+    else its own.
+
+    @param exclude A transaction that should not be found, e.g. the
+    one being imported, or NULL.
+
+    @return A transaction other than exclude, or NULL if there is
+    none.
+*/
+Transaction * gnc_import_find_trans_by_online_id(Account * account,
+        const gchar * online_id,
+        Transaction * exclude);
+
+/** Add an imported transaction to the index right away.  A committed
+    transaction is indexed anyway; this is for the ones that are still
+    open, so that duplicates within the same import are found.
+*/
+void gnc_import_index_trans_online_id(Transaction * trans);
+/** @} */
+
 #endif
 /** @} */
 
@@ -0,0 +1,256 @@
+/*
+ * bench-import.c -- Time the import matchers and the bayes lookup.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+/* This is not run by "make check"; test-import-match and
+ * test-import-map-bayes check the results.  "bench-import match 20000
+ * 1000000" matches 20000 imported transactions, half of them copies,
+ * against an account of a million once one by one and once as a
+ * batch.  "bench-import bayes 200000" trains a map with that many
+ * tokens and times reading it back and looking accounts up.  Without
+ * arguments both run at their default sizes. */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libguile.h>
+
+#include "gnc-module.h"
+#include "gnc-ui-util.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "import-backend.h"
+#include "import-match-map.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define DEFAULT_IMPORTS 5000
+#define DEFAULT_TRANSACTIONS 200000
+#define DEFAULT_TOKENS 50000
+#define DISPLAY_THRESHOLD 1
+#define FUZZY_AMOUNT 2.0
+#define DATE_HARDLIMIT 42
+#define NUM_ACCOUNTS 20
+#define NUM_LOOKUPS 20000
+#define TOKENS_PER_LOOKUP 4
+
+static gnc_numeric
+random_amount (void)
+{
+    /* Few distinct amounts, so that there are many near misses. */
+    return gnc_numeric_create (get_random_int_in_range (-500, 500) * 100 +
+                               get_random_int_in_range (0, 3) * 25, 100);
+}
+
+static GList *
+make_imports (QofBook *book, Account *acc, Account *other,
+              GPtrArray *existing, guint imports)
+{
+    GList *infos = NULL;
+    guint i;
+
+    for (i = 0; i < imports; i++)
+    {
+        Transaction *trans;
+
+        if (i % 2)
+        {
+            Transaction *copy = g_ptr_array_index (existing, get_random_int_in_range
+                                                   (0, existing->len - 1));
+            trans = make_test_transaction
+                    (book, acc, other, xaccTransGetDate (copy) +
+                     get_random_int_in_range (-5, 5) * 86400,
+                     xaccSplitGetValue (xaccTransGetSplit (copy, 1)));
+            xaccTransSetDescription (trans, xaccTransGetDescription (copy));
+        }
+        else
+        {
+            trans = make_test_transaction (book, acc, other,
+                                           get_random_test_book_date (),
+                                           random_amount ());
+            xaccTransSetDescription (trans, "Grocery");
+        }
+        infos = g_list_prepend (infos, gnc_import_TransInfo_new (trans, NULL));
+    }
+    return infos;
+}
+
+static void
+free_imports (GList *infos)
+{
+    GList *node;
+
+    for (node = infos; node; node = node->next)
+        gnc_import_TransInfo_delete (node->data);
+    g_list_free (infos);
+}
+
+static void
+bench_match (guint imports, guint count)
+{
+    QofBook *book = gnc_get_current_book ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Account *acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    Account *other = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    GPtrArray *existing = g_ptr_array_new ();
+    GList *infos, *node;
+    GTimer *timer;
+    gdouble single_time, batch_time;
+    guint i;
+
+    for (i = 0; i < count; i++)
+    {
+        Transaction *trans = make_test_transaction (book, acc, other,
+                                                    get_random_test_book_date (),
+                                                    random_amount ());
+
+        xaccTransSetDescription (trans, "Grocery");
+        xaccTransCommitEdit (trans);
+        g_ptr_array_add (existing, trans);
+    }
+
+    infos = make_imports (book, acc, other, existing, imports);
+    timer = g_timer_new ();
+    for (node = infos; node; node = node->next)
+        gnc_import_find_split_matches (node->data, DISPLAY_THRESHOLD,
+                                       FUZZY_AMOUNT, DATE_HARDLIMIT);
+    single_time = g_timer_elapsed (timer, NULL);
+    free_imports (infos);
+
+    infos = make_imports (book, acc, other, existing, imports);
+    g_timer_start (timer);
+    gnc_import_find_split_matches_batch (infos, DISPLAY_THRESHOLD,
+                                         FUZZY_AMOUNT, DATE_HARDLIMIT);
+    batch_time = g_timer_elapsed (timer, NULL);
+    free_imports (infos);
+
+    printf ("%8u imports, %8u transactions: single %10.3f s, "
+            "batch %10.3f s\n", imports, count, single_time, batch_time);
+
+    g_ptr_array_free (existing, TRUE);
+    g_timer_destroy (timer);
+}
+
+static void
+bench_bayes (guint n_tokens)
+{
+    QofBook *book = gnc_get_current_book ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Account *import = make_test_account (book, NULL, ACCT_TYPE_BANK, usd,
+                                         "Import");
+    Account *copy = make_test_account (book, NULL, ACCT_TYPE_BANK, usd,
+                                       "Copy");
+    Account *accounts[NUM_ACCOUNTS];
+    GncImportMatchMap *imap;
+    GPtrArray *token_names = g_ptr_array_new ();
+    GList **lookups = g_new0 (GList *, NUM_LOOKUPS);
+    GTimer *timer;
+    gdouble load_time, lookup_time;
+    guint matched = 0, i, j;
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+    {
+        gchar *name = g_strdup_printf ("Expense %u", i);
+        accounts[i] = make_test_account (book, NULL, ACCT_TYPE_EXPENSE, usd,
+                                         name);
+        g_free (name);
+    }
+    for (i = 0; i < n_tokens; i++)
+        g_ptr_array_add (token_names, g_strdup_printf ("token%u", i));
+
+    imap = gnc_imap_create_from_account (import);
+    for (i = 0; i < n_tokens; i++)
+    {
+        GList *tokens = g_list_prepend (NULL, token_names->pdata[i]);
+
+        for (j = get_random_int_in_range (1, 5); j > 0; j--)
+            gnc_imap_add_account_bayes (imap, tokens, accounts[i % NUM_ACCOUNTS]);
+        g_list_free (tokens);
+    }
+    gnc_imap_destroy (imap);
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+        for (j = 0; j < TOKENS_PER_LOOKUP; j++)
+            lookups[i] = g_list_prepend (lookups[i], token_names->pdata
+                                         [get_random_int_in_range (0, n_tokens - 1)]);
+
+    /* A fresh account with the same frame has to read the map back. */
+    xaccAccountBeginEdit (copy);
+    kvp_frame_set_frame (xaccAccountGetSlots (copy), "import-map-bayes",
+                         kvp_frame_get_frame (xaccAccountGetSlots (import),
+                                              "import-map-bayes"));
+    qof_instance_set_dirty (QOF_INSTANCE (copy));
+    xaccAccountCommitEdit (copy);
+
+    timer = g_timer_new ();
+    imap = gnc_imap_create_from_account (copy);
+    gnc_imap_find_account_bayes (imap, lookups[0]);
+    load_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (i = 0; i < NUM_LOOKUPS; i++)
+        if (gnc_imap_find_account_bayes (imap, lookups[i]))
+            matched++;
+    lookup_time = g_timer_elapsed (timer, NULL);
+    gnc_imap_destroy (imap);
+
+    printf ("%8u tokens, %u lookups, %u matched: model load %9.3f ms, "
+            "lookups %9.3f ms\n", n_tokens, NUM_LOOKUPS, matched,
+            load_time * 1e3, lookup_time * 1e3);
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+        g_list_free (lookups[i]);
+    g_free (lookups);
+    for (i = 0; i < token_names->len; i++)
+        g_free (token_names->pdata[i]);
+    g_ptr_array_free (token_names, TRUE);
+    g_timer_destroy (timer);
+}
+
+static void
+main_helper (void *closure, int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+
+    gnc_module_load ("gnucash/import-export", 0);
+    xaccLogDisable ();
+
+    if (!name || strcmp (name, "match") == 0)
+        bench_match (argc > 2 ? MAX (atoi (argv[2]), 1) : DEFAULT_IMPORTS,
+                     argc > 3 ? MAX (atoi (argv[3]), 1) : DEFAULT_TRANSACTIONS);
+    if (!name || strcmp (name, "bayes") == 0)
+        bench_bayes (argc > 2 ? MAX (atoi (argv[2]), NUM_ACCOUNTS)
+                     : DEFAULT_TOKENS);
+    exit (0);
+}
+
+int
+main (int argc, char **argv)
+{
+    scm_boot_guile (argc, argv, main_helper, NULL);
+    return 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * test-import-map-bayes.c -- Check the bayes account lookup.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+/* An import account is trained with a number of tokens, most of them
+ * used for one destination account only.  Every lookup of
+ * gnc_imap_find_account_bayes is checked against the probabilities
+ * computed straight from the kvp frame, the way the lookup used to do
+ * it, once through the trained map and once through the map of an
+ * account that only got a copy of the frame.  bench-import times the
+ * lookups on bigger maps. */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include <libguile.h>
+
+#include "gnc-module.h"
+#include "gnc-ui-util.h"
+#include "Account.h"
+#include "gnc-commodity.h"
+#include "import-match-map.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TOKENS 2000
+#define NUM_ACCOUNTS 20
+#define NUM_LOOKUPS 2000
+#define TOKENS_PER_LOOKUP 4
+#define PROBABILITY_FACTOR 100000
+
+typedef struct
+{
+    double product;
+    double product_difference;
+} Probability;
+
+/* The reference: read the counts of every token from the kvp frame. */
+static void
+add_token_account (const char *key, KvpValue *value, gpointer data)
+{
+    GHashTable *counts = data;
+
+    g_hash_table_insert (counts, (gpointer)key, value);
+}
+
+static GHashTable *
+reference_probabilities (kvp_frame *frame, GList *tokens)
+{
+    GHashTable *probabilities = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                NULL, g_free);
+    GList *node;
+
+    for (node = tokens; node; node = node->next)
+    {
+        KvpValue *value = kvp_frame_get_slot_path (frame, "import-map-bayes",
+                          node->data, NULL);
+        GHashTable *counts;
+        GHashTableIter iter;
+        gpointer name, count;
+        gint64 total = 0;
+
+        if (!value)
+            continue;
+        counts = g_hash_table_new (g_str_hash, g_str_equal);
+        kvp_frame_for_each_slot (kvp_value_get_frame (value),
+                                 add_token_account, counts);
+        g_hash_table_iter_init (&iter, counts);
+        while (g_hash_table_iter_next (&iter, &name, &count))
+            total += kvp_value_get_gint64 (count);
+
+        g_hash_table_iter_init (&iter, counts);
+        while (g_hash_table_iter_next (&iter, &name, &count))
+        {
+            Probability *p = g_hash_table_lookup (probabilities, name);
+            double a = (double)kvp_value_get_gint64 (count) / (double)total;
+
+            if (p)
+            {
+                p->product *= a;
+                p->product_difference *= 1 - a;
+            }
+            else
+            {
+                p = g_new (Probability, 1);
+                p->product = a;
+                p->product_difference = 1 - a;
+                g_hash_table_insert (probabilities, name, p);
+            }
+        }
+        g_hash_table_destroy (counts);
+    }
+    return probabilities;
+}
+
+static gint32
+probability_of (Probability *p)
+{
+    return (p->product / (p->product + p->product_difference))
+           * PROBABILITY_FACTOR;
+}
+
+/* Check that found is one of the best accounts, if any is good enough. */
+static gboolean
+reference_agrees (kvp_frame *frame, GList *tokens, Account *found)
+{
+    GHashTable *probabilities = reference_probabilities (frame, tokens);
+    GHashTableIter iter;
+    gpointer name, p;
+    gint32 best = 0;
+    gboolean agrees;
+
+    g_hash_table_iter_init (&iter, probabilities);
+    while (g_hash_table_iter_next (&iter, &name, &p))
+        best = MAX (best, probability_of (p));
+
+    if (best < .90 * PROBABILITY_FACTOR)
+    {
+        agrees = (found == NULL);
+    }
+    else
+    {
+        gchar *found_name = found ? gnc_account_get_full_name (found) : NULL;
+
+        p = found_name ? g_hash_table_lookup (probabilities, found_name) : NULL;
+        agrees = (p && probability_of (p) == best);
+        g_free (found_name);
+    }
+    g_hash_table_destroy (probabilities);
+    return agrees;
+}
+
+/* An account with a copy of the bayes data of acc, but no map
+ * built from it yet. */
+static Account *
+copy_bayes_data (QofBook *book, Account *acc, gnc_commodity *currency)
+{
+    Account *copy = make_test_account (book, NULL, ACCT_TYPE_BANK, currency,
+                                       "Copy");
+
+    xaccAccountBeginEdit (copy);
+    kvp_frame_set_frame (xaccAccountGetSlots (copy), "import-map-bayes",
+                         kvp_frame_get_frame (xaccAccountGetSlots (acc),
+                                              "import-map-bayes"));
+    qof_instance_set_dirty (QOF_INSTANCE (copy));
+    xaccAccountCommitEdit (copy);
+    return copy;
+}
+
+/* Look up every token list through imap and compare with the frame. */
+static void
+check_lookups (GncImportMatchMap *imap, kvp_frame *frame, GList **lookups,
+               const char *title)
+{
+    guint agreed = 0, matched = 0, i;
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+    {
+        Account *found = gnc_imap_find_account_bayes (imap, lookups[i]);
+
+        if (reference_agrees (frame, lookups[i], found))
+            agreed++;
+        if (found)
+            matched++;
+    }
+    do_test (agreed == NUM_LOOKUPS, title);
+    do_test (matched > 0, title);
+}
+
+static void
+run_test (guint n_tokens)
+{
+    QofBook *book = gnc_get_current_book ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Account *import = make_test_account (book, NULL, ACCT_TYPE_BANK, usd,
+                                         "Import");
+    Account *accounts[NUM_ACCOUNTS];
+    Account *copy;
+    GncImportMatchMap *imap;
+    GPtrArray *token_names = g_ptr_array_new ();
+    GList **lookups = g_new0 (GList *, NUM_LOOKUPS);
+    guint i, j;
+
+    for (i = 0; i < NUM_ACCOUNTS; i++)
+    {
+        gchar *name = g_strdup_printf ("Expense %u", i);
+        accounts[i] = make_test_account (book, NULL, ACCT_TYPE_EXPENSE, usd,
+                                         name);
+        g_free (name);
+    }
+    for (i = 0; i < n_tokens; i++)
+        g_ptr_array_add (token_names, g_strdup_printf ("token%u", i));
+
+    /* Train: token i belongs to account i % NUM_ACCOUNTS, with some
+       noise from the others. */
+    imap = gnc_imap_create_from_account (import);
+    for (i = 0; i < n_tokens; i++)
+    {
+        GList *tokens = g_list_prepend (NULL, token_names->pdata[i]);
+
+        for (j = get_random_int_in_range (1, 5); j > 0; j--)
+            gnc_imap_add_account_bayes (imap, tokens, accounts[i % NUM_ACCOUNTS]);
+        if (i % 3 == 0)
+            gnc_imap_add_account_bayes (imap, tokens, accounts
+                                        [get_random_int_in_range (0, NUM_ACCOUNTS - 1)]);
+        g_list_free (tokens);
+    }
+    gnc_imap_destroy (imap);
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+    {
+        guint account = get_random_int_in_range (0, NUM_ACCOUNTS - 1);
+
+        for (j = 0; j < TOKENS_PER_LOOKUP; j++)
+        {
+            guint token = get_random_int_in_range (0, n_tokens / NUM_ACCOUNTS - 1)
+                          * NUM_ACCOUNTS + account;
+            /* Some tokens of other accounts, and some unknown ones. */
+            if (j == 0 && i % 4 == 0)
+                token = get_random_int_in_range (0, n_tokens - 1);
+            if (j == 1 && i % 5 == 0)
+                token = n_tokens;
+            lookups[i] = g_list_prepend (lookups[i], token < n_tokens ?
+                                         token_names->pdata[token] : "unknown");
+        }
+    }
+
+    imap = gnc_imap_create_from_account (import);
+    check_lookups (imap, xaccAccountGetSlots (import), lookups,
+                   "lookups of the trained map agree with the kvp frame");
+    gnc_imap_destroy (imap);
+
+    /* The same counts read back from the kvp frame alone. */
+    copy = copy_bayes_data (book, import, usd);
+    imap = gnc_imap_create_from_account (copy);
+    check_lookups (imap, xaccAccountGetSlots (import), lookups,
+                   "lookups of the copied frame agree with the kvp frame");
+    gnc_imap_destroy (imap);
+
+    for (i = 0; i < NUM_LOOKUPS; i++)
+        g_list_free (lookups[i]);
+    g_free (lookups);
+    for (i = 0; i < token_names->len; i++)
+        g_free (token_names->pdata[i]);
+    g_ptr_array_free (token_names, TRUE);
+}
+
+static void
+main_helper (void *closure, int argc, char **argv)
+{
+    gnc_module_load ("gnucash/import-export", 0);
+    run_test (NUM_TOKENS);
+    print_test_results ();
+    exit (get_rv ());
+}
+
+int
+main (int argc, char **argv)
+{
+    scm_boot_guile (argc, argv, main_helper, NULL);
+    return 0;
+}
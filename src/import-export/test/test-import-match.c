@@ -0,0 +1,206 @@
+/*
+ * test-import-match.c -- Compare the import matchers.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+/* The book gets an import account full of transactions spread over ten
+ * years.  Half of the imported transactions are copies of some of
+ * them, a few days off, the others are new.  Every imported
+ * transaction is matched once by gnc_import_find_split_matches and
+ * once by gnc_import_find_split_matches_batch, and both have to find
+ * the same splits with the same probabilities.  bench-import times
+ * both on bigger imports. */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include <libguile.h>
+
+#include "gnc-module.h"
+#include "gnc-ui-util.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "import-backend.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_IMPORTS 500
+#define NUM_TRANSACTIONS 5000
+#define DISPLAY_THRESHOLD 1
+#define FUZZY_AMOUNT 2.0
+#define DATE_HARDLIMIT 42
+
+static const char *descriptions[] = { "Grocery", "Gas station", "Salary",
+                                      "Rent", "ATM withdrawal", NULL
+                                    };
+
+/* The split in acc gets the amount.  The transaction is left open,
+ * as the importers do. */
+static Transaction *
+make_transaction (QofBook *book, Account *acc, Account *other, time_t date,
+                  gnc_numeric amount, const char *description,
+                  const char *num)
+{
+    Transaction *trans = make_test_transaction (book, acc, other, date,
+                                                gnc_numeric_neg (amount));
+
+    xaccTransSetDescription (trans, description);
+    xaccTransSetNum (trans, num);
+    return trans;
+}
+
+static gnc_numeric
+random_amount (void)
+{
+    /* Few distinct amounts, so that there are many near misses. */
+    return gnc_numeric_create (get_random_int_in_range (-500, 500) * 100 +
+                               get_random_int_in_range (0, 3) * 25, 100);
+}
+
+static gboolean
+same_matches (GNCImportTransInfo *a, GNCImportTransInfo *b)
+{
+    GHashTable *found = g_hash_table_new (g_direct_hash, g_direct_equal);
+    GList *list_a = gnc_import_TransInfo_get_match_list (a);
+    GList *list_b = gnc_import_TransInfo_get_match_list (b);
+    gboolean same = (g_list_length (list_a) == g_list_length (list_b));
+    GList *node;
+
+    for (node = list_a; node; node = node->next)
+        g_hash_table_insert (found, gnc_import_MatchInfo_get_split (node->data),
+                             GINT_TO_POINTER (gnc_import_MatchInfo_get_probability (node->data)));
+    for (node = list_b; same && node; node = node->next)
+    {
+        gpointer prob;
+
+        same = g_hash_table_lookup_extended (found,
+                                             gnc_import_MatchInfo_get_split (node->data),
+                                             NULL, &prob)
+               && GPOINTER_TO_INT (prob) == gnc_import_MatchInfo_get_probability (node->data);
+    }
+    g_hash_table_destroy (found);
+    return same;
+}
+
+static void
+run_test (guint imports, guint count)
+{
+    QofBook *book = gnc_get_current_book ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Account *acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    Account *other = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    GPtrArray *existing = g_ptr_array_new ();
+    GList *single = NULL, *batch = NULL, *node_a, *node_b;
+    guint matches = 0, i;
+    gboolean same = TRUE;
+
+    for (i = 0; i < count; i++)
+    {
+        gchar *num = g_strdup_printf ("%u", i);
+        Transaction *trans = make_transaction (book, acc, other,
+                                               get_random_test_book_date (),
+                                               random_amount (),
+                                               descriptions[i % 5],
+                                               i % 7 ? "" : num);
+
+        xaccTransCommitEdit (trans);
+        g_ptr_array_add (existing, trans);
+        g_free (num);
+    }
+
+    for (i = 0; i < imports; i++)
+    {
+        Transaction *trans;
+
+        if (i % 2)
+        {
+            Transaction *copy = g_ptr_array_index (existing, get_random_int_in_range
+                                                   (0, existing->len - 1));
+            trans = make_transaction (book, acc, other,
+                                      xaccTransGetDate (copy) +
+                                      get_random_int_in_range (-5, 5) * 86400,
+                                      xaccSplitGetAmount (xaccTransGetSplit (copy, 0)),
+                                      xaccTransGetDescription (copy),
+                                      xaccTransGetNum (copy));
+        }
+        else
+        {
+            trans = make_transaction (book, acc, other,
+                                      get_random_test_book_date (),
+                                      random_amount (), descriptions[i % 5],
+                                      "");
+        }
+        single = g_list_prepend (single, gnc_import_TransInfo_new (trans, NULL));
+        batch = g_list_prepend (batch, gnc_import_TransInfo_new (trans, NULL));
+    }
+
+    for (node_a = single; node_a; node_a = node_a->next)
+        gnc_import_find_split_matches (node_a->data, DISPLAY_THRESHOLD,
+                                       FUZZY_AMOUNT, DATE_HARDLIMIT);
+    gnc_import_find_split_matches_batch (batch, DISPLAY_THRESHOLD,
+                                         FUZZY_AMOUNT, DATE_HARDLIMIT);
+
+    for (node_a = single, node_b = batch; node_a && node_b;
+            node_a = node_a->next, node_b = node_b->next)
+    {
+        matches += g_list_length (gnc_import_TransInfo_get_match_list (node_a->data));
+        same = same && same_matches (node_a->data, node_b->data);
+    }
+    do_test (same, "batch matches equal single matches");
+    do_test (matches > 0, "matches found");
+
+    /* Both infos share the transaction, which is destroyed with the
+       first one, so the second one is freed like
+       gnc_import_TransInfo_delete does, without the transaction. */
+    for (node_b = batch; node_b; node_b = node_b->next)
+    {
+        GList *match_list = gnc_import_TransInfo_get_match_list (node_b->data);
+
+        for (node_a = match_list; node_a; node_a = node_a->next)
+            g_free (node_a->data);
+        g_list_free (match_list);
+        g_free (node_b->data);
+    }
+    for (node_a = single; node_a; node_a = node_a->next)
+        gnc_import_TransInfo_delete (node_a->data);
+    g_list_free (single);
+    g_list_free (batch);
+    g_ptr_array_free (existing, TRUE);
+}
+
+static void
+main_helper (void *closure, int argc, char **argv)
+{
+    gnc_module_load ("gnucash/import-export", 0);
+    xaccLogDisable ();
+    run_test (NUM_IMPORTS, NUM_TRANSACTIONS);
+    print_test_results ();
+    exit (get_rv ());
+}
+
+int
+main (int argc, char **argv)
+{
+    scm_boot_guile (argc, argv, main_helper, NULL);
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * test-import-online-id.c -- Check the online_id index of the importers.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+/* An account gets a transaction with the online_id on its split and
+ * one with the online_id on the transaction, and both are looked up
+ * through gnc_import_find_trans_by_online_id.  Then the online_id of
+ * the first is changed, the second is destroyed and an open imported
+ * transaction is indexed, and every lookup has to follow. */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+#include <libguile.h>
+
+#include "gnc-module.h"
+#include "gnc-ui-util.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include "gnc-commodity.h"
+#include "import-utilities.h"
+
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+/* Leaves the transaction open, as the importers do; the split in acc
+ * is the first one. */
+static Transaction *
+make_transaction (QofBook *book, Account *acc, Account *other)
+{
+    return make_test_transaction (book, acc, other, TEST_BOOK_START,
+                                  gnc_numeric_create (-1000, 100));
+}
+
+static void
+run_test (void)
+{
+    QofBook *book = gnc_get_current_book ();
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "ISO4217",
+                                            "USD", "840", 100);
+    Account *acc = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    Account *other = make_test_account (book, NULL, ACCT_TYPE_BANK, usd, NULL);
+    Transaction *on_split, *on_trans, *open;
+
+    on_split = make_transaction (book, acc, other);
+    gnc_import_set_split_online_id (xaccTransGetSplit (on_split, 0), "split-1");
+    xaccTransCommitEdit (on_split);
+    on_trans = make_transaction (book, acc, other);
+    gnc_import_set_trans_online_id (on_trans, "trans-1");
+    xaccTransCommitEdit (on_trans);
+
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-1", NULL) == on_split,
+             "online_id of the split found");
+    do_test (gnc_import_find_trans_by_online_id (acc, "trans-1", NULL) == on_trans,
+             "online_id of the transaction found");
+    do_test (gnc_import_find_trans_by_online_id (acc, "none", NULL) == NULL,
+             "unknown online_id not found");
+    do_test (gnc_import_find_trans_by_online_id (acc, "", NULL) == NULL,
+             "empty online_id not found");
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-1", on_split) == NULL,
+             "excluded transaction not found");
+    do_test (gnc_import_find_trans_by_online_id (other, "split-1", NULL) == NULL,
+             "online_id of a split in another account not found");
+    do_test (gnc_import_find_trans_by_online_id (other, "trans-1", NULL) == on_trans,
+             "online_id of the transaction found in the other account");
+
+    xaccTransBeginEdit (on_split);
+    gnc_import_set_split_online_id (xaccTransGetSplit (on_split, 0), "split-2");
+    xaccTransCommitEdit (on_split);
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-1", NULL) == NULL,
+             "old online_id not found after the change");
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-2", NULL) == on_split,
+             "new online_id found after the change");
+
+    xaccTransBeginEdit (on_trans);
+    xaccTransDestroy (on_trans);
+    xaccTransCommitEdit (on_trans);
+    do_test (gnc_import_find_trans_by_online_id (acc, "trans-1", NULL) == NULL,
+             "online_id of a destroyed transaction not found");
+    do_test (gnc_import_find_trans_by_online_id (other, "trans-1", NULL) == NULL,
+             "online_id of a destroyed transaction not found in the other account");
+
+    open = make_transaction (book, acc, other);
+    gnc_import_set_split_online_id (xaccTransGetSplit (open, 0), "split-3");
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-3", NULL) == NULL,
+             "open transaction not found before it is indexed");
+    gnc_import_index_trans_online_id (open);
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-3", NULL) == open,
+             "open transaction found once indexed");
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-3", open) == NULL,
+             "open transaction excluded");
+
+    xaccTransDestroy (open);
+    xaccTransCommitEdit (open);
+    do_test (gnc_import_find_trans_by_online_id (acc, "split-3", NULL) == NULL,
+             "online_id of a destroyed open transaction not found");
+}
+
+static void
+main_helper (void *closure, int argc, char **argv)
+{
+    gnc_module_load ("gnucash/import-export", 0);
+    xaccLogDisable ();
+    run_test ();
+    print_test_results ();
+    exit (get_rv ());
+}
+
+int
+main (int argc, char **argv)
+{
+    scm_boot_guile (argc, argv, main_helper, NULL);
+    return 0;
+}
@@ -44,6 +44,9 @@
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#ifdef HAVE_PTHREAD_ATFORK
+# include <pthread.h>
+#endif
 #include "qof.h"
 #include "md5.h"
 
@@ -56,10 +59,35 @@
 #define BLOCKSIZE 4096
 #define THRESHOLD (2 * BLOCKSIZE)
 
+/* The ids are taken from a ChaCha20 keystream.  The key comes from
+ * /dev/urandom, or from the md5 of the old entropy pool where there is
+ * none.  Every thread runs its own stream, with its own nonce, and
+ * makes GUID_BATCH_BLOCKS blocks of ids at a time. */
+#define GUID_KEY_SIZE 32
+#define CHACHA_BLOCK_SIZE 64
+#define GUID_BATCH_BLOCKS 4
+#define GUID_BATCH_SIZE (GUID_BATCH_BLOCKS * CHACHA_BLOCK_SIZE / GUID_DATA_SIZE)
+
+typedef struct
+{
+    guint32 input[16];
+    guchar ids[GUID_BATCH_SIZE * GUID_DATA_SIZE];
+    guint used;
+    gint generation;
+} GuidGenerator;
+
 
 /* Static global variables *****************************************/
 static gboolean guid_initialized = FALSE;
 static struct md5_ctx guid_context;
+static guint32 guid_key[GUID_KEY_SIZE / 4];
+/* Bumped whenever the key changes, including in a forked child, where
+ * it is read without the lock. */
+static volatile gint guid_generation = 0;
+static guint64 guid_thread_serial = 0;
+static gboolean guid_forked = FALSE;
+static GStaticMutex guid_mutex = G_STATIC_MUTEX_INIT;
+static GStaticPrivate guid_generator = G_STATIC_PRIVATE_INIT;
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
@@ -340,43 +368,15 @@ init_from_time(void)
     return total;
 }
 
-static size_t
-init_from_int(int val)
-{
-    ENTER("");
-    md5_process_bytes(&val, sizeof(val), &guid_context);
-    LEAVE("");
-    return sizeof(int);
-}
-
-static size_t
-init_from_buff(unsigned char * buf, size_t buflen)
-{
-    ENTER("");
-    md5_process_bytes(buf, buflen, &guid_context);
-    LEAVE("");
-    return buflen;
-}
-
-void
-guid_init(void)
+/* The old entropy pool, for systems without /dev/urandom. */
+static void
+init_key_from_system(guchar *key)
 {
+    struct md5_ctx ctx;
     size_t bytes = 0;
 
-    ENTER("");
-
-    /* Not needed; taken care of on first malloc.
-     * guid_memchunk_init(); */
-
     md5_init_ctx(&guid_context);
 
-    /* entropy pool
-     * FIXME /dev/urandom doesn't exist on Windows. We should
-     *       use the Windows native CryptGenRandom or RtlGenRandom
-     *       functions. See
-     *       http://en.wikipedia.org/wiki/CryptGenRandom */
-    bytes += init_from_file ("/dev/urandom", 512);
-
     /* files
      * FIXME none of these directories make sense on
      *       Windows. We should figure out some proper
@@ -522,66 +522,214 @@ guid_init(void)
               (unsigned long int)bytes);
 #endif
 
-    guid_initialized = TRUE;
-    LEAVE();
+    ctx = guid_context;
+    md5_process_bytes("0", 1, &ctx);
+    md5_finish_ctx(&ctx, key);
+    ctx = guid_context;
+    md5_process_bytes("1", 1, &ctx);
+    md5_finish_ctx(&ctx, key + GUID_KEY_SIZE / 2);
 }
 
-void
-guid_shutdown (void)
+
+static inline guint32
+load_le32 (const guchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static inline void
+store_le32 (guchar *p, guint32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static gboolean
+init_key_from_urandom(guchar *key)
+{
+    FILE *fp;
+    size_t n;
+
+    fp = g_fopen ("/dev/urandom", "rb");
+    if (fp == NULL)
+        return FALSE;
+    n = fread (key, 1, GUID_KEY_SIZE, fp);
+    fclose (fp);
+    return n == GUID_KEY_SIZE;
+}
+
+#ifdef HAVE_PTHREAD_ATFORK
+/* Hold the lock across fork, so that the child doesn't inherit it
+ * taken by a thread it doesn't have. */
+static void
+guid_atfork_prepare (void)
+{
+    g_static_mutex_lock (&guid_mutex);
+}
+
+static void
+guid_atfork_parent (void)
 {
+    g_static_mutex_unlock (&guid_mutex);
 }
 
-#define GUID_PERIOD 5000
+/* The child shares the key and the nonces of its parent, so it must not
+ * make another id from them.  A new key is a read of /dev/urandom,
+ * which is left to its first id. */
+static void
+guid_atfork_child (void)
+{
+    guid_forked = TRUE;
+    g_atomic_int_inc (&guid_generation);
+    g_static_mutex_unlock (&guid_mutex);
+}
+#endif
 
 void
-guid_new(GncGUID *guid)
+guid_init(void)
 {
-    static int counter = 0;
-    struct md5_ctx ctx;
+    guchar key[GUID_KEY_SIZE];
+    int i;
 
-    if (guid == NULL)
-        return;
+    ENTER("");
 
+    /* FIXME /dev/urandom doesn't exist on Windows. We should
+     *       use the Windows native CryptGenRandom or RtlGenRandom
+     *       functions. See
+     *       http://en.wikipedia.org/wiki/CryptGenRandom */
+    if (!init_key_from_urandom (key))
+        init_key_from_system (key);
+
+    g_static_mutex_lock (&guid_mutex);
+    for (i = 0; i < GUID_KEY_SIZE / 4; i++)
+        guid_key[i] = load_le32 (key + 4 * i);
+    /* Every generator picks up the new key with its next id. */
+    g_atomic_int_inc (&guid_generation);
+    guid_thread_serial = 0;
+    guid_forked = FALSE;
+#ifdef HAVE_PTHREAD_ATFORK
     if (!guid_initialized)
-        guid_init();
+        pthread_atfork (guid_atfork_prepare, guid_atfork_parent,
+                        guid_atfork_child);
+#endif
+    guid_initialized = TRUE;
+    g_static_mutex_unlock (&guid_mutex);
 
-    /* make the id */
-    ctx = guid_context;
-    md5_finish_ctx(&ctx, guid->data);
-
-    /* update the global context */
-    init_from_time();
-
-    /* Make it a little extra salty.  I think init_from_time was buggy,
-    * or something, since duplicate id's actually happened. Or something
-    * like that.  I think this is because init_from_time kept returning
-    * the same values too many times in a row.  So we'll do some 'block
-    * chaining', and feed in the old guid as new random data.
-    *
-    * Anyway, I think the whole fact that I saw a bunch of duplicate
-    * id's at one point, but can't reproduce the bug is rather alarming.
-    * Something must be broken somewhere, and merely adding more salt
-    * is just hiding the problem, not fixing it.
-    */
-    init_from_int (433781 * counter);
-    init_from_buff (guid->data, GUID_DATA_SIZE);
-
-    if (counter == 0)
-    {
-        FILE *fp;
+    memset (key, 0, sizeof (key));
+    LEAVE("");
+}
 
-        fp = g_fopen ("/dev/urandom", "r");
-        if (fp == NULL)
-            return;
+void
+guid_shutdown (void)
+{
+}
 
-        init_from_stream(fp, 32);
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTERROUND(x, a, b, c, d) \
+    x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 16); \
+    x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 12); \
+    x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 8); \
+    x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 7);
 
-        fclose(fp);
+/* One ChaCha20 block of keystream, then step the block counter. */
+static void
+chacha_block (guint32 *input, guchar *output)
+{
+    guint32 x[16];
+    int i;
 
-        counter = GUID_PERIOD;
+    memcpy (x, input, sizeof (x));
+    for (i = 0; i < 10; i++)
+    {
+        QUARTERROUND (x, 0, 4, 8, 12);
+        QUARTERROUND (x, 1, 5, 9, 13);
+        QUARTERROUND (x, 2, 6, 10, 14);
+        QUARTERROUND (x, 3, 7, 11, 15);
+        QUARTERROUND (x, 0, 5, 10, 15);
+        QUARTERROUND (x, 1, 6, 11, 12);
+        QUARTERROUND (x, 2, 7, 8, 13);
+        QUARTERROUND (x, 3, 4, 9, 14);
     }
+    for (i = 0; i < 16; i++)
+        store_le32 (output + 4 * i, x[i] + input[i]);
+
+    if (++input[12] == 0)
+        input[13]++;
+}
+
+/* Start the stream of a generator from the current key, with a nonce
+ * no other generator uses with that key. */
+static void
+guid_generator_seed (GuidGenerator *gen)
+{
+    static const guchar sigma[] = "expand 32-byte k";
+    guint64 serial;
+    int i;
+
+    g_static_mutex_lock (&guid_mutex);
+    for (i = 0; i < 4; i++)
+        gen->input[i] = load_le32 (sigma + 4 * i);
+    for (i = 0; i < GUID_KEY_SIZE / 4; i++)
+        gen->input[4 + i] = guid_key[i];
+    serial = guid_thread_serial++;
+    gen->generation = g_atomic_int_get (&guid_generation);
+    g_static_mutex_unlock (&guid_mutex);
+
+    gen->input[12] = 0;
+    gen->input[13] = 0;
+    gen->input[14] = (guint32) serial;
+    gen->input[15] = (guint32) (serial >> 32);
+}
+
+static void
+guid_generator_fill (GuidGenerator *gen)
+{
+    gboolean stale;
+    int i;
+
+    g_static_mutex_lock (&guid_mutex);
+    stale = !guid_initialized || guid_forked;
+    g_static_mutex_unlock (&guid_mutex);
+    if (stale)
+        guid_init ();
 
-    counter--;
+    if (gen->generation != g_atomic_int_get (&guid_generation))
+        guid_generator_seed (gen);
+
+    for (i = 0; i < GUID_BATCH_BLOCKS; i++)
+        chacha_block (gen->input, gen->ids + i * CHACHA_BLOCK_SIZE);
+    gen->used = 0;
+}
+
+void
+guid_new(GncGUID *guid)
+{
+    GuidGenerator *gen;
+
+    if (guid == NULL)
+        return;
+
+    gen = g_static_private_get (&guid_generator);
+    if (gen == NULL)
+    {
+        gen = g_new0 (GuidGenerator, 1);
+        gen->used = GUID_BATCH_SIZE;
+        g_static_private_set (&guid_generator, gen, g_free);
+    }
+    /* After a fork the generation has moved on, so that the child
+     * doesn't hand out the rest of the batch its parent hands out. */
+    if (gen->used == GUID_BATCH_SIZE
+            || gen->generation != g_atomic_int_get (&guid_generation))
+        guid_generator_fill (gen);
+
+    memcpy (guid->data, gen->ids + gen->used * GUID_DATA_SIZE, GUID_DATA_SIZE);
+    gen->used++;
+
+    /* RFC 4122 version 4, random */
+    guid->data[6] = (guid->data[6] & 0x0f) | 0x40;
+    guid->data[8] = (guid->data[8] & 0x3f) | 0x80;
 }
 
 GncGUID
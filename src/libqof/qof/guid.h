@@ -71,13 +71,12 @@ G_CONST_RETURN GncGUID* gnc_value_get_guid (const GValue *value);
 #define GUID_ENCODING_LENGTH 32
 
 
-/** Initialize the id generator with a variety of random
- *  sources.
+/** Initialize the id generator with a new random key, read from
+ *  /dev/urandom, or gathered from a variety of random sources where
+ *  there is no such device.
  *
- *  @note Only one of guid_init(), guid_init_with_salt() and
- *  guid_init_only_salt() should be called.  Calling any
- *  initialization function a second time will reset the generator and
- *  erase the effect of the first call.
+ *  @note Calling it a second time will reset the generator and erase
+ *  the effect of the first call.
  */
 void guid_init(void);
 
@@ -92,13 +91,15 @@ void guid_shutdown (void);
  *  @param guid A pointer to an existing guid data structure.  The
  *  existing value will be replaced with a new value.
  *
- * This routine uses the md5 algorithm to build strong random guids.
+ * This routine makes RFC 4122 version 4 (random) guids from a ChaCha20
+ * keystream.  Each thread has a stream of its own, and a forked child
+ * gets a new key.
  * Note that while guid's are generated randomly, the odds of this
  * routine returning a non-unique id are astronomically small.
  * (Literally astronomically: If you had Cray's on every solar
  * system in the universe running for the entire age of the universe,
  * you'd still have less than a one-in-a-million chance of coming up
- * with a duplicate id.  2^128 == 10^38 is a really really big number.)
+ * with a duplicate id.  2^122 == 10^36 is a really really big number.)
  */
 void guid_new(GncGUID *guid);
 
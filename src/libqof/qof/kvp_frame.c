@@ -32,15 +32,39 @@
 
 #include "qof.h"
 
-/* Note that we keep the keys for this hash table in a GCache
+/* Note that we keep the keys of the slots in a GCache
  * (qof_util_string_cache), as it is very likely we will see the
- * same keys over and over again  */
+ * same keys over and over again.  This also makes the keys unique:
+ * two slots with the same name share the same key pointer.
+ *
+ * Most frames only hold a few slots, so these are kept in a small
+ * array sorted by key.  A frame only switches to a hash table once
+ * it gets more than KVP_FRAME_MAX_SLOTS slots, and then stays that
+ * way. */
+
+#define KVP_FRAME_MAX_SLOTS 8
+
+typedef struct
+{
+    const char *key;
+    KvpValue *value;
+} KvpSlot;
 
 struct _KvpFrame
 {
+    KvpSlot     * slots;
+    guint16       n_slots;
+    guint16       n_allocated;
     GHashTable  * hash;
 };
 
+/* A path split up once into cached keys, see kvp_path_new. */
+struct _KvpPath
+{
+    guint n_keys;
+    const char *keys[1];
+};
+
 
 typedef struct
 {
@@ -85,14 +109,102 @@ kvp_comp_func(gconstpointer v, gconstpointer v2)
     return g_str_equal(v, v2);
 }
 
+/* Compare the key of a slot with the first len chars of key, so that
+ * path components can be looked up without copying them. */
+static inline gint
+kvp_key_compare(const char *slot_key, const char *key, gsize len)
+{
+    gint cmp = strncmp(slot_key, key, len);
+    if (cmp == 0 && slot_key[len] != '\0')
+        cmp = 1;
+    return cmp;
+}
+
+/* Binary search of the slot array.  Returns TRUE if the key is there,
+ * and its position, or else the position it would be inserted at. */
 static gboolean
-init_frame_body_if_needed(KvpFrame *f)
+kvp_frame_find_slot(const KvpFrame *frame, const char *key, gsize len,
+                    guint *pos)
+{
+    guint lo = 0, hi = frame->n_slots;
+
+    while (lo < hi)
+    {
+        guint mid = (lo + hi) / 2;
+        gint cmp = kvp_key_compare(frame->slots[mid].key, key, len);
+
+        if (cmp == 0)
+        {
+            *pos = mid;
+            return TRUE;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+    return FALSE;
+}
+
+static KvpValue *
+kvp_frame_get_slot_len(const KvpFrame *frame, const char *key, gsize len)
 {
-    if (!f->hash)
+    guint pos;
+
+    if (frame->hash)
     {
-        f->hash = g_hash_table_new(&kvp_hash_func, &kvp_comp_func);
+        char buf[128];
+        char *tmp;
+        KvpValue *value;
+
+        if (key[len] == '\0')
+            return g_hash_table_lookup(frame->hash, key);
+        if (len < sizeof(buf))
+        {
+            memcpy(buf, key, len);
+            buf[len] = '\0';
+            return g_hash_table_lookup(frame->hash, buf);
+        }
+        tmp = g_strndup(key, len);
+        value = g_hash_table_lookup(frame->hash, tmp);
+        g_free(tmp);
+        return value;
     }
-    return(f->hash != NULL);
+    if (kvp_frame_find_slot(frame, key, len, &pos))
+        return frame->slots[pos].value;
+    return NULL;
+}
+
+/* Look up a key from the string cache.  The slot with that name has
+ * the very same key, so the array is scanned comparing pointers. */
+static KvpValue *
+kvp_frame_get_slot_cached(const KvpFrame *frame, const char *key)
+{
+    guint i;
+
+    if (frame->hash)
+        return g_hash_table_lookup(frame->hash, key);
+    for (i = 0; i < frame->n_slots; i++)
+        if (frame->slots[i].key == key)
+            return frame->slots[i].value;
+    return NULL;
+}
+
+/* Move the slots of a frame that got too big into a hash table. */
+static void
+kvp_frame_make_hash(KvpFrame *frame)
+{
+    guint i;
+
+    frame->hash = g_hash_table_new(&kvp_hash_func, &kvp_comp_func);
+    for (i = 0; i < frame->n_slots; i++)
+        g_hash_table_insert(frame->hash, (gpointer) frame->slots[i].key,
+                            frame->slots[i].value);
+    g_free(frame->slots);
+    frame->slots = NULL;
+    frame->n_slots = 0;
+    frame->n_allocated = 0;
 }
 
 KvpFrame *
@@ -101,6 +213,7 @@ kvp_frame_new(void)
     KvpFrame * retval = g_new0(KvpFrame, 1);
 
     /* Save space until the frame is actually used */
+    retval->slots = NULL;
     retval->hash = NULL;
     return retval;
 }
@@ -115,6 +228,8 @@ kvp_frame_delete_worker(gpointer key, gpointer value, gpointer user_data)
 void
 kvp_frame_delete(KvpFrame * frame)
 {
+    guint i;
+
     if (!frame) return;
 
     if (frame->hash)
@@ -127,6 +242,12 @@ kvp_frame_delete(KvpFrame * frame)
         g_hash_table_destroy(frame->hash);
         frame->hash = NULL;
     }
+    for (i = 0; i < frame->n_slots; i++)
+    {
+        qof_util_string_cache_remove(frame->slots[i].key);
+        kvp_value_delete(frame->slots[i].value);
+    }
+    g_free(frame->slots);
     g_free(frame);
 }
 
@@ -134,8 +255,8 @@ gboolean
 kvp_frame_is_empty(const KvpFrame * frame)
 {
     if (!frame) return TRUE;
-    if (!frame->hash) return TRUE;
-    return FALSE;
+    if (frame->hash) return g_hash_table_size(frame->hash) == 0;
+    return frame->n_slots == 0;
 }
 
 static void
@@ -151,16 +272,28 @@ KvpFrame *
 kvp_frame_copy(const KvpFrame * frame)
 {
     KvpFrame * retval = kvp_frame_new();
+    guint i;
 
     if (!frame) return retval;
 
     if (frame->hash)
     {
-        if (!init_frame_body_if_needed(retval)) return(NULL);
+        retval->hash = g_hash_table_new(&kvp_hash_func, &kvp_comp_func);
         g_hash_table_foreach(frame->hash,
                              & kvp_frame_copy_worker,
                              (gpointer)retval);
     }
+    else if (frame->n_slots)
+    {
+        retval->slots = g_new(KvpSlot, frame->n_slots);
+        retval->n_slots = retval->n_allocated = frame->n_slots;
+        for (i = 0; i < frame->n_slots; i++)
+        {
+            retval->slots[i].key =
+                qof_util_string_cache_insert((gpointer) frame->slots[i].key);
+            retval->slots[i].value = kvp_value_copy(frame->slots[i].value);
+        }
+    }
     return retval;
 }
 
@@ -175,9 +308,50 @@ kvp_frame_replace_slot_nc (KvpFrame * frame, const char * slot,
     gpointer orig_key;
     gpointer orig_value = NULL;
     int      key_exists;
+    guint    pos;
 
     if (!frame || !slot) return NULL;
-    if (!init_frame_body_if_needed(frame)) return NULL; /* Error ... */
+
+    if (!frame->hash)
+    {
+        if (kvp_frame_find_slot(frame, slot, strlen(slot), &pos))
+        {
+            orig_value = frame->slots[pos].value;
+            if (new_value)
+            {
+                frame->slots[pos].value = new_value;
+                return (KvpValue *) orig_value;
+            }
+            qof_util_string_cache_remove(frame->slots[pos].key);
+            frame->n_slots--;
+            memmove(frame->slots + pos, frame->slots + pos + 1,
+                    (frame->n_slots - pos) * sizeof(KvpSlot));
+            if (frame->n_slots == 0)
+            {
+                g_free(frame->slots);
+                frame->slots = NULL;
+                frame->n_allocated = 0;
+            }
+            return (KvpValue *) orig_value;
+        }
+        if (!new_value) return NULL;
+        if (frame->n_slots < KVP_FRAME_MAX_SLOTS)
+        {
+            if (frame->n_slots == frame->n_allocated)
+            {
+                frame->n_allocated = frame->n_allocated ?
+                                     MIN(2 * frame->n_allocated, KVP_FRAME_MAX_SLOTS) : 1;
+                frame->slots = g_renew(KvpSlot, frame->slots, frame->n_allocated);
+            }
+            memmove(frame->slots + pos + 1, frame->slots + pos,
+                    (frame->n_slots - pos) * sizeof(KvpSlot));
+            frame->slots[pos].key = qof_util_string_cache_insert((gpointer) slot);
+            frame->slots[pos].value = new_value;
+            frame->n_slots++;
+            return NULL;
+        }
+        kvp_frame_make_hash(frame);
+    }
 
     key_exists = g_hash_table_lookup_extended(frame->hash, slot,
                  & orig_key, & orig_value);
@@ -305,6 +479,65 @@ kvp_frame_get_frame_or_null_slash_trash (const KvpFrame *frame, char *key_path)
     return frame;
 }
 
+/* Like kvp_frame_get_frame_slash_trash, for the part of key_path
+ * before end, which is walked in place instead of being copied.
+ */
+static KvpFrame *
+get_path_make (KvpFrame *frame, const char *key_path, const char *end)
+{
+    const char *key, *next;
+
+    for (key = key_path; frame && key < end; key = next)
+    {
+        KvpValue *value;
+
+        if ('/' == *key)
+        {
+            next = key + 1;
+            continue;
+        }
+        next = strchr (key, '/');
+        value = kvp_frame_get_slot_len (frame, key, next - key);
+        if (value)
+        {
+            frame = kvp_value_get_frame (value);
+        }
+        else
+        {
+            char *name = g_strndup (key, next - key);
+            frame = get_or_make (frame, name);
+            g_free (name);
+        }
+    }
+    return frame;
+}
+
+/* Like kvp_frame_get_frame_or_null_slash_trash, for the part of
+ * key_path before end, which is walked in place instead of being
+ * copied.
+ */
+static const KvpFrame *
+get_path_or_null (const KvpFrame *frame, const char *key_path, const char *end)
+{
+    const char *key, *next;
+
+    for (key = key_path; frame && key < end; key = next)
+    {
+        KvpValue *value;
+
+        if ('/' == *key)
+        {
+            next = key + 1;
+            continue;
+        }
+        next = strchr (key, '/');
+        value = kvp_frame_get_slot_len (frame, key, next - key);
+        if (!value) return NULL;
+        frame = kvp_value_get_frame (value);
+    }
+    return frame;
+}
+
 /* Return pointer to last frame in path, and also store the
  * last dangling part of path in 'end_key'.  If path doesn't
  * exist, it is created.
@@ -332,13 +565,7 @@ get_trailer_make (KvpFrame * frame, const char * key_path, char **end_key)
     }
     else
     {
-        char *root, *lkey;
-        root = g_strdup (key_path);
-        lkey = strrchr (root, '/');
-        *lkey = 0;
-        frame = kvp_frame_get_frame_slash_trash (frame, root);
-        g_free(root);
-
+        frame = get_path_make (frame, key_path, last_key);
         last_key ++;
     }
 
@@ -374,13 +601,7 @@ get_trailer_or_null (const KvpFrame * frame, const char * key_path, char **end_k
     }
     else
     {
-        char *root, *lkey;
-        root = g_strdup (key_path);
-        lkey = strrchr (root, '/');
-        *lkey = 0;
-        frame = kvp_frame_get_frame_or_null_slash_trash (frame, root);
-        g_free(root);
-
+        frame = get_path_or_null (frame, key_path, last_key);
         last_key ++;
     }
 
@@ -598,11 +819,8 @@ kvp_frame_set_slot_nc(KvpFrame * frame, const char * slot,
 KvpValue *
 kvp_frame_get_slot(const KvpFrame * frame, const char * slot)
 {
-    KvpValue *v;
-    if (!frame) return NULL;
-    if (!frame->hash) return NULL;  /* Error ... */
-    v = g_hash_table_lookup(frame->hash, slot);
-    return v;
+    if (!frame || !slot) return NULL;
+    return kvp_frame_get_slot_len(frame, slot, strlen(slot));
 }
 
 /* ============================================================ */
@@ -825,6 +1043,88 @@ kvp_frame_get_value(const KvpFrame *frame, const char *path)
 
 /* ============================================================ */
 
+KvpPath *
+kvp_path_new (const char *path)
+{
+    KvpPath *handle;
+    gchar **keys;
+    guint i, n = 0;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    keys = g_strsplit (path, "/", -1);
+    handle = g_malloc (sizeof (KvpPath) + g_strv_length (keys) * sizeof (char *));
+    for (i = 0; keys[i]; i++)
+    {
+        if (keys[i][0])
+            handle->keys[n++] = qof_util_string_cache_insert (keys[i]);
+    }
+    handle->n_keys = n;
+    g_strfreev (keys);
+    return handle;
+}
+
+void
+kvp_path_free (KvpPath *path)
+{
+    guint i;
+
+    if (!path) return;
+    for (i = 0; i < path->n_keys; i++)
+        qof_util_string_cache_remove (path->keys[i]);
+    g_free (path);
+}
+
+KvpValue *
+kvp_frame_get_value_at (const KvpFrame *frame, const KvpPath *path)
+{
+    guint i;
+
+    if (!frame || !path || !path->n_keys) return NULL;
+
+    for (i = 0; i + 1 < path->n_keys; i++)
+    {
+        frame = kvp_value_get_frame (kvp_frame_get_slot_cached (frame, path->keys[i]));
+        if (!frame) return NULL;
+    }
+    return kvp_frame_get_slot_cached (frame, path->keys[i]);
+}
+
+const char *
+kvp_frame_get_string_at (const KvpFrame *frame, const KvpPath *path)
+{
+    return kvp_value_get_string (kvp_frame_get_value_at (frame, path));
+}
+
+KvpFrame *
+kvp_frame_set_value_at_nc (KvpFrame *frame, const KvpPath *path,
+                           KvpValue *value)
+{
+    guint i;
+
+    if (!frame || !path || !path->n_keys) return NULL;
+
+    for (i = 0; frame && i + 1 < path->n_keys; i++)
+    {
+        KvpValue *next = kvp_frame_get_slot_cached (frame, path->keys[i]);
+        frame = next ? kvp_value_get_frame (next) : get_or_make (frame, path->keys[i]);
+    }
+    if (!frame) return NULL;
+    kvp_frame_set_slot_destructively (frame, path->keys[i], value);
+    return frame;
+}
+
+void
+kvp_frame_set_string_at (KvpFrame *frame, const KvpPath *path, const char *str)
+{
+    KvpValue *value;
+    value = kvp_value_new_string (str);
+    frame = kvp_frame_set_value_at_nc (frame, path, value);
+    if (!frame) kvp_value_delete (value);
+}
+
+/* ============================================================ */
+
 KvpFrame *
 kvp_frame_get_frame_slash (KvpFrame *frame, const char *key_path)
 {
@@ -1380,11 +1680,35 @@ kvp_frame_for_each_slot(KvpFrame *f,
                                      gpointer data),
                         gpointer data)
 {
+    guint i;
+
     if (!f) return;
     if (!proc) return;
-    if (!(f->hash)) return;
 
-    g_hash_table_foreach(f->hash, (GHFunc) proc, data);
+    if (f->hash)
+    {
+        g_hash_table_foreach(f->hash, (GHFunc) proc, data);
+        return;
+    }
+    for (i = 0; i < f->n_slots; i++)
+        proc(f->slots[i].key, f->slots[i].value, data);
+}
+
+void
+kvp_frame_for_each_slot_sorted(KvpFrame *f,
+                               void (*proc)(const char *key,
+                                       KvpValue *value,
+                                       gpointer data),
+                               gpointer data)
+{
+    if (!f) return;
+    if (!proc) return;
+
+    if (f->hash)
+        g_hash_table_foreach_sorted(f->hash, (GHFunc) proc, data,
+                                    (GCompareFunc) strcmp);
+    else
+        kvp_frame_for_each_slot(f, proc, data);
 }
 
 #ifdef _MSC_VER
@@ -1492,8 +1816,8 @@ kvp_frame_compare(const KvpFrame *fa, const KvpFrame *fb)
     if (fa && !fb) return 1;
 
     /* nothing is always less than something */
-    if (!fa->hash && fb->hash) return -1;
-    if (fa->hash && !fb->hash) return 1;
+    if (kvp_frame_is_empty(fa) && !kvp_frame_is_empty(fb)) return -1;
+    if (!kvp_frame_is_empty(fa) && kvp_frame_is_empty(fb)) return 1;
 
     status.compare = 0;
     status.other_frame = (KvpFrame *) fb;
@@ -1657,13 +1981,13 @@ kvp_value_to_string(const KvpValue *val)
 }
 
 static void
-kvp_frame_to_string_helper(gpointer key, gpointer value, gpointer data)
+kvp_frame_to_string_helper(const char *key, KvpValue *value, gpointer data)
 {
     gchar *tmp_val;
     gchar **str = (gchar**)data;
     gchar *old_data = *str;
 
-    tmp_val = kvp_value_to_string((KvpValue *)value);
+    tmp_val = kvp_value_to_string(value);
 
     *str = g_strdup_printf("%s    %s => %s,\n",
                            *str ? *str : "",
@@ -1683,8 +2007,7 @@ kvp_frame_to_string(const KvpFrame *frame)
 
     tmp1 = g_strdup_printf("{\n");
 
-    if (frame->hash)
-        g_hash_table_foreach(frame->hash, kvp_frame_to_string_helper, &tmp1);
+    kvp_frame_for_each_slot((KvpFrame *) frame, kvp_frame_to_string_helper, &tmp1);
 
     {
         gchar *tmp2;
@@ -1700,6 +2023,9 @@ GHashTable*
 kvp_frame_get_hash(const KvpFrame *frame)
 {
     g_return_val_if_fail (frame != NULL, NULL);
+    /* Callers hold on to the table, so the frame stays a hash. */
+    if (!frame->hash && frame->n_slots)
+        kvp_frame_make_hash((KvpFrame *) frame);
     return frame->hash;
 }
 
@@ -74,6 +74,10 @@ typedef struct _KvpFrame KvpFrame;
  * KvpValueType enum. */
 typedef struct _KvpValue KvpValue;
 
+/** A path like "a/b/c" split up once, for the paths that are looked
+ * up over and over again. */
+typedef struct _KvpPath KvpPath;
+
 /** \brief possible types in the union KvpValue
  * \todo : People have asked for boolean values,
  *  e.g. in xaccAccountSetAutoInterestXfer
@@ -312,6 +316,33 @@ KvpFrame    * kvp_frame_get_frame_slash (KvpFrame *frame,
         const gchar *path);
 
 /** @} */
+
+/** @name KvpFrame Path Handles
+
+  A KvpPath holds a slash-separated path split into its keys, so that
+  code looking up the same path for every transaction or split does
+  not parse it each time.  Handles are usually made once and kept in
+  a static variable.
+ @{
+*/
+/** Split up path.  Empty components are skipped, as they are by the
+ * routines taking a string path. */
+KvpPath    * kvp_path_new (const gchar *path);
+void         kvp_path_free (KvpPath *path);
+
+/** Same as kvp_frame_get_value, with a path handle. */
+KvpValue   * kvp_frame_get_value_at (const KvpFrame *frame, const KvpPath *path);
+/** Same as kvp_frame_get_string, with a path handle. */
+const gchar * kvp_frame_get_string_at (const KvpFrame *frame, const KvpPath *path);
+
+/** Same as kvp_frame_set_value_nc, with a path handle. */
+KvpFrame   * kvp_frame_set_value_at_nc (KvpFrame *frame, const KvpPath *path,
+                                        KvpValue *value);
+/** Same as kvp_frame_set_string, with a path handle. */
+void         kvp_frame_set_string_at (KvpFrame *frame, const KvpPath *path,
+                                      const gchar *str);
+/** @} */
+
 /** @name KvpFrame KvpValue low-level storing routines.
 
 You probably shouldn't be using these low-level routines
@@ -581,11 +612,20 @@ void kvp_frame_for_each_slot(KvpFrame *f,
                                      gpointer data),
                              gpointer data);
 
+/** Same as kvp_frame_for_each_slot, but in strcmp order of the keys. */
+void kvp_frame_for_each_slot_sorted(KvpFrame *f,
+                                    void (*proc)(const gchar *key,
+                                            KvpValue *value,
+                                            gpointer data),
+                                    gpointer data);
+
 /** @} */
 
 /** Internal helper routines, you probably shouldn't be using these. */
 gchar* kvp_frame_to_string(const KvpFrame *frame);
 gchar* binary_to_string(const void *data, guint32 size);
+/** Small frames do not have a hash table, this makes one for good.
+ * Use the iterators instead. */
 GHashTable* kvp_frame_get_hash(const KvpFrame *frame);
 
 /** @} */
@@ -37,6 +37,24 @@ void qof_class_shutdown (void);
 
 QofSortFunc qof_class_get_default_sort (QofIdTypeConst obj_name);
 
+/* A registered index.  For a sorted index, estimate and foreach are
+ * NULL and the query engine does the work. */
+typedef struct _QofClassIndex
+{
+    GSList               *param_path;
+    QofIndexEstimateFunc  estimate;
+    QofIndexForeachFunc   foreach;
+    gboolean              sorted;
+} QofClassIndex;
+
+/* Return the list of QofClassIndex registered for the class.  The list
+ * belongs to qofclass. */
+GList * qof_class_get_indexes (QofIdTypeConst obj_name);
+
+/* Return the table of other type -> QofDependentsFunc registered for
+ * the class, or NULL if there is none.  The table belongs to qofclass. */
+GHashTable * qof_class_get_dependents (QofIdTypeConst obj_name);
+
 /* @} */
 /* @} */
 /* @} */
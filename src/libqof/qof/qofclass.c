@@ -32,6 +32,8 @@ static QofLogModule log_module = QOF_MOD_CLASS;
 
 static GHashTable *classTable = NULL;
 static GHashTable *sortTable = NULL;
+static GHashTable *indexTable = NULL;
+static GHashTable *dependentsTable = NULL;
 static gboolean initialized = FALSE;
 
 static gboolean clear_table (gpointer key, gpointer value, gpointer user_data)
@@ -40,6 +42,20 @@ static gboolean clear_table (gpointer key, gpointer value, gpointer user_data)
     return TRUE;
 }
 
+static gboolean clear_indexes (gpointer key, gpointer value, gpointer user_data)
+{
+    GList *node;
+
+    for (node = value; node; node = node->next)
+    {
+        QofClassIndex *index = node->data;
+        g_slist_free (index->param_path);
+        g_free (index);
+    }
+    g_list_free (value);
+    return TRUE;
+}
+
 /* *******************************************************************/
 /* PRIVATE FUNCTIONS */
 
@@ -59,6 +75,8 @@ qof_class_init(void)
 
     classTable = g_hash_table_new (g_str_hash, g_str_equal);
     sortTable = g_hash_table_new (g_str_hash, g_str_equal);
+    indexTable = g_hash_table_new (g_str_hash, g_str_equal);
+    dependentsTable = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 void
@@ -70,6 +88,10 @@ qof_class_shutdown (void)
     g_hash_table_foreach_remove (classTable, clear_table, NULL);
     g_hash_table_destroy (classTable);
     g_hash_table_destroy (sortTable);
+    g_hash_table_foreach_remove (indexTable, clear_indexes, NULL);
+    g_hash_table_destroy (indexTable);
+    g_hash_table_foreach_remove (dependentsTable, clear_table, NULL);
+    g_hash_table_destroy (dependentsTable);
 }
 
 QofSortFunc
@@ -79,6 +101,37 @@ qof_class_get_default_sort (QofIdTypeConst obj_name)
     return g_hash_table_lookup (sortTable, obj_name);
 }
 
+GList *
+qof_class_get_indexes (QofIdTypeConst obj_name)
+{
+    if (!obj_name || !initialized) return NULL;
+    return g_hash_table_lookup (indexTable, obj_name);
+}
+
+GHashTable *
+qof_class_get_dependents (QofIdTypeConst obj_name)
+{
+    if (!obj_name || !initialized) return NULL;
+    return g_hash_table_lookup (dependentsTable, obj_name);
+}
+
+static void
+class_register_index (QofIdTypeConst obj_name, QofClassIndex *index,
+                      const char *param, va_list ap)
+{
+    GList *indexes;
+    const char *this_param;
+
+    for (this_param = param; this_param; this_param = va_arg (ap, const char *))
+        index->param_path = g_slist_prepend (index->param_path,
+                                             (gpointer) this_param);
+    index->param_path = g_slist_reverse (index->param_path);
+
+    indexes = g_hash_table_lookup (indexTable, obj_name);
+    g_hash_table_insert (indexTable, (char *)obj_name,
+                         g_list_append (indexes, index));
+}
+
 /* *******************************************************************/
 /* PUBLISHED API FUNCTIONS */
 
@@ -120,6 +173,62 @@ qof_class_register (QofIdTypeConst obj_name,
     }
 }
 
+void
+qof_class_register_index (QofIdTypeConst obj_name,
+                          QofIndexEstimateFunc estimate,
+                          QofIndexForeachFunc foreach,
+                          const char *param, ...)
+{
+    QofClassIndex *index;
+    va_list ap;
+
+    if (!obj_name || !estimate || !foreach || !param) return;
+    if (!check_init()) return;
+
+    index = g_new0 (QofClassIndex, 1);
+    index->estimate = estimate;
+    index->foreach = foreach;
+    va_start (ap, param);
+    class_register_index (obj_name, index, param, ap);
+    va_end (ap);
+}
+
+void
+qof_class_register_sorted_index (QofIdTypeConst obj_name,
+                                 const char *param, ...)
+{
+    QofClassIndex *index;
+    va_list ap;
+
+    if (!obj_name || !param) return;
+    if (!check_init()) return;
+
+    index = g_new0 (QofClassIndex, 1);
+    index->sorted = TRUE;
+    va_start (ap, param);
+    class_register_index (obj_name, index, param, ap);
+    va_end (ap);
+}
+
+void
+qof_class_register_dependents (QofIdTypeConst obj_name,
+                               QofIdTypeConst other_type,
+                               QofDependentsFunc func)
+{
+    GHashTable *ht;
+
+    if (!obj_name || !other_type || !func) return;
+    if (!check_init()) return;
+
+    ht = g_hash_table_lookup (dependentsTable, obj_name);
+    if (!ht)
+    {
+        ht = g_hash_table_new (g_str_hash, g_str_equal);
+        g_hash_table_insert (dependentsTable, (char *)obj_name, ht);
+    }
+    g_hash_table_insert (ht, (char *)other_type, func);
+}
+
 gboolean
 qof_class_is_registered (QofIdTypeConst obj_name)
 {
@@ -225,6 +225,65 @@ void qof_class_register (QofIdTypeConst obj_name,
  * qof_class_register ("myObjectName", myObjectCompare, &myParams);
  */
 
+/** @name Secondary indexes
+
+ A class can register indexes, so that a query does not have to check
+ every object of the class in the book.  An index is registered for a
+ parameter path, e.g. SPLIT_ACCOUNT, QOF_PARAM_GUID, and is consulted
+ for query terms on exactly that path.  An index only has to propose a
+ superset of the objects matching the predicate: every proposed object
+ is still checked against the whole query.
+ @{ */
+
+struct _QofQueryPredData;
+
+/** Return the number of objects in the book the index would propose
+ *  for the predicate, or -1 if the index can't handle the predicate. */
+typedef gint (*QofIndexEstimateFunc) (QofBook *book,
+                                      const struct _QofQueryPredData *pred_data);
+
+/** Call cb once for every object in the book that may match the
+ *  predicate. */
+typedef void (*QofIndexForeachFunc) (QofBook *book,
+                                     const struct _QofQueryPredData *pred_data,
+                                     QofInstanceForeachCB cb,
+                                     gpointer user_data);
+
+/** Register an index on the NULL-terminated parameter path, which the
+ *  class maintains itself. */
+void qof_class_register_index (QofIdTypeConst obj_name,
+                               QofIndexEstimateFunc estimate,
+                               QofIndexForeachFunc foreach,
+                               const char *param, ...);
+
+/** Register an index on the NULL-terminated parameter path that the
+ *  query engine builds and maintains by itself: the objects sorted by
+ *  the value at the end of the path.  The path must end in a date,
+ *  numeric, debcred or char parameter.  Range and equality predicates
+ *  on it are then answered with a binary search.  The index is rebuilt
+ *  when one of the collections along the path has changed, see
+ *  qof_collection_get_generation().
+ */
+void qof_class_register_sorted_index (QofIdTypeConst obj_name,
+                                      const char *param, ...);
+
+/** Call cb for every object of the registering class that reaches the
+ *  instance through its parameters, e.g. for the splits of a
+ *  transaction. */
+typedef void (*QofDependentsFunc) (QofInstance *inst,
+                                   QofInstanceForeachCB cb,
+                                   gpointer user_data);
+
+/** Tell the query engine how to find the objects of the class that
+ *  depend on an instance of other_type.  Live queries (see
+ *  qof_query_set_live()) use this to re-check just those objects when
+ *  the instance changes; without it, a change to an instance of a type
+ *  the query looks through makes them run the query again. */
+void qof_class_register_dependents (QofIdTypeConst obj_name,
+                                    QofIdTypeConst other_type,
+                                    QofDependentsFunc func);
+/** @} */
+
 /** Return true if the the indicated type is registered,
  *  else return FALSE.
  */
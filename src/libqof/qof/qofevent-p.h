@@ -34,9 +34,18 @@ typedef struct
     gpointer user_data;
 
     gint handler_id;
+
+    /* interest: the entity type (NULL for any) and the events (0 for
+     * any) the handler wants to see */
+    QofIdTypeConst e_type;
+    QofEventId event_mask;
 } HandlerInfo;
 
 /* generates an event even when events are suspended! */
 void qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data);
 
+/* Drop the events held for the instance by qof_event_batch(); called
+ * when the instance goes away. */
+void qof_event_forget_instance (QofInstance *entity);
+
 #endif
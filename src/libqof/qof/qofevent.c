@@ -32,6 +32,28 @@ static guint   suspend_counter   = 0;
 static gint    next_handler_id   = 1;
 static guint   handler_run_level = 0;
 static guint   pending_deletes   = 0;
+static guint   dropped_events    = 0;
+
+/* Events are dropped while plain_suspends is non-zero.  Otherwise,
+ * while suspend_counter is non-zero, some qof_event_batch() is active
+ * and events are held in pending_events.  suspend_kinds records, for
+ * every open suspend or batch, innermost first, which one it was. */
+static guint   plain_suspends    = 0;
+static GSList  *suspend_kinds    = NULL;
+
+typedef struct
+{
+    QofInstance *entity;
+    QofEventId   event_id;
+    GList       *link;          /* in pending_events */
+} PendingEvent;
+
+static GQueue  pending_events    = G_QUEUE_INIT;
+static GHashTable *pending_by_entity = NULL;   /* entity -> GList of PendingEvent */
+
+static guint   generated_events  = 0;
+static guint   delivered_events  = 0;
+static guint   coalesced_events  = 0;
 static GList   *handlers  =   NULL;
 
 /* This static indicates the debugging module that this .o belongs to.  */
@@ -70,11 +92,22 @@ find_next_handler_id(void)
 
 gint
 qof_event_register_handler (QofEventHandler handler, gpointer user_data)
+{
+    return qof_event_register_filtered_handler (handler, user_data, NULL,
+            QOF_EVENT_NONE);
+}
+
+gint
+qof_event_register_filtered_handler (QofEventHandler handler,
+                                     gpointer user_data,
+                                     QofIdTypeConst e_type,
+                                     QofEventId event_mask)
 {
     HandlerInfo *hi;
     gint handler_id;
 
-    ENTER ("(handler=%p, data=%p)", handler, user_data);
+    ENTER ("(handler=%p, data=%p, type=%s, mask=%x)", handler, user_data,
+           e_type ? e_type : "(all)", event_mask);
 
     /* sanity check */
     if (!handler)
@@ -92,6 +125,8 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
     hi->handler = handler;
     hi->user_data = user_data;
     hi->handler_id = handler_id;
+    hi->e_type = e_type;
+    hi->event_mask = event_mask;
 
     handlers = g_list_prepend (handlers, hi);
     LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
@@ -149,6 +184,53 @@ qof_event_suspend (void)
     {
         PERR ("suspend counter overflow");
     }
+    plain_suspends++;
+    suspend_kinds = g_slist_prepend (suspend_kinds, GINT_TO_POINTER (FALSE));
+}
+
+void
+qof_event_batch (void)
+{
+    suspend_counter++;
+
+    if (suspend_counter == 0)
+    {
+        PERR ("suspend counter overflow");
+    }
+    suspend_kinds = g_slist_prepend (suspend_kinds, GINT_TO_POINTER (TRUE));
+}
+
+static void qof_event_generate_internal (QofInstance *entity,
+        QofEventId event_id,
+        gpointer event_data);
+
+static void
+pending_event_forget (PendingEvent *ev)
+{
+    GList *list = g_hash_table_lookup (pending_by_entity, ev->entity);
+
+    list = g_list_remove (list, ev);
+    if (list)
+        g_hash_table_insert (pending_by_entity, ev->entity, list);
+    else
+        g_hash_table_remove (pending_by_entity, ev->entity);
+    g_free (ev);
+}
+
+/* Deliver the held events, unless a new batch was opened by one of
+ * the handlers. */
+static void
+qof_event_flush (void)
+{
+    while (suspend_counter == 0 && !g_queue_is_empty (&pending_events))
+    {
+        PendingEvent *ev = g_queue_pop_head (&pending_events);
+        QofInstance *entity = ev->entity;
+        QofEventId event_id = ev->event_id;
+
+        pending_event_forget (ev);
+        qof_event_generate_internal (entity, event_id, NULL);
+    }
 }
 
 void
@@ -161,6 +243,97 @@ qof_event_resume (void)
     }
 
     suspend_counter--;
+    if (suspend_kinds)
+    {
+        if (!GPOINTER_TO_INT (suspend_kinds->data))
+            plain_suspends--;
+        suspend_kinds = g_slist_delete_link (suspend_kinds, suspend_kinds);
+    }
+    if (suspend_counter == 0)
+        qof_event_flush ();
+}
+
+/* Hold the event until the batch ends.  A modification of an entity
+ * that is already held as modified adds nothing. */
+static void
+qof_event_hold (QofInstance *entity, QofEventId event_id)
+{
+    PendingEvent *ev;
+    GList *list, *node;
+
+    if (!pending_by_entity)
+        pending_by_entity = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    list = g_hash_table_lookup (pending_by_entity, entity);
+    if (event_id == QOF_EVENT_MODIFY)
+    {
+        for (node = list; node; node = node->next)
+        {
+            if (((PendingEvent *)node->data)->event_id == QOF_EVENT_MODIFY)
+            {
+                coalesced_events++;
+                return;
+            }
+        }
+    }
+
+    ev = g_new (PendingEvent, 1);
+    ev->entity = entity;
+    ev->event_id = event_id;
+    g_queue_push_tail (&pending_events, ev);
+    ev->link = g_queue_peek_tail_link (&pending_events);
+    g_hash_table_insert (pending_by_entity, entity, g_list_append (list, ev));
+}
+
+void
+qof_event_forget_instance (QofInstance *entity)
+{
+    GList *list, *node;
+
+    if (!pending_by_entity) return;
+    list = g_hash_table_lookup (pending_by_entity, entity);
+    if (!list) return;
+
+    g_hash_table_remove (pending_by_entity, entity);
+    for (node = list; node; node = node->next)
+    {
+        PendingEvent *ev = node->data;
+        g_queue_delete_link (&pending_events, ev->link);
+        g_free (ev);
+    }
+    g_list_free (list);
+}
+
+/* Deliver the events held for the entity now, ahead of an event that
+ * can't be held, so that its handlers still see them in order. */
+static void
+qof_event_flush_instance (QofInstance *entity)
+{
+    GList *list, *node;
+
+    if (!pending_by_entity) return;
+    list = g_hash_table_lookup (pending_by_entity, entity);
+    if (!list) return;
+
+    /* Events the handlers generate for the entity are held anew. */
+    g_hash_table_remove (pending_by_entity, entity);
+    for (node = list; node; node = node->next)
+        g_queue_delete_link (&pending_events, ((PendingEvent *)node->data)->link);
+    for (node = list; node; node = node->next)
+    {
+        PendingEvent *ev = node->data;
+        qof_event_generate_internal (ev->entity, ev->event_id, NULL);
+        g_free (ev);
+    }
+    g_list_free (list);
+}
+
+void
+qof_event_get_stats (guint *generated, guint *delivered, guint *coalesced)
+{
+    if (generated) *generated = generated_events;
+    if (delivered) *delivered = delivered_events;
+    if (coalesced) *coalesced = coalesced_events;
 }
 
 static void
@@ -193,12 +366,17 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
         HandlerInfo *hi = node->data;
 
         next_node = node->next;
-        if (hi->handler)
-        {
-            PINFO("id=%d hi=%p han=%p data=%p", hi->handler_id, hi,
-                  hi->handler, event_data);
-            hi->handler (entity, event_id, hi->user_data, event_data);
-        }
+        if (!hi->handler)
+            continue;
+        if (hi->event_mask && !(hi->event_mask & event_id))
+            continue;
+        if (hi->e_type && safe_strcmp (hi->e_type, entity->e_type))
+            continue;
+
+        PINFO("id=%d hi=%p han=%p data=%p", hi->handler_id, hi,
+              hi->handler, event_data);
+        delivered_events++;
+        hi->handler (entity, event_id, hi->user_data, event_data);
     }
     handler_run_level--;
 
@@ -229,6 +407,7 @@ qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data)
     if (!entity)
         return;
 
+    generated_events++;
     qof_event_generate_internal (entity, event_id, event_data);
 }
 
@@ -238,10 +417,37 @@ qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
     if (!entity)
         return;
 
-    if (suspend_counter)
+    generated_events++;
+    if (plain_suspends)
+    {
+        dropped_events++;
         return;
+    }
+
+    /* In a batch, hold what can be held.  The entity is about to go
+     * away after a destroy event, so that one is delivered now and the
+     * events held for the entity are dropped.  An event with data goes
+     * now as well, after the events held for its entity. */
+    if (suspend_counter && event_id != QOF_EVENT_NONE)
+    {
+        if (event_id == QOF_EVENT_DESTROY)
+            qof_event_forget_instance (entity);
+        else if (!event_data)
+        {
+            qof_event_hold (entity, event_id);
+            return;
+        }
+        else
+            qof_event_flush_instance (entity);
+    }
 
     qof_event_generate_internal (entity, event_id, event_data);
 }
 
+guint
+qof_event_get_dropped_count (void)
+{
+    return dropped_events;
+}
+
 /* =========================== END OF FILE ======================= */
@@ -93,6 +93,25 @@ typedef void (*QofEventHandler) (QofInstance *ent,  QofEventId event_type,
  */
 gint qof_event_register_handler (QofEventHandler handler, gpointer handler_data);
 
+/** \brief Register a handler for some events only.
+ *
+ * Like qof_event_register_handler(), but the handler is only invoked
+ * for entities of the given type and for the given events, which
+ * saves calling it just to have it return.
+ *
+ * @param handler:   handler to register
+ * @param handler_data: data provided when handler is invoked
+ * @param e_type:    entity type of interest, or NULL for all types
+ * @param event_mask: the events of interest, or'ed together, or
+ *                   QOF_EVENT_NONE for all events
+ *
+ * @return id identifying handler
+ */
+gint qof_event_register_filtered_handler (QofEventHandler handler,
+        gpointer handler_data,
+        QofIdTypeConst e_type,
+        QofEventId event_mask);
+
 /** \brief Unregister an event handler.
  *
  * @param handler_id: the id of the handler to unregister
@@ -131,8 +150,36 @@ void qof_event_gen (QofInstance *entity, QofEventId event_type,
  */
 void qof_event_suspend (void);
 
-/** Resume engine event generation. */
+/** Resume engine event generation.  If this ends the outermost
+ *  qof_event_batch(), the events collected during the batch are
+ *  delivered now. */
 void qof_event_resume (void);
 
+/** \brief Collect events instead of delivering them.
+ *
+ *   Like qof_event_suspend(), this must be matched by a call to
+ *   qof_event_resume().  In between, events without event data are
+ *   held back, and repeated QOF_EVENT_MODIFY events of an entity are
+ *   folded into one.  They are delivered in order when the outermost
+ *   batch is resumed.  Events with event data can't be held, since the
+ *   data may be gone by then; they are delivered right away, after the
+ *   events held for the same entity, which go first.  So is
+ *   QOF_EVENT_DESTROY, which also drops the events held for its
+ *   entity.  Within a qof_event_suspend() events are dropped as
+ *   before, batch or not.
+ */
+void qof_event_batch (void);
+
+/** Return the number of events generated, of handler invocations
+ *  made, and of events folded into an earlier one by qof_event_batch()
+ *  since the start of the program.  Any of the pointers may be NULL. */
+void qof_event_get_stats (guint *generated, guint *delivered,
+                          guint *coalesced);
+
+/** Return the number of events dropped so far because events were
+ *  suspended.  Whoever keeps state up to date from events can compare
+ *  it to find out whether it missed something. */
+guint qof_event_get_dropped_count (void);
+
 #endif
 /** @} */
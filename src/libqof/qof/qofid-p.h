@@ -44,8 +44,14 @@ void qof_collection_insert_entity (QofCollection *, QofInstance *);
 /** reset value of dirty flag */
 void qof_collection_mark_clean (QofCollection *);
 void qof_collection_mark_dirty (QofCollection *);
+/** bump the generation counter, see qof_collection_get_generation() */
+void qof_collection_touch (QofCollection *);
 void qof_collection_print_dirty (const QofCollection *col, gpointer dummy);
 
+/** Some entity of the collection, or NULL if it is empty, for the
+ *  code that only needs to know the class of the entities. */
+QofInstance *qof_collection_get_any_entity (const QofCollection *col);
+
 /* @} */
 /* @} */
 /* @} */
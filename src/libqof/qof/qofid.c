@@ -37,6 +37,7 @@ struct QofCollection_s
 {
     QofIdType    e_type;
     gboolean     is_dirty;
+    guint        generation; /* bumped whenever anything in it changes */
 
     GHashTable * hash_of_entities;
     gpointer     data;       /* place where object class can hang arbitrary data */
@@ -102,6 +103,7 @@ qof_collection_remove_entity (QofInstance *ent)
     if (!col) return;
     guid = qof_instance_get_guid(ent);
     g_hash_table_remove (col->hash_of_entities, guid);
+    col->generation++;
     if (!qof_alt_dirty_mode)
         qof_collection_mark_dirty(col);
     qof_instance_set_collection(ent, NULL);
@@ -118,6 +120,7 @@ qof_collection_insert_entity (QofCollection *col, QofInstance *ent)
     g_return_if_fail (col->e_type == ent->e_type);
     qof_collection_remove_entity (ent);
     g_hash_table_insert (col->hash_of_entities, (gpointer)guid, ent);
+    col->generation++;
     if (!qof_alt_dirty_mode)
         qof_collection_mark_dirty(col);
     qof_instance_set_collection(ent, col);
@@ -266,6 +269,17 @@ qof_collection_count (const QofCollection *col)
     return c;
 }
 
+QofInstance *
+qof_collection_get_any_entity (const QofCollection *col)
+{
+    GHashTableIter iter;
+    gpointer ent = NULL;
+
+    g_hash_table_iter_init (&iter, col->hash_of_entities);
+    g_hash_table_iter_next (&iter, NULL, &ent);
+    return ent;
+}
+
 /* =============================================================== */
 
 gboolean
@@ -292,6 +306,21 @@ qof_collection_mark_dirty (QofCollection *col)
     }
 }
 
+guint
+qof_collection_get_generation (const QofCollection *col)
+{
+    return col ? col->generation : 0;
+}
+
+void
+qof_collection_touch (QofCollection *col)
+{
+    if (col)
+    {
+        col->generation++;
+    }
+}
+
 void
 qof_collection_print_dirty (const QofCollection *col, gpointer dummy)
 {
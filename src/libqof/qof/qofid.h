@@ -196,6 +196,12 @@ void qof_collection_set_data (QofCollection *col, gpointer user_data);
 /** Return value of 'dirty' flag on collection */
 gboolean qof_collection_is_dirty (const QofCollection *col);
 
+/** Return a counter that changes whenever an entity is added to or
+ *  removed from the collection, or an entity in it is marked dirty.
+ *  Caches derived from the entities can compare it to find out whether
+ *  they are still current. */
+guint qof_collection_get_generation (const QofCollection *col);
+
 /** @name QOF_TYPE_COLLECT: Linking one entity to many of one type
 
 \note These are \b NOT the same as the main collections in the book.
@@ -33,6 +33,7 @@
 #include "qof.h"
 #include "kvp-util-p.h"
 #include "qofbook-p.h"
+#include "qofevent-p.h"
 #include "qofid-p.h"
 #include "qofinstance-p.h"
 
@@ -125,6 +126,7 @@ static void qof_instance_set_property (GObject         *object,
                                        const GValue    *value,
                                        GParamSpec      *pspec);
 static void qof_instance_dispose(GObject*);
+static void reference_index_forget(QofInstance* inst);
 static void qof_instance_class_init(QofInstanceClass *klass)
 {
     GObjectClass *object_class = G_OBJECT_CLASS(klass);
@@ -138,6 +140,7 @@ static void qof_instance_class_init(QofInstanceClass *klass)
     klass->get_display_name = NULL;
     klass->refers_to_object = NULL;
     klass->get_typed_referring_object_list = NULL;
+    klass->references_indexed = FALSE;
 
     g_object_class_install_property
     (object_class,
@@ -327,9 +330,12 @@ qof_instance_dispose (GObject *instp)
     QofInstancePrivate *priv;
     QofInstance* inst = QOF_INSTANCE(instp);
 
+    qof_event_forget_instance(inst);
+
     priv = GET_PRIVATE(instp);
     if (!priv->collection)
         return;
+    reference_index_forget(inst);
     qof_collection_remove_entity(inst);
 
     CACHE_REMOVE(inst->e_type);
@@ -731,9 +737,10 @@ qof_instance_set_dirty(QofInstance* inst)
 
     priv = GET_PRIVATE(inst);
     priv->dirty = TRUE;
+    coll = priv->collection;
+    qof_collection_touch(coll);
     if (!qof_get_alt_dirty_mode())
     {
-        coll = priv->collection;
         qof_collection_mark_dirty(coll);
     }
 }
@@ -833,36 +840,190 @@ gchar* qof_instance_get_display_name(const QofInstance* inst)
     }
 }
 
+/* The book's reference index.  For every object it holds the
+ * instances of the indexed types that refer to it, and for every
+ * such instance the objects it refers to.  Both map an instance to a
+ * table of instance -> number of references, as an instance can
+ * refer to the same object through more than one field. */
+
+#define REFERENCE_INDEX "qof-reference-index"
+
 typedef struct
 {
-    const QofInstance* inst;
-    GList* list;
-} GetReferringObjectHelperData;
+    GHashTable* referrers;      /* object -> instances referring to it */
+    GHashTable* targets;        /* instance -> objects it refers to */
+} ReferenceIndex;
 
 static void
-get_referring_object_instance_helper(QofInstance* inst, gpointer user_data)
+reference_index_destroy(QofBook* book, gpointer key, gpointer user_data)
 {
-    QofInstance** pInst = (QofInstance**)user_data;
+    ReferenceIndex* index = (ReferenceIndex*)user_data;
 
-    if (*pInst == NULL)
+    g_hash_table_destroy(index->referrers);
+    g_hash_table_destroy(index->targets);
+    g_free(index);
+}
+
+static ReferenceIndex*
+reference_index_get(QofBook* book, gboolean create)
+{
+    ReferenceIndex* index;
+
+    /* The index is already gone while the book's objects are freed */
+    if (!book || qof_book_shutting_down(book))
+        return NULL;
+
+    index = qof_book_get_data(book, REFERENCE_INDEX);
+    if (!index && create)
     {
-        *pInst = inst;
+        index = g_new0(ReferenceIndex, 1);
+        index->referrers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                           (GDestroyNotify)g_hash_table_destroy);
+        index->targets = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                               (GDestroyNotify)g_hash_table_destroy);
+        qof_book_set_data_fin(book, REFERENCE_INDEX, index, reference_index_destroy);
     }
+    return index;
 }
 
 static void
-get_referring_object_helper(QofCollection* coll, gpointer user_data)
+reference_map_add(GHashTable* map, gconstpointer from, gconstpointer to)
 {
-    QofInstance* first_instance = NULL;
-    GetReferringObjectHelperData* data = (GetReferringObjectHelperData*)user_data;
+    GHashTable* counts = g_hash_table_lookup(map, from);
+    guint count;
 
-    qof_collection_foreach(coll, get_referring_object_instance_helper, &first_instance);
+    if (!counts)
+    {
+        counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_hash_table_insert(map, (gpointer)from, counts);
+    }
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(counts, to));
+    g_hash_table_insert(counts, (gpointer)to, GUINT_TO_POINTER(count + 1));
+}
+
+/* Drop one reference, or all of them */
+static void
+reference_map_remove(GHashTable* map, gconstpointer from, gconstpointer to, gboolean all)
+{
+    GHashTable* counts = g_hash_table_lookup(map, from);
+    guint count;
+
+    if (!counts)
+        return;
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(counts, to));
+    if (count > 1 && !all)
+        g_hash_table_insert(counts, (gpointer)to, GUINT_TO_POINTER(count - 1));
+    else
+        g_hash_table_remove(counts, to);
+    if (g_hash_table_size(counts) == 0)
+        g_hash_table_remove(map, from);
+}
+
+void
+qof_instance_reference_changed(QofInstance* inst, gconstpointer old_ref, gconstpointer new_ref)
+{
+    ReferenceIndex* index;
 
-    if (first_instance != NULL)
+    g_return_if_fail(QOF_IS_INSTANCE(inst));
+
+    if (old_ref == new_ref)
+        return;
+    index = reference_index_get(qof_instance_get_book(inst), new_ref != NULL);
+    if (!index)
+        return;
+
+    if (old_ref)
+    {
+        reference_map_remove(index->referrers, old_ref, inst, FALSE);
+        reference_map_remove(index->targets, inst, old_ref, FALSE);
+    }
+    if (new_ref)
+    {
+        reference_map_add(index->referrers, new_ref, inst);
+        reference_map_add(index->targets, inst, new_ref);
+    }
+}
+
+/* An instance going away neither refers nor is referred to any more */
+static void
+reference_index_forget(QofInstance* inst)
+{
+    ReferenceIndex* index = reference_index_get(qof_instance_get_book(inst), FALSE);
+    GHashTable* counts;
+    GHashTableIter iter;
+    gpointer other;
+
+    if (!index)
+        return;
+
+    counts = g_hash_table_lookup(index->targets, inst);
+    if (counts)
     {
-        GList* new_list = qof_instance_get_typed_referring_object_list(first_instance, data->inst);
-        data->list = g_list_concat(data->list, new_list);
+        g_hash_table_iter_init(&iter, counts);
+        while (g_hash_table_iter_next(&iter, &other, NULL))
+            reference_map_remove(index->referrers, other, inst, TRUE);
+        g_hash_table_remove(index->targets, inst);
     }
+
+    counts = g_hash_table_lookup(index->referrers, inst);
+    if (counts)
+    {
+        g_hash_table_iter_init(&iter, counts);
+        while (g_hash_table_iter_next(&iter, &other, NULL))
+            reference_map_remove(index->targets, other, inst, TRUE);
+        g_hash_table_remove(index->referrers, inst);
+    }
+}
+
+/* The indexed instances referring to ref, of the given type or of any */
+static GList*
+reference_index_lookup(const QofInstance* ref, QofIdTypeConst type)
+{
+    ReferenceIndex* index = reference_index_get(qof_instance_get_book(ref), FALSE);
+    GHashTable* counts;
+    GHashTableIter iter;
+    gpointer other;
+    GList* list = NULL;
+
+    counts = index ? g_hash_table_lookup(index->referrers, ref) : NULL;
+    if (!counts)
+        return NULL;
+
+    g_hash_table_iter_init(&iter, counts);
+    while (g_hash_table_iter_next(&iter, &other, NULL))
+    {
+        if (type == NULL || safe_strcmp(QOF_INSTANCE(other)->e_type, type) == 0)
+            list = g_list_prepend(list, other);
+    }
+    return list;
+}
+
+typedef struct
+{
+    const QofInstance* inst;
+    GList* list;
+} GetReferringObjectHelperData;
+
+static void
+get_referring_object_helper(QofCollection* coll, gpointer user_data)
+{
+    QofInstance* first_instance = qof_collection_get_any_entity(coll);
+    GetReferringObjectHelperData* data = (GetReferringObjectHelperData*)user_data;
+    QofInstanceClass* klass;
+
+    if (first_instance == NULL)
+        return;
+
+    /* The indexed types were looked up already, and the types with
+       neither method refer to nothing. */
+    klass = QOF_INSTANCE_GET_CLASS(first_instance);
+    if (klass->references_indexed
+            || (klass->refers_to_object == NULL
+                && klass->get_typed_referring_object_list == NULL))
+        return;
+
+    data->list = g_list_concat(data->list,
+                               qof_instance_get_typed_referring_object_list(first_instance, data->inst));
 }
 
 /* Returns a list of objects referring to this object */
@@ -872,9 +1033,9 @@ GList* qof_instance_get_referring_object_list(const QofInstance* inst)
 
     g_return_val_if_fail( inst != NULL, NULL );
 
-    /* scan all collections */
+    /* take the indexed types from the index and scan the others */
     data.inst = inst;
-    data.list = NULL;
+    data.list = reference_index_lookup(inst, NULL);
 
     qof_book_foreach_collection(qof_instance_get_book(inst),
                                 get_referring_object_helper,
@@ -914,7 +1075,11 @@ qof_instance_get_typed_referring_object_list(const QofInstance* inst, const QofI
     g_return_val_if_fail( inst != NULL, NULL );
     g_return_val_if_fail( ref != NULL, NULL );
 
-    if ( QOF_INSTANCE_GET_CLASS(inst)->get_typed_referring_object_list != NULL )
+    if ( QOF_INSTANCE_GET_CLASS(inst)->references_indexed )
+    {
+        return reference_index_lookup(ref, inst->e_type);
+    }
+    else if ( QOF_INSTANCE_GET_CLASS(inst)->get_typed_referring_object_list != NULL )
     {
         return QOF_INSTANCE_GET_CLASS(inst)->get_typed_referring_object_list(inst, ref);
     }
@@ -946,6 +1111,106 @@ gboolean qof_instance_refers_to_object(const QofInstance* inst, const QofInstanc
     }
 }
 
+typedef struct
+{
+    QofBook* book;
+    ReferenceIndex* index;
+    QofInstance* referrer;
+    guint pairs;
+    guint errors;
+} CheckReferenceData;
+
+static void
+check_reference_target(QofInstance* target, gpointer user_data)
+{
+    CheckReferenceData* data = (CheckReferenceData*)user_data;
+    GHashTable* counts = g_hash_table_lookup(data->index->targets, data->referrer);
+    gboolean indexed = (counts != NULL && g_hash_table_lookup(counts, target) != NULL);
+
+    if (indexed)
+        data->pairs++;
+    if (indexed != qof_instance_refers_to_object(data->referrer, target))
+    {
+        PERR("%s %p %s %s %p", data->referrer->e_type, data->referrer,
+             indexed ? "is indexed but does not refer to" : "refers to unindexed",
+             target->e_type, target);
+        data->errors++;
+    }
+}
+
+static void
+check_reference_target_collection(QofCollection* coll, gpointer user_data)
+{
+    qof_collection_foreach(coll, check_reference_target, user_data);
+}
+
+static void
+check_reference_referrer(QofInstance* inst, gpointer user_data)
+{
+    CheckReferenceData* data = (CheckReferenceData*)user_data;
+
+    data->referrer = inst;
+    qof_book_foreach_collection(data->book, check_reference_target_collection, data);
+}
+
+static void
+check_reference_referrer_collection(QofCollection* coll, gpointer user_data)
+{
+    QofInstance* inst = qof_collection_get_any_entity(coll);
+
+    if (inst != NULL && QOF_INSTANCE_GET_CLASS(inst)->references_indexed)
+        qof_collection_foreach(coll, check_reference_referrer, user_data);
+}
+
+guint
+qof_instance_check_reference_index(QofBook* book)
+{
+    CheckReferenceData data;
+    GHashTableIter iter, count_iter;
+    gpointer referrer, targets, target, referrers, count;
+    guint pairs = 0, reverse_pairs = 0;
+
+    g_return_val_if_fail(book != NULL, 0);
+
+    data.book = book;
+    data.index = reference_index_get(book, TRUE);
+    data.pairs = 0;
+    data.errors = 0;
+    qof_book_foreach_collection(book, check_reference_referrer_collection, &data);
+
+    /* Nothing else may be left in the index, and both of its maps
+       have to hold the same counts. */
+    g_hash_table_iter_init(&iter, data.index->targets);
+    while (g_hash_table_iter_next(&iter, &referrer, &targets))
+    {
+        g_hash_table_iter_init(&count_iter, targets);
+        while (g_hash_table_iter_next(&count_iter, &target, &count))
+        {
+            referrers = g_hash_table_lookup(data.index->referrers, target);
+            pairs++;
+            if (!referrers || g_hash_table_lookup(referrers, referrer) != count)
+            {
+                PERR("reference from %p to %p is counted differently", referrer, target);
+                data.errors++;
+            }
+        }
+    }
+    g_hash_table_iter_init(&iter, data.index->referrers);
+    while (g_hash_table_iter_next(&iter, &target, &referrers))
+        reverse_pairs += g_hash_table_size(referrers);
+    if (pairs != reverse_pairs)
+    {
+        PERR("%u references indexed one way, %u the other", pairs, reverse_pairs);
+        data.errors++;
+    }
+    if (pairs != data.pairs)
+    {
+        PERR("%u references indexed, %u of them between objects of the book", pairs, data.pairs);
+        data.errors++;
+    }
+    return data.errors;
+}
+
 /* =================================================================== */
 /* Entity edit and commit utilities */
 /* =================================================================== */
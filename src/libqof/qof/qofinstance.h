@@ -87,6 +87,11 @@ struct _QofInstanceClass
 
     /* Returns a list of my type of object which refers to an object */
     GList* (*get_typed_referring_object_list)(const QofInstance* inst, const QofInstance* ref);
+
+    /* TRUE if every setter of a field refers_to_object looks at calls
+     * qof_instance_reference_changed, so that the references of this
+     * type are found in the book's index instead of by a scan. */
+    gboolean references_indexed;
 };
 
 /** Return the GType of a QofInstance */
@@ -252,6 +257,21 @@ GList* qof_instance_get_typed_referring_object_list(const QofInstance* inst, con
  */
 GList* qof_instance_get_referring_object_list_from_collection(const QofCollection* coll, const QofInstance* ref);
 
+/** Tell the book's reference index that inst stopped referring to old_ref
+    and now refers to new_ref.  Either may be NULL.  Called by the setters of
+    the types that set references_indexed; an instance referring to the same
+    object through two fields reports each of them.
+ */
+void qof_instance_reference_changed(QofInstance* inst, gconstpointer old_ref, gconstpointer new_ref);
+
+/** Check the book's reference index against refers_to_object, for the test
+    suite.  Every indexed reference has to be a real one, and every real
+    reference of an indexed type has to be in the index.  This compares every
+    pair of instances, so it is slow on big books.
+    @return the number of differences found, after logging each of them.
+ */
+guint qof_instance_check_reference_index(QofBook* book);
+
 /* @} */
 /* @} */
 #endif /* QOF_INSTANCE_H */
@@ -32,6 +32,11 @@ typedef struct _QofQuerySort QofQuerySort;
 /* Functions to get Query information */
 int qof_query_get_max_results (const QofQuery *q);
 
+/* Let queries use the indexes registered with qof_class_register_index()
+ * and qof_class_register_sorted_index(), which they do by default.  The
+ * results are the same either way; this is for tests and benchmarks. */
+void qof_query_set_use_indexes (gboolean use);
+
 
 /* Functions to get and look at QueryTerms */
 
@@ -33,6 +33,7 @@
 #include "qofbackend-p.h"
 #include "qofbook-p.h"
 #include "qofclass-p.h"
+#include "qofevent-p.h"
 #include "qofquery-p.h"
 #include "qofquerycore-p.h"
 
@@ -70,6 +71,8 @@ struct _QofQuerySort
     QofCompareFunc      comp_fcn;       /* When you are comparing core types */
 };
 
+typedef struct _QofQueryLive QofQueryLive;
+
 /* The QUERY structure */
 struct _QofQuery
 {
@@ -101,6 +104,9 @@ struct _QofQuery
     gint              changed;
 
     GList *           results;
+
+    /* see qof_query_set_live() */
+    QofQueryLive *    live;
 };
 
 typedef struct _QofQueryCB
@@ -706,6 +712,83 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
     }
 }
 
+/* An object to select from, with its position in the matching list. */
+typedef struct
+{
+    gpointer object;
+    gint pos;
+} QuerySelectItem;
+
+/* Sort order, and the list order between objects that sort the same,
+ * as the stable sort of the whole list keeps it. */
+static gint query_select_cmp (const QuerySelectItem *a,
+                              const QuerySelectItem *b, QofQuery *q)
+{
+    gint retval = sort_func (a->object, b->object, q);
+
+    if (retval)
+        return retval;
+    return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+/* Comparison for g_qsort_with_data() over an array of items. */
+static gint query_select_sort_func (gconstpointer a, gconstpointer b,
+                                    gpointer q)
+{
+    return query_select_cmp (a, b, q);
+}
+
+/* Return the last k of the count matching objects in sort order, as
+ * the sort-and-crop below would, without sorting all of them: a
+ * quickselect moves the k largest objects to the end of an array and
+ * only those get sorted.  Ties are broken by list position, so that
+ * the same objects make the cut.  Frees the objects list. */
+static GList * query_select_last (QofQuery *q, GList *objects, gint count,
+                                  gint k)
+{
+    QuerySelectItem *items = g_new (QuerySelectItem, count);
+    GList *node, *result = NULL;
+    gint i, lo = 0, hi = count - 1, target = count - k;
+
+    for (i = 0, node = objects; node; node = node->next, i++)
+    {
+        items[i].object = node->data;
+        items[i].pos = i;
+    }
+    g_list_free (objects);
+
+    while (lo < hi)
+    {
+        QuerySelectItem pivot = items[lo + (hi - lo) / 2];
+        gint left = lo, right = hi;
+
+        while (left <= right)
+        {
+            while (query_select_cmp (&items[left], &pivot, q) < 0) left++;
+            while (query_select_cmp (&items[right], &pivot, q) > 0) right--;
+            if (left <= right)
+            {
+                QuerySelectItem tmp = items[left];
+                items[left++] = items[right];
+                items[right--] = tmp;
+            }
+        }
+        if (target <= right)
+            hi = right;
+        else if (target >= left)
+            lo = left;
+        else
+            break;
+    }
+
+    g_qsort_with_data (items + target, k, sizeof (QuerySelectItem),
+                       query_select_sort_func, q);
+    for (i = count - 1; i >= target; i--)
+        result = g_list_prepend (result, items[i].object);
+    g_free (items);
+    return result;
+}
+
 static GList * qof_query_run_internal (QofQuery *q,
                                        void(*run_cb)(QofQueryCB*, gpointer),
                                        gpointer cb_arg)
@@ -755,11 +838,19 @@ static GList * qof_query_run_internal (QofQuery *q,
      */
     matching_objects = g_list_reverse(matching_objects);
 
-    /* Now sort the matching objects based on the search criteria */
+    /* Now sort the matching objects based on the search criteria.  If
+     * only a few of them are wanted, just select and sort those. */
     if (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
             (q->primary_sort.use_default && q->defaultSort))
     {
-        matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
+        if (q->max_results > 0 && object_count > q->max_results)
+        {
+            matching_objects = query_select_last (q, matching_objects,
+                                                  object_count, q->max_results);
+            object_count = q->max_results;
+        }
+        else
+            matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
     }
 
     /* Crop the list to limit the number of splits. */
@@ -798,6 +889,586 @@ static GList * qof_query_run_internal (QofQuery *q,
     return matching_objects;
 }
 
+/* ==================================================================== */
+/* Index-assisted execution.  If every OR-term of the query has an AND
+ * term for which the class registered an index, the candidates are
+ * taken from those indexes instead of from a walk over the whole
+ * collection.  The indexes only narrow the set of objects that get
+ * looked at; every candidate still goes through check_object().
+ */
+
+static gboolean use_indexes = TRUE;
+
+void
+qof_query_set_use_indexes (gboolean use)
+{
+    use_indexes = use;
+}
+
+typedef Timespec (*QofIndexDateGetter) (gpointer, QofParam *);
+typedef gnc_numeric (*QofIndexNumericGetter) (gpointer, QofParam *);
+typedef char (*QofIndexCharGetter) (gpointer, QofParam *);
+
+typedef enum
+{
+    INDEX_KEY_NONE,
+    INDEX_KEY_DATE,
+    INDEX_KEY_NUMERIC,
+    INDEX_KEY_CHAR
+} QofIndexKeyType;
+
+typedef union
+{
+    Timespec    date;
+    gnc_numeric amount;     /* absolute value, like the numeric predicate */
+    guchar      c;
+} QofIndexKey;
+
+typedef struct
+{
+    gpointer    object;
+    QofIndexKey key;
+} QofIndexEntry;
+
+typedef struct
+{
+    gboolean    has_lo;
+    gboolean    has_hi;
+    QofIndexKey lo;
+    QofIndexKey hi;
+} QofIndexRange;
+
+/* The per-book state of a sorted index.  The entries are only built
+ * when the index is asked for twice without the collections along its
+ * path changing in between, so that a book that is edited between
+ * every query doesn't pay for a sort on top of the scan. */
+typedef struct
+{
+    QofIndexKeyType key_type;
+    guint           generation;
+    gboolean        wanted;
+    gboolean        built;
+    GArray         *entries;    /* QofIndexEntry, sorted by key */
+    GPtrArray      *unkeyed;    /* objects with a NULL along the path */
+} QofSortedIndex;
+
+/* One step of an execution plan: the index serving one OR-term. */
+typedef struct
+{
+    const QofClassIndex *index;
+    QofQueryTerm        *term;
+    QofSortedIndex      *sorted;
+    GArray              *ranges;    /* QofIndexRange */
+} QofQueryPlanStep;
+
+#define QOF_QUERY_SORTED_INDEXES "qof-query-sorted-indexes"
+
+static int
+index_key_cmp (QofIndexKeyType key_type, const QofIndexKey *a,
+               const QofIndexKey *b)
+{
+    if (key_type == INDEX_KEY_DATE)
+        return timespec_cmp (&a->date, &b->date);
+    if (key_type == INDEX_KEY_CHAR)
+        return (int)a->c - (int)b->c;
+    return gnc_numeric_compare (a->amount, b->amount);
+}
+
+static QofIndexKeyType
+index_key_type (const QofParam *param)
+{
+    if (!safe_strcmp (param->param_type, QOF_TYPE_DATE))
+        return INDEX_KEY_DATE;
+    if (!safe_strcmp (param->param_type, QOF_TYPE_NUMERIC) ||
+            !safe_strcmp (param->param_type, QOF_TYPE_DEBCRED))
+        return INDEX_KEY_NUMERIC;
+    if (!safe_strcmp (param->param_type, QOF_TYPE_CHAR))
+        return INDEX_KEY_CHAR;
+    return INDEX_KEY_NONE;
+}
+
+static void
+sorted_index_free (gpointer data)
+{
+    QofSortedIndex *sorted = data;
+
+    if (sorted->entries)
+        g_array_free (sorted->entries, TRUE);
+    if (sorted->unkeyed)
+        g_ptr_array_free (sorted->unkeyed, TRUE);
+    g_free (sorted);
+}
+
+static void
+sorted_indexes_destroy (QofBook *book, gpointer key, gpointer data)
+{
+    g_hash_table_destroy (data);
+}
+
+/* The generation of an index is the sum of the generations of the
+ * collections its path walks through. */
+static guint
+sorted_index_generation (QofBook *book, QofIdTypeConst obj_type,
+                         const GSList *param_fcns)
+{
+    guint generation;
+
+    generation = qof_collection_get_generation
+                 (qof_book_get_collection (book, obj_type));
+    for (; param_fcns && param_fcns->next; param_fcns = param_fcns->next)
+    {
+        const QofParam *param = param_fcns->data;
+        generation += qof_collection_get_generation
+                      (qof_book_get_collection (book, param->param_type));
+    }
+    return generation;
+}
+
+typedef struct
+{
+    QofSortedIndex *sorted;
+    const GSList   *param_fcns;
+} QofSortedIndexBuild;
+
+static void
+sorted_index_add_cb (QofInstance *inst, gpointer user_data)
+{
+    QofSortedIndexBuild *build = user_data;
+    const GSList *node;
+    QofParam *param = NULL;
+    gpointer conv_obj = inst;
+    QofIndexEntry entry;
+
+    for (node = build->param_fcns; node; node = node->next)
+    {
+        param = node->data;
+        if (!node->next) break;
+        conv_obj = param->param_getfcn (conv_obj, param);
+        if (!conv_obj)
+        {
+            g_ptr_array_add (build->sorted->unkeyed, inst);
+            return;
+        }
+    }
+
+    entry.object = inst;
+    if (build->sorted->key_type == INDEX_KEY_DATE)
+        entry.key.date = ((QofIndexDateGetter)param->param_getfcn) (conv_obj,
+                         param);
+    else if (build->sorted->key_type == INDEX_KEY_CHAR)
+        entry.key.c = ((QofIndexCharGetter)param->param_getfcn) (conv_obj,
+                      param);
+    else
+        entry.key.amount = gnc_numeric_abs
+                           (((QofIndexNumericGetter)param->param_getfcn) (conv_obj, param));
+    g_array_append_val (build->sorted->entries, entry);
+}
+
+static gint
+sorted_index_entry_cmp (gconstpointer a, gconstpointer b, gpointer key_type)
+{
+    const QofIndexEntry *ea = a;
+    const QofIndexEntry *eb = b;
+
+    return index_key_cmp (GPOINTER_TO_INT (key_type), &ea->key, &eb->key);
+}
+
+static void
+sorted_index_build (QofSortedIndex *sorted, QofBook *book,
+                    QofIdTypeConst obj_type, const GSList *param_fcns)
+{
+    QofCollection *col = qof_book_get_collection (book, obj_type);
+    QofSortedIndexBuild build;
+
+    if (sorted->entries)
+        g_array_free (sorted->entries, TRUE);
+    if (sorted->unkeyed)
+        g_ptr_array_free (sorted->unkeyed, TRUE);
+    sorted->entries = g_array_sized_new (FALSE, FALSE, sizeof (QofIndexEntry),
+                                         qof_collection_count (col));
+    sorted->unkeyed = g_ptr_array_new ();
+
+    build.sorted = sorted;
+    build.param_fcns = param_fcns;
+    qof_collection_foreach (col, sorted_index_add_cb, &build);
+    g_qsort_with_data (sorted->entries->data, sorted->entries->len,
+                       sizeof (QofIndexEntry), sorted_index_entry_cmp,
+                       GINT_TO_POINTER (sorted->key_type));
+    sorted->built = TRUE;
+}
+
+/* Return the sorted index of the book for the term, ready to use, or
+ * NULL if it isn't worth building (yet). */
+static QofSortedIndex *
+sorted_index_get (QofBook *book, QofIdTypeConst obj_type,
+                  const QofClassIndex *index, const QofQueryTerm *qt)
+{
+    GHashTable *indexes;
+    QofSortedIndex *sorted;
+    const QofParam *param;
+    guint generation;
+
+    param = g_slist_last (qt->param_fcns)->data;
+    indexes = qof_book_get_data (book, QOF_QUERY_SORTED_INDEXES);
+    if (!indexes)
+    {
+        indexes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                         sorted_index_free);
+        qof_book_set_data_fin (book, QOF_QUERY_SORTED_INDEXES, indexes,
+                               sorted_indexes_destroy);
+    }
+
+    sorted = g_hash_table_lookup (indexes, index);
+    if (!sorted)
+    {
+        sorted = g_new0 (QofSortedIndex, 1);
+        sorted->key_type = index_key_type (param);
+        g_hash_table_insert (indexes, (gpointer)index, sorted);
+    }
+    if (sorted->key_type == INDEX_KEY_NONE) return NULL;
+
+    generation = sorted_index_generation (book, obj_type, qt->param_fcns);
+    if (sorted->built && sorted->generation == generation)
+        return sorted;
+
+    if (sorted->wanted && sorted->generation == generation)
+    {
+        sorted_index_build (sorted, book, obj_type, qt->param_fcns);
+        PINFO ("built sorted index on %s.%s: %u entries", obj_type,
+               param->param_name, sorted->entries->len);
+        return sorted;
+    }
+
+    sorted->wanted = TRUE;
+    sorted->built = FALSE;
+    sorted->generation = generation;
+    return NULL;
+}
+
+/* Turn the predicate into key ranges covering at least all of the
+ * values it accepts.  Returns NULL if that can't be done, e.g. for a
+ * "not equal" predicate. */
+static GArray *
+sorted_index_ranges (QofIndexKeyType key_type, const QofQueryPredData *pd)
+{
+    GArray *ranges = g_array_new (FALSE, TRUE, sizeof (QofIndexRange));
+    QofIndexRange range;
+
+    memset (&range, 0, sizeof (range));
+    if (key_type == INDEX_KEY_DATE && !safe_strcmp (pd->type_name,
+            QOF_TYPE_DATE))
+    {
+        const query_date_def *pdata = (const query_date_def *)pd;
+        Timespec lo = pdata->date, hi = pdata->date;
+
+        /* Matching on the day compares the canonical times of the
+         * days, which are less than a day away from the real times. */
+        if (pdata->options == QOF_DATE_MATCH_DAY)
+        {
+            lo.tv_sec -= 2 * 86400;
+            hi.tv_sec += 2 * 86400;
+        }
+        range.lo.date = lo;
+        range.hi.date = hi;
+        switch (pd->how)
+        {
+        case QOF_COMPARE_LT:
+        case QOF_COMPARE_LTE:
+            range.has_hi = TRUE;
+            break;
+        case QOF_COMPARE_GT:
+        case QOF_COMPARE_GTE:
+            range.has_lo = TRUE;
+            break;
+        case QOF_COMPARE_EQUAL:
+            range.has_lo = range.has_hi = TRUE;
+            break;
+        default:
+            g_array_free (ranges, TRUE);
+            return NULL;
+        }
+        g_array_append_val (ranges, range);
+    }
+    else if (key_type == INDEX_KEY_NUMERIC && !safe_strcmp (pd->type_name,
+             QOF_TYPE_NUMERIC))
+    {
+        const query_numeric_def *pdata = (const query_numeric_def *)pd;
+
+        switch (pd->how)
+        {
+        case QOF_COMPARE_LT:
+        case QOF_COMPARE_LTE:
+            range.has_hi = TRUE;
+            range.hi.amount = pdata->amount;
+            break;
+        case QOF_COMPARE_GT:
+        case QOF_COMPARE_GTE:
+            range.has_lo = TRUE;
+            range.lo.amount = pdata->amount;
+            break;
+        case QOF_COMPARE_EQUAL:
+        {
+            /* The predicate allows for 1/10000 of difference. */
+            gnc_numeric amount = gnc_numeric_abs (pdata->amount);
+            gnc_numeric epsilon = gnc_numeric_create (2, 10000);
+
+            range.has_lo = range.has_hi = TRUE;
+            range.lo.amount = gnc_numeric_sub (amount, epsilon, GNC_DENOM_AUTO,
+                                               GNC_HOW_DENOM_LCD);
+            range.hi.amount = gnc_numeric_add (amount, epsilon, GNC_DENOM_AUTO,
+                                               GNC_HOW_DENOM_LCD);
+            if (gnc_numeric_check (range.lo.amount) ||
+                    gnc_numeric_check (range.hi.amount))
+            {
+                g_array_free (ranges, TRUE);
+                return NULL;
+            }
+            break;
+        }
+        default:
+            g_array_free (ranges, TRUE);
+            return NULL;
+        }
+        if (gnc_numeric_check (pdata->amount))
+        {
+            g_array_free (ranges, TRUE);
+            return NULL;
+        }
+        g_array_append_val (ranges, range);
+    }
+    else if (key_type == INDEX_KEY_CHAR && !safe_strcmp (pd->type_name,
+             QOF_TYPE_CHAR))
+    {
+        const query_char_def *pdata = (const query_char_def *)pd;
+        const gchar *c;
+
+        if (pdata->options != QOF_CHAR_MATCH_ANY || !pdata->char_list)
+        {
+            g_array_free (ranges, TRUE);
+            return NULL;
+        }
+        for (c = pdata->char_list; *c; c++)
+        {
+            if (strchr (pdata->char_list, *c) != c) continue;
+            range.has_lo = range.has_hi = TRUE;
+            range.lo.c = range.hi.c = (guchar) * c;
+            g_array_append_val (ranges, range);
+        }
+    }
+    else
+    {
+        g_array_free (ranges, TRUE);
+        return NULL;
+    }
+    return ranges;
+}
+
+/* Index of the first entry whose key is not below (after == FALSE) or
+ * is above (after == TRUE) the key. */
+static guint
+sorted_index_bound (const QofSortedIndex *sorted, const QofIndexKey *key,
+                    gboolean after)
+{
+    const QofIndexEntry *entries = (const QofIndexEntry *)sorted->entries->data;
+    guint lo = 0, hi = sorted->entries->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        int cmp = index_key_cmp (sorted->key_type, &entries[mid].key, key);
+
+        if (cmp < 0 || (after && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+sorted_index_range_bounds (const QofSortedIndex *sorted,
+                           const QofIndexRange *range,
+                           guint *first, guint *last)
+{
+    *first = range->has_lo ? sorted_index_bound (sorted, &range->lo, FALSE) : 0;
+    *last = range->has_hi ? sorted_index_bound (sorted, &range->hi, TRUE) :
+            sorted->entries->len;
+    if (*last < *first) *last = *first;
+}
+
+static gint
+plan_step_estimate (QofQueryPlanStep *step, QofBook *book,
+                    QofIdTypeConst obj_type)
+{
+    guint i, first, last;
+    gint estimate;
+
+    if (!step->index->sorted)
+        return step->index->estimate (book, step->term->pdata);
+
+    step->sorted = sorted_index_get (book, obj_type, step->index, step->term);
+    if (!step->sorted) return -1;
+    step->ranges = sorted_index_ranges (step->sorted->key_type,
+                                        step->term->pdata);
+    if (!step->ranges) return -1;
+
+    estimate = step->sorted->unkeyed->len;
+    for (i = 0; i < step->ranges->len; i++)
+    {
+        sorted_index_range_bounds (step->sorted,
+                                   &g_array_index (step->ranges, QofIndexRange, i),
+                                   &first, &last);
+        estimate += last - first;
+    }
+    return estimate;
+}
+
+static void
+plan_step_foreach (QofQueryPlanStep *step, QofBook *book,
+                   QofInstanceForeachCB cb, gpointer user_data)
+{
+    const QofIndexEntry *entries;
+    guint i, j, first, last;
+
+    if (!step->index->sorted)
+    {
+        step->index->foreach (book, step->term->pdata, cb, user_data);
+        return;
+    }
+
+    entries = (const QofIndexEntry *)step->sorted->entries->data;
+    for (i = 0; i < step->ranges->len; i++)
+    {
+        sorted_index_range_bounds (step->sorted,
+                                   &g_array_index (step->ranges, QofIndexRange, i),
+                                   &first, &last);
+        for (j = first; j < last; j++)
+            cb (entries[j].object, user_data);
+    }
+    for (i = 0; i < step->sorted->unkeyed->len; i++)
+        cb (g_ptr_array_index (step->sorted->unkeyed, i), user_data);
+}
+
+static void
+plan_step_free (QofQueryPlanStep *step)
+{
+    if (step->ranges)
+        g_array_free (step->ranges, TRUE);
+    g_free (step);
+}
+
+/* Pick the cheapest usable index of the OR-term, or NULL if it has
+ * none. */
+static QofQueryPlanStep *
+plan_or_term (QofQuery *q, QofBook *book, GList *and_terms, GList *indexes,
+              gint *estimate)
+{
+    QofQueryPlanStep *best = NULL;
+    GList *and_ptr, *inode;
+
+    for (and_ptr = and_terms; and_ptr; and_ptr = and_ptr->next)
+    {
+        QofQueryTerm *qt = and_ptr->data;
+
+        if (qt->invert || !qt->param_fcns || !qt->pred_fcn) continue;
+        for (inode = indexes; inode; inode = inode->next)
+        {
+            const QofClassIndex *index = inode->data;
+            QofQueryPlanStep *step;
+            gint est;
+
+            if (param_list_cmp (index->param_path, qt->param_list)) continue;
+
+            step = g_new0 (QofQueryPlanStep, 1);
+            step->index = index;
+            step->term = qt;
+            est = plan_step_estimate (step, book, q->search_for);
+            if (est >= 0 && (!best || est < *estimate))
+            {
+                if (best) plan_step_free (best);
+                best = step;
+                *estimate = est;
+            }
+            else
+                plan_step_free (step);
+        }
+    }
+    return best;
+}
+
+typedef struct
+{
+    QofQueryCB *qcb;
+    GHashTable *seen;
+} QofQueryDedup;
+
+static void
+check_item_once_cb (gpointer object, gpointer user_data)
+{
+    QofQueryDedup *dedup = user_data;
+
+    if (g_hash_table_lookup (dedup->seen, object)) return;
+    g_hash_table_insert (dedup->seen, object, object);
+    check_item_cb (object, dedup->qcb);
+}
+
+/* Run the query on the book through its indexes.  Returns FALSE,
+ * without having touched qcb, if that isn't possible or not cheaper
+ * than looking at every object. */
+static gboolean
+query_run_indexed (QofQueryCB *qcb, QofBook *book)
+{
+    QofQuery *q = qcb->query;
+    GList *indexes, *or_ptr, *plan = NULL, *node;
+    gint total = 0, count;
+
+    if (!use_indexes || !q->terms) return FALSE;
+    indexes = qof_class_get_indexes (q->search_for);
+    if (!indexes) return FALSE;
+
+    count = qof_collection_count (qof_book_get_collection (book, q->search_for));
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+    {
+        gint estimate = 0;
+        QofQueryPlanStep *step = plan_or_term (q, book, or_ptr->data, indexes,
+                                               &estimate);
+
+        if (step)
+            plan = g_list_prepend (plan, step);
+        total += estimate;
+        if (!step || total >= count)
+        {
+            g_list_foreach (plan, (GFunc)plan_step_free, NULL);
+            g_list_free (plan);
+            return FALSE;
+        }
+    }
+    plan = g_list_reverse (plan);
+    PINFO ("query %p: %d candidates from indexes instead of %d objects",
+           q, total, count);
+
+    if (!plan->next)
+    {
+        plan_step_foreach (plan->data, book,
+                           (QofInstanceForeachCB) check_item_cb, qcb);
+    }
+    else
+    {
+        QofQueryDedup dedup;
+
+        dedup.qcb = qcb;
+        dedup.seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (node = plan; node; node = node->next)
+            plan_step_foreach (node->data, book,
+                               (QofInstanceForeachCB) check_item_once_cb, &dedup);
+        g_hash_table_destroy (dedup.seen);
+    }
+
+    g_list_foreach (plan, (GFunc)plan_step_free, NULL);
+    g_list_free (plan);
+    return TRUE;
+}
+
 static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
 {
     GList *node;
@@ -822,14 +1493,332 @@ static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
             }
         }
 
-        /* And then iterate over all the objects */
-        qof_object_foreach (qcb->query->search_for, book,
-                            (QofInstanceForeachCB) check_item_cb, qcb);
+        /* And then iterate over the candidates from the indexes, or
+         * over all the objects */
+        if (!query_run_indexed (qcb, book))
+            qof_object_foreach (qcb->query->search_for, book,
+                                (QofInstanceForeachCB) check_item_cb, qcb);
+    }
+}
+
+/* ==================================================================== */
+/* Live queries.  A live query keeps the complete, uncropped and sorted
+ * list of the objects it matches, and patches it from the QOF events
+ * instead of running over the book again.  The list links are also
+ * kept in a GSequence, ordered the same way, so that an object can be
+ * moved or added in O(log n).
+ */
+
+struct _QofQueryLive
+{
+    gint        handler_id;
+    gboolean    valid;          /* list reflects the books */
+    guint       dropped;        /* qof_event_get_dropped_count() at sync */
+    gboolean    sorted;
+    GList      *list;           /* all matching objects, in sort order */
+    GSequence  *order;          /* the links of list */
+    GHashTable *members;        /* object -> GSequenceIter */
+    GHashTable *types;          /* type -> QofDependentsFunc or NULL */
+    guint       count;
+};
+
+static gint live_link_order (gconstpointer a, gconstpointer b, gpointer q)
+{
+    return sort_func (((const GList *)a)->data, ((const GList *)b)->data, q);
+}
+
+static void live_clear (QofQueryLive *live)
+{
+    g_list_free (live->list);
+    live->list = NULL;
+    live->count = 0;
+    g_sequence_remove_range (g_sequence_get_begin_iter (live->order),
+                             g_sequence_get_end_iter (live->order));
+    g_hash_table_remove_all (live->members);
+    g_hash_table_remove_all (live->types);
+    live->valid = FALSE;
+}
+
+/* Link the list node of the sequence entry into the list, right behind
+ * the node of the preceding entry. */
+static void live_splice_link (QofQueryLive *live, GSequenceIter *iter)
+{
+    GList *link = g_sequence_get (iter);
+    GList *prev;
+
+    if (g_sequence_iter_is_begin (iter))
+    {
+        link->prev = NULL;
+        link->next = live->list;
+        if (live->list)
+            live->list->prev = link;
+        live->list = link;
+        return;
+    }
+
+    prev = g_sequence_get (g_sequence_iter_prev (iter));
+    link->prev = prev;
+    link->next = prev->next;
+    if (prev->next)
+        prev->next->prev = link;
+    prev->next = link;
+}
+
+static void live_remove (QofQueryLive *live, gpointer object)
+{
+    GSequenceIter *iter = g_hash_table_lookup (live->members, object);
+    GList *link;
+
+    if (!iter) return;
+    link = g_sequence_get (iter);
+    live->list = g_list_delete_link (live->list, link);
+    g_sequence_remove (iter);
+    g_hash_table_remove (live->members, object);
+    live->count--;
+}
+
+static void live_insert (QofQuery *q, gpointer object)
+{
+    QofQueryLive *live = q->live;
+    GList *link = g_list_alloc ();
+    GSequenceIter *iter;
+
+    link->data = object;
+    if (live->sorted)
+        iter = g_sequence_insert_sorted (live->order, link, live_link_order, q);
+    else
+        iter = g_sequence_append (live->order, link);
+    live_splice_link (live, iter);
+    g_hash_table_insert (live->members, object, iter);
+    live->count++;
+}
+
+/* Put the object back into the list if it still matches.  It must not
+ * be in the list, and the list must be in order. */
+static void live_reinsert (QofQuery *q, gpointer object)
+{
+    QofInstance *inst = object;
+
+    if (!qof_instance_get_destroying (inst) &&
+            g_list_find (q->books, qof_instance_get_book (inst)) &&
+            check_object (q, object))
+        live_insert (q, object);
+}
+
+/* Check the object again and move it into, within or out of the list. */
+static void live_update_object (QofQuery *q, gpointer object)
+{
+    live_remove (q->live, object);
+    live_reinsert (q, object);
+}
+
+static void live_collect_object (gpointer object, gpointer user_data)
+{
+    g_ptr_array_add (user_data, object);
+}
+
+/* A change to one object may change the sort keys of all of the
+ * objects depending on it at once.  Those still in the list would
+ * break the order the binary search relies on, so take all of them out
+ * before putting any back. */
+static void live_update_dependents (QofQuery *q, QofInstance *ent,
+                                    QofDependentsFunc dependents)
+{
+    GPtrArray *objects = g_ptr_array_new ();
+    guint i;
+
+    dependents (ent, live_collect_object, objects);
+    for (i = 0; i < objects->len; i++)
+        live_remove (q->live, objects->pdata[i]);
+    for (i = 0; i < objects->len; i++)
+        if (!g_hash_table_lookup (q->live->members, objects->pdata[i]))
+            live_reinsert (q, objects->pdata[i]);
+    g_ptr_array_free (objects, TRUE);
+}
+
+/* Collect the types the query looks through: the objects along the
+ * parameter paths of its terms and sorts.  A path that only goes on
+ * to the GncGUID of such an object doesn't depend on its contents. */
+static void live_add_path_types (QofQuery *q, const GSList *param_fcns)
+{
+    GHashTable *dependents = qof_class_get_dependents (q->search_for);
+
+    for (; param_fcns && param_fcns->next; param_fcns = param_fcns->next)
+    {
+        const QofParam *param = param_fcns->data;
+        const QofParam *next = param_fcns->next->data;
+
+        if (!safe_strcmp (next->param_name, QOF_PARAM_GUID)) continue;
+        g_hash_table_insert (q->live->types, (gpointer)param->param_type,
+                             dependents ? g_hash_table_lookup (dependents,
+                                     param->param_type) : NULL);
+    }
+}
+
+static void live_add_dependents (gpointer key, gpointer value, gpointer data)
+{
+    g_hash_table_insert (data, key, value);
+}
+
+/* Take over the complete, sorted result of a fresh run. */
+static void live_rebuild (QofQuery *q, GList *objects)
+{
+    QofQueryLive *live = q->live;
+    QofQuerySort *sorts[3];
+    GList *or_ptr, *and_ptr, *link;
+    gint i;
+
+    live_clear (live);
+    live->sorted = (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
+                    (q->primary_sort.use_default && q->defaultSort));
+    live->list = objects;
+    for (link = objects; link; link = link->next)
+    {
+        g_hash_table_insert (live->members, link->data,
+                             g_sequence_append (live->order, link));
+        live->count++;
+    }
+
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+        for (and_ptr = or_ptr->data; and_ptr; and_ptr = and_ptr->next)
+            live_add_path_types (q, ((QofQueryTerm *)and_ptr->data)->param_fcns);
+
+    sorts[0] = &q->primary_sort;
+    sorts[1] = &q->secondary_sort;
+    sorts[2] = &q->tertiary_sort;
+    for (i = 0; i < 3; i++)
+    {
+        live_add_path_types (q, sorts[i]->param_fcns);
+        /* The default sort may look at anything the class depends on. */
+        if (sorts[i]->use_default && qof_class_get_dependents (q->search_for))
+            g_hash_table_foreach (qof_class_get_dependents (q->search_for),
+                                  live_add_dependents, live->types);
+    }
+
+    live->dropped = qof_event_get_dropped_count ();
+    live->valid = TRUE;
+}
+
+static void live_event_handler (QofInstance *ent, QofEventId event_type,
+                                gpointer handler_data, gpointer event_data)
+{
+    QofQuery *q = handler_data;
+    QofQueryLive *live = q->live;
+    QofDependentsFunc dependents;
+
+    if (!live || !live->valid || q->changed) return;
+    if (!(event_type & (QOF_EVENT_CREATE | QOF_EVENT_MODIFY | QOF_EVENT_DESTROY |
+                        QOF_EVENT_ADD | QOF_EVENT_REMOVE)))
+        return;
+
+    if (!safe_strcmp (ent->e_type, q->search_for))
+    {
+        if (event_type == QOF_EVENT_DESTROY)
+            live_remove (live, ent);
+        else
+            live_update_object (q, ent);
+        return;
+    }
+
+    if (!g_hash_table_lookup_extended (live->types, ent->e_type, NULL,
+                                       (gpointer *)&dependents))
+        return;
+    if (!g_list_find (q->books, qof_instance_get_book (ent)))
+        return;
+    if (dependents)
+        live_update_dependents (q, ent, dependents);
+    else
+        live->valid = FALSE;
+}
+
+static void live_destroy (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+
+    if (!live) return;
+    qof_event_unregister_handler (live->handler_id);
+    g_list_free (live->list);
+    g_sequence_free (live->order);
+    g_hash_table_destroy (live->members);
+    g_hash_table_destroy (live->types);
+    g_free (live);
+    q->live = NULL;
+}
+
+/* Hand out a copy of the live list, cropped to max_results like a
+ * normal run.  The event handler edits the live list in place, so the
+ * caller must not walk it while changing the objects. */
+static GList * live_results (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+
+    g_list_free (q->results);
+    q->results = NULL;
+    if (q->max_results < 0 || live->count <= (guint)q->max_results)
+        q->results = g_list_copy (live->list);
+    else if (q->max_results > 0)
+    {
+        GSequenceIter *iter = g_sequence_get_end_iter (live->order);
+        gint i;
+
+        for (i = 0; i < q->max_results; i++)
+        {
+            iter = g_sequence_iter_prev (iter);
+            q->results = g_list_prepend (q->results,
+                                         ((GList *)g_sequence_get (iter))->data);
+        }
+    }
+    return q->results;
+}
+
+static GList * qof_query_run_live (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+    GList *objects;
+    gint max_results;
+
+    if (!q->search_for || !q->books) return NULL;
+    if (live->valid && !q->changed &&
+            live->dropped == qof_event_get_dropped_count ())
+        return live_results (q);
+
+    /* Run the query without cropping and take over the result. */
+    g_list_free (q->results);
+    max_results = q->max_results;
+    q->max_results = -1;
+    objects = qof_query_run_internal (q, qof_query_run_cb, NULL);
+    q->max_results = max_results;
+    q->results = NULL;
+
+    live_rebuild (q, objects);
+    return live_results (q);
+}
+
+void qof_query_set_live (QofQuery *q, gboolean live)
+{
+    if (!q) return;
+    if (!live)
+    {
+        live_destroy (q);
+        return;
     }
+    if (q->live) return;
+
+    q->live = g_new0 (QofQueryLive, 1);
+    q->live->order = g_sequence_new (NULL);
+    q->live->members = g_hash_table_new (g_direct_hash, g_direct_equal);
+    q->live->types = g_hash_table_new (g_str_hash, g_str_equal);
+    q->live->handler_id = qof_event_register_filtered_handler
+                          (live_event_handler, q, NULL,
+                           QOF_EVENT_CREATE | QOF_EVENT_MODIFY | QOF_EVENT_DESTROY |
+                           QOF_EVENT_ADD | QOF_EVENT_REMOVE);
 }
 
 GList * qof_query_run (QofQuery *q)
 {
+    if (q && q->live)
+        return qof_query_run_live (q);
+
     /* Just a wrapper */
     return qof_query_run_internal(q, qof_query_run_cb, NULL);
 }
@@ -973,6 +1962,7 @@ GSList * qof_query_get_term_type (QofQuery *q, QofQueryParamList *term_param)
 void qof_query_destroy (QofQuery *q)
 {
     if (!q) return;
+    live_destroy (q);
     free_members (q);
     query_clear_compiles (q);
     g_hash_table_destroy (q->be_compiled);
@@ -995,6 +1985,7 @@ QofQuery * qof_query_copy (QofQuery *q)
     copy->terms = copy_or_terms (q->terms);
     copy->books = g_list_copy (q->books);
     copy->results = g_list_copy (q->results);
+    copy->live = NULL;
 
     copy_sort (&(copy->primary_sort), &(q->primary_sort));
     copy_sort (&(copy->secondary_sort), &(q->secondary_sort));
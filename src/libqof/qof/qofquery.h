@@ -222,6 +222,20 @@ GList * qof_query_run (QofQuery *query);
  */
 GList * qof_query_last_run (QofQuery *query);
 
+/** Make the query live, or stop it from being live.  A live query
+ *  listens to the QOF events and keeps its results up to date by
+ *  checking just the objects that changed, so that qof_query_run()
+ *  doesn't have to look at the whole book again.  It only runs the
+ *  query again after its terms, sorts or books changed, after events
+ *  were suspended, or after a change it can't trace to the objects it
+ *  affects, see qof_class_register_dependents().
+ *
+ *  Like for any query, the list returned by qof_query_run() stays
+ *  valid until the next run, so the objects in it may be changed
+ *  while walking it.
+ */
+void qof_query_set_live (QofQuery *query, gboolean live);
+
 /** Perform a subquery, return the results.
  *  Instead of running over a book, the subquery runs over the results
  *  of the primary query.
@@ -0,0 +1,176 @@
+/********************************************************************
+ * test-guid.c: GLib g_test test suite for guid.c.                  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#ifndef G_OS_WIN32
+# include <unistd.h>
+# include <sys/wait.h>
+#endif
+#include "qof.h"
+#include "test-stuff.h"
+
+static const gchar *suitename = "/qof/guid";
+void test_suite_guid ( void );
+
+#define NUM_GUIDS 200000
+#define NUM_THREADS 4
+#define PERF_GUIDS 10000000
+
+/* Insert guids into seen, and return how many were there already. */
+static guint
+count_duplicates( GHashTable *seen, GncGUID *guids, guint n )
+{
+    guint i, duplicates = 0;
+
+    for ( i = 0; i < n; i++ )
+    {
+        if ( g_hash_table_lookup( seen, &guids[i] ) )
+            duplicates++;
+        else
+            g_hash_table_insert( seen, &guids[i], &guids[i] );
+    }
+    return duplicates;
+}
+
+static void
+test_guid_new_unique( void )
+{
+    GncGUID *guids = g_new( GncGUID, NUM_GUIDS );
+    GHashTable *seen = guid_hash_table_new();
+    guint i;
+
+    for ( i = 0; i < NUM_GUIDS; i++ )
+        guid_new( &guids[i] );
+    g_assert_cmpint( count_duplicates( seen, guids, NUM_GUIDS ), == , 0 );
+
+    g_test_message( "Test the ids are RFC 4122 version 4" );
+    for ( i = 0; i < NUM_GUIDS; i++ )
+    {
+        g_assert_cmpint( guids[i].data[6] >> 4, == , 4 );
+        g_assert_cmpint( guids[i].data[8] >> 6, == , 2 );
+        g_assert( !guid_equal( &guids[i], guid_null() ) );
+    }
+
+    g_test_message( "Test a new key still gives new ids" );
+    guid_init();
+    for ( i = 0; i < NUM_GUIDS / 2; i++ )
+        guid_new( &guids[i] );
+    g_hash_table_remove_all( seen );
+    g_assert_cmpint( count_duplicates( seen, guids, NUM_GUIDS ), == , 0 );
+
+    g_hash_table_destroy( seen );
+    g_free( guids );
+}
+
+static gpointer
+make_guids( gpointer data )
+{
+    GncGUID *guids = data;
+    guint i;
+
+    for ( i = 0; i < NUM_GUIDS / NUM_THREADS; i++ )
+        guid_new( &guids[i] );
+    return NULL;
+}
+
+static void
+test_guid_new_threads( void )
+{
+    GncGUID *guids = g_new( GncGUID, NUM_GUIDS );
+    GThread *threads[NUM_THREADS];
+    GHashTable *seen = guid_hash_table_new();
+    guint i;
+
+    if ( !g_thread_supported() )
+    {
+        g_test_message( "Threads are not supported, skipping" );
+        g_free( guids );
+        return;
+    }
+    for ( i = 0; i < NUM_THREADS; i++ )
+        threads[i] = g_thread_create( make_guids, guids + i * (NUM_GUIDS / NUM_THREADS),
+                                      TRUE, NULL );
+    for ( i = 0; i < NUM_THREADS; i++ )
+        g_thread_join( threads[i] );
+    g_assert_cmpint( count_duplicates( seen, guids, NUM_GUIDS ), == , 0 );
+
+    g_hash_table_destroy( seen );
+    g_free( guids );
+}
+
+#ifndef G_OS_WIN32
+static void
+test_guid_new_fork( void )
+{
+    GncGUID parent, child;
+    int fds[2], status;
+    pid_t pid;
+
+    /* Start a batch, so that the child inherits the rest of it */
+    guid_new( &parent );
+    g_assert( pipe( fds ) == 0 );
+    pid = fork();
+    g_assert( pid >= 0 );
+    if ( pid == 0 )
+    {
+        guid_new( &child );
+        _exit( write( fds[1], &child, sizeof( child ) ) == sizeof( child ) ? 0 : 1 );
+    }
+    guid_new( &parent );
+    g_assert( read( fds[0], &child, sizeof( child ) ) == sizeof( child ) );
+    g_assert( waitpid( pid, &status, 0 ) == pid );
+    g_assert( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+    close( fds[0] );
+    close( fds[1] );
+    g_assert( !guid_equal( &parent, &child ) );
+}
+#endif
+
+static void
+test_guid_new_perf( void )
+{
+    GncGUID guid;
+    GTimer *timer;
+    gdouble seconds;
+    guint i;
+
+    if ( !g_test_perf() )
+        return;
+    timer = g_timer_new();
+    for ( i = 0; i < PERF_GUIDS; i++ )
+        guid_new( &guid );
+    seconds = g_timer_elapsed( timer, NULL );
+    g_timer_destroy( timer );
+    g_test_maximized_result( PERF_GUIDS / seconds, "%d guids in %.3f s",
+                             PERF_GUIDS, seconds );
+}
+
+void
+test_suite_guid( void )
+{
+    GNC_TEST_ADD_FUNC( suitename, "guid new unique", test_guid_new_unique );
+    GNC_TEST_ADD_FUNC( suitename, "guid new threads", test_guid_new_threads );
+#ifndef G_OS_WIN32
+    GNC_TEST_ADD_FUNC( suitename, "guid new fork", test_guid_new_fork );
+#endif
+    GNC_TEST_ADD_FUNC( suitename, "guid new perf", test_guid_new_perf );
+}
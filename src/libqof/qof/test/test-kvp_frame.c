@@ -1455,6 +1455,109 @@ test_get_trailer_or_null( Fixture *fixture, gconstpointer pData )
     g_assert_cmpstr( last_key, == , "test2" );
 }
 
+static void
+test_kvp_frame_append_key( const gchar *key, KvpValue *value, gpointer data )
+{
+    g_string_append_printf( (GString *) data, "%s=%" G_GINT64_FORMAT ",",
+                            key, kvp_value_get_gint64( value ) );
+}
+
+static void
+test_kvp_frame_many_slots( Fixture *fixture, gconstpointer pData )
+{
+    /* small frames keep their slots in a sorted array, bigger ones in a hash */
+    static const gchar *keys[] = { "k", "c", "m", "a", "e", "i", "g", "b",
+                                   "l", "d", "j", "f", "h"
+                                 };
+    GString *order = g_string_new( NULL );
+    KvpFrame *copy;
+    guint i, n = G_N_ELEMENTS( keys );
+
+    g_assert( fixture->frame );
+    g_assert( kvp_frame_is_empty( fixture->frame ) );
+
+    g_test_message( "Test slots are found while the frame grows" );
+    for ( i = 0; i < n; i++ )
+    {
+        guint j;
+        kvp_frame_set_gint64( fixture->frame, keys[i], i );
+        for ( j = 0; j <= i; j++ )
+            g_assert_cmpint( kvp_frame_get_gint64( fixture->frame, keys[j] ), == , j );
+        g_assert( kvp_frame_get_slot( fixture->frame, "z" ) == NULL );
+    }
+
+    g_test_message( "Test sorted traversal" );
+    kvp_frame_for_each_slot_sorted( fixture->frame, test_kvp_frame_append_key, order );
+    g_assert_cmpstr( order->str, == , "a=3,b=7,c=1,d=9,e=4,f=11,g=6,h=12,i=5,j=10,k=0,l=8,m=2," );
+
+    g_test_message( "Test copy and compare" );
+    copy = kvp_frame_copy( fixture->frame );
+    g_assert_cmpint( kvp_frame_compare( fixture->frame, copy ), == , 0 );
+    kvp_frame_set_gint64( copy, "m", 20 );
+    g_assert_cmpint( kvp_frame_compare( fixture->frame, copy ), != , 0 );
+
+    g_test_message( "Test removing all slots empties the frame" );
+    for ( i = 0; i < n; i++ )
+    {
+        kvp_frame_set_slot_nc( fixture->frame, keys[i], NULL );
+        g_assert( kvp_frame_get_slot( fixture->frame, keys[i] ) == NULL );
+    }
+    g_assert( kvp_frame_is_empty( fixture->frame ) );
+
+    g_test_message( "Test a small frame" );
+    kvp_frame_set_gint64( copy, "/x/b", 2 );
+    kvp_frame_set_gint64( copy, "/x/a", 1 );
+    kvp_frame_set_value_nc( copy, "x/b", NULL );
+    g_assert_cmpint( kvp_frame_get_gint64( copy, "x/a" ), == , 1 );
+    g_assert( kvp_frame_get_slot_path( copy, "x", "b", NULL ) == NULL );
+    g_string_truncate( order, 0 );
+    kvp_frame_for_each_slot_sorted( kvp_frame_get_frame( copy, "x" ),
+                                    test_kvp_frame_append_key, order );
+    g_assert_cmpstr( order->str, == , "a=1," );
+
+    kvp_frame_delete( copy );
+    g_string_free( order, TRUE );
+}
+
+static void
+test_kvp_path( Fixture *fixture, gconstpointer pData )
+{
+    KvpPath *notes = kvp_path_new( "notes" );
+    KvpPath *deep = kvp_path_new( "/a//b/c/" );
+    KvpPath *empty = kvp_path_new( "/" );
+
+    g_assert( fixture->frame );
+    g_assert( kvp_frame_is_empty( fixture->frame ) );
+
+    g_test_message( "Test paths that are not there" );
+    g_assert( kvp_frame_get_value_at( fixture->frame, notes ) == NULL );
+    g_assert( kvp_frame_get_value_at( fixture->frame, deep ) == NULL );
+    g_assert( kvp_frame_get_value_at( NULL, notes ) == NULL );
+    g_assert( kvp_frame_get_value_at( fixture->frame, empty ) == NULL );
+    g_assert( kvp_frame_set_value_at_nc( fixture->frame, empty, NULL ) == NULL );
+
+    g_test_message( "Test values set with a handle are found by path and back" );
+    kvp_frame_set_string_at( fixture->frame, notes, "a note" );
+    g_assert_cmpstr( kvp_frame_get_string( fixture->frame, "notes" ), == , "a note" );
+    kvp_frame_set_string( fixture->frame, "a/b/c", "deep" );
+    g_assert_cmpstr( kvp_frame_get_string_at( fixture->frame, deep ), == , "deep" );
+    kvp_frame_set_string_at( fixture->frame, deep, "deeper" );
+    g_assert_cmpstr( kvp_frame_get_string( fixture->frame, "a/b/c" ), == , "deeper" );
+
+    g_test_message( "Test the frames along the path are created" );
+    kvp_frame_set_slot_nc( fixture->frame, "a", NULL );
+    kvp_frame_set_string_at( fixture->frame, deep, "again" );
+    g_assert_cmpstr( kvp_frame_get_string( fixture->frame, "a/b/c" ), == , "again" );
+
+    g_test_message( "Test a NULL string removes the slot" );
+    kvp_frame_set_string_at( fixture->frame, notes, NULL );
+    g_assert( kvp_frame_get_slot( fixture->frame, "notes" ) == NULL );
+
+    kvp_path_free( notes );
+    kvp_path_free( deep );
+    kvp_path_free( empty );
+}
+
 void
 test_suite_kvp_frame( void )
 {
@@ -1477,6 +1580,8 @@ test_suite_kvp_frame( void )
     GNC_TEST_ADD( suitename, "kvp frame set slot path", Fixture, NULL, setup, test_kvp_frame_set_slot_path, teardown );
     GNC_TEST_ADD( suitename, "kvp frame set slot path gslist", Fixture, NULL, setup, test_kvp_frame_set_slot_path_gslist, teardown );
     GNC_TEST_ADD( suitename, "kvp frame replace slot nc", Fixture, NULL, setup, test_kvp_frame_replace_slot_nc, teardown );
+    GNC_TEST_ADD( suitename, "kvp frame many slots", Fixture, NULL, setup, test_kvp_frame_many_slots, teardown );
+    GNC_TEST_ADD( suitename, "kvp path", Fixture, NULL, setup, test_kvp_path, teardown );
     GNC_TEST_ADD( suitename, "get trailer make", Fixture, NULL, setup_static, test_get_trailer_make, teardown_static );
     GNC_TEST_ADD( suitename, "kvp value glist to string", Fixture, NULL, setup_static, test_kvp_value_glist_to_string, teardown_static );
     GNC_TEST_ADD( suitename, "get or make", Fixture, NULL, setup_static, test_get_or_make, teardown_static );
@@ -26,27 +26,33 @@
 #include "qof.h"
 
 extern void test_suite_qofbook();
+extern void test_suite_qofevent();
 extern void test_suite_qofinstance();
 extern void test_suite_kvp_frame();
 extern void test_suite_qofobject();
 extern void test_suite_qofsession();
 extern void test_suite_gnc_date();
+extern void test_suite_guid();
 
 int
 main (int   argc,
       char *argv[])
 {
+    if (!g_thread_supported ())
+        g_thread_init (NULL);		/* The guid tests use threads */
     g_type_init(); 			/* Initialize the GObject system */
     g_test_init ( &argc, &argv, NULL ); 	/* initialize test program */
     qof_log_init_filename_special("stderr"); /* Init the log system */
     g_test_bug_base("https://bugzilla.gnome.org/show_bug.cgi?id="); /* init the bugzilla URL */
 
     test_suite_qofbook();
+    test_suite_qofevent();
     test_suite_qofinstance();
     test_suite_kvp_frame();
     test_suite_qofobject();
     test_suite_qofsession();
     test_suite_gnc_date();
+    test_suite_guid();
 
     return g_test_run( );
 }
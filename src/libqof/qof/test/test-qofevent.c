@@ -0,0 +1,204 @@
+/********************************************************************
+ * test-qofevent.c: GLib g_test test suite for qofevent.c.	    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include "config.h"
+#include <glib.h>
+#include "qof.h"
+#include "test-stuff.h"
+
+static const gchar *suitename = "/qof/qofevent";
+void test_suite_qofevent ( void );
+
+typedef struct
+{
+    QofBook *book;
+    QofInstance *inst;
+    QofInstance *other;
+    GList *events;      /* of GINT_TO_POINTER(event id), in order */
+    gint handler_id;
+} Fixture;
+
+static void
+event_handler (QofInstance *ent, QofEventId event_type,
+               gpointer handler_data, gpointer event_data)
+{
+    Fixture *fixture = handler_data;
+    fixture->events = g_list_append (fixture->events,
+                                     GINT_TO_POINTER (event_type));
+}
+
+static void
+setup( Fixture *fixture, gconstpointer pData )
+{
+    fixture->book = qof_book_new ();
+    fixture->inst = g_object_new (QOF_TYPE_INSTANCE, NULL);
+    qof_instance_init_data (fixture->inst, "TestA", fixture->book);
+    fixture->other = g_object_new (QOF_TYPE_INSTANCE, NULL);
+    qof_instance_init_data (fixture->other, "TestB", fixture->book);
+    fixture->events = NULL;
+    fixture->handler_id = 0;
+}
+
+static void
+teardown( Fixture *fixture, gconstpointer pData )
+{
+    if (fixture->handler_id)
+        qof_event_unregister_handler (fixture->handler_id);
+    g_list_free (fixture->events);
+    g_object_unref (fixture->inst);
+    g_object_unref (fixture->other);
+    qof_book_destroy (fixture->book);
+}
+
+static void
+test_event_filtered_handler( Fixture *fixture, gconstpointer pData )
+{
+    guint delivered_before, delivered_after;
+
+    fixture->handler_id = qof_event_register_filtered_handler
+                          (event_handler, fixture, "TestA",
+                           QOF_EVENT_MODIFY | QOF_EVENT_DESTROY);
+
+    qof_event_get_stats (NULL, &delivered_before, NULL);
+    g_test_message( "Events of other types and kinds are not delivered" );
+    qof_event_gen (fixture->other, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_ADD, NULL);
+    g_assert (fixture->events == NULL);
+
+    g_test_message( "Events of interest are delivered" );
+    qof_event_gen (fixture->inst, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_DESTROY, NULL);
+    g_assert_cmpint (g_list_length (fixture->events), == , 2);
+    qof_event_get_stats (NULL, &delivered_after, NULL);
+    g_assert_cmpint (delivered_after - delivered_before, >= , 2);
+}
+
+static void
+test_event_batch_coalesces( Fixture *fixture, gconstpointer pData )
+{
+    guint coalesced_before, coalesced_after;
+    gint i;
+
+    fixture->handler_id = qof_event_register_handler (event_handler, fixture);
+    qof_event_get_stats (NULL, NULL, &coalesced_before);
+
+    qof_event_batch ();
+    qof_event_gen (fixture->inst, QOF_EVENT_CREATE, NULL);
+    for (i = 0; i < 10; i++)
+        qof_event_gen (fixture->inst, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_ADD, NULL);
+    g_test_message( "Nothing is delivered during the batch" );
+    g_assert (fixture->events == NULL);
+    qof_event_resume ();
+
+    g_test_message( "The modifications are delivered once, in order" );
+    g_assert_cmpint (g_list_length (fixture->events), == , 3);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 0)),
+                     == , QOF_EVENT_CREATE);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 1)),
+                     == , QOF_EVENT_MODIFY);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 2)),
+                     == , QOF_EVENT_ADD);
+    qof_event_get_stats (NULL, NULL, &coalesced_after);
+    g_assert_cmpint (coalesced_after - coalesced_before, == , 9);
+}
+
+static void
+test_event_batch_nesting( Fixture *fixture, gconstpointer pData )
+{
+    fixture->handler_id = qof_event_register_handler (event_handler, fixture);
+
+    qof_event_batch ();
+    qof_event_batch ();
+    qof_event_gen (fixture->inst, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    g_test_message( "An inner resume does not end the batch" );
+    g_assert (fixture->events == NULL);
+
+    g_test_message( "Events are dropped in a suspend within a batch" );
+    qof_event_suspend ();
+    qof_event_gen (fixture->other, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    qof_event_resume ();
+    g_assert_cmpint (g_list_length (fixture->events), == , 1);
+}
+
+static void
+test_event_batch_destroy( Fixture *fixture, gconstpointer pData )
+{
+    fixture->handler_id = qof_event_register_handler (event_handler, fixture);
+
+    qof_event_batch ();
+    qof_event_gen (fixture->inst, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->other, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_DESTROY, NULL);
+    g_test_message( "A destroy event is delivered at once" );
+    g_assert_cmpint (g_list_length (fixture->events), == , 1);
+    g_assert_cmpint (GPOINTER_TO_INT (fixture->events->data),
+                     == , QOF_EVENT_DESTROY);
+    qof_event_resume ();
+
+    g_test_message( "The events held for the destroyed entity are gone" );
+    g_assert_cmpint (g_list_length (fixture->events), == , 2);
+    g_assert_cmpint (GPOINTER_TO_INT (fixture->events->next->data),
+                     == , QOF_EVENT_MODIFY);
+}
+
+static void
+test_event_batch_data_order( Fixture *fixture, gconstpointer pData )
+{
+    gint data = 0;
+
+    fixture->handler_id = qof_event_register_handler (event_handler, fixture);
+
+    qof_event_batch ();
+    qof_event_gen (fixture->other, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_CREATE, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_ADD, NULL);
+    qof_event_gen (fixture->inst, QOF_EVENT_REMOVE, &data);
+    g_test_message( "An event with data goes after the ones held for its entity" );
+    g_assert_cmpint (g_list_length (fixture->events), == , 3);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 0)),
+                     == , QOF_EVENT_CREATE);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 1)),
+                     == , QOF_EVENT_ADD);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 2)),
+                     == , QOF_EVENT_REMOVE);
+
+    g_test_message( "The events of other entities are still held" );
+    qof_event_gen (fixture->inst, QOF_EVENT_MODIFY, NULL);
+    g_assert_cmpint (g_list_length (fixture->events), == , 3);
+    qof_event_resume ();
+    g_assert_cmpint (g_list_length (fixture->events), == , 5);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 3)),
+                     == , QOF_EVENT_MODIFY);
+    g_assert_cmpint (GPOINTER_TO_INT (g_list_nth_data (fixture->events, 4)),
+                     == , QOF_EVENT_MODIFY);
+}
+
+void
+test_suite_qofevent (void)
+{
+    GNC_TEST_ADD( suitename, "filtered handler", Fixture, NULL, setup, test_event_filtered_handler, teardown );
+    GNC_TEST_ADD( suitename, "batch coalesces", Fixture, NULL, setup, test_event_batch_coalesces, teardown );
+    GNC_TEST_ADD( suitename, "batch nesting", Fixture, NULL, setup, test_event_batch_nesting, teardown );
+    GNC_TEST_ADD( suitename, "batch destroy", Fixture, NULL, setup, test_event_batch_destroy, teardown );
+    GNC_TEST_ADD( suitename, "batch data order", Fixture, NULL, setup, test_event_batch_data_order, teardown );
+}